@@ -0,0 +1,396 @@
+#ifndef ML_BENCHMARK_HARNESS_HPP
+#define ML_BENCHMARK_HARNESS_HPP
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <cstdlib>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+/**
+ * @file BenchmarkHarness.hpp
+ * @brief Minimal timing, allocation and memory harness for the benchmark suite.
+ *
+ * Allocation counts are only collected if the program replaces the global operator new and
+ * reports to bench::allocation_counters(). Defining BENCH_COUNT_ALLOCATIONS before including
+ * this header does so; exactly one translation unit of a program may define it.
+ */
+
+namespace bench {
+
+/**
+ * @brief Process-wide allocation counters fed by the replaced global operator new.
+ */
+struct AllocationCounters {
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> bytes{0};
+};
+
+inline AllocationCounters& allocation_counters() {
+    static AllocationCounters counters;
+    return counters;
+}
+
+/**
+ * @brief Keeps the compiler from discarding a computed value.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @brief Resets the peak resident set size, where the platform allows it.
+ * @return True if later peak_rss_kb() readings cover only the time since the reset.
+ */
+inline bool reset_peak_rss() {
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    return static_cast<bool>(clear_refs.flush());
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Peak resident set size of the process in KiB, or -1 if unavailable.
+ */
+inline long peak_rss_kb() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    return -1;
+#elif defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<long>(usage.ru_maxrss / 1024);
+#elif defined(__unix__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<long>(usage.ru_maxrss);
+#else
+    return -1;
+#endif
+}
+
+/**
+ * @brief Command line options of the benchmark runner.
+ */
+struct Options {
+    double scale = 1.0;          ///< Multiplier applied to every dataset size
+    std::size_t repetitions = 5; ///< Timed repetitions of each batch benchmark
+    std::size_t queries = 200;   ///< Timed single-sample calls of each latency benchmark
+    std::size_t threads = 0;     ///< Worker threads given to estimators; 0 runs serially
+    std::string filter;          ///< Only benchmarks whose name contains this string run
+    std::string output;          ///< JSON output file; empty writes to stdout
+};
+
+/**
+ * @brief Benchmark parameters, reported verbatim in the JSON output.
+ */
+using Params = std::vector<std::pair<std::string, double>>;
+
+/**
+ * @brief Measurements of one benchmark case.
+ */
+struct Result {
+    std::string name;
+    Params params;
+    std::size_t items_per_call = 0;
+    std::vector<double> seconds;
+    double allocations_per_call = 0.0;
+    double allocated_bytes_per_call = 0.0;
+    long peak_rss_kb = -1;
+    bool peak_rss_is_per_case = false;
+};
+
+/**
+ * @class Runner
+ * @brief Runs benchmark cases, collects their measurements and writes them as JSON.
+ */
+class Runner {
+public:
+    explicit Runner(Options options) : options_(std::move(options)) {}
+
+    const Options& options() const { return options_; }
+
+    /**
+     * @brief Whether a benchmark name passes the --filter option.
+     */
+    bool enabled(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    /**
+     * @brief Scales a base dataset size by the --scale option.
+     */
+    std::size_t scaled(std::size_t base, std::size_t minimum = 16) const {
+        return std::max(minimum, static_cast<std::size_t>(std::llround(base * options_.scale)));
+    }
+
+    /**
+     * @brief Times body() options().repetitions times; each call processes items rows.
+     *
+     * Intended for fit and batch predict, where every call is expensive enough to time alone.
+     */
+    template <typename F>
+    void run_batch(const std::string& name, Params params, std::size_t items, F&& body) {
+        if (!enabled(name)) {
+            return;
+        }
+        measure(name, std::move(params), items, options_.repetitions, 0, [&](std::size_t) { body(); });
+    }
+
+    /**
+     * @brief Times options().queries single calls body(i); each call processes one row.
+     *
+     * Intended for single-sample predict latency. A few untimed calls warm the caches first.
+     */
+    template <typename F>
+    void run_latency(const std::string& name, Params params, F&& body) {
+        if (!enabled(name)) {
+            return;
+        }
+        measure(name, std::move(params), 1, options_.queries, 10, std::forward<F>(body));
+    }
+
+    /**
+     * @brief Writes all results and the run configuration as a JSON document.
+     */
+    void write_json(std::ostream& os) const {
+        os << std::setprecision(9);
+        os << "{\n  \"context\": {";
+        os << "\"scale\": " << options_.scale;
+        os << ", \"repetitions\": " << options_.repetitions;
+        os << ", \"queries\": " << options_.queries;
+        os << ", \"threads\": " << options_.threads;
+        os << ", \"hardware_concurrency\": " << std::thread::hardware_concurrency();
+#ifdef NDEBUG
+        os << ", \"build\": \"release\"";
+#else
+        os << ", \"build\": \"debug\"";
+#endif
+        os << "},\n  \"benchmarks\": [";
+        for (std::size_t r = 0; r < results_.size(); ++r) {
+            const Result& result = results_[r];
+            std::vector<double> sorted = result.seconds;
+            std::sort(sorted.begin(), sorted.end());
+            double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+            double mean = total / sorted.size();
+
+            os << (r == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name << "\", \"params\": {";
+            for (std::size_t p = 0; p < result.params.size(); ++p) {
+                os << (p == 0 ? "" : ", ") << '"' << result.params[p].first << "\": " << result.params[p].second;
+            }
+            os << "}, \"calls\": " << sorted.size();
+            os << ", \"items_per_call\": " << result.items_per_call;
+            os << ", \"throughput_items_per_s\": " << (total > 0.0 ? result.items_per_call * sorted.size() / total : 0.0);
+            os << ", \"latency_s\": {\"mean\": " << mean
+               << ", \"min\": " << sorted.front()
+               << ", \"p50\": " << percentile(sorted, 0.50)
+               << ", \"p90\": " << percentile(sorted, 0.90)
+               << ", \"p99\": " << percentile(sorted, 0.99)
+               << ", \"max\": " << sorted.back() << "}";
+            os << ", \"allocations_per_call\": " << result.allocations_per_call;
+            os << ", \"allocated_bytes_per_call\": " << result.allocated_bytes_per_call;
+            os << ", \"peak_rss_kb\": ";
+            if (result.peak_rss_kb < 0) {
+                os << "null";
+            } else {
+                os << result.peak_rss_kb;
+            }
+            os << ", \"peak_rss_scope\": \"" << (result.peak_rss_is_per_case ? "case" : "process") << "\"}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+private:
+    /**
+     * @brief Nearest-rank percentile of sorted samples.
+     */
+    static double percentile(const std::vector<double>& sorted, double q) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(q * sorted.size()));
+        return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+
+    template <typename F>
+    void measure(const std::string& name, Params params, std::size_t items, std::size_t calls,
+                 std::size_t warmup, F&& body) {
+        using Clock = std::chrono::steady_clock;
+        calls = std::max<std::size_t>(1, calls);
+        for (std::size_t i = 0; i < warmup; ++i) {
+            body(i % calls);
+        }
+
+        Result result;
+        result.name = name;
+        result.params = std::move(params);
+        result.items_per_call = items;
+        result.seconds.reserve(calls);
+        result.peak_rss_is_per_case = reset_peak_rss();
+
+        AllocationCounters& counters = allocation_counters();
+        std::uint64_t count_before = counters.count.load(std::memory_order_relaxed);
+        std::uint64_t bytes_before = counters.bytes.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < calls; ++i) {
+            auto start = Clock::now();
+            body(i);
+            auto stop = Clock::now();
+            result.seconds.push_back(std::chrono::duration<double>(stop - start).count());
+        }
+        // The reserved sample buffer above does not allocate inside the loop
+        result.allocations_per_call =
+            static_cast<double>(counters.count.load(std::memory_order_relaxed) - count_before) / calls;
+        result.allocated_bytes_per_call =
+            static_cast<double>(counters.bytes.load(std::memory_order_relaxed) - bytes_before) / calls;
+        result.peak_rss_kb = peak_rss_kb();
+
+        std::vector<double> sorted = result.seconds;
+        std::sort(sorted.begin(), sorted.end());
+        std::ostringstream line;
+        line << std::left << std::setw(44) << name;
+        for (const auto& param : result.params) {
+            line << ' ' << param.first << '=' << param.second;
+        }
+        line << "  p50=" << percentile(sorted, 0.5) * 1e3 << "ms";
+        std::cerr << line.str() << std::endl;
+
+        results_.push_back(std::move(result));
+    }
+
+    Options options_;
+    std::vector<Result> results_;
+};
+
+} // namespace bench
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+
+// Count every heap allocation. Every form of the global operators is replaced, so array, aligned
+// and nothrow allocations are counted too.
+namespace bench {
+namespace detail {
+
+constexpr std::size_t default_alignment = alignof(std::max_align_t);
+
+inline void* counted_allocate(std::size_t size, std::size_t alignment) noexcept {
+    AllocationCounters& counters = allocation_counters();
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+    if (alignment <= default_alignment) {
+        return std::malloc(size);
+    }
+#ifdef _MSC_VER
+    return _aligned_malloc(size, alignment);
+#else
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+// Kept out of line: once free() is inlined into operator delete, GCC pairs it with the operator
+// new at the call site and reports a mismatched deallocation (-Wmismatched-new-delete)
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline))
+#elif defined(_MSC_VER)
+__declspec(noinline)
+#endif
+inline void counted_free(void* ptr, std::size_t alignment) noexcept {
+#ifdef _MSC_VER
+    if (alignment > default_alignment) {
+        _aligned_free(ptr);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    std::free(ptr);
+}
+
+inline void* counted_new(std::size_t size, std::size_t alignment) {
+    if (void* ptr = counted_allocate(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace detail
+} // namespace bench
+
+void* operator new(std::size_t size) { return bench::detail::counted_new(size, bench::detail::default_alignment); }
+void* operator new[](std::size_t size) { return bench::detail::counted_new(size, bench::detail::default_alignment); }
+void* operator new(std::size_t size, std::align_val_t al) {
+    return bench::detail::counted_new(size, static_cast<std::size_t>(al));
+}
+void* operator new[](std::size_t size, std::align_val_t al) {
+    return bench::detail::counted_new(size, static_cast<std::size_t>(al));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return bench::detail::counted_allocate(size, bench::detail::default_alignment);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return bench::detail::counted_allocate(size, bench::detail::default_alignment);
+}
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return bench::detail::counted_allocate(size, static_cast<std::size_t>(al));
+}
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return bench::detail::counted_allocate(size, static_cast<std::size_t>(al));
+}
+
+void operator delete(void* ptr) noexcept { bench::detail::counted_free(ptr, bench::detail::default_alignment); }
+void operator delete[](void* ptr) noexcept { bench::detail::counted_free(ptr, bench::detail::default_alignment); }
+void operator delete(void* ptr, std::size_t) noexcept { bench::detail::counted_free(ptr, bench::detail::default_alignment); }
+void operator delete[](void* ptr, std::size_t) noexcept { bench::detail::counted_free(ptr, bench::detail::default_alignment); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    bench::detail::counted_free(ptr, bench::detail::default_alignment);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    bench::detail::counted_free(ptr, bench::detail::default_alignment);
+}
+void operator delete(void* ptr, std::align_val_t al) noexcept { bench::detail::counted_free(ptr, static_cast<std::size_t>(al)); }
+void operator delete[](void* ptr, std::align_val_t al) noexcept { bench::detail::counted_free(ptr, static_cast<std::size_t>(al)); }
+void operator delete(void* ptr, std::size_t, std::align_val_t al) noexcept {
+    bench::detail::counted_free(ptr, static_cast<std::size_t>(al));
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t al) noexcept {
+    bench::detail::counted_free(ptr, static_cast<std::size_t>(al));
+}
+void operator delete(void* ptr, std::align_val_t al, const std::nothrow_t&) noexcept {
+    bench::detail::counted_free(ptr, static_cast<std::size_t>(al));
+}
+void operator delete[](void* ptr, std::align_val_t al, const std::nothrow_t&) noexcept {
+    bench::detail::counted_free(ptr, static_cast<std::size_t>(al));
+}
+
+#endif // BENCH_COUNT_ALLOCATIONS
+
+#endif // ML_BENCHMARK_HARNESS_HPP
@@ -0,0 +1,634 @@
+// Count every heap allocation made by the library while a benchmark runs
+#define BENCH_COUNT_ALLOCATIONS
+#include "BenchmarkHarness.hpp"
+#include "DataGenerators.hpp"
+#include "CodegenModels.hpp"
+#include "../ml_library_include/ml/core/ThreadPool.hpp"
+#include "../ml_library_include/ml/core/Kernels.hpp"
+#include "../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../ml_library_include/ml/tree/DecisionTreeRegressor.hpp"
+#include "../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include "../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+#include "../ml_library_include/ml/tree/GradientBoostingClassifier.hpp"
+#include "../ml_library_include/ml/tree/GradientBoostingRegressor.hpp"
+#include "../ml_library_include/ml/clustering/KMeans.hpp"
+#include "../ml_library_include/ml/clustering/KNNClassifier.hpp"
+#include "../ml_library_include/ml/clustering/KNNRegressor.hpp"
+#include "../ml_library_include/ml/clustering/HierarchicalClustering.hpp"
+#include "../ml_library_include/ml/regression/SupportVectorRegression.hpp"
+#include "../ml_library_include/ml/regression/LogisticRegression.hpp"
+#include "../ml_library_include/ml/regression/MultiLinearRegression.hpp"
+#include "../ml_library_include/ml/regression/PolynomialRegression.hpp"
+#include "../ml_library_include/ml/neural_network/NeuralNetwork.hpp"
+#include "../ml_library_include/ml/association/Apriori.hpp"
+#include "../ml_library_include/ml/association/Eclat.hpp"
+#include "../ml_library_include/ml/io/Csv.hpp"
+#include "../ml_library_include/ml/io/ColumnarFile.hpp"
+#include "generated_tree.hpp"
+#include "generated_forest.hpp"
+#include "generated_forest_tables.hpp"
+#include "generated_forest_classifier.hpp"
+#include <filesystem>
+#include <span>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+/**
+ * @brief Returns a view of the first count rows, used as the prediction batch.
+ */
+ml::MatrixView head(const ml::Matrix& X, std::size_t count) {
+    return X.view().row_block(0, std::min(count, X.rows()));
+}
+
+std::vector<double> row_vector(const ml::Matrix& X, std::size_t i) {
+    return std::vector<double>(X.row(i), X.row(i) + X.cols());
+}
+
+void bench_decision_trees(bench::Runner& runner) {
+    struct Shape { std::size_t n, d; double sparsity; };
+    for (Shape shape : {Shape{500, 4, 0.0}, Shape{2000, 4, 0.0}, Shape{2000, 16, 0.0}, Shape{2000, 16, 0.5}}) {
+        std::size_t n = runner.scaled(shape.n);
+        bench::Params params = {{"n", double(n)}, {"d", double(shape.d)}, {"sparsity", shape.sparsity}, {"max_depth", 8}};
+
+        auto cls = bench::make_classification(n, shape.d, 4, shape.sparsity, 1);
+        runner.run_batch("DecisionTreeClassifier/fit", params, n, [&] {
+            DecisionTreeClassifier model(8);
+            model.fit(cls.X, cls.y);
+            bench::do_not_optimize(model);
+        });
+        DecisionTreeClassifier classifier(8);
+        classifier.fit(cls.X, cls.y);
+        runner.run_batch("DecisionTreeClassifier/predict", params, n, [&] {
+            bench::do_not_optimize(classifier.predict(cls.X.view()));
+        });
+        runner.run_latency("DecisionTreeClassifier/predict_one", params, [&](std::size_t i) {
+            bench::do_not_optimize(classifier.predict(cls.X.view().row_block(i % n, 1)));
+        });
+
+        auto reg = bench::make_regression(n, shape.d, shape.sparsity, 2);
+        runner.run_batch("DecisionTreeRegressor/fit", params, n, [&] {
+            DecisionTreeRegressor model(8);
+            model.fit(reg.X, reg.y);
+            bench::do_not_optimize(model);
+        });
+        DecisionTreeRegressor regressor(8);
+        regressor.fit(reg.X, reg.y);
+        runner.run_batch("DecisionTreeRegressor/predict", params, n, [&] {
+            bench::do_not_optimize(regressor.predict(reg.X.view()));
+        });
+        runner.run_latency("DecisionTreeRegressor/predict_one", params, [&](std::size_t i) {
+            bench::do_not_optimize(regressor.predict(reg.X.view().row_block(i % n, 1)));
+        });
+    }
+}
+
+void bench_random_forests(bench::Runner& runner, ml::ThreadPool* pool) {
+    const std::size_t d = 8;
+    for (std::size_t base_n : {500, 2000}) {
+        for (int n_estimators : {16, 64}) {
+            std::size_t n = runner.scaled(base_n);
+            bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"n_estimators", double(n_estimators)}, {"max_depth", 6}};
+
+            auto cls = bench::make_classification(n, d, 4, 0.0, 3);
+            runner.run_batch("RandomForestClassifier/fit", params, n, [&] {
+                RandomForestClassifier model(n_estimators, 6);
+                model.set_thread_pool(pool);
+                model.fit(cls.X, cls.y);
+                bench::do_not_optimize(model);
+            });
+            RandomForestClassifier classifier(n_estimators, 6);
+            classifier.set_thread_pool(pool);
+            classifier.fit(cls.X, cls.y);
+            runner.run_batch("RandomForestClassifier/predict", params, n, [&] {
+                bench::do_not_optimize(classifier.predict(cls.X.view()));
+            });
+            runner.run_latency("RandomForestClassifier/predict_one", params, [&](std::size_t i) {
+                bench::do_not_optimize(classifier.predict(cls.X.view().row_block(i % n, 1)));
+            });
+            int label = 0;
+            runner.run_latency("RandomForestClassifier/predict_into_one", params, [&](std::size_t i) {
+                classifier.predict_into(cls.X.view().row_block(i % n, 1), std::span<int>(&label, 1));
+                bench::do_not_optimize(label);
+            });
+
+            auto reg = bench::make_regression(n, d, 0.0, 4);
+            runner.run_batch("RandomForestRegressor/fit", params, n, [&] {
+                RandomForestRegressor model(n_estimators, 6);
+                model.set_thread_pool(pool);
+                model.fit(reg.X, reg.y);
+                bench::do_not_optimize(model);
+            });
+            RandomForestRegressor regressor(n_estimators, 6);
+            regressor.set_thread_pool(pool);
+            regressor.fit(reg.X, reg.y);
+            runner.run_batch("RandomForestRegressor/predict", params, n, [&] {
+                bench::do_not_optimize(regressor.predict(reg.X.view()));
+            });
+            runner.run_latency("RandomForestRegressor/predict_one", params, [&](std::size_t i) {
+                bench::do_not_optimize(regressor.predict(reg.X.view().row_block(i % n, 1)));
+            });
+        }
+    }
+}
+
+void bench_gradient_boosting(bench::Runner& runner, ml::ThreadPool* pool) {
+    const std::size_t d = 8;
+    const int n_estimators = 100;
+    for (std::size_t base_n : {2000, 20000}) {
+        std::size_t n = runner.scaled(base_n);
+        bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"n_estimators", double(n_estimators)}, {"max_depth", 3}};
+
+        auto cls = bench::make_classification(n, d, 4, 0.0, 3);
+        runner.run_batch("GradientBoostingClassifier/fit", params, n, [&] {
+            GradientBoostingClassifier model(n_estimators, 0.1, 3, 2, -1, 1);
+            model.set_thread_pool(pool);
+            model.fit(cls.X, cls.y);
+            bench::do_not_optimize(model);
+        });
+        GradientBoostingClassifier classifier(n_estimators, 0.1, 3, 2, -1, 1);
+        classifier.set_thread_pool(pool);
+        classifier.fit(cls.X, cls.y);
+        runner.run_batch("GradientBoostingClassifier/predict", params, n, [&] {
+            bench::do_not_optimize(classifier.predict(cls.X.view()));
+        });
+        int label = 0;
+        runner.run_latency("GradientBoostingClassifier/predict_into_one", params, [&](std::size_t i) {
+            classifier.predict_into(cls.X.view().row_block(i % n, 1), std::span<int>(&label, 1));
+            bench::do_not_optimize(label);
+        });
+
+        auto reg = bench::make_regression(n, d, 0.0, 4);
+        runner.run_batch("GradientBoostingRegressor/fit", params, n, [&] {
+            GradientBoostingRegressor model(n_estimators, 0.1, 3, 2, -1, 1);
+            model.set_thread_pool(pool);
+            model.fit(reg.X, reg.y);
+            bench::do_not_optimize(model);
+        });
+        GradientBoostingRegressor regressor(n_estimators, 0.1, 3, 2, -1, 1);
+        regressor.set_thread_pool(pool);
+        regressor.fit(reg.X, reg.y);
+        runner.run_batch("GradientBoostingRegressor/predict", params, n, [&] {
+            bench::do_not_optimize(regressor.predict(reg.X.view()));
+        });
+        double value = 0.0;
+        runner.run_latency("GradientBoostingRegressor/predict_into_one", params, [&](std::size_t i) {
+            regressor.predict_into(reg.X.view().row_block(i % n, 1), std::span<double>(&value, 1));
+            bench::do_not_optimize(value);
+        });
+    }
+}
+
+/**
+ * @brief Compares the interpreted predict path with code generated from the same models.
+ *
+ * The generated headers come from generate_tree_models at build time; the models are retrained
+ * here from the same seeds and must agree with them on every row before anything is timed.
+ */
+void bench_tree_codegen(bench::Runner& runner) {
+    using namespace bench::codegen;
+    auto reg = regression_data();
+    auto cls = classification_data();
+    DecisionTreeRegressor tree = tree_regressor();
+    tree.fit(reg.X, reg.y);
+    RandomForestRegressor forest = forest_regressor();
+    forest.fit(reg.X, reg.y);
+    RandomForestClassifier classifier = forest_classifier();
+    classifier.fit(cls.X, cls.y);
+
+    std::vector<double> tree_values = tree.predict(reg.X.view());
+    std::vector<double> forest_values = forest.predict(reg.X.view());
+    std::vector<int> labels = classifier.predict(cls.X.view());
+    for (std::size_t i = 0; i < rows; ++i) {
+        if (generated_tree::predict(reg.X.row(i)) != tree_values[i] ||
+            generated_forest::predict(reg.X.row(i)) != forest_values[i] ||
+            generated_forest_tables::predict(reg.X.row(i)) != forest_values[i] ||
+            generated_forest_classifier::predict(cls.X.row(i)) != labels[i]) {
+            throw std::runtime_error("Generated tree code disagrees with the model it was generated from.");
+        }
+    }
+
+    auto compare = [&](const std::string& name, const ml::Matrix& X, bench::Params params, auto interpreted,
+                       auto branches, auto tables) {
+        std::vector<double> out(rows);
+        runner.run_batch(name + "/interpreted", params, rows, [&] {
+            interpreted(X.view(), std::span<double>(out));
+            bench::do_not_optimize(out);
+        });
+        auto run_generated = [&](const std::string& style, auto predict) {
+            runner.run_batch(name + "/" + style, params, rows, [&] {
+                for (std::size_t i = 0; i < rows; ++i) {
+                    out[i] = predict(X.row(i));
+                }
+                bench::do_not_optimize(out);
+            });
+        };
+        run_generated("branches", branches);
+        if constexpr (!std::is_same_v<decltype(tables), std::nullptr_t>) {
+            run_generated("tables", tables);
+        }
+        double value = 0.0;
+        runner.run_latency(name + "/interpreted_one", params, [&](std::size_t i) {
+            interpreted(X.view().row_block(i % rows, 1), std::span<double>(&value, 1));
+            bench::do_not_optimize(value);
+        });
+        runner.run_latency(name + "/branches_one", params, [&](std::size_t i) {
+            bench::do_not_optimize(branches(X.row(i % rows)));
+        });
+    };
+
+    bench::Params params = {{"n", double(rows)}, {"d", double(features)}, {"max_depth", double(max_depth)}};
+    compare("TreeCodegen/DecisionTreeRegressor", reg.X, params,
+            [&](const ml::MatrixView& X, std::span<double> out) { tree.predict_into(X, out); },
+            generated_tree::predict, nullptr);
+
+    params.push_back({"n_estimators", double(n_estimators)});
+    compare("TreeCodegen/RandomForestRegressor", reg.X, params,
+            [&](const ml::MatrixView& X, std::span<double> out) { forest.predict_into(X, out); },
+            generated_forest::predict, generated_forest_tables::predict);
+
+    std::vector<int> predicted(rows);
+    compare("TreeCodegen/RandomForestClassifier", cls.X, params,
+            [&](const ml::MatrixView& X, std::span<double> out) {
+                std::span<int> labels_out(predicted.data(), X.rows());
+                classifier.predict_into(X, labels_out);
+                std::copy(labels_out.begin(), labels_out.end(), out.begin());
+            },
+            generated_forest_classifier::predict, nullptr);
+}
+
+void bench_nearest_neighbors(bench::Runner& runner, ml::ThreadPool* pool) {
+    for (std::size_t base_n : {2000, 10000}) {
+        for (std::size_t d : {8, 32}) {
+            std::size_t n = runner.scaled(base_n);
+            std::size_t batch = runner.scaled(200);
+            bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"k", 5}, {"batch", double(batch)}};
+
+            auto cls = bench::make_classification(n, d, 4, 0.0, 5);
+            runner.run_batch("KNNClassifier/fit", params, n, [&] {
+                KNNClassifier model(5);
+                model.fit(cls.X, cls.y);
+                bench::do_not_optimize(model);
+            });
+            KNNClassifier classifier(5);
+            classifier.set_thread_pool(pool);
+            classifier.fit(cls.X, cls.y);
+            runner.run_batch("KNNClassifier/predict", params, batch, [&] {
+                bench::do_not_optimize(classifier.predict(head(cls.X, batch)));
+            });
+            runner.run_latency("KNNClassifier/predict_one", params, [&](std::size_t i) {
+                bench::do_not_optimize(classifier.predict(cls.X.view().row_block(i % n, 1)));
+            });
+            int label = 0;
+            runner.run_latency("KNNClassifier/predict_into_one", params, [&](std::size_t i) {
+                classifier.predict_into(cls.X.view().row_block(i % n, 1), std::span<int>(&label, 1));
+                bench::do_not_optimize(label);
+            });
+
+            auto reg = bench::make_regression(n, d, 0.0, 6);
+            runner.run_batch("KNNRegressor/fit", params, n, [&] {
+                KNNRegressor model(5);
+                model.fit(reg.X, reg.y);
+                bench::do_not_optimize(model);
+            });
+            KNNRegressor regressor(5);
+            regressor.set_thread_pool(pool);
+            regressor.fit(reg.X, reg.y);
+            runner.run_batch("KNNRegressor/predict", params, batch, [&] {
+                bench::do_not_optimize(regressor.predict(head(reg.X, batch)));
+            });
+            runner.run_latency("KNNRegressor/predict_one", params, [&](std::size_t i) {
+                bench::do_not_optimize(regressor.predict(reg.X.view().row_block(i % n, 1)));
+            });
+        }
+    }
+}
+
+void bench_clustering(bench::Runner& runner, ml::ThreadPool* pool) {
+    for (std::size_t base_n : {5000, 20000}) {
+        for (std::size_t d : {8, 32}) {
+            std::size_t n = runner.scaled(base_n);
+            bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"k", 8}, {"max_iter", 50}};
+            auto data = bench::make_classification(n, d, 8, 0.0, 7);
+
+            runner.run_batch("KMeans/fit", params, n, [&] {
+                KMeans model(8, 50, 1e-4, 1);
+                model.set_thread_pool(pool);
+                model.fit(data.X);
+                bench::do_not_optimize(model);
+            });
+            KMeans model(8, 50, 1e-4, 1);
+            model.set_thread_pool(pool);
+            model.fit(data.X);
+            runner.run_batch("KMeans/predict", params, n, [&] {
+                bench::do_not_optimize(model.predict(data.X.view()));
+            });
+            runner.run_latency("KMeans/predict_one", params, [&](std::size_t i) {
+                bench::do_not_optimize(model.predict(data.X.view().row_block(i % n, 1)));
+            });
+        }
+    }
+
+    // Agglomerative clustering is cubic in n, so it is swept at much smaller sizes
+    for (std::size_t base_n : {100, 200}) {
+        std::size_t n = runner.scaled(base_n);
+        bench::Params params = {{"n", double(n)}, {"d", 8}, {"n_clusters", 4}};
+        auto data = bench::make_classification(n, 8, 4, 0.0, 8);
+        runner.run_batch("HierarchicalClustering/fit", params, n, [&] {
+            HierarchicalClustering model(4);
+            model.fit_view(data.X.view());
+            bench::do_not_optimize(model.predict());
+        });
+    }
+}
+
+void bench_svr(bench::Runner& runner) {
+    for (std::size_t base_n : {200, 500}) {
+        std::size_t n = runner.scaled(base_n);
+        bench::Params params = {{"n", double(n)}, {"d", 8}};
+        auto data = bench::make_regression(n, 8, 0.0, 9);
+
+        runner.run_batch("SupportVectorRegression/fit", params, n, [&] {
+            SupportVectorRegression model(1.0, 0.1, SupportVectorRegression::KernelType::RBF, 3, 0.1);
+            model.fit(data.X, data.y);
+            bench::do_not_optimize(model);
+        });
+        SupportVectorRegression model(1.0, 0.1, SupportVectorRegression::KernelType::RBF, 3, 0.1);
+        model.fit(data.X, data.y);
+        runner.run_batch("SupportVectorRegression/predict", params, n, [&] {
+            bench::do_not_optimize(model.predict(data.X.view()));
+        });
+        runner.run_latency("SupportVectorRegression/predict_one", params, [&](std::size_t i) {
+            bench::do_not_optimize(model.predict(data.X.view().row_block(i % n, 1)));
+        });
+    }
+}
+
+void bench_linear_models(bench::Runner& runner) {
+    for (std::size_t base_n : {2000, 10000}) {
+        for (std::size_t d : {8, 32}) {
+            std::size_t n = runner.scaled(base_n);
+            bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"iterations", 100}};
+
+            auto cls = bench::make_classification(n, d, 2, 0.0, 10);
+            runner.run_batch("LogisticRegression/fit", params, n, [&] {
+                LogisticRegression model(0.01, 100);
+                model.train(cls.X, cls.y);
+                bench::do_not_optimize(model);
+            });
+            LogisticRegression logistic(0.01, 100);
+            logistic.train(cls.X, cls.y);
+            runner.run_batch("LogisticRegression/predict", params, n, [&] {
+                bench::do_not_optimize(logistic.predict(cls.X.view()));
+            });
+            std::vector<double> sample = row_vector(cls.X, 0);
+            runner.run_latency("LogisticRegression/predict_one", params, [&](std::size_t) {
+                bench::do_not_optimize(logistic.predict(sample));
+            });
+
+            auto reg = bench::make_regression(n, d, 0.0, 11);
+            runner.run_batch("MultilinearRegression/fit", params, n, [&] {
+                MultilinearRegression model(0.01, 100);
+                model.train(reg.X, reg.y);
+                bench::do_not_optimize(model);
+            });
+            MultilinearRegression linear(0.01, 100);
+            linear.train(reg.X, reg.y);
+            runner.run_batch("MultilinearRegression/predict", params, n, [&] {
+                bench::do_not_optimize(linear.predict(reg.X.view()));
+            });
+            sample = row_vector(reg.X, 0);
+            runner.run_latency("MultilinearRegression/predict_one", params, [&](std::size_t) {
+                bench::do_not_optimize(linear.predict(sample));
+            });
+        }
+    }
+
+    for (std::size_t base_n : {10000, 100000}) {
+        for (int degree : {3, 8}) {
+            std::size_t n = runner.scaled(base_n);
+            bench::Params params = {{"n", double(n)}, {"degree", double(degree)}};
+            auto reg = bench::make_regression(n, 1, 0.0, 12);
+            std::vector<double> x(reg.X.data(), reg.X.data() + n);
+
+            runner.run_batch("PolynomialRegression/fit", params, n, [&] {
+                PolynomialRegression model(degree, 1e-6);
+                model.train(x, reg.y);
+                bench::do_not_optimize(model);
+            });
+            PolynomialRegression model(degree, 1e-6);
+            model.train(x, reg.y);
+            runner.run_latency("PolynomialRegression/predict_one", params, [&](std::size_t i) {
+                bench::do_not_optimize(model.predict(x[i % n]));
+            });
+        }
+    }
+}
+
+void bench_neural_network(bench::Runner& runner) {
+    for (std::size_t base_n : {1000, 5000}) {
+        for (unsigned hidden : {16u, 64u}) {
+            std::size_t n = runner.scaled(base_n);
+            const unsigned d = 8;
+            bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"hidden", double(hidden)}};
+            auto reg = bench::make_regression(n, d, 0.0, 13);
+            std::vector<std::vector<double>> inputs = reg.X.to_vectors();
+            std::vector<std::vector<double>> targets(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                targets[i] = {std::tanh(reg.y[i])};
+            }
+
+            // One epoch of online training
+            runner.run_batch("NeuralNetwork/fit_epoch", params, n, [&] {
+                NeuralNetwork net({d, hidden, 1});
+                for (std::size_t i = 0; i < n; ++i) {
+                    net.feedForward(inputs[i]);
+                    net.backProp(targets[i]);
+                }
+                bench::do_not_optimize(net);
+            });
+            NeuralNetwork net({d, hidden, 1});
+            std::vector<double> output;
+            runner.run_latency("NeuralNetwork/predict_one", params, [&](std::size_t i) {
+                net.feedForward(inputs[i % n]);
+                net.getResults(output);
+                bench::do_not_optimize(output);
+            });
+        }
+    }
+}
+
+void bench_association(bench::Runner& runner, ml::ThreadPool* pool) {
+    for (std::size_t base_n : {1000, 5000}) {
+        for (int items : {50, 100}) {
+            std::size_t n = runner.scaled(base_n);
+            bench::Params params = {{"transactions", double(n)}, {"items", double(items)}, {"min_support", 0.05}};
+            auto transactions = bench::make_transactions(n, items, 0.5, 14);
+
+            runner.run_batch("Apriori/run", params, n, [&] {
+                Apriori model(0.05);
+                model.set_thread_pool(pool);
+                bench::do_not_optimize(model.run(transactions));
+            });
+            runner.run_batch("Eclat/run", params, n, [&] {
+                Eclat model(0.05);
+                bench::do_not_optimize(model.run(transactions));
+            });
+        }
+    }
+}
+
+void bench_kernels(bench::Runner& runner, ml::ThreadPool* pool) {
+    ml::kernels::Isa detected = ml::kernels::detected_isa();
+    for (std::size_t d : {8, 64, 512}) {
+        std::size_t n = runner.scaled(4000);
+        auto data = bench::make_regression(n, d, 0.0, 16);
+        std::vector<double> distances(n);
+        for (ml::kernels::Isa isa : {ml::kernels::Isa::Scalar, ml::kernels::Isa::SSE2,
+                                     ml::kernels::Isa::AVX2, ml::kernels::Isa::AVX512}) {
+            if (isa > detected) {
+                continue;
+            }
+            ml::kernels::set_isa(isa);
+            bench::Params params = {{"n", double(n)}, {"d", double(d)}, {"isa", double(static_cast<int>(isa))}};
+            runner.run_batch("Kernels/squared_l2_one_to_many", params, n, [&] {
+                ml::kernels::squared_l2_one_to_many(data.X.row(0), data.X, distances.data());
+                bench::do_not_optimize(distances);
+            });
+            ml::MatrixView queries = head(data.X, 64);
+            runner.run_batch("Kernels/squared_l2_many_to_many", params, queries.rows() * n, [&] {
+                bench::do_not_optimize(ml::kernels::squared_l2_many_to_many(queries, data.X, pool));
+            });
+        }
+        ml::kernels::set_isa(detected);
+    }
+}
+
+void bench_io(bench::Runner& runner, ml::ThreadPool* pool) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string csv_path = (directory / "ml_benchmarks_io.csv").string();
+    std::string columnar_path = (directory / "ml_benchmarks_io.col").string();
+    for (std::size_t base_n : {20000, 100000}) {
+        std::size_t n = runner.scaled(base_n);
+        std::size_t d = 16;
+        bench::Params params = {{"n", double(n)}, {"d", double(d)}};
+        auto data = bench::make_regression(n, d, 0.0, 15);
+        {
+            std::ofstream csv(csv_path);
+            csv.precision(17);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < d; ++j) {
+                    csv << (j == 0 ? "" : ",") << data.X(i, j);
+                }
+                csv << '\n';
+            }
+        }
+        ml::io::write_columnar(columnar_path, data.X);
+
+        ml::io::CsvOptions options;
+        options.pool = pool;
+        runner.run_batch("Csv/read", params, n, [&] {
+            bench::do_not_optimize(ml::io::read_csv(csv_path, options));
+        });
+        runner.run_batch("Csv/read_batches", params, n, [&] {
+            ml::io::CsvBatchReader reader(csv_path, 4096, options);
+            ml::Matrix batch;
+            while (reader.next(batch)) {
+                bench::do_not_optimize(batch);
+            }
+        });
+        runner.run_batch("Columnar/read", params, n, [&] {
+            bench::do_not_optimize(ml::io::read_columnar(columnar_path, pool));
+        });
+    }
+    std::filesystem::remove(csv_path);
+    std::filesystem::remove(columnar_path);
+}
+
+void print_usage() {
+    std::cerr << "Usage: ml_benchmarks [--quick] [--scale S] [--repetitions N] [--queries N]\n"
+                 "                     [--threads N] [--filter NAME] [--output FILE]\n";
+}
+
+bench::Options parse_options(int argc, char** argv) {
+    bench::Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--quick") {
+            options.scale = 0.1;
+            options.repetitions = 2;
+            options.queries = 20;
+        } else if (arg == "--scale") {
+            options.scale = std::stod(value());
+        } else if (arg == "--repetitions") {
+            options.repetitions = std::stoul(value());
+        } else if (arg == "--queries") {
+            options.queries = std::stoul(value());
+        } else if (arg == "--threads") {
+            options.threads = std::stoul(value());
+        } else if (arg == "--filter") {
+            options.filter = value();
+        } else if (arg == "--output") {
+            options.output = value();
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    if (options.scale <= 0.0) {
+        throw std::invalid_argument("--scale must be positive.");
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        print_usage();
+        return 2;
+    }
+
+    std::unique_ptr<ml::ThreadPool> pool;
+    if (options.threads > 0) {
+        pool = std::make_unique<ml::ThreadPool>(options.threads);
+    }
+
+    bench::Runner runner(options);
+    bench_decision_trees(runner);
+    bench_random_forests(runner, pool.get());
+    bench_gradient_boosting(runner, pool.get());
+    bench_tree_codegen(runner);
+    bench_nearest_neighbors(runner, pool.get());
+    bench_clustering(runner, pool.get());
+    bench_svr(runner);
+    bench_linear_models(runner);
+    bench_neural_network(runner);
+    bench_association(runner, pool.get());
+    bench_io(runner, pool.get());
+    bench_kernels(runner, pool.get());
+
+    if (options.output.empty()) {
+        runner.write_json(std::cout);
+    } else {
+        std::ofstream file(options.output);
+        if (!file) {
+            std::cerr << "Cannot open " << options.output << "\n";
+            return 1;
+        }
+        runner.write_json(file);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef ML_BENCHMARK_CODEGEN_MODELS_HPP
+#define ML_BENCHMARK_CODEGEN_MODELS_HPP
+
+#include <cstddef>
+#include "DataGenerators.hpp"
+#include "../ml_library_include/ml/tree/DecisionTreeRegressor.hpp"
+#include "../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include "../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+
+/**
+ * @file CodegenModels.hpp
+ * @brief The seeded models that generate_tree_models exports and ml_benchmarks compares against.
+ *
+ * Both programs train them from the same data and seeds, so the generated headers compiled into
+ * ml_benchmarks predict exactly like the models it trains at run time.
+ */
+
+namespace bench {
+namespace codegen {
+
+constexpr std::size_t rows = 2000;
+constexpr std::size_t features = 8;
+constexpr int n_estimators = 32;
+constexpr int max_depth = 8;
+
+inline RegressionData regression_data() {
+    return make_regression(rows, features, 0.0, 21);
+}
+
+inline ClassificationData classification_data() {
+    return make_classification(rows, features, 4, 0.0, 22);
+}
+
+// Unfitted models; fit the tree and the regressor on regression_data() and the classifier on classification_data()
+inline DecisionTreeRegressor tree_regressor() {
+    return DecisionTreeRegressor(max_depth);
+}
+
+inline RandomForestRegressor forest_regressor() {
+    return RandomForestRegressor(n_estimators, max_depth, 2, -1, 5);
+}
+
+inline RandomForestClassifier forest_classifier() {
+    return RandomForestClassifier(n_estimators, max_depth, 2, -1, 6);
+}
+
+} // namespace codegen
+} // namespace bench
+
+#endif // ML_BENCHMARK_CODEGEN_MODELS_HPP
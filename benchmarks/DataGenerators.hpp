@@ -0,0 +1,123 @@
+#ifndef ML_BENCHMARK_DATA_GENERATORS_HPP
+#define ML_BENCHMARK_DATA_GENERATORS_HPP
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstddef>
+#include "../ml_library_include/ml/core/Matrix.hpp"
+
+/**
+ * @file DataGenerators.hpp
+ * @brief Synthetic, seeded datasets for the benchmark suite.
+ */
+
+namespace bench {
+
+/**
+ * @brief A dense dataset with integer class labels.
+ */
+struct ClassificationData {
+    ml::Matrix X;
+    std::vector<int> y;
+};
+
+/**
+ * @brief A dense dataset with real-valued targets.
+ */
+struct RegressionData {
+    ml::Matrix X;
+    std::vector<double> y;
+};
+
+/**
+ * @brief Gaussian blobs around one random center per class.
+ * @param n Number of samples.
+ * @param d Number of features.
+ * @param classes Number of classes.
+ * @param sparsity Fraction of feature values forced to zero, in [0, 1).
+ * @param seed Random seed.
+ */
+inline ClassificationData make_classification(std::size_t n, std::size_t d, int classes, double sparsity, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> center_dist(-5.0, 5.0);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> label_dist(0, classes - 1);
+
+    ml::Matrix centers(classes, d);
+    for (int c = 0; c < classes; ++c) {
+        for (std::size_t j = 0; j < d; ++j) {
+            centers(c, j) = center_dist(rng);
+        }
+    }
+
+    ClassificationData data{ml::Matrix(n, d), std::vector<int>(n)};
+    for (std::size_t i = 0; i < n; ++i) {
+        int label = label_dist(rng);
+        data.y[i] = label;
+        for (std::size_t j = 0; j < d; ++j) {
+            data.X(i, j) = unit(rng) < sparsity ? 0.0 : centers(label, j) + noise(rng);
+        }
+    }
+    return data;
+}
+
+/**
+ * @brief Targets from a random linear model plus a mild non-linearity and Gaussian noise.
+ * @param n Number of samples.
+ * @param d Number of features.
+ * @param sparsity Fraction of feature values forced to zero, in [0, 1).
+ * @param seed Random seed.
+ */
+inline RegressionData make_regression(std::size_t n, std::size_t d, double sparsity, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    std::vector<double> weights(d);
+    for (double& w : weights) {
+        w = normal(rng);
+    }
+
+    RegressionData data{ml::Matrix(n, d), std::vector<double>(n)};
+    for (std::size_t i = 0; i < n; ++i) {
+        double target = 0.0;
+        for (std::size_t j = 0; j < d; ++j) {
+            double value = unit(rng) < sparsity ? 0.0 : normal(rng);
+            data.X(i, j) = value;
+            target += weights[j] * value;
+        }
+        data.y[i] = target + 0.5 * std::sin(target) + 0.1 * normal(rng);
+    }
+    return data;
+}
+
+/**
+ * @brief Market-basket transactions with a skewed item popularity.
+ * @param n Number of transactions.
+ * @param n_items Number of distinct items.
+ * @param density Expected fraction of items in a transaction for the most popular item.
+ * @param seed Random seed.
+ */
+inline std::vector<std::vector<int>> make_transactions(std::size_t n, int n_items, double density, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<std::vector<int>> transactions(n);
+    for (auto& transaction : transactions) {
+        for (int item = 0; item < n_items; ++item) {
+            // Item popularity decays like 1 / sqrt(rank)
+            if (unit(rng) < density / std::sqrt(1.0 + item)) {
+                transaction.push_back(item);
+            }
+        }
+        if (transaction.empty()) {
+            transaction.push_back(0);
+        }
+    }
+    return transactions;
+}
+
+} // namespace bench
+
+#endif // ML_BENCHMARK_DATA_GENERATORS_HPP
@@ -0,0 +1,35 @@
+#include "CodegenModels.hpp"
+#include <filesystem>
+#include <iostream>
+#include <exception>
+
+// Writes the generated headers that ml_benchmarks includes into the directory given as argument
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: generate_tree_models OUTPUT_DIRECTORY\n";
+        return 2;
+    }
+    std::filesystem::path directory = argv[1];
+    try {
+        std::filesystem::create_directories(directory);
+        bench::RegressionData regression = bench::codegen::regression_data();
+        DecisionTreeRegressor tree = bench::codegen::tree_regressor();
+        tree.fit(regression.X, regression.y);
+        tree.export_cpp((directory / "generated_tree.hpp").string(), "generated_tree");
+
+        RandomForestRegressor forest = bench::codegen::forest_regressor();
+        forest.fit(regression.X, regression.y);
+        forest.export_cpp((directory / "generated_forest.hpp").string(), "generated_forest");
+        forest.export_cpp((directory / "generated_forest_tables.hpp").string(), "generated_forest_tables",
+                          ml::tree::CodeStyle::Tables);
+
+        bench::ClassificationData classification = bench::codegen::classification_data();
+        RandomForestClassifier classifier = bench::codegen::forest_classifier();
+        classifier.fit(classification.X, classification.y);
+        classifier.export_cpp((directory / "generated_forest_classifier.hpp").string(), "generated_forest_classifier");
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,12 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <fstream>
+#include "../core/ThreadPool.hpp"
+#include "../core/Profiling.hpp"
+#include "../core/Serialization.hpp"
 
 /**
  * @file Apriori.hpp
@@ -40,6 +46,26 @@ public:
      * @return An unordered_map where keys are itemsets (as strings) and values are support counts.
      */
     std::unordered_map<std::string, int> get_support_counts() const;
+
+    /**
+     * @brief Sets the pool used to count candidate support across transactions in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Saves the support threshold and the support counts of the last run to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the support threshold and support counts.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold an Apriori model.
+     */
+    void load(const std::string& path);
     
     /**
      * @brief Converts an itemset to a string representation for use as a key.
@@ -89,6 +115,7 @@ private:
     int min_support_count; ///< Minimum support count (absolute number of transactions).
     int total_transactions; ///< Total number of transactions.
     std::unordered_map<std::string, int> support_counts; ///< Support counts for itemsets.
+    ml::ThreadPool* thread_pool = nullptr; ///< Pool used by count_support, if any.
 };
 
 Apriori::Apriori(double min_support)
@@ -99,6 +126,7 @@ Apriori::Apriori(double min_support)
 }
 
 std::vector<std::set<int>> Apriori::run(const std::vector<std::vector<int>>& transactions) {
+    ML_PROFILE_SCOPE("Apriori::run");
     total_transactions = static_cast<int>(transactions.size());
     min_support_count = static_cast<int>(std::ceil(min_support * total_transactions));
 
@@ -125,6 +153,8 @@ std::vector<std::set<int>> Apriori::run(const std::vector<std::vector<int>>& tra
     while (!frequent_itemsets_k.empty()) {
         // Generate candidate itemsets of size k
         auto candidates_k = generate_candidates(frequent_itemsets_k, k);
+        ML_PROFILE_COUNT("Apriori::candidates", candidates_k.size());
+        ML_PROFILE_COUNT_DYNAMIC("Apriori::candidates_level_" + std::to_string(k), candidates_k.size());
 
         // Count support for candidates
         auto candidate_supports = count_support(candidates_k, transactions);
@@ -193,16 +223,37 @@ bool Apriori::has_infrequent_subset(const std::set<int>& candidate,
 
 std::unordered_map<std::string, int> Apriori::count_support(const std::set<std::set<int>>& candidates,
                                                             const std::vector<std::vector<int>>& transactions) {
-    std::unordered_map<std::string, int> counts;
-    for (const auto& transaction : transactions) {
-        std::set<int> transaction_set(transaction.begin(), transaction.end());
-        for (const auto& candidate : candidates) {
-            if (std::includes(transaction_set.begin(), transaction_set.end(),
-                              candidate.begin(), candidate.end())) {
-                std::string candidate_str = itemset_to_string(candidate);
-                counts[candidate_str]++;
+    // Count per candidate in flat arrays, one per block of transactions, then merge
+    std::vector<const std::set<int>*> candidate_list;
+    candidate_list.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        candidate_list.push_back(&candidate);
+    }
+    std::vector<int> totals(candidate_list.size(), 0);
+    std::mutex totals_mutex;
+
+    ml::parallel_for_blocks(thread_pool, 0, transactions.size(), [&](size_t begin, size_t end) {
+        std::vector<int> local(candidate_list.size(), 0);
+        for (size_t t = begin; t < end; ++t) {
+            std::set<int> transaction_set(transactions[t].begin(), transactions[t].end());
+            for (size_t c = 0; c < candidate_list.size(); ++c) {
+                if (std::includes(transaction_set.begin(), transaction_set.end(),
+                                  candidate_list[c]->begin(), candidate_list[c]->end())) {
+                    local[c]++;
+                }
             }
         }
+        std::lock_guard<std::mutex> lock(totals_mutex);
+        for (size_t c = 0; c < totals.size(); ++c) {
+            totals[c] += local[c];
+        }
+    }, 64);
+
+    std::unordered_map<std::string, int> counts;
+    for (size_t c = 0; c < candidate_list.size(); ++c) {
+        if (totals[c] > 0) {
+            counts[itemset_to_string(*candidate_list[c])] = totals[c];
+        }
     }
     return counts;
 }
@@ -211,6 +262,46 @@ std::unordered_map<std::string, int> Apriori::get_support_counts() const {
     return support_counts;
 }
 
+void Apriori::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+void Apriori::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::Apriori, 1);
+    writer.write_double(min_support);
+    writer.write_int(min_support_count);
+    writer.write_int(total_transactions);
+    writer.write_int(static_cast<int64_t>(support_counts.size()));
+    for (const auto& [itemset, count] : support_counts) {
+        writer.write_string(itemset);
+        writer.write_int(count);
+    }
+    writer.finish();
+}
+
+void Apriori::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::Apriori, 1);
+    double stored_min_support = reader.read_double();
+    if (stored_min_support <= 0.0 || stored_min_support > 1.0) {
+        throw std::runtime_error("Model file holds an invalid min_support.");
+    }
+    int stored_min_support_count = reader.read_int<int>();
+    int stored_total_transactions = reader.read_int<int>();
+    size_t n_itemsets = reader.read_int<size_t>();
+    std::unordered_map<std::string, int> stored_counts;
+    for (size_t i = 0; i < n_itemsets; ++i) {
+        std::string itemset = reader.read_string();
+        stored_counts[itemset] = reader.read_int<int>();
+    }
+
+    min_support = stored_min_support;
+    min_support_count = stored_min_support_count;
+    total_transactions = stored_total_transactions;
+    support_counts = std::move(stored_counts);
+}
+
 std::string Apriori::itemset_to_string(const std::set<int>& itemset) const {
     std::string s;
     for (auto it = itemset.begin(); it != itemset.end(); ++it) {
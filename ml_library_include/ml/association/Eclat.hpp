@@ -8,6 +8,8 @@
 #include <string>
 #include <cmath>
 #include <stdexcept>
+#include <fstream>
+#include "../core/Serialization.hpp"
 
 /**
  * @file Eclat.hpp
@@ -39,6 +41,20 @@ public:
      */
     std::map<std::vector<int>, int> get_support_counts() const;
 
+    /**
+     * @brief Saves the support threshold and the support counts of the last run to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the support threshold and support counts.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold an Eclat model.
+     */
+    void load(const std::string& path);
+
 private:
     /**
      * @brief Recursively mines frequent itemsets using the Eclat algorithm.
@@ -156,4 +172,40 @@ std::map<std::vector<int>, int> Eclat::get_support_counts() const {
     return support_counts;
 }
 
+void Eclat::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::Eclat, 1);
+    writer.write_double(min_support);
+    writer.write_int(min_support_count);
+    writer.write_int(total_transactions);
+    writer.write_int(static_cast<int64_t>(support_counts.size()));
+    for (const auto& [itemset, count] : support_counts) {
+        writer.write_array(itemset);
+        writer.write_int(count);
+    }
+    writer.finish();
+}
+
+void Eclat::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::Eclat, 1);
+    double stored_min_support = reader.read_double();
+    if (stored_min_support <= 0.0 || stored_min_support > 1.0) {
+        throw std::runtime_error("Model file holds an invalid min_support.");
+    }
+    int stored_min_support_count = reader.read_int<int>();
+    int stored_total_transactions = reader.read_int<int>();
+    size_t n_itemsets = reader.read_int<size_t>();
+    std::map<std::vector<int>, int> stored_counts;
+    for (size_t i = 0; i < n_itemsets; ++i) {
+        std::span<const int> itemset = reader.read_array<int>();
+        stored_counts[std::vector<int>(itemset.begin(), itemset.end())] = reader.read_int<int>();
+    }
+
+    min_support = stored_min_support;
+    min_support_count = stored_min_support_count;
+    total_transactions = stored_total_transactions;
+    support_counts = std::move(stored_counts);
+}
+
 #endif // ECLAT_HPP
@@ -6,6 +6,12 @@
 #include <algorithm>
 #include <memory>
 #include <limits>
+#include <string>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/DataHolder.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file HierarchicalClustering.hpp
@@ -45,6 +51,20 @@ public:
      */
     void fit(const std::vector<std::vector<double>>& X);
 
+    /**
+     * @brief Fits the clustering algorithm to the data.
+     * @param X A dense matrix of data points (one row per point).
+     */
+    void fit(const ml::MatrixView& X);
+
+    /**
+     * @brief Fits the clustering algorithm by referencing the caller's data without copying it.
+     *
+     * X must stay alive and unchanged while predict() or get_cluster_centers() are used.
+     * @param X A dense matrix of data points (one row per point).
+     */
+    void fit_view(const ml::MatrixView& X);
+
     /**
      * @brief Predicts the cluster labels for the data.
      * @return A vector of cluster labels.
@@ -57,10 +77,27 @@ public:
      */
     std::vector<std::vector<double>> get_cluster_centers() const;
 
+    /**
+     * @brief Saves the fitted model (data points and clusters) to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the data points are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a HierarchicalClustering.
+     */
+    void load(const std::string& path);
+
 private:
     int n_clusters;  ///< Number of clusters to form.
     Linkage linkage; ///< Linkage criterion.
-    std::vector<std::vector<double>> data; ///< Data points.
+    ml::MatrixHolder data; ///< Data points, one per row.
+    std::shared_ptr<const ml::MappedFile> model_file; ///< Mapped model file that data borrows from after load().
 
     struct Cluster {
         int id; ///< Unique identifier for the cluster.
@@ -85,6 +122,11 @@ private:
      */
     double cluster_distance(const Cluster& cluster_a, const Cluster& cluster_b) const;
 
+    /**
+     * @brief Runs agglomerative clustering over the stored data points.
+     */
+    void build_clusters();
+
     /**
      * @brief Merges the two closest clusters.
      */
@@ -103,11 +145,27 @@ HierarchicalClustering::HierarchicalClustering(int n_clusters, Linkage linkage)
 HierarchicalClustering::~HierarchicalClustering() {}
 
 void HierarchicalClustering::fit(const std::vector<std::vector<double>>& X) {
-    data = X;
+    data.own(ml::Matrix(X));
+    model_file.reset();
+    build_clusters();
+}
 
+void HierarchicalClustering::fit(const ml::MatrixView& X) {
+    data.own(ml::Matrix(X));
+    model_file.reset();
+    build_clusters();
+}
+
+void HierarchicalClustering::fit_view(const ml::MatrixView& X) {
+    data.borrow(X);
+    model_file.reset();
+    build_clusters();
+}
+
+void HierarchicalClustering::build_clusters() {
     // Initialize each data point as a separate cluster
     clusters.clear();
-    for (size_t i = 0; i < data.size(); ++i) {
+    for (size_t i = 0; i < data.rows(); ++i) {
         auto cluster = std::make_shared<Cluster>();
         cluster->id = static_cast<int>(i);
         cluster->points.push_back(static_cast<int>(i));
@@ -121,7 +179,7 @@ void HierarchicalClustering::fit(const std::vector<std::vector<double>>& X) {
 }
 
 std::vector<int> HierarchicalClustering::predict() const {
-    std::vector<int> labels(data.size(), -1);
+    std::vector<int> labels(data.rows(), -1);
     for (size_t i = 0; i < clusters.size(); ++i) {
         for (int point_idx : clusters[i]->points) {
             labels[point_idx] = static_cast<int>(i);
@@ -135,10 +193,10 @@ std::vector<std::vector<double>> HierarchicalClustering::get_cluster_centers() c
     centers.reserve(clusters.size());
 
     for (const auto& cluster : clusters) {
-        std::vector<double> centroid(data[0].size(), 0.0);
+        std::vector<double> centroid(data.cols(), 0.0);
         for (int idx : cluster->points) {
-            const auto& point = data[idx];
-            for (size_t i = 0; i < point.size(); ++i) {
+            const double* point = data.row(idx);
+            for (size_t i = 0; i < data.cols(); ++i) {
                 centroid[i] += point[i];
             }
         }
@@ -153,14 +211,7 @@ std::vector<std::vector<double>> HierarchicalClustering::get_cluster_centers() c
 }
 
 double HierarchicalClustering::euclidean_distance(int a, int b) const {
-    const auto& point_a = data[a];
-    const auto& point_b = data[b];
-    double distance = 0.0;
-    for (size_t i = 0; i < point_a.size(); ++i) {
-        double diff = point_a[i] - point_b[i];
-        distance += diff * diff;
-    }
-    return std::sqrt(distance);
+    return ml::kernels::l2(data.row(a), data.row(b), data.cols());
 }
 
 double HierarchicalClustering::cluster_distance(const Cluster& cluster_a, const Cluster& cluster_b) const {
@@ -235,4 +286,48 @@ std::pair<int, int> HierarchicalClustering::find_closest_clusters() const {
     return {idx_a, idx_b};
 }
 
+void HierarchicalClustering::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::HierarchicalClustering, 1);
+    writer.write_int(n_clusters);
+    writer.write_int(static_cast<int64_t>(linkage));
+    writer.write_matrix(data.view());
+    writer.write_int(static_cast<int64_t>(clusters.size()));
+    for (const auto& cluster : clusters) {
+        writer.write_int(cluster->id);
+        writer.write_array(cluster->points);
+    }
+    writer.finish();
+}
+
+void HierarchicalClustering::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::HierarchicalClustering, 1);
+    int new_n_clusters = reader.read_int<int>();
+    int new_linkage = reader.read_int<int>();
+    if (new_linkage < static_cast<int>(Linkage::SINGLE) || new_linkage > static_cast<int>(Linkage::AVERAGE)) {
+        throw std::runtime_error("Model file holds an unknown linkage.");
+    }
+    ml::MatrixView points = reader.read_matrix();
+    size_t n_stored = reader.read_int<size_t>();
+    std::vector<std::shared_ptr<Cluster>> new_clusters;
+    for (size_t c = 0; c < n_stored; ++c) {
+        auto cluster = std::make_shared<Cluster>();
+        cluster->id = reader.read_int<int>();
+        std::span<const int> members = reader.read_array<int>();
+        for (int point : members) {
+            if (point < 0 || static_cast<size_t>(point) >= points.rows()) {
+                throw std::runtime_error("Model file holds an invalid cluster member.");
+            }
+        }
+        cluster->points.assign(members.begin(), members.end());
+        new_clusters.push_back(std::move(cluster));
+    }
+    n_clusters = new_n_clusters;
+    linkage = static_cast<Linkage>(new_linkage);
+    data.borrow(points);
+    clusters = std::move(new_clusters);
+    model_file = std::move(file);
+}
+
 #endif // HIERARCHICAL_CLUSTERING_HPP
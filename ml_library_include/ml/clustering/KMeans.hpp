@@ -6,6 +6,15 @@
 #include <limits>
 #include <random>
 #include <algorithm>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Profiling.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file KMeans.hpp
@@ -13,10 +22,12 @@
  */
 
 /**
- * @class KMeans
+ * @class BasicKMeans
  * @brief Implements the K-Means clustering algorithm with K-Means++ initialization.
+ * @tparam T Scalar type of the samples and cluster centers, double or float.
  */
-class KMeans {
+template <typename T>
+class BasicKMeans {
 public:
     /**
      * @brief Constructs a KMeans object.
@@ -25,38 +36,86 @@ public:
      * @param tol The tolerance to declare convergence.
      * @param random_state Seed for random number generator (optional).
      */
-    KMeans(int n_clusters = 8, int max_iter = 300, double tol = 1e-4, unsigned int random_state = 0);
+    BasicKMeans(int n_clusters = 8, int max_iter = 300, double tol = 1e-4, unsigned int random_state = 0);
 
     /**
      * @brief Destructor for KMeans.
      */
-    ~KMeans();
+    ~BasicKMeans();
+
+    /**
+     * @brief Sets the pool used to assign samples to clusters in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
 
     /**
      * @brief Fits the KMeans model to the data.
      * @param X A vector of feature vectors.
      */
-    void fit(const std::vector<std::vector<double>>& X);
+    void fit(const std::vector<std::vector<T>>& X);
+
+    /**
+     * @brief Fits the KMeans model to the data.
+     * @param X A dense matrix of samples (one row per sample).
+     */
+    void fit(const ml::BasicMatrixView<T>& X);
 
     /**
      * @brief Predicts the closest cluster each sample in X belongs to.
      * @param X A vector of feature vectors.
      * @return A vector of cluster labels.
      */
-    std::vector<int> predict(const std::vector<std::vector<double>>& X) const;
+    std::vector<int> predict(const std::vector<std::vector<T>>& X) const;
+
+    /**
+     * @brief Predicts the closest cluster each sample in X belongs to.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of cluster labels.
+     */
+    std::vector<int> predict(const ml::BasicMatrixView<T>& X) const;
+
+    /**
+     * @brief Predicts cluster labels into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param labels Receives one cluster label per row of X.
+     * @throw std::invalid_argument If labels.size() != X.rows().
+     */
+    void predict_into(const ml::BasicMatrixView<T>& X, std::span<int> labels) const;
 
     /**
      * @brief Returns the cluster centers.
      * @return A vector of cluster centers.
      */
-    const std::vector<std::vector<double>>& get_cluster_centers() const;
+    std::vector<std::vector<T>> get_cluster_centers() const;
+
+    /**
+     * @brief Returns the cluster centers as a dense n_clusters x n_features matrix.
+     * @return The cluster centers.
+     */
+    const ml::BasicMatrix<T>& get_cluster_centers_matrix() const;
+
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a KMeans.
+     */
+    void load(const std::string& path);
 
 private:
     int n_clusters;
     int max_iter;
     double tol;
-    std::vector<std::vector<double>> cluster_centers;
+    ml::BasicMatrix<T> cluster_centers; ///< One center per row.
     std::vector<int> labels;
+    ml::ThreadPool* thread_pool = nullptr;
 
     mutable std::mt19937 rng; ///< Random number generator declared as mutable
 
@@ -64,33 +123,40 @@ private:
      * @brief Computes the Euclidean distance between two points.
      * @param a First point.
      * @param b Second point.
+     * @param n_features Number of elements in each point.
      * @return The Euclidean distance.
      */
-    double euclidean_distance(const std::vector<double>& a, const std::vector<double>& b) const;
+    T euclidean_distance(const T* a, const T* b, size_t n_features) const;
 
     /**
      * @brief Assigns each sample to the nearest cluster center.
-     * @param X A vector of feature vectors.
-     * @return A vector of cluster labels.
+     * @param X A matrix of samples, in any layout.
+     * @param labels Receives one cluster label per row of X.
      */
-    std::vector<int> assign_labels(const std::vector<std::vector<double>>& X) const;
+    void assign_labels(const ml::BasicMatrixView<T>& X, std::span<int> labels) const;
 
     /**
      * @brief Computes the cluster centers given the current labels.
-     * @param X A vector of feature vectors.
+     * @param X A row-major matrix of samples.
      * @param labels A vector of cluster labels.
-     * @return A vector of new cluster centers.
+     * @return A matrix of new cluster centers.
      */
-    std::vector<std::vector<double>> compute_cluster_centers(const std::vector<std::vector<double>>& X, const std::vector<int>& labels) const;
+    ml::BasicMatrix<T> compute_cluster_centers(const ml::BasicMatrixView<T>& X, const std::vector<int>& labels) const;
 
     /**
      * @brief Initializes cluster centers using the K-Means++ algorithm.
-     * @param X A vector of feature vectors.
+     * @param X A row-major matrix of samples.
      */
-    void initialize_centers(const std::vector<std::vector<double>>& X);
+    void initialize_centers(const ml::BasicMatrixView<T>& X);
 };
 
-KMeans::KMeans(int n_clusters, int max_iter, double tol, unsigned int random_state)
+/**
+ * @brief K-Means clustering on double-precision samples.
+ */
+using KMeans = BasicKMeans<double>;
+
+template <typename T>
+BasicKMeans<T>::BasicKMeans(int n_clusters, int max_iter, double tol, unsigned int random_state)
     : n_clusters(n_clusters), max_iter(max_iter), tol(tol), rng(random_state) {
     if (random_state == 0) {
         std::random_device rd;
@@ -98,20 +164,36 @@ KMeans::KMeans(int n_clusters, int max_iter, double tol, unsigned int random_sta
     }
 }
 
-KMeans::~KMeans() {}
+template <typename T>
+BasicKMeans<T>::~BasicKMeans() {}
 
-void KMeans::fit(const std::vector<std::vector<double>>& X) {
-    size_t n_samples = X.size();
+template <typename T>
+void BasicKMeans<T>::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+template <typename T>
+void BasicKMeans<T>::fit(const std::vector<std::vector<T>>& X) {
+    fit(ml::BasicMatrix<T>(X));
+}
+
+template <typename T>
+void BasicKMeans<T>::fit(const ml::BasicMatrixView<T>& X_in) {
+    ML_PROFILE_SCOPE("KMeans::fit");
+    ml::BasicMatrix<T> packed;
+    ml::BasicMatrixView<T> X = ml::as_row_major(X_in, packed);
+    size_t n_samples = X.rows();
+    size_t n_features = X.cols();
 
     // Initialize cluster centers using K-Means++ initialization
     initialize_centers(X);
 
     labels.resize(n_samples);
-    std::vector<std::vector<double>> old_cluster_centers;
+    ml::BasicMatrix<T> old_cluster_centers;
 
     for (int iter = 0; iter < max_iter; ++iter) {
         // Assign labels to each point
-        labels = assign_labels(X);
+        assign_labels(X, labels);
 
         // Save old centers
         old_cluster_centers = cluster_centers;
@@ -120,9 +202,9 @@ void KMeans::fit(const std::vector<std::vector<double>>& X) {
         cluster_centers = compute_cluster_centers(X, labels);
 
         // Check for convergence
-        double max_center_shift = 0.0;
+        T max_center_shift = 0.0;
         for (int i = 0; i < n_clusters; ++i) {
-            double shift = euclidean_distance(cluster_centers[i], old_cluster_centers[i]);
+            T shift = euclidean_distance(cluster_centers.row(i), old_cluster_centers.row(i), n_features);
             if (shift > max_center_shift) {
                 max_center_shift = shift;
             }
@@ -133,61 +215,88 @@ void KMeans::fit(const std::vector<std::vector<double>>& X) {
     }
 }
 
-std::vector<int> KMeans::predict(const std::vector<std::vector<double>>& X) const {
-    return assign_labels(X);
+template <typename T>
+std::vector<int> BasicKMeans<T>::predict(const std::vector<std::vector<T>>& X) const {
+    return predict(ml::BasicMatrix<T>(X));
+}
+
+template <typename T>
+std::vector<int> BasicKMeans<T>::predict(const ml::BasicMatrixView<T>& X) const {
+    std::vector<int> labels(X.rows());
+    predict_into(X, labels);
+    return labels;
 }
 
-const std::vector<std::vector<double>>& KMeans::get_cluster_centers() const {
+template <typename T>
+void BasicKMeans<T>::predict_into(const ml::BasicMatrixView<T>& X, std::span<int> labels) const {
+    ml::check_output_size(X.rows(), labels.size());
+    assign_labels(X, labels);
+}
+
+template <typename T>
+std::vector<std::vector<T>> BasicKMeans<T>::get_cluster_centers() const {
+    return cluster_centers.to_vectors();
+}
+
+template <typename T>
+const ml::BasicMatrix<T>& BasicKMeans<T>::get_cluster_centers_matrix() const {
     return cluster_centers;
 }
 
-double KMeans::euclidean_distance(const std::vector<double>& a, const std::vector<double>& b) const {
-    double sum = 0.0;
-    for (size_t i = 0; i < a.size(); ++i) {
-        double diff = a[i] - b[i];
-        sum += diff * diff;
-    }
-    return std::sqrt(sum);
+template <typename T>
+T BasicKMeans<T>::euclidean_distance(const T* a, const T* b, size_t n_features) const {
+    return ml::kernels::l2(a, b, n_features);
 }
 
-std::vector<int> KMeans::assign_labels(const std::vector<std::vector<double>>& X) const {
-    std::vector<int> labels(X.size());
-    for (size_t i = 0; i < X.size(); ++i) {
-        double min_dist = std::numeric_limits<double>::max();
-        int label = -1;
-        for (int k = 0; k < n_clusters; ++k) {
-            double dist = euclidean_distance(X[i], cluster_centers[k]);
-            if (dist < min_dist) {
-                min_dist = dist;
-                label = k;
+template <typename T>
+void BasicKMeans<T>::assign_labels(const ml::BasicMatrixView<T>& X, std::span<int> labels) const {
+    ML_PROFILE_SCOPE("KMeans::assign_labels");
+    ML_PROFILE_COUNT("KMeans::distance_computations", X.rows() * n_clusters);
+    ml::parallel_for_blocks(thread_pool, 0, X.rows(), [&](size_t begin, size_t end) {
+        // Squared distances pick the same nearest center without the square roots
+        std::span<T> distances = ml::scratch<T>(n_clusters);
+        std::span<T> row_buffer = ml::scratch<T, 1>(X.cols());
+        for (size_t i = begin; i < end; ++i) {
+            ml::kernels::squared_l2_one_to_many(ml::contiguous_row(X, i, row_buffer), cluster_centers.view(), distances.data());
+            T min_dist = std::numeric_limits<T>::max();
+            int label = -1;
+            for (int k = 0; k < n_clusters; ++k) {
+                if (distances[k] < min_dist) {
+                    min_dist = distances[k];
+                    label = k;
+                }
             }
+            labels[i] = label;
         }
-        labels[i] = label;
-    }
-    return labels;
+    }, 256);
 }
 
-std::vector<std::vector<double>> KMeans::compute_cluster_centers(const std::vector<std::vector<double>>& X, const std::vector<int>& labels) const {
-    size_t n_features = X[0].size();
-    std::vector<std::vector<double>> new_centers(n_clusters, std::vector<double>(n_features, 0.0));
+template <typename T>
+ml::BasicMatrix<T> BasicKMeans<T>::compute_cluster_centers(const ml::BasicMatrixView<T>& X, const std::vector<int>& labels) const {
+    size_t n_features = X.cols();
+    ml::BasicMatrix<T> new_centers(n_clusters, n_features, 0.0);
     std::vector<int> counts(n_clusters, 0);
 
-    for (size_t i = 0; i < X.size(); ++i) {
+    for (size_t i = 0; i < X.rows(); ++i) {
         int label = labels[i];
         counts[label]++;
+        const T* x = X.row(i);
+        T* center = new_centers.row(label);
         for (size_t j = 0; j < n_features; ++j) {
-            new_centers[label][j] += X[i][j];
+            center[j] += x[j];
         }
     }
 
     for (int k = 0; k < n_clusters; ++k) {
+        T* center = new_centers.row(k);
         if (counts[k] == 0) {
             // If a cluster lost all its members, reinitialize its center using K-Means++ logic
-            std::uniform_int_distribution<size_t> dist(0, X.size() - 1);
-            new_centers[k] = X[dist(rng)];
+            std::uniform_int_distribution<size_t> dist(0, X.rows() - 1);
+            const T* x = X.row(dist(rng));
+            std::copy(x, x + n_features, center);
         } else {
             for (size_t j = 0; j < n_features; ++j) {
-                new_centers[k][j] /= counts[k];
+                center[j] /= counts[k];
             }
         }
     }
@@ -195,24 +304,24 @@ std::vector<std::vector<double>> KMeans::compute_cluster_centers(const std::vect
     return new_centers;
 }
 
-void KMeans::initialize_centers(const std::vector<std::vector<double>>& X) {
-    size_t n_samples = X.size();
-    size_t n_features = X[0].size();
-    cluster_centers.clear();
-    cluster_centers.reserve(n_clusters);
+template <typename T>
+void BasicKMeans<T>::initialize_centers(const ml::BasicMatrixView<T>& X) {
+    size_t n_samples = X.rows();
+    size_t n_features = X.cols();
+    cluster_centers.assign(n_clusters, n_features);
 
     // Step 1: Choose one center uniformly at random from the data points
     std::uniform_int_distribution<size_t> dist(0, n_samples - 1);
     size_t first_center_idx = dist(rng);
-    cluster_centers.push_back(X[first_center_idx]);
+    std::copy(X.row(first_center_idx), X.row(first_center_idx) + n_features, cluster_centers.row(0));
 
     // Step 2: For each data point, compute its distance to the nearest center
-    std::vector<double> distances(n_samples, std::numeric_limits<double>::max());
+    std::vector<T> distances(n_samples, std::numeric_limits<T>::max());
 
     for (int k = 1; k < n_clusters; ++k) {
-        double total_distance = 0.0;
+        T total_distance = 0.0;
         for (size_t i = 0; i < n_samples; ++i) {
-            double dist_to_center = euclidean_distance(X[i], cluster_centers.back());
+            T dist_to_center = euclidean_distance(X.row(i), cluster_centers.row(k - 1), n_features);
             if (dist_to_center < distances[i]) {
                 distances[i] = dist_to_center;
             }
@@ -220,10 +329,10 @@ void KMeans::initialize_centers(const std::vector<std::vector<double>>& X) {
         }
 
         // Step 3: Choose the next center with probability proportional to the square of the distance
-        std::uniform_real_distribution<double> uniform_dist(0.0, total_distance);
-        double random_value = uniform_dist(rng);
+        std::uniform_real_distribution<T> uniform_dist(0.0, total_distance);
+        T random_value = uniform_dist(rng);
 
-        double cumulative_distance = 0.0;
+        T cumulative_distance = 0.0;
         size_t next_center_idx = 0;
         for (size_t i = 0; i < n_samples; ++i) {
             cumulative_distance += distances[i];
@@ -232,8 +341,40 @@ void KMeans::initialize_centers(const std::vector<std::vector<double>>& X) {
                 break;
             }
         }
-        cluster_centers.push_back(X[next_center_idx]);
+        std::copy(X.row(next_center_idx), X.row(next_center_idx) + n_features, cluster_centers.row(k));
+    }
+}
+
+template <typename T>
+void BasicKMeans<T>::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::KMeans, 2);
+    writer.write_scalar_type<T>();
+    writer.write_int(n_clusters);
+    writer.write_int(max_iter);
+    writer.write_double(tol);
+    writer.write_matrix(cluster_centers);
+    writer.finish();
+}
+
+template <typename T>
+void BasicKMeans<T>::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::KMeans, 2);
+    reader.read_scalar_type<T>(2);
+    int new_n_clusters = reader.read_int<int>();
+    int new_max_iter = reader.read_int<int>();
+    double new_tol = reader.read_double();
+    ml::BasicMatrixView<T> centers = reader.read_matrix<T>();
+    if (centers.rows() != static_cast<size_t>(new_n_clusters) && !centers.empty()) {
+        throw std::runtime_error("Model file holds the wrong number of cluster centers.");
     }
+    n_clusters = new_n_clusters;
+    max_iter = new_max_iter;
+    tol = new_tol;
+    // The centers are small and fit() rewrites them, so they are copied out of the mapping
+    cluster_centers = ml::BasicMatrix<T>(centers);
+    labels.clear();
 }
 
 #endif // KMEANS_HPP
@@ -4,7 +4,17 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
-#include <unordered_map>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <memory>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/DataHolder.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file KNNClassifier.hpp
@@ -12,119 +22,251 @@
  */
 
 /**
- * @class KNNClassifier
+ * @class BasicKNNClassifier
  * @brief K-Nearest Neighbors Classifier for classification tasks.
+ * @tparam T Scalar type of the features, double or float.
  */
-class KNNClassifier {
+template <typename T>
+class BasicKNNClassifier {
 public:
     /**
      * @brief Constructs a KNNClassifier.
      * @param k The number of neighbors to consider.
      */
-    explicit KNNClassifier(int k = 3);
+    explicit BasicKNNClassifier(int k = 3);
 
     /**
      * @brief Destructor for KNNClassifier.
      */
-    ~KNNClassifier();
+    ~BasicKNNClassifier();
+
+    /**
+     * @brief Sets the pool used to answer queries in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
 
     /**
      * @brief Fits the classifier to the training data.
      * @param X A vector of feature vectors (training data).
      * @param y A vector of target class labels (training labels).
      */
-    void fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y);
+    void fit(const std::vector<std::vector<T>>& X, const std::vector<int>& y);
+
+    /**
+     * @brief Fits the classifier to the training data.
+     * @param X A dense matrix of training samples (one row per sample).
+     * @param y A vector of target class labels (training labels).
+     */
+    void fit(const ml::BasicMatrixView<T>& X, const std::vector<int>& y);
+
+    /**
+     * @brief Fits the classifier by referencing the caller's training data without copying it.
+     *
+     * X and y must stay alive and unchanged for as long as the model is used.
+     * @param X A dense matrix of training samples (one row per sample).
+     * @param y The target class labels (training labels).
+     */
+    void fit_view(const ml::BasicMatrixView<T>& X, std::span<const int> y);
 
     /**
      * @brief Predicts class labels for the given input data.
      * @param X A vector of feature vectors (test data).
      * @return A vector of predicted class labels.
      */
-    std::vector<int> predict(const std::vector<std::vector<double>>& X) const;
+    std::vector<int> predict(const std::vector<std::vector<T>>& X) const;
 
-private:
-    int k;  ///< Number of neighbors to consider.
-    std::vector<std::vector<double>> X_train;  ///< Training data features.
-    std::vector<int> y_train;  ///< Training data labels.
+    /**
+     * @brief Predicts class labels for the given input data.
+     * @param X A dense matrix of test samples (one row per sample).
+     * @return A vector of predicted class labels.
+     */
+    std::vector<int> predict(const ml::BasicMatrixView<T>& X) const;
+
+    /**
+     * @brief Predicts class labels into a caller-provided buffer without allocating.
+     * @param X A dense matrix of test samples (one row per sample), in any layout.
+     * @param predictions Receives one label per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows().
+     */
+    void predict_into(const ml::BasicMatrixView<T>& X, std::span<int> predictions) const;
 
     /**
-     * @brief Computes the Euclidean distance between two feature vectors.
-     * @param a The first feature vector.
-     * @param b The second feature vector.
-     * @return The Euclidean distance.
+     * @brief Saves the fitted model, including its training data, to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
      */
-    double euclidean_distance(const std::vector<double>& a, const std::vector<double>& b) const;
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the training data is used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a KNNClassifier.
+     */
+    void load(const std::string& path);
+
+private:
+    int k;  ///< Number of neighbors to consider.
+    ml::BasicMatrixHolder<T> X_train;  ///< Training data features, one sample per row.
+    ml::ArrayHolder<int> y_train;  ///< Training data labels.
+    ml::ThreadPool* thread_pool = nullptr;  ///< Pool used by predict, if any.
+    std::shared_ptr<const ml::MappedFile> model_file;  ///< Mapped model file that X_train and y_train borrow from after load().
 
     /**
      * @brief Predicts the class label for a single sample.
      * @param x The feature vector of the sample.
      * @return The predicted class label.
      */
-    int predict_sample(const std::vector<double>& x) const;
+    int predict_sample(const T* x) const;
 };
 
-KNNClassifier::KNNClassifier(int k) : k(k) {}
+/**
+ * @brief K-Nearest Neighbors Classifier on double-precision features.
+ */
+using KNNClassifier = BasicKNNClassifier<double>;
+
+template <typename T>
+BasicKNNClassifier<T>::BasicKNNClassifier(int k) : k(k) {}
 
-KNNClassifier::~KNNClassifier() {}
+template <typename T>
+BasicKNNClassifier<T>::~BasicKNNClassifier() {}
 
-void KNNClassifier::fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y) {
-    X_train = X;
-    y_train = y;
+template <typename T>
+void BasicKNNClassifier<T>::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
 }
 
-std::vector<int> KNNClassifier::predict(const std::vector<std::vector<double>>& X) const {
-    std::vector<int> predictions;
-    predictions.reserve(X.size());
-    for (const auto& x : X) {
-        predictions.push_back(predict_sample(x));
+template <typename T>
+void BasicKNNClassifier<T>::fit(const std::vector<std::vector<T>>& X, const std::vector<int>& y) {
+    if (X.size() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
     }
-    return predictions;
+    X_train.own(ml::BasicMatrix<T>(X));
+    y_train.own(y);
+    model_file.reset();
+}
+
+template <typename T>
+void BasicKNNClassifier<T>::fit(const ml::BasicMatrixView<T>& X, const std::vector<int>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
+    }
+    X_train.own(ml::BasicMatrix<T>(X));
+    y_train.own(y);
+    model_file.reset();
 }
 
-double KNNClassifier::euclidean_distance(const std::vector<double>& a, const std::vector<double>& b) const {
-    double distance = 0.0;
-    for (size_t i = 0; i < a.size(); ++i) {
-        double diff = a[i] - b[i];
-        distance += diff * diff;
+template <typename T>
+void BasicKNNClassifier<T>::fit_view(const ml::BasicMatrixView<T>& X, std::span<const int> y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
     }
-    return std::sqrt(distance);
+    X_train.borrow(X);
+    y_train.borrow(y);
+    model_file.reset();
+}
+
+template <typename T>
+std::vector<int> BasicKNNClassifier<T>::predict(const std::vector<std::vector<T>>& X) const {
+    std::vector<int> predictions(X.size());
+    ml::parallel_for(thread_pool, 0, X.size(), [&](size_t i) {
+        predictions[i] = predict_sample(X[i].data());
+    });
+    return predictions;
+}
+
+template <typename T>
+std::vector<int> BasicKNNClassifier<T>::predict(const ml::BasicMatrixView<T>& X) const {
+    std::vector<int> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+template <typename T>
+void BasicKNNClassifier<T>::predict_into(const ml::BasicMatrixView<T>& X, std::span<int> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::parallel_for_blocks(thread_pool, 0, X.rows(), [&](size_t begin, size_t end) {
+        std::span<T> row_buffer = ml::scratch<T, 1>(X.cols());
+        for (size_t i = begin; i < end; ++i) {
+            predictions[i] = predict_sample(ml::contiguous_row(X, i, row_buffer));
+        }
+    });
 }
 
-int KNNClassifier::predict_sample(const std::vector<double>& x) const {
-    // Vector to store distances and corresponding labels
-    std::vector<std::pair<double, int>> distances;
-    distances.reserve(X_train.size());
+template <typename T>
+int BasicKNNClassifier<T>::predict_sample(const T* x) const {
+    ml::BasicMatrixView<T> train = X_train.view();
+    std::span<const int> targets = y_train.span();
+
+    // Compute squared distances to all training samples; the square root would not change their order
+    std::span<T> squared_distances = ml::scratch<T>(train.rows());
+    ml::kernels::squared_l2_one_to_many(x, train, squared_distances.data());
 
-    // Compute distances to all training samples
-    for (size_t i = 0; i < X_train.size(); ++i) {
-        double dist = euclidean_distance(x, X_train[i]);
-        distances.emplace_back(dist, y_train[i]);
+    // Pair the distances with their labels in a per-thread buffer reused across calls
+    std::span<std::pair<T, int>> distances = ml::scratch<std::pair<T, int>>(train.rows());
+    for (size_t i = 0; i < train.rows(); ++i) {
+        distances[i] = {squared_distances[i], targets[i]};
     }
 
     // Sort distances
     std::nth_element(distances.begin(), distances.begin() + k, distances.end(),
-                     [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                     [](const std::pair<T, int>& a, const std::pair<T, int>& b) {
                          return a.first < b.first;
                      });
 
-    // Get the labels of the k nearest neighbors
-    std::unordered_map<int, int> class_counts;
+    // Get the labels of the k nearest neighbors, sorted so that equal labels are adjacent
+    std::span<int> labels = ml::scratch<int>(k);
     for (int i = 0; i < k; ++i) {
-        int label = distances[i].second;
-        class_counts[label]++;
+        labels[i] = distances[i].second;
     }
+    std::sort(labels.begin(), labels.end());
 
-    // Determine the majority class
-    int max_count = 0;
+    // Determine the majority class; ties go to the smallest label
+    size_t max_count = 0;
     int majority_class = -1;
-    for (const auto& [label, count] : class_counts) {
-        if (count > max_count) {
-            max_count = count;
-            majority_class = label;
+    for (size_t begin = 0; begin < labels.size();) {
+        size_t end = begin + 1;
+        while (end < labels.size() && labels[end] == labels[begin]) {
+            ++end;
         }
+        if (end - begin > max_count) {
+            max_count = end - begin;
+            majority_class = labels[begin];
+        }
+        begin = end;
     }
 
     return majority_class;
 }
 
+template <typename T>
+void BasicKNNClassifier<T>::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::KNNClassifier, 2);
+    writer.write_scalar_type<T>();
+    writer.write_int(k);
+    writer.write_matrix(X_train.view());
+    writer.write_array(y_train.span());
+    writer.finish();
+}
+
+template <typename T>
+void BasicKNNClassifier<T>::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::KNNClassifier, 2);
+    reader.read_scalar_type<T>(2);
+    int new_k = reader.read_int<int>();
+    ml::BasicMatrixView<T> X = reader.read_matrix<T>();
+    std::span<const int> y = reader.read_array<int>();
+    if (X.rows() != y.size()) {
+        throw std::runtime_error("Model file holds mismatched samples and labels.");
+    }
+    k = new_k;
+    X_train.borrow(X);
+    y_train.borrow(y);
+    model_file = std::move(file);
+}
+
 #endif // KNN_CLASSIFIER_HPP
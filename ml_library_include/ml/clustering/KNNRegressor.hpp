@@ -4,6 +4,17 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <memory>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/DataHolder.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file KNNRegressor.hpp
@@ -11,107 +22,234 @@
  */
 
 /**
- * @class KNNRegressor
+ * @class BasicKNNRegressor
  * @brief K-Nearest Neighbors Regressor for regression tasks.
+ * @tparam T Scalar type of the features and targets, double or float.
  */
-class KNNRegressor {
+template <typename T>
+class BasicKNNRegressor {
 public:
     /**
      * @brief Constructs a KNNRegressor.
      * @param k The number of neighbors to consider.
      */
-    explicit KNNRegressor(int k = 3);
+    explicit BasicKNNRegressor(int k = 3);
 
     /**
      * @brief Destructor for KNNRegressor.
      */
-    ~KNNRegressor();
+    ~BasicKNNRegressor();
+
+    /**
+     * @brief Sets the pool used to answer queries in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
 
     /**
      * @brief Fits the regressor to the training data.
      * @param X A vector of feature vectors (training data).
      * @param y A vector of target values (training labels).
      */
-    void fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y);
+    void fit(const std::vector<std::vector<T>>& X, const std::vector<T>& y);
+
+    /**
+     * @brief Fits the regressor to the training data.
+     * @param X A dense matrix of training samples (one row per sample).
+     * @param y A vector of target values (training labels).
+     */
+    void fit(const ml::BasicMatrixView<T>& X, const std::vector<T>& y);
+
+    /**
+     * @brief Fits the regressor by referencing the caller's training data without copying it.
+     *
+     * X and y must stay alive and unchanged for as long as the model is used.
+     * @param X A dense matrix of training samples (one row per sample).
+     * @param y The target values (training labels).
+     */
+    void fit_view(const ml::BasicMatrixView<T>& X, std::span<const T> y);
 
     /**
      * @brief Predicts target values for the given input data.
      * @param X A vector of feature vectors (test data).
      * @return A vector of predicted target values.
      */
-    std::vector<double> predict(const std::vector<std::vector<double>>& X) const;
+    std::vector<T> predict(const std::vector<std::vector<T>>& X) const;
 
-private:
-    int k;  ///< Number of neighbors to consider.
-    std::vector<std::vector<double>> X_train;  ///< Training data features.
-    std::vector<double> y_train;  ///< Training data target values.
+    /**
+     * @brief Predicts target values for the given input data.
+     * @param X A dense matrix of test samples (one row per sample).
+     * @return A vector of predicted target values.
+     */
+    std::vector<T> predict(const ml::BasicMatrixView<T>& X) const;
+
+    /**
+     * @brief Predicts target values into a caller-provided buffer without allocating.
+     * @param X A dense matrix of test samples (one row per sample), in any layout.
+     * @param predictions Receives one target value per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows().
+     */
+    void predict_into(const ml::BasicMatrixView<T>& X, std::span<T> predictions) const;
 
     /**
-     * @brief Computes the Euclidean distance between two feature vectors.
-     * @param a The first feature vector.
-     * @param b The second feature vector.
-     * @return The Euclidean distance.
+     * @brief Saves the fitted model, including its training data, to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
      */
-    double euclidean_distance(const std::vector<double>& a, const std::vector<double>& b) const;
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the training data is used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a KNNRegressor.
+     */
+    void load(const std::string& path);
+
+private:
+    int k;  ///< Number of neighbors to consider.
+    ml::BasicMatrixHolder<T> X_train;  ///< Training data features, one sample per row.
+    ml::ArrayHolder<T> y_train;  ///< Training data target values.
+    ml::ThreadPool* thread_pool = nullptr;  ///< Pool used by predict, if any.
+    std::shared_ptr<const ml::MappedFile> model_file;  ///< Mapped model file that X_train and y_train borrow from after load().
 
     /**
      * @brief Predicts the target value for a single sample.
      * @param x The feature vector of the sample.
      * @return The predicted target value.
      */
-    double predict_sample(const std::vector<double>& x) const;
+    T predict_sample(const T* x) const;
 };
 
-KNNRegressor::KNNRegressor(int k) : k(k) {}
+/**
+ * @brief K-Nearest Neighbors Regressor on double-precision features.
+ */
+using KNNRegressor = BasicKNNRegressor<double>;
+
+template <typename T>
+BasicKNNRegressor<T>::BasicKNNRegressor(int k) : k(k) {}
 
-KNNRegressor::~KNNRegressor() {}
+template <typename T>
+BasicKNNRegressor<T>::~BasicKNNRegressor() {}
 
-void KNNRegressor::fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y) {
-    X_train = X;
-    y_train = y;
+template <typename T>
+void BasicKNNRegressor<T>::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
 }
 
-std::vector<double> KNNRegressor::predict(const std::vector<std::vector<double>>& X) const {
-    std::vector<double> predictions;
-    predictions.reserve(X.size());
-    for (const auto& x : X) {
-        predictions.push_back(predict_sample(x));
+template <typename T>
+void BasicKNNRegressor<T>::fit(const std::vector<std::vector<T>>& X, const std::vector<T>& y) {
+    if (X.size() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
     }
-    return predictions;
+    X_train.own(ml::BasicMatrix<T>(X));
+    y_train.own(y);
+    model_file.reset();
 }
 
-double KNNRegressor::euclidean_distance(const std::vector<double>& a, const std::vector<double>& b) const {
-    double distance = 0.0;
-    for (size_t i = 0; i < a.size(); ++i) {
-        double diff = a[i] - b[i];
-        distance += diff * diff;
+template <typename T>
+void BasicKNNRegressor<T>::fit(const ml::BasicMatrixView<T>& X, const std::vector<T>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
     }
-    return std::sqrt(distance);
+    X_train.own(ml::BasicMatrix<T>(X));
+    y_train.own(y);
+    model_file.reset();
 }
 
-double KNNRegressor::predict_sample(const std::vector<double>& x) const {
-    // Vector to store distances and corresponding target values
-    std::vector<std::pair<double, double>> distances;
-    distances.reserve(X_train.size());
+template <typename T>
+void BasicKNNRegressor<T>::fit_view(const ml::BasicMatrixView<T>& X, std::span<const T> y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    X_train.borrow(X);
+    y_train.borrow(y);
+    model_file.reset();
+}
+
+template <typename T>
+std::vector<T> BasicKNNRegressor<T>::predict(const std::vector<std::vector<T>>& X) const {
+    std::vector<T> predictions(X.size());
+    ml::parallel_for(thread_pool, 0, X.size(), [&](size_t i) {
+        predictions[i] = predict_sample(X[i].data());
+    });
+    return predictions;
+}
 
-    // Compute distances to all training samples
-    for (size_t i = 0; i < X_train.size(); ++i) {
-        double dist = euclidean_distance(x, X_train[i]);
-        distances.emplace_back(dist, y_train[i]);
+template <typename T>
+std::vector<T> BasicKNNRegressor<T>::predict(const ml::BasicMatrixView<T>& X) const {
+    std::vector<T> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+template <typename T>
+void BasicKNNRegressor<T>::predict_into(const ml::BasicMatrixView<T>& X, std::span<T> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::parallel_for_blocks(thread_pool, 0, X.rows(), [&](size_t begin, size_t end) {
+        std::span<T> row_buffer = ml::scratch<T, 1>(X.cols());
+        for (size_t i = begin; i < end; ++i) {
+            predictions[i] = predict_sample(ml::contiguous_row(X, i, row_buffer));
+        }
+    });
+}
+
+template <typename T>
+T BasicKNNRegressor<T>::predict_sample(const T* x) const {
+    ml::BasicMatrixView<T> train = X_train.view();
+    std::span<const T> targets = y_train.span();
+
+    // Compute squared distances to all training samples; the square root would not change their order
+    std::span<T> squared_distances = ml::scratch<T>(train.rows());
+    ml::kernels::squared_l2_one_to_many(x, train, squared_distances.data());
+
+    // Pair the distances with their target values in a per-thread buffer reused across calls
+    std::span<std::pair<T, T>> distances = ml::scratch<std::pair<T, T>>(train.rows());
+    for (size_t i = 0; i < train.rows(); ++i) {
+        distances[i] = {squared_distances[i], targets[i]};
     }
 
     // Find the k nearest neighbors
     std::nth_element(distances.begin(), distances.begin() + k, distances.end(),
-                     [](const std::pair<double, double>& a, const std::pair<double, double>& b) {
+                     [](const std::pair<T, T>& a, const std::pair<T, T>& b) {
                          return a.first < b.first;
                      });
 
     // Compute the average of the target values of the k nearest neighbors
-    double sum = 0.0;
+    T sum = 0;
     for (int i = 0; i < k; ++i) {
         sum += distances[i].second;
     }
     return sum / k;
 }
 
+template <typename T>
+void BasicKNNRegressor<T>::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::KNNRegressor, 2);
+    writer.write_scalar_type<T>();
+    writer.write_int(k);
+    writer.write_matrix(X_train.view());
+    writer.write_array(y_train.span());
+    writer.finish();
+}
+
+template <typename T>
+void BasicKNNRegressor<T>::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::KNNRegressor, 2);
+    reader.read_scalar_type<T>(2);
+    int new_k = reader.read_int<int>();
+    ml::BasicMatrixView<T> X = reader.read_matrix<T>();
+    std::span<const T> y = reader.read_array<T>();
+    if (X.rows() != y.size()) {
+        throw std::runtime_error("Model file holds mismatched samples and targets.");
+    }
+    k = new_k;
+    X_train.borrow(X);
+    y_train.borrow(y);
+    model_file = std::move(file);
+}
+
 #endif // KNN_REGRESSOR_HPP
@@ -0,0 +1,97 @@
+#ifndef ML_DATA_HOLDER_HPP
+#define ML_DATA_HOLDER_HPP
+
+#include <vector>
+#include <span>
+#include <cstddef>
+#include "Matrix.hpp"
+
+/**
+ * @file DataHolder.hpp
+ * @brief Training-data members that either own their storage or borrow the caller's.
+ */
+
+namespace ml {
+
+/**
+ * @class BasicMatrixHolder
+ * @brief Holds a row-major sample matrix that is either owned or borrowed from the caller.
+ *
+ * Borrowed data is never copied, so the caller must keep it alive for as long as it is held.
+ * @tparam T The element type.
+ */
+template <typename T>
+class BasicMatrixHolder {
+public:
+    /**
+     * @brief Takes ownership of a matrix.
+     */
+    void own(BasicMatrix<T> matrix) {
+        owned_ = std::move(matrix);
+        borrowed_ = BasicMatrixView<T>();
+        is_borrowed_ = false;
+    }
+
+    /**
+     * @brief References caller memory without copying.
+     *
+     * Views whose rows are not contiguous are packed once into owned storage, since
+     * row-wise kernels need each sample to be contiguous.
+     */
+    void borrow(const BasicMatrixView<T>& view) {
+        if (!view.is_row_contiguous()) {
+            own(BasicMatrix<T>(view));
+            return;
+        }
+        owned_ = BasicMatrix<T>();
+        borrowed_ = view;
+        is_borrowed_ = true;
+    }
+
+    BasicMatrixView<T> view() const { return is_borrowed_ ? borrowed_ : owned_.view(); }
+    std::size_t rows() const { return view().rows(); }
+    std::size_t cols() const { return view().cols(); }
+    const T* row(std::size_t i) const { return view().row(i); }
+    bool is_borrowed() const { return is_borrowed_; }
+
+private:
+    BasicMatrix<T> owned_;
+    BasicMatrixView<T> borrowed_;
+    bool is_borrowed_ = false;
+};
+
+using MatrixHolder = BasicMatrixHolder<double>;
+
+/**
+ * @class ArrayHolder
+ * @brief Holds a one-dimensional array that is either owned or borrowed from the caller.
+ */
+template <typename T>
+class ArrayHolder {
+public:
+    void own(std::vector<T> values) {
+        owned_ = std::move(values);
+        borrowed_ = std::span<const T>();
+        is_borrowed_ = false;
+    }
+
+    void borrow(std::span<const T> values) {
+        owned_.clear();
+        borrowed_ = values;
+        is_borrowed_ = true;
+    }
+
+    std::span<const T> span() const { return is_borrowed_ ? borrowed_ : std::span<const T>(owned_); }
+    std::size_t size() const { return span().size(); }
+    const T& operator[](std::size_t i) const { return span()[i]; }
+    bool is_borrowed() const { return is_borrowed_; }
+
+private:
+    std::vector<T> owned_;
+    std::span<const T> borrowed_;
+    bool is_borrowed_ = false;
+};
+
+} // namespace ml
+
+#endif // ML_DATA_HOLDER_HPP
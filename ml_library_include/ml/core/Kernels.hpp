@@ -0,0 +1,1070 @@
+#ifndef ML_KERNELS_HPP
+#define ML_KERNELS_HPP
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "Matrix.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ML_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(ML_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ML_KERNEL_TARGET(features) __attribute__((target(features)))
+#else
+#define ML_KERNEL_TARGET(features)
+#endif
+
+/**
+ * @file Kernels.hpp
+ * @brief Vectorized distance and dot-product kernels shared by all estimators.
+ *
+ * Every kernel has a scalar, SSE2, AVX2 (with FMA) and AVX-512F implementation. The widest one
+ * the CPU and operating system support is chosen once at startup via CPUID, so the library
+ * does not need to be compiled with -mavx2 or similar flags. Other architectures use the
+ * scalar kernels, which keep several partial sums so that the compiler can vectorize them.
+ *
+ * The implementations add in different orders, so results may differ in the last bits between
+ * instruction sets.
+ *
+ * Every kernel exists for double and float. Float kernels accumulate in single precision and
+ * process twice as many elements per instruction.
+ */
+
+namespace ml {
+namespace kernels {
+
+/**
+ * @brief Instruction sets with a kernel implementation, from narrowest to widest.
+ */
+enum class Isa {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+inline const char* isa_name(Isa isa) {
+    switch (isa) {
+        case Isa::SSE2: return "sse2";
+        case Isa::AVX2: return "avx2";
+        case Isa::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+/**
+ * @brief Function table of one instruction set for elements of type T.
+ *
+ * The *_rows entries evaluate x against rows consecutive rows of Y, each row_stride elements
+ * apart, so that dispatch happens once per batch instead of once per pair.
+ */
+template <typename T>
+struct BasicKernelTable {
+    Isa isa;
+    T (*squared_l2)(const T* a, const T* b, std::size_t n);
+    T (*dot)(const T* a, const T* b, std::size_t n);
+    T (*l1)(const T* a, const T* b, std::size_t n);
+    void (*cosine_terms)(const T* a, const T* b, std::size_t n, T* ab, T* aa, T* bb);
+    void (*squared_l2_rows)(const T* x, const T* Y, std::size_t rows, std::size_t n,
+                            std::size_t row_stride, T* out);
+    void (*dot_rows)(const T* x, const T* Y, std::size_t rows, std::size_t n,
+                     std::size_t row_stride, T* out);
+};
+
+using KernelTable = BasicKernelTable<double>;
+
+namespace detail {
+
+// Scalar kernels: four partial sums break the dependency chain of the accumulation
+
+template <typename T>
+T squared_l2_scalar(const T* a, const T* b, std::size_t n) {
+    T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        T d0 = a[i] - b[i], d1 = a[i + 1] - b[i + 1], d2 = a[i + 2] - b[i + 2], d3 = a[i + 3] - b[i + 3];
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    for (; i < n; ++i) {
+        T d = a[i] - b[i];
+        s0 += d * d;
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <typename T>
+T dot_scalar(const T* a, const T* b, std::size_t n) {
+    T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <typename T>
+T l1_scalar(const T* a, const T* b, std::size_t n) {
+    T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += std::abs(a[i] - b[i]);
+        s1 += std::abs(a[i + 1] - b[i + 1]);
+        s2 += std::abs(a[i + 2] - b[i + 2]);
+        s3 += std::abs(a[i + 3] - b[i + 3]);
+    }
+    for (; i < n; ++i) {
+        s0 += std::abs(a[i] - b[i]);
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template <typename T>
+void cosine_terms_scalar(const T* a, const T* b, std::size_t n, T* ab, T* aa, T* bb) {
+    T sab = 0, saa = 0, sbb = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sab += a[i] * b[i];
+        saa += a[i] * a[i];
+        sbb += b[i] * b[i];
+    }
+    *ab = sab;
+    *aa = saa;
+    *bb = sbb;
+}
+
+template <typename T>
+void squared_l2_rows_scalar(const T* x, const T* Y, std::size_t rows, std::size_t n,
+                            std::size_t row_stride, T* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_scalar(x, Y + r * row_stride, n);
+    }
+}
+
+template <typename T>
+void dot_rows_scalar(const T* x, const T* Y, std::size_t rows, std::size_t n,
+                     std::size_t row_stride, T* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_scalar(x, Y + r * row_stride, n);
+    }
+}
+
+template <typename T>
+inline const BasicKernelTable<T> scalar_table = {
+    Isa::Scalar, squared_l2_scalar<T>, dot_scalar<T>, l1_scalar<T>, cosine_terms_scalar<T>,
+    squared_l2_rows_scalar<T>, dot_rows_scalar<T>
+};
+
+#ifdef ML_KERNELS_X86
+
+// SSE2: two lanes, two accumulators
+
+ML_KERNEL_TARGET("sse2") inline double hsum_sse2(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+ML_KERNEL_TARGET("sse2") inline double squared_l2_sse2(const double* a, const double* b, std::size_t n) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+    }
+    double sum = hsum_sse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i) {
+        double d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("sse2") inline double dot_sse2(const double* a, const double* b, std::size_t n) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double sum = hsum_sse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("sse2") inline double l1_sse2(const double* a, const double* b, std::size_t n) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))));
+        acc1 = _mm_add_pd(acc1, _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2))));
+    }
+    double sum = hsum_sse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += std::abs(a[i] - b[i]);
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("sse2") inline void cosine_terms_sse2(const double* a, const double* b, std::size_t n,
+                                                        double* ab, double* aa, double* bb) {
+    __m128d sab = _mm_setzero_pd();
+    __m128d saa = _mm_setzero_pd();
+    __m128d sbb = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d va = _mm_loadu_pd(a + i);
+        __m128d vb = _mm_loadu_pd(b + i);
+        sab = _mm_add_pd(sab, _mm_mul_pd(va, vb));
+        saa = _mm_add_pd(saa, _mm_mul_pd(va, va));
+        sbb = _mm_add_pd(sbb, _mm_mul_pd(vb, vb));
+    }
+    double tab = hsum_sse2(sab), taa = hsum_sse2(saa), tbb = hsum_sse2(sbb);
+    for (; i < n; ++i) {
+        tab += a[i] * b[i];
+        taa += a[i] * a[i];
+        tbb += b[i] * b[i];
+    }
+    *ab = tab;
+    *aa = taa;
+    *bb = tbb;
+}
+
+ML_KERNEL_TARGET("sse2") inline void squared_l2_rows_sse2(const double* x, const double* Y, std::size_t rows,
+                                                           std::size_t n, std::size_t row_stride, double* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_sse2(x, Y + r * row_stride, n);
+    }
+}
+
+ML_KERNEL_TARGET("sse2") inline void dot_rows_sse2(const double* x, const double* Y, std::size_t rows,
+                                                    std::size_t n, std::size_t row_stride, double* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_sse2(x, Y + r * row_stride, n);
+    }
+}
+
+inline const KernelTable sse2_table = {
+    Isa::SSE2, squared_l2_sse2, dot_sse2, l1_sse2, cosine_terms_sse2,
+    squared_l2_rows_sse2, dot_rows_sse2
+};
+
+// AVX2: four lanes, four accumulators, fused multiply-add
+
+ML_KERNEL_TARGET("avx2,fma") inline double hsum_avx2(__m256d v) {
+    __m128d low = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline double squared_l2_avx2(const double* a, const double* b, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        __m256d d2 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8));
+        __m256d d3 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        acc0 = _mm256_fmadd_pd(d, d, acc0);
+    }
+    double sum = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < n; ++i) {
+        double d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline double dot_avx2(const double* a, const double* b, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+        acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), acc2);
+        acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), acc3);
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+    }
+    double sum = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline double l1_avx2(const double* a, const double* b, std::size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, d0));
+        acc1 = _mm256_add_pd(acc1, _mm256_andnot_pd(sign, d1));
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, d));
+    }
+    double sum = hsum_avx2(_mm256_add_pd(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += std::abs(a[i] - b[i]);
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline void cosine_terms_avx2(const double* a, const double* b, std::size_t n,
+                                                            double* ab, double* aa, double* bb) {
+    __m256d sab = _mm256_setzero_pd();
+    __m256d saa = _mm256_setzero_pd();
+    __m256d sbb = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d va = _mm256_loadu_pd(a + i);
+        __m256d vb = _mm256_loadu_pd(b + i);
+        sab = _mm256_fmadd_pd(va, vb, sab);
+        saa = _mm256_fmadd_pd(va, va, saa);
+        sbb = _mm256_fmadd_pd(vb, vb, sbb);
+    }
+    double tab = hsum_avx2(sab), taa = hsum_avx2(saa), tbb = hsum_avx2(sbb);
+    for (; i < n; ++i) {
+        tab += a[i] * b[i];
+        taa += a[i] * a[i];
+        tbb += b[i] * b[i];
+    }
+    *ab = tab;
+    *aa = taa;
+    *bb = tbb;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline void squared_l2_rows_avx2(const double* x, const double* Y, std::size_t rows,
+                                                               std::size_t n, std::size_t row_stride, double* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_avx2(x, Y + r * row_stride, n);
+    }
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline void dot_rows_avx2(const double* x, const double* Y, std::size_t rows,
+                                                        std::size_t n, std::size_t row_stride, double* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_avx2(x, Y + r * row_stride, n);
+    }
+}
+
+inline const KernelTable avx2_table = {
+    Isa::AVX2, squared_l2_avx2, dot_avx2, l1_avx2, cosine_terms_avx2,
+    squared_l2_rows_avx2, dot_rows_avx2
+};
+
+// AVX-512: eight lanes, two accumulators, masked loads for the tail
+
+ML_KERNEL_TARGET("avx512f") inline double hsum_avx512(__m512d v) {
+    // Spills to memory; the GCC 12 reduce and shuffle intrinsics trip -Wuninitialized
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, v);
+    return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+ML_KERNEL_TARGET("avx512f") inline __mmask8 tail_mask_avx512(std::size_t remaining) {
+    return static_cast<__mmask8>((1u << remaining) - 1u);
+}
+
+ML_KERNEL_TARGET("avx512f") inline double squared_l2_avx512(const double* a, const double* b, std::size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m512d d = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        acc0 = _mm512_fmadd_pd(d, d, acc0);
+    }
+    if (i < n) {
+        __mmask8 mask = tail_mask_avx512(n - i);
+        __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i));
+        acc1 = _mm512_fmadd_pd(d, d, acc1);
+    }
+    return hsum_avx512(_mm512_add_pd(acc0, acc1));
+}
+
+ML_KERNEL_TARGET("avx512f") inline double dot_avx512(const double* a, const double* b, std::size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+    }
+    if (i < n) {
+        __mmask8 mask = tail_mask_avx512(n - i);
+        acc1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i), acc1);
+    }
+    return hsum_avx512(_mm512_add_pd(acc0, acc1));
+}
+
+ML_KERNEL_TARGET("avx512f") inline double l1_avx512(const double* a, const double* b, std::size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_add_pd(acc0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i))));
+        acc1 = _mm512_add_pd(acc1, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8))));
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm512_add_pd(acc0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i))));
+    }
+    if (i < n) {
+        __mmask8 mask = tail_mask_avx512(n - i);
+        __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i));
+        acc1 = _mm512_add_pd(acc1, _mm512_abs_pd(d));
+    }
+    return hsum_avx512(_mm512_add_pd(acc0, acc1));
+}
+
+ML_KERNEL_TARGET("avx512f") inline void cosine_terms_avx512(const double* a, const double* b, std::size_t n,
+                                                             double* ab, double* aa, double* bb) {
+    __m512d sab = _mm512_setzero_pd();
+    __m512d saa = _mm512_setzero_pd();
+    __m512d sbb = _mm512_setzero_pd();
+    for (std::size_t i = 0; i < n; i += 8) {
+        __mmask8 mask = n - i >= 8 ? static_cast<__mmask8>(0xFF) : tail_mask_avx512(n - i);
+        __m512d va = _mm512_maskz_loadu_pd(mask, a + i);
+        __m512d vb = _mm512_maskz_loadu_pd(mask, b + i);
+        sab = _mm512_fmadd_pd(va, vb, sab);
+        saa = _mm512_fmadd_pd(va, va, saa);
+        sbb = _mm512_fmadd_pd(vb, vb, sbb);
+    }
+    *ab = hsum_avx512(sab);
+    *aa = hsum_avx512(saa);
+    *bb = hsum_avx512(sbb);
+}
+
+ML_KERNEL_TARGET("avx512f") inline void squared_l2_rows_avx512(const double* x, const double* Y, std::size_t rows,
+                                                                std::size_t n, std::size_t row_stride, double* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_avx512(x, Y + r * row_stride, n);
+    }
+}
+
+ML_KERNEL_TARGET("avx512f") inline void dot_rows_avx512(const double* x, const double* Y, std::size_t rows,
+                                                         std::size_t n, std::size_t row_stride, double* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_avx512(x, Y + r * row_stride, n);
+    }
+}
+
+inline const KernelTable avx512_table = {
+    Isa::AVX512, squared_l2_avx512, dot_avx512, l1_avx512, cosine_terms_avx512,
+    squared_l2_rows_avx512, dot_rows_avx512
+};
+
+// Single precision: the same kernels over twice as many lanes
+
+ML_KERNEL_TARGET("sse2") inline float hsum_sse2(__m128 v) {
+    __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 0x55)));
+}
+
+ML_KERNEL_TARGET("sse2") inline float squared_l2_sse2(const float* a, const float* b, std::size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    float sum = hsum_sse2(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("sse2") inline float dot_sse2(const float* a, const float* b, std::size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float sum = hsum_sse2(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("sse2") inline float l1_sse2(const float* a, const float* b, std::size_t n) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))));
+        acc1 = _mm_add_ps(acc1, _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4))));
+    }
+    float sum = hsum_sse2(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += std::abs(a[i] - b[i]);
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("sse2") inline void cosine_terms_sse2(const float* a, const float* b, std::size_t n,
+                                                        float* ab, float* aa, float* bb) {
+    __m128 sab = _mm_setzero_ps();
+    __m128 saa = _mm_setzero_ps();
+    __m128 sbb = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        sab = _mm_add_ps(sab, _mm_mul_ps(va, vb));
+        saa = _mm_add_ps(saa, _mm_mul_ps(va, va));
+        sbb = _mm_add_ps(sbb, _mm_mul_ps(vb, vb));
+    }
+    float tab = hsum_sse2(sab), taa = hsum_sse2(saa), tbb = hsum_sse2(sbb);
+    for (; i < n; ++i) {
+        tab += a[i] * b[i];
+        taa += a[i] * a[i];
+        tbb += b[i] * b[i];
+    }
+    *ab = tab;
+    *aa = taa;
+    *bb = tbb;
+}
+
+ML_KERNEL_TARGET("sse2") inline void squared_l2_rows_sse2(const float* x, const float* Y, std::size_t rows,
+                                                           std::size_t n, std::size_t row_stride, float* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_sse2(x, Y + r * row_stride, n);
+    }
+}
+
+ML_KERNEL_TARGET("sse2") inline void dot_rows_sse2(const float* x, const float* Y, std::size_t rows,
+                                                    std::size_t n, std::size_t row_stride, float* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_sse2(x, Y + r * row_stride, n);
+    }
+}
+
+inline const BasicKernelTable<float> sse2_table_f = {
+    Isa::SSE2, squared_l2_sse2, dot_sse2, l1_sse2, cosine_terms_sse2,
+    squared_l2_rows_sse2, dot_rows_sse2
+};
+
+ML_KERNEL_TARGET("avx2,fma") inline float hsum_avx2(__m256 v) {
+    return hsum_sse2(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline float squared_l2_avx2(const float* a, const float* b, std::size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));
+        __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+    float sum = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < n; ++i) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline float dot_avx2(const float* a, const float* b, std::size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline float l1_avx2(const float* a, const float* b, std::size_t n) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_add_ps(acc0, _mm256_andnot_ps(sign, d0));
+        acc1 = _mm256_add_ps(acc1, _mm256_andnot_ps(sign, d1));
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_add_ps(acc0, _mm256_andnot_ps(sign, d));
+    }
+    float sum = hsum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += std::abs(a[i] - b[i]);
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline void cosine_terms_avx2(const float* a, const float* b, std::size_t n,
+                                                            float* ab, float* aa, float* bb) {
+    __m256 sab = _mm256_setzero_ps();
+    __m256 saa = _mm256_setzero_ps();
+    __m256 sbb = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 va = _mm256_loadu_ps(a + i);
+        __m256 vb = _mm256_loadu_ps(b + i);
+        sab = _mm256_fmadd_ps(va, vb, sab);
+        saa = _mm256_fmadd_ps(va, va, saa);
+        sbb = _mm256_fmadd_ps(vb, vb, sbb);
+    }
+    float tab = hsum_avx2(sab), taa = hsum_avx2(saa), tbb = hsum_avx2(sbb);
+    for (; i < n; ++i) {
+        tab += a[i] * b[i];
+        taa += a[i] * a[i];
+        tbb += b[i] * b[i];
+    }
+    *ab = tab;
+    *aa = taa;
+    *bb = tbb;
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline void squared_l2_rows_avx2(const float* x, const float* Y, std::size_t rows,
+                                                               std::size_t n, std::size_t row_stride, float* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_avx2(x, Y + r * row_stride, n);
+    }
+}
+
+ML_KERNEL_TARGET("avx2,fma") inline void dot_rows_avx2(const float* x, const float* Y, std::size_t rows,
+                                                        std::size_t n, std::size_t row_stride, float* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_avx2(x, Y + r * row_stride, n);
+    }
+}
+
+inline const BasicKernelTable<float> avx2_table_f = {
+    Isa::AVX2, squared_l2_avx2, dot_avx2, l1_avx2, cosine_terms_avx2,
+    squared_l2_rows_avx2, dot_rows_avx2
+};
+
+ML_KERNEL_TARGET("avx512f") inline float hsum_avx512(__m512 v) {
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, v);
+    float sum = 0.0f;
+    for (std::size_t k = 0; k < 8; ++k) {
+        sum += lanes[k] + lanes[k + 8];
+    }
+    return sum;
+}
+
+ML_KERNEL_TARGET("avx512f") inline __mmask16 tail_mask16_avx512(std::size_t remaining) {
+    return static_cast<__mmask16>((1u << remaining) - 1u);
+}
+
+ML_KERNEL_TARGET("avx512f") inline float squared_l2_avx512(const float* a, const float* b, std::size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc0 = _mm512_fmadd_ps(d, d, acc0);
+    }
+    if (i < n) {
+        __mmask16 mask = tail_mask16_avx512(n - i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        acc1 = _mm512_fmadd_ps(d, d, acc1);
+    }
+    return hsum_avx512(_mm512_add_ps(acc0, acc1));
+}
+
+ML_KERNEL_TARGET("avx512f") inline float dot_avx512(const float* a, const float* b, std::size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        __mmask16 mask = tail_mask16_avx512(n - i);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return hsum_avx512(_mm512_add_ps(acc0, acc1));
+}
+
+ML_KERNEL_TARGET("avx512f") inline float l1_avx512(const float* a, const float* b, std::size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_add_ps(acc0, _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i))));
+        acc1 = _mm512_add_ps(acc1, _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16))));
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_add_ps(acc0, _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i))));
+    }
+    if (i < n) {
+        __mmask16 mask = tail_mask16_avx512(n - i);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        acc1 = _mm512_add_ps(acc1, _mm512_abs_ps(d));
+    }
+    return hsum_avx512(_mm512_add_ps(acc0, acc1));
+}
+
+ML_KERNEL_TARGET("avx512f") inline void cosine_terms_avx512(const float* a, const float* b, std::size_t n,
+                                                             float* ab, float* aa, float* bb) {
+    __m512 sab = _mm512_setzero_ps();
+    __m512 saa = _mm512_setzero_ps();
+    __m512 sbb = _mm512_setzero_ps();
+    for (std::size_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tail_mask16_avx512(n - i);
+        __m512 va = _mm512_maskz_loadu_ps(mask, a + i);
+        __m512 vb = _mm512_maskz_loadu_ps(mask, b + i);
+        sab = _mm512_fmadd_ps(va, vb, sab);
+        saa = _mm512_fmadd_ps(va, va, saa);
+        sbb = _mm512_fmadd_ps(vb, vb, sbb);
+    }
+    *ab = hsum_avx512(sab);
+    *aa = hsum_avx512(saa);
+    *bb = hsum_avx512(sbb);
+}
+
+ML_KERNEL_TARGET("avx512f") inline void squared_l2_rows_avx512(const float* x, const float* Y, std::size_t rows,
+                                                                std::size_t n, std::size_t row_stride, float* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = squared_l2_avx512(x, Y + r * row_stride, n);
+    }
+}
+
+ML_KERNEL_TARGET("avx512f") inline void dot_rows_avx512(const float* x, const float* Y, std::size_t rows,
+                                                         std::size_t n, std::size_t row_stride, float* out) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        out[r] = dot_avx512(x, Y + r * row_stride, n);
+    }
+}
+
+inline const BasicKernelTable<float> avx512_table_f = {
+    Isa::AVX512, squared_l2_avx512, dot_avx512, l1_avx512, cosine_terms_avx512,
+    squared_l2_rows_avx512, dot_rows_avx512
+};
+
+#endif // ML_KERNELS_X86
+
+/**
+ * @brief Queries CPUID (and XGETBV for the register state the OS saves) for the widest usable ISA.
+ */
+inline Isa query_cpu_isa() {
+#if defined(ML_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Isa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Isa::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Isa::SSE2;
+    }
+    return Isa::Scalar;
+#elif defined(ML_KERNELS_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx_state = (xcr0 & 0x6) == 0x6;
+    bool avx512_state = (xcr0 & 0xE6) == 0xE6;
+    bool avx2 = false;
+    bool avx512f = false;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+        avx512f = (info[1] & (1 << 16)) != 0;
+    }
+    if (avx512f && avx512_state) {
+        return Isa::AVX512;
+    }
+    if (avx && avx2 && fma && avx_state) {
+        return Isa::AVX2;
+    }
+    return sse2 ? Isa::SSE2 : Isa::Scalar;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+template <typename T>
+const BasicKernelTable<T>& table_for(Isa isa) {
+#ifdef ML_KERNELS_X86
+    static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>, "Kernels exist for double and float.");
+    switch (isa) {
+        case Isa::AVX512:
+            if constexpr (std::is_same_v<T, double>) return avx512_table; else return avx512_table_f;
+        case Isa::AVX2:
+            if constexpr (std::is_same_v<T, double>) return avx2_table; else return avx2_table_f;
+        case Isa::SSE2:
+            if constexpr (std::is_same_v<T, double>) return sse2_table; else return sse2_table_f;
+        default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return scalar_table<T>;
+}
+
+template <typename T>
+std::atomic<const BasicKernelTable<T>*>& active_table() {
+    static std::atomic<const BasicKernelTable<T>*> table{&table_for<T>(query_cpu_isa())};
+    return table;
+}
+
+} // namespace detail
+
+/**
+ * @brief Widest instruction set supported by this CPU and operating system.
+ */
+inline Isa detected_isa() {
+    static const Isa isa = detail::query_cpu_isa();
+    return isa;
+}
+
+/**
+ * @brief Function table currently used by the kernels below for elements of type T.
+ */
+template <typename T = double>
+const BasicKernelTable<T>& table() {
+    return *detail::active_table<T>().load(std::memory_order_relaxed);
+}
+
+inline Isa active_isa() {
+    return table().isa;
+}
+
+/**
+ * @brief Selects the kernels of an instruction set, e.g. to compare implementations.
+ * @param isa The requested instruction set; lowered to detected_isa() if wider.
+ * @return The instruction set now in use.
+ */
+inline Isa set_isa(Isa isa) {
+    isa = std::min(isa, detected_isa());
+    detail::active_table<double>().store(&detail::table_for<double>(isa), std::memory_order_relaxed);
+    detail::active_table<float>().store(&detail::table_for<float>(isa), std::memory_order_relaxed);
+    return isa;
+}
+
+/**
+ * @brief Squared Euclidean distance between a and b.
+ */
+template <typename T>
+T squared_l2(const T* a, const T* b, std::size_t n) {
+    return table<T>().squared_l2(a, b, n);
+}
+
+/**
+ * @brief Euclidean distance between a and b.
+ */
+template <typename T>
+T l2(const T* a, const T* b, std::size_t n) {
+    return std::sqrt(table<T>().squared_l2(a, b, n));
+}
+
+/**
+ * @brief Dot product of a and b.
+ */
+template <typename T>
+T dot(const T* a, const T* b, std::size_t n) {
+    return table<T>().dot(a, b, n);
+}
+
+/**
+ * @brief Manhattan distance between a and b.
+ */
+template <typename T>
+T l1(const T* a, const T* b, std::size_t n) {
+    return table<T>().l1(a, b, n);
+}
+
+/**
+ * @brief Cosine distance 1 - cos(a, b); 1 if either vector is zero.
+ */
+template <typename T>
+T cosine_distance(const T* a, const T* b, std::size_t n) {
+    T ab = 0, aa = 0, bb = 0;
+    table<T>().cosine_terms(a, b, n, &ab, &aa, &bb);
+    if (aa == 0 || bb == 0) {
+        return 1;
+    }
+    return 1 - ab / std::sqrt(aa * bb);
+}
+
+/**
+ * @brief Squared Euclidean distances from x to every row of Y.
+ * @param x A vector of Y.cols() elements.
+ * @param Y Rows to compare against; must be row-contiguous (see as_row_major()).
+ * @param out Receives Y.rows() distances.
+ */
+template <typename T>
+void squared_l2_one_to_many(const T* x, const std::type_identity_t<BasicMatrixView<T>>& Y, T* out) {
+    table<T>().squared_l2_rows(x, Y.data(), Y.rows(), Y.cols(), Y.row_stride(), out);
+}
+
+/**
+ * @brief Dot products of x with every row of Y.
+ * @param x A vector of Y.cols() elements.
+ * @param Y Rows to multiply with; must be row-contiguous (see as_row_major()).
+ * @param out Receives Y.rows() products.
+ */
+template <typename T>
+void dot_one_to_many(const T* x, const std::type_identity_t<BasicMatrixView<T>>& Y, T* out) {
+    table<T>().dot_rows(x, Y.data(), Y.rows(), Y.cols(), Y.row_stride(), out);
+}
+
+namespace detail {
+
+template <typename T, typename RowsKernel>
+BasicMatrix<T> many_to_many(const BasicMatrixView<T>& X_in, const BasicMatrixView<T>& Y_in, ThreadPool* pool,
+                            RowsKernel rows_kernel) {
+    if (X_in.cols() != Y_in.cols()) {
+        throw std::invalid_argument("X and Y must have the same number of columns.");
+    }
+    BasicMatrix<T> X_packed;
+    BasicMatrix<T> Y_packed;
+    BasicMatrixView<T> X = as_row_major(X_in, X_packed);
+    BasicMatrixView<T> Y = as_row_major(Y_in, Y_packed);
+    BasicMatrix<T> result(X.rows(), Y.rows());
+    // Blocks of Y small enough to stay in cache while a block of X rows is compared against them
+    std::size_t y_block = std::max<std::size_t>(16, (std::size_t(32) << 10) / std::max<std::size_t>(1, Y.cols() * sizeof(T)));
+    parallel_for_blocks(pool, 0, X.rows(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t y0 = 0; y0 < Y.rows(); y0 += y_block) {
+            std::size_t count = std::min(y_block, Y.rows() - y0);
+            for (std::size_t i = begin; i < end; ++i) {
+                rows_kernel(X.row(i), Y.row(y0), count, Y.cols(), Y.row_stride(), result.row(i) + y0);
+            }
+        }
+    }, 16);
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief Squared Euclidean distances between every row of X and every row of Y.
+ * @param pool Pool used to split the rows of X, or nullptr.
+ * @return An X.rows() x Y.rows() row-major matrix.
+ * @throw std::invalid_argument If X and Y have different numbers of columns.
+ */
+inline Matrix squared_l2_many_to_many(const MatrixView& X, const MatrixView& Y, ThreadPool* pool = nullptr) {
+    return detail::many_to_many(X, Y, pool, table<double>().squared_l2_rows);
+}
+
+inline BasicMatrix<float> squared_l2_many_to_many(const BasicMatrixView<float>& X, const BasicMatrixView<float>& Y,
+                                                  ThreadPool* pool = nullptr) {
+    return detail::many_to_many(X, Y, pool, table<float>().squared_l2_rows);
+}
+
+/**
+ * @brief Dot products between every row of X and every row of Y.
+ * @param pool Pool used to split the rows of X, or nullptr.
+ * @return An X.rows() x Y.rows() row-major matrix.
+ * @throw std::invalid_argument If X and Y have different numbers of columns.
+ */
+inline Matrix dot_many_to_many(const MatrixView& X, const MatrixView& Y, ThreadPool* pool = nullptr) {
+    return detail::many_to_many(X, Y, pool, table<double>().dot_rows);
+}
+
+inline BasicMatrix<float> dot_many_to_many(const BasicMatrixView<float>& X, const BasicMatrixView<float>& Y,
+                                           ThreadPool* pool = nullptr) {
+    return detail::many_to_many(X, Y, pool, table<float>().dot_rows);
+}
+
+} // namespace kernels
+} // namespace ml
+
+#endif // ML_KERNELS_HPP
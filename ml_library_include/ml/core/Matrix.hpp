@@ -0,0 +1,277 @@
+#ifndef ML_MATRIX_HPP
+#define ML_MATRIX_HPP
+
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+#include <algorithm>
+#include <span>
+#include <type_traits>
+
+/**
+ * @file Matrix.hpp
+ * @brief Dense contiguous matrix storage and non-owning strided views shared by all estimators.
+ *
+ * Both are templates on the element type; Matrix and MatrixView are the double instantiations
+ * used by default, and BasicMatrix<float> halves the memory of models that store samples.
+ */
+
+namespace ml {
+
+/**
+ * @brief Memory order of the elements of a Matrix.
+ */
+enum class Layout {
+    RowMajor,
+    ColMajor
+};
+
+/**
+ * @class BasicMatrixView
+ * @brief Non-owning, read-only view of a dense matrix described by a pointer and element strides.
+ *
+ * Element (i, j) lives at data[i * row_stride + j * col_stride], so the same type describes
+ * row-major, column-major and sliced storage without copying.
+ * @tparam T The element type.
+ */
+template <typename T>
+class BasicMatrixView {
+public:
+    /**
+     * @brief Constructs an empty view.
+     */
+    BasicMatrixView() = default;
+
+    /**
+     * @brief Constructs a view over packed storage.
+     * @param data Pointer to the first element.
+     * @param rows Number of rows.
+     * @param cols Number of columns.
+     * @param layout Memory order of the packed storage.
+     */
+    BasicMatrixView(const T* data, std::size_t rows, std::size_t cols, Layout layout = Layout::RowMajor)
+        : data_(data), rows_(rows), cols_(cols),
+          row_stride_(layout == Layout::RowMajor ? cols : 1),
+          col_stride_(layout == Layout::RowMajor ? 1 : rows) {}
+
+    /**
+     * @brief Constructs a view over packed storage owned by the caller (e.g. an mmapped file).
+     * @param data The elements; must hold at least rows * cols values.
+     * @param rows Number of rows.
+     * @param cols Number of columns.
+     * @param layout Memory order of the packed storage.
+     * @throw std::invalid_argument If data is too small for the requested shape.
+     */
+    BasicMatrixView(std::span<const T> data, std::size_t rows, std::size_t cols, Layout layout = Layout::RowMajor)
+        : BasicMatrixView(data.data(), rows, cols, layout) {
+        if (data.size() < rows * cols) {
+            throw std::invalid_argument("Buffer is smaller than rows * cols.");
+        }
+    }
+
+    /**
+     * @brief Constructs a view with explicit element strides.
+     * @param data Pointer to the first element.
+     * @param rows Number of rows.
+     * @param cols Number of columns.
+     * @param row_stride Distance in elements between consecutive rows.
+     * @param col_stride Distance in elements between consecutive columns.
+     */
+    BasicMatrixView(const T* data, std::size_t rows, std::size_t cols, std::size_t row_stride, std::size_t col_stride)
+        : data_(data), rows_(rows), cols_(cols), row_stride_(row_stride), col_stride_(col_stride) {}
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+    std::size_t row_stride() const { return row_stride_; }
+    std::size_t col_stride() const { return col_stride_; }
+    const T* data() const { return data_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    /**
+     * @brief Returns element (i, j).
+     */
+    T operator()(std::size_t i, std::size_t j) const {
+        return data_[i * row_stride_ + j * col_stride_];
+    }
+
+    /**
+     * @brief Whether the elements of each row are adjacent in memory.
+     */
+    bool is_row_contiguous() const {
+        return col_stride_ == 1 || cols_ <= 1;
+    }
+
+    /**
+     * @brief Returns a pointer to the first element of row i. Only valid if is_row_contiguous().
+     */
+    const T* row(std::size_t i) const {
+        return data_ + i * row_stride_;
+    }
+
+    /**
+     * @brief Returns a view of rows [begin, begin + count).
+     */
+    BasicMatrixView row_block(std::size_t begin, std::size_t count) const {
+        if (begin > rows_ || count > rows_ - begin) {
+            throw std::out_of_range("Row block exceeds the matrix bounds.");
+        }
+        return BasicMatrixView(data_ + begin * row_stride_, count, cols_, row_stride_, col_stride_);
+    }
+
+private:
+    const T* data_ = nullptr;
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+    std::size_t row_stride_ = 0;
+    std::size_t col_stride_ = 1;
+};
+
+/**
+ * @class BasicMatrix
+ * @brief Owning dense matrix backed by a single allocation.
+ * @tparam T The element type.
+ */
+template <typename T>
+class BasicMatrix {
+public:
+    /**
+     * @brief Constructs an empty matrix.
+     */
+    BasicMatrix() = default;
+
+    /**
+     * @brief Constructs a rows x cols matrix filled with a value.
+     * @param rows Number of rows.
+     * @param cols Number of columns.
+     * @param value Initial value of every element.
+     * @param layout Memory order of the storage.
+     */
+    BasicMatrix(std::size_t rows, std::size_t cols, T value = T(0), Layout layout = Layout::RowMajor)
+        : data_(rows * cols, value), rows_(rows), cols_(cols), layout_(layout) {}
+
+    /**
+     * @brief Packs a vector of equally sized rows into contiguous row-major storage.
+     * @param rows A vector of feature vectors.
+     * @throw std::invalid_argument If the rows do not all have the same length.
+     */
+    explicit BasicMatrix(const std::vector<std::vector<T>>& rows)
+        : rows_(rows.size()), cols_(rows.empty() ? 0 : rows[0].size()) {
+        data_.reserve(rows_ * cols_);
+        for (const auto& row : rows) {
+            if (row.size() != cols_) {
+                throw std::invalid_argument("All rows must have the same number of elements.");
+            }
+            data_.insert(data_.end(), row.begin(), row.end());
+        }
+    }
+
+    /**
+     * @brief Copies the elements of a view into owned storage.
+     * @param view The view to copy.
+     * @param layout Memory order of the new storage.
+     */
+    explicit BasicMatrix(const BasicMatrixView<T>& view, Layout layout = Layout::RowMajor)
+        : data_(view.rows() * view.cols()), rows_(view.rows()), cols_(view.cols()), layout_(layout) {
+        for (std::size_t i = 0; i < rows_; ++i) {
+            for (std::size_t j = 0; j < cols_; ++j) {
+                (*this)(i, j) = view(i, j);
+            }
+        }
+    }
+
+    /**
+     * @brief Copies the elements of a view of another element type, converting each one.
+     * @param view The view to convert, e.g. double samples for a float model.
+     * @param layout Memory order of the new storage.
+     */
+    template <typename U>
+        requires(!std::is_same_v<U, T>)
+    explicit BasicMatrix(const BasicMatrixView<U>& view, Layout layout = Layout::RowMajor)
+        : data_(view.rows() * view.cols()), rows_(view.rows()), cols_(view.cols()), layout_(layout) {
+        for (std::size_t i = 0; i < rows_; ++i) {
+            for (std::size_t j = 0; j < cols_; ++j) {
+                (*this)(i, j) = static_cast<T>(view(i, j));
+            }
+        }
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+    Layout layout() const { return layout_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    T* data() { return data_.data(); }
+    const T* data() const { return data_.data(); }
+
+    T& operator()(std::size_t i, std::size_t j) {
+        return layout_ == Layout::RowMajor ? data_[i * cols_ + j] : data_[j * rows_ + i];
+    }
+
+    T operator()(std::size_t i, std::size_t j) const {
+        return layout_ == Layout::RowMajor ? data_[i * cols_ + j] : data_[j * rows_ + i];
+    }
+
+    /**
+     * @brief Returns a pointer to row i. Only valid for row-major matrices.
+     */
+    T* row(std::size_t i) { return data_.data() + i * cols_; }
+    const T* row(std::size_t i) const { return data_.data() + i * cols_; }
+
+    /**
+     * @brief Returns a non-owning view of the whole matrix.
+     */
+    BasicMatrixView<T> view() const {
+        return BasicMatrixView<T>(data_.data(), rows_, cols_, layout_);
+    }
+
+    operator BasicMatrixView<T>() const { return view(); }
+
+    /**
+     * @brief Resizes the matrix, discarding its contents.
+     */
+    void assign(std::size_t rows, std::size_t cols, T value = T(0)) {
+        data_.assign(rows * cols, value);
+        rows_ = rows;
+        cols_ = cols;
+    }
+
+    /**
+     * @brief Copies the matrix back into a vector of rows.
+     */
+    std::vector<std::vector<T>> to_vectors() const {
+        std::vector<std::vector<T>> result(rows_, std::vector<T>(cols_));
+        for (std::size_t i = 0; i < rows_; ++i) {
+            for (std::size_t j = 0; j < cols_; ++j) {
+                result[i][j] = (*this)(i, j);
+            }
+        }
+        return result;
+    }
+
+private:
+    std::vector<T> data_;
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+    Layout layout_ = Layout::RowMajor;
+};
+
+using MatrixView = BasicMatrixView<double>;
+using Matrix = BasicMatrix<double>;
+
+/**
+ * @brief Returns a view of X whose rows are contiguous, copying into storage only when needed.
+ * @param X The input view.
+ * @param storage Receives the packed copy if X is not row-contiguous.
+ * @return X itself, or a view of storage.
+ */
+template <typename T>
+BasicMatrixView<T> as_row_major(const std::type_identity_t<BasicMatrixView<T>>& X, BasicMatrix<T>& storage) {
+    if (X.is_row_contiguous()) {
+        return X;
+    }
+    storage = BasicMatrix<T>(X);
+    return storage.view();
+}
+
+} // namespace ml
+
+#endif // ML_MATRIX_HPP
@@ -0,0 +1,334 @@
+#ifndef ML_PROFILING_HPP
+#define ML_PROFILING_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <iomanip>
+
+/**
+ * @file Profiling.hpp
+ * @brief Opt-in scoped timers, counters and Chrome trace export for the estimators' hot paths.
+ *
+ * Instrumentation is written with the ML_PROFILE_* macros, which expand to nothing unless
+ * ML_ENABLE_PROFILING is defined (CMake option of the same name). The ml::profile functions
+ * are always available, so report() and write_chrome_trace() compile either way.
+ *
+ * Timers are inclusive: a scope's time also covers the scopes opened inside it, which is how
+ * they nest in the Chrome trace (e.g. recursive DecisionTreeClassifier::build_tree calls).
+ */
+
+namespace ml {
+namespace profile {
+
+/**
+ * @brief Accumulated timings of one instrumented scope.
+ */
+struct Timer {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> total_ns{0};
+    std::atomic<std::uint64_t> min_ns{std::numeric_limits<std::uint64_t>::max()};
+    std::atomic<std::uint64_t> max_ns{0};
+
+    void add(std::uint64_t ns) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+        std::uint64_t seen = min_ns.load(std::memory_order_relaxed);
+        while (ns < seen && !min_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+        }
+        seen = max_ns.load(std::memory_order_relaxed);
+        while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+/**
+ * @brief A named event counter.
+ */
+struct Counter {
+    std::atomic<std::uint64_t> value{0};
+
+    void add(std::uint64_t n) { value.fetch_add(n, std::memory_order_relaxed); }
+};
+
+/**
+ * @brief One completed scope, as exported to the Chrome trace.
+ */
+struct TraceEvent {
+    const std::string* name;
+    std::uint64_t start_ns;
+    std::uint64_t duration_ns;
+    std::uint32_t thread;
+};
+
+/**
+ * @class Registry
+ * @brief Process-wide store of timers, counters and trace events.
+ *
+ * Timers and counters have stable addresses, so call sites look them up once and then update
+ * them with relaxed atomics.
+ */
+class Registry {
+public:
+    /// Trace events beyond this many are dropped (timers and counters keep accumulating)
+    static constexpr std::size_t max_trace_events = std::size_t(1) << 20;
+
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    Timer& timer(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lookup(timers_, timer_names_, timer_index_, name);
+    }
+
+    Counter& counter(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lookup(counters_, counter_names_, counter_index_, name);
+    }
+
+    /**
+     * @brief Nanoseconds since the registry was created.
+     */
+    std::uint64_t now_ns() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch_).count());
+    }
+
+    void record_event(const std::string& name, std::uint64_t start_ns, std::uint64_t duration_ns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (events_.size() < max_trace_events) {
+            events_.push_back(TraceEvent{&name, start_ns, duration_ns, thread_index()});
+        } else {
+            ++dropped_events_;
+        }
+    }
+
+    /**
+     * @brief Writes a table of all timers and counters.
+     */
+    void report(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ios_base::fmtflags flags = os.flags();
+        std::streamsize precision = os.precision();
+        os << std::left << std::setw(48) << "scope" << std::right << std::setw(10) << "calls"
+           << std::setw(14) << "total ms" << std::setw(12) << "mean us" << std::setw(12) << "min us"
+           << std::setw(12) << "max us" << '\n';
+        for (std::size_t i = 0; i < timers_.size(); ++i) {
+            const Timer& t = timers_[i];
+            std::uint64_t calls = t.calls.load(std::memory_order_relaxed);
+            if (calls == 0) {
+                continue;
+            }
+            double total = static_cast<double>(t.total_ns.load(std::memory_order_relaxed));
+            os << std::left << std::setw(48) << timer_names_[i] << std::right << std::setw(10) << calls
+               << std::fixed << std::setprecision(3)
+               << std::setw(14) << total / 1e6
+               << std::setw(12) << total / calls / 1e3
+               << std::setw(12) << t.min_ns.load(std::memory_order_relaxed) / 1e3
+               << std::setw(12) << t.max_ns.load(std::memory_order_relaxed) / 1e3 << '\n';
+        }
+        os << '\n' << std::left << std::setw(48) << "counter" << std::right << std::setw(16) << "value" << '\n';
+        for (std::size_t i = 0; i < counters_.size(); ++i) {
+            std::uint64_t value = counters_[i].value.load(std::memory_order_relaxed);
+            if (value != 0) {
+                os << std::left << std::setw(48) << counter_names_[i] << std::right << std::setw(16) << value << '\n';
+            }
+        }
+        if (dropped_events_ > 0) {
+            os << "\n(" << dropped_events_ << " trace events dropped)\n";
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    /**
+     * @brief Writes the recorded scopes as complete ("X") events and the counter totals as
+     * counter ("C") events, in the Chrome trace event JSON format (chrome://tracing, Perfetto).
+     */
+    void write_chrome_trace(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        os << "{\"traceEvents\":[";
+        bool first = true;
+        std::uint64_t end_ns = 0;
+        for (const TraceEvent& event : events_) {
+            os << (first ? "\n" : ",\n") << "{\"name\":\"" << *event.name << "\",\"cat\":\"ml\",\"ph\":\"X\""
+               << ",\"ts\":" << event.start_ns / 1000 << '.' << std::setw(3) << std::setfill('0') << event.start_ns % 1000
+               << ",\"dur\":" << event.duration_ns / 1000 << '.' << std::setw(3) << event.duration_ns % 1000
+               << std::setfill(' ') << ",\"pid\":1,\"tid\":" << event.thread << '}';
+            end_ns = std::max(end_ns, event.start_ns + event.duration_ns);
+            first = false;
+        }
+        for (std::size_t i = 0; i < counters_.size(); ++i) {
+            os << (first ? "\n" : ",\n") << "{\"name\":\"" << counter_names_[i] << "\",\"cat\":\"ml\",\"ph\":\"C\""
+               << ",\"ts\":" << end_ns / 1000 << ",\"pid\":1,\"args\":{\"value\":"
+               << counters_[i].value.load(std::memory_order_relaxed) << "}}";
+            first = false;
+        }
+        os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    /**
+     * @brief Zeroes every timer and counter and discards the trace events.
+     */
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Timer& t : timers_) {
+            t.calls = 0;
+            t.total_ns = 0;
+            t.min_ns = std::numeric_limits<std::uint64_t>::max();
+            t.max_ns = 0;
+        }
+        for (Counter& c : counters_) {
+            c.value = 0;
+        }
+        events_.clear();
+        dropped_events_ = 0;
+    }
+
+private:
+    Registry() : epoch_(std::chrono::steady_clock::now()) {}
+
+    template <typename T>
+    static T& lookup(std::deque<T>& items, std::deque<std::string>& names,
+                     std::unordered_map<std::string, std::size_t>& index, const std::string& name) {
+        auto it = index.find(name);
+        if (it != index.end()) {
+            return items[it->second];
+        }
+        items.emplace_back();
+        names.push_back(name);
+        index.emplace(name, items.size() - 1);
+        return items.back();
+    }
+
+    static std::uint32_t thread_index() {
+        static std::atomic<std::uint32_t> next{0};
+        thread_local std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    std::mutex mutex_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::deque<Timer> timers_;
+    std::deque<std::string> timer_names_;
+    std::deque<Counter> counters_;
+    std::deque<std::string> counter_names_;
+    std::unordered_map<std::string, std::size_t> timer_index_;
+    std::unordered_map<std::string, std::size_t> counter_index_;
+    std::vector<TraceEvent> events_;
+    std::size_t dropped_events_ = 0;
+};
+
+/**
+ * @brief Returns the timer with the given name, creating it on first use.
+ */
+inline Timer& timer(const std::string& name) {
+    return Registry::instance().timer(name);
+}
+
+/**
+ * @brief Returns the counter with the given name, creating it on first use.
+ */
+inline Counter& counter(const std::string& name) {
+    return Registry::instance().counter(name);
+}
+
+/**
+ * @brief Writes a table of all timers and counters.
+ */
+inline void report(std::ostream& os = std::cout) {
+    Registry::instance().report(os);
+}
+
+/**
+ * @brief Writes all recorded scopes and counters as Chrome trace event JSON.
+ */
+inline void write_chrome_trace(std::ostream& os) {
+    Registry::instance().write_chrome_trace(os);
+}
+
+/**
+ * @brief Zeroes all timers and counters and discards recorded trace events.
+ */
+inline void reset() {
+    Registry::instance().reset();
+}
+
+/**
+ * @class ScopedTimer
+ * @brief Adds the lifetime of the object to a timer and records it as a trace event.
+ */
+class ScopedTimer {
+public:
+    ScopedTimer(Timer& timer, const std::string& name)
+        : timer_(timer), name_(name), start_ns_(Registry::instance().now_ns()) {}
+
+    ~ScopedTimer() {
+        Registry& registry = Registry::instance();
+        std::uint64_t duration = registry.now_ns() - start_ns_;
+        timer_.add(duration);
+        registry.record_event(name_, start_ns_, duration);
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Timer& timer_;
+    const std::string& name_;
+    std::uint64_t start_ns_;
+};
+
+} // namespace profile
+} // namespace ml
+
+#define ML_PROFILE_CONCAT_INNER(a, b) a##b
+#define ML_PROFILE_CONCAT(a, b) ML_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ML_ENABLE_PROFILING
+
+/**
+ * @brief Times the rest of the enclosing scope. name must be the same on every pass through
+ * the call site (typically a string literal), as the timer is looked up only once.
+ */
+#define ML_PROFILE_SCOPE(name)                                                                       \
+    static const std::string ML_PROFILE_CONCAT(ml_profile_name_, __LINE__){name};                    \
+    static ::ml::profile::Timer& ML_PROFILE_CONCAT(ml_profile_timer_, __LINE__) =                    \
+        ::ml::profile::timer(ML_PROFILE_CONCAT(ml_profile_name_, __LINE__));                         \
+    ::ml::profile::ScopedTimer ML_PROFILE_CONCAT(ml_profile_scope_, __LINE__)(                       \
+        ML_PROFILE_CONCAT(ml_profile_timer_, __LINE__), ML_PROFILE_CONCAT(ml_profile_name_, __LINE__))
+
+/**
+ * @brief Adds n to a counter. Like ML_PROFILE_SCOPE, name must be fixed for the call site.
+ */
+#define ML_PROFILE_COUNT(name, n)                                                                    \
+    do {                                                                                             \
+        static ::ml::profile::Counter& ml_profile_counter = ::ml::profile::counter(name);            \
+        ml_profile_counter.add(static_cast<std::uint64_t>(n));                                       \
+    } while (0)
+
+/**
+ * @brief Adds n to a counter whose name is computed at run time (looked up on every call).
+ */
+#define ML_PROFILE_COUNT_DYNAMIC(name, n) ::ml::profile::counter(name).add(static_cast<std::uint64_t>(n))
+
+#else
+
+#define ML_PROFILE_SCOPE(name) static_cast<void>(0)
+#define ML_PROFILE_COUNT(name, n) static_cast<void>(0)
+#define ML_PROFILE_COUNT_DYNAMIC(name, n) static_cast<void>(0)
+
+#endif // ML_ENABLE_PROFILING
+
+#endif // ML_PROFILING_HPP
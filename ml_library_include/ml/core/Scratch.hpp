@@ -0,0 +1,77 @@
+#ifndef ML_SCRATCH_HPP
+#define ML_SCRATCH_HPP
+
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "Matrix.hpp"
+
+/**
+ * @file Scratch.hpp
+ * @brief Per-thread reusable buffers and helpers for allocation-free prediction.
+ */
+
+namespace ml {
+
+/**
+ * @brief Returns a per-thread buffer of size elements that is reused by later calls.
+ *
+ * The buffer grows but never shrinks, so code that takes its temporaries from here stops
+ * allocating once it has seen its largest input. The contents are unspecified and stay valid
+ * until the next call with the same T and Slot on the same thread; Slot tells apart buffers
+ * of the same type that are in use at the same time.
+ * @param size Number of elements needed.
+ */
+template <typename T, int Slot = 0>
+std::span<T> scratch(std::size_t size) {
+    thread_local std::vector<T> buffer;
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return std::span<T>(buffer.data(), size);
+}
+
+/**
+ * @brief Returns a pointer to the contiguous elements of row i of X.
+ * @param X The samples, in any layout.
+ * @param i The row.
+ * @param buffer At least X.cols() elements; the row is gathered here only if X is not row-contiguous.
+ */
+template <typename T>
+const T* contiguous_row(const std::type_identity_t<BasicMatrixView<T>>& X, std::size_t i, std::span<T> buffer) {
+    if (X.is_row_contiguous()) {
+        return X.row(i);
+    }
+    for (std::size_t j = 0; j < X.cols(); ++j) {
+        buffer[j] = X(i, j);
+    }
+    return buffer.data();
+}
+
+/**
+ * @brief Checks that a caller-provided prediction buffer matches the number of samples.
+ * @param expected The number of elements the prediction produces.
+ * @param size The size of the caller's buffer.
+ * @throw std::invalid_argument If the sizes differ.
+ */
+inline void check_output_size(std::size_t expected, std::size_t size) {
+    if (expected != size) {
+        throw std::invalid_argument("The output buffer must hold one prediction per sample.");
+    }
+}
+
+/**
+ * @brief Checks that samples have as many features as the model was trained on.
+ * @throw std::invalid_argument If they do not.
+ */
+inline void check_feature_count(std::size_t expected, std::size_t features) {
+    if (expected != features) {
+        throw std::invalid_argument("Samples must have as many features as the training samples.");
+    }
+}
+
+} // namespace ml
+
+#endif // ML_SCRATCH_HPP
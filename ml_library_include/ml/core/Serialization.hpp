@@ -0,0 +1,396 @@
+#ifndef ML_SERIALIZATION_HPP
+#define ML_SERIALIZATION_HPP
+
+#include <vector>
+#include <string>
+#include <span>
+#include <memory>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include "Matrix.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ML_HAS_MMAP 1
+#endif
+
+/**
+ * @file Serialization.hpp
+ * @brief Versioned little-endian binary model format, readable in place from a memory-mapped file.
+ *
+ * Layout of a model file:
+ *   - a 24-byte header: magic "CPPMLMDL", format version, model type, model version and a
+ *     byte-order mark (all uint32);
+ *   - the model's fields in a fixed order. Scalars take 8 bytes (int64 or IEEE double) and
+ *     arrays are a uint64 element count followed by the raw elements, zero-padded to 8 bytes.
+ *
+ * Every field therefore starts 8-byte aligned, so arrays can be used directly from the mapping.
+ */
+
+namespace ml {
+
+/**
+ * @brief Identifies the estimator stored in a model file.
+ */
+enum class ModelType : std::uint32_t {
+    DecisionTreeClassifier = 1,
+    DecisionTreeRegressor = 2,
+    RandomForestClassifier = 3,
+    RandomForestRegressor = 4,
+    KMeans = 5,
+    KNNClassifier = 6,
+    KNNRegressor = 7,
+    HierarchicalClustering = 8,
+    SupportVectorRegression = 9,
+    LogisticRegression = 10,
+    MultilinearRegression = 11,
+    PolynomialRegression = 12,
+    NeuralNetwork = 13,
+    Apriori = 14,
+    Eclat = 15,
+    GradientBoostingClassifier = 16,
+    GradientBoostingRegressor = 17
+};
+
+inline constexpr char model_file_magic[8] = {'C', 'P', 'P', 'M', 'L', 'M', 'D', 'L'};
+inline constexpr std::uint32_t model_format_version = 1;
+inline constexpr std::uint32_t model_byte_order_mark = 0x01020304;
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * On platforms without mmap the file is read into an 8-byte aligned buffer instead. Models that
+ * borrow arrays from the file hold a shared_ptr to it, so the mapping lives as long as they do.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps a file.
+     * @param path The file to map.
+     * @throw std::runtime_error If the file cannot be opened or mapped.
+     */
+    static std::shared_ptr<const MappedFile> open(const std::string& path) {
+        std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef ML_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        file->size_ = static_cast<std::size_t>(info.st_size);
+        if (file->size_ > 0) {
+            void* address = ::mmap(nullptr, file->size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (address == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + path);
+            }
+            file->data_ = static_cast<const std::byte*>(address);
+            file->mapped_ = true;
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        file->size_ = static_cast<std::size_t>(in.tellg());
+        file->buffer_.resize((file->size_ + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(file->buffer_.data()), static_cast<std::streamsize>(file->size_))) {
+            throw std::runtime_error("Cannot read " + path);
+        }
+        file->data_ = reinterpret_cast<const std::byte*>(file->buffer_.data());
+#endif
+        return file;
+    }
+
+    ~MappedFile() {
+#ifdef ML_HAS_MMAP
+        if (mapped_) {
+            ::munmap(const_cast<std::byte*>(data_), size_);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> bytes() const { return std::span<const std::byte>(data_, size_); }
+    bool is_mapped() const { return mapped_; }
+
+private:
+    MappedFile() = default;
+
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<std::uint64_t> buffer_;
+};
+
+/**
+ * @class BinaryWriter
+ * @brief Writes a model file field by field.
+ */
+class BinaryWriter {
+public:
+    /**
+     * @brief Writes the file header.
+     * @param os Destination stream, opened in binary mode.
+     * @param type The estimator being saved.
+     * @param model_version Version of the estimator's field layout.
+     * @throw std::runtime_error If the stream is not writable or the host is not little-endian.
+     */
+    BinaryWriter(std::ostream& os, ModelType type, std::uint32_t model_version) : os_(os) {
+        if constexpr (std::endian::native != std::endian::little) {
+            throw std::runtime_error("Model files require a little-endian host.");
+        }
+        if (!os_) {
+            throw std::runtime_error("Cannot write model file.");
+        }
+        write_bytes(model_file_magic, sizeof(model_file_magic));
+        write_raw(model_format_version);
+        write_raw(static_cast<std::uint32_t>(type));
+        write_raw(model_version);
+        write_raw(model_byte_order_mark);
+    }
+
+    void write_int(std::int64_t value) { write_raw(value); }
+    void write_double(double value) { write_raw(value); }
+
+    /**
+     * @brief Records the element size of an estimator templated on its scalar type.
+     */
+    template <typename T>
+    void write_scalar_type() { write_int(static_cast<std::int64_t>(sizeof(T))); }
+
+    /**
+     * @brief Writes an element count followed by the elements, padded to 8 bytes.
+     */
+    template <typename T>
+    void write_array(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 8, "Array elements must be plain data.");
+        write_raw(static_cast<std::uint64_t>(values.size()));
+        write_bytes(values.data(), values.size_bytes());
+        pad();
+    }
+
+    template <typename T>
+    void write_array(const std::vector<T>& values) {
+        write_array(std::span<const T>(values));
+    }
+
+    void write_string(const std::string& value) {
+        write_array(std::span<const char>(value.data(), value.size()));
+    }
+
+    /**
+     * @brief Writes the shape of a matrix and its elements in row-major order.
+     */
+    template <typename T>
+    void write_matrix(const BasicMatrixView<T>& matrix) {
+        write_int(static_cast<std::int64_t>(matrix.rows()));
+        write_int(static_cast<std::int64_t>(matrix.cols()));
+        if (matrix.is_row_contiguous() && (matrix.row_stride() == matrix.cols() || matrix.rows() <= 1)) {
+            write_array(std::span<const T>(matrix.data(), matrix.rows() * matrix.cols()));
+        } else {
+            BasicMatrix<T> packed(matrix);
+            write_array(std::span<const T>(packed.data(), packed.rows() * packed.cols()));
+        }
+    }
+
+    template <typename T>
+    void write_matrix(const BasicMatrix<T>& matrix) {
+        write_matrix(matrix.view());
+    }
+
+    /**
+     * @brief Flushes the stream and checks that every field was written.
+     * @throw std::runtime_error If a write failed.
+     */
+    void finish() {
+        os_.flush();
+        if (!os_) {
+            throw std::runtime_error("Failed to write model file.");
+        }
+    }
+
+private:
+    template <typename T>
+    void write_raw(T value) {
+        write_bytes(&value, sizeof(T));
+    }
+
+    void write_bytes(const void* data, std::size_t size) {
+        os_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written_ += size;
+    }
+
+    void pad() {
+        static constexpr char zeros[8] = {};
+        write_bytes(zeros, (8 - written_ % 8) % 8);
+    }
+
+    std::ostream& os_;
+    std::size_t written_ = 0;
+};
+
+/**
+ * @class BinaryReader
+ * @brief Reads a model file in place; arrays are returned as views into the file's bytes.
+ */
+class BinaryReader {
+public:
+    /**
+     * @brief Validates the header of a model file.
+     * @param bytes The whole file, 8-byte aligned (as provided by MappedFile).
+     * @param type The estimator expected in the file.
+     * @param max_model_version Newest field layout the caller understands.
+     * @throw std::runtime_error If the file is not a model of the expected type and version.
+     */
+    BinaryReader(std::span<const std::byte> bytes, ModelType type, std::uint32_t max_model_version) : bytes_(bytes) {
+        if constexpr (std::endian::native != std::endian::little) {
+            throw std::runtime_error("Model files require a little-endian host.");
+        }
+        if (bytes_.size() < 24 || std::memcmp(bytes_.data(), model_file_magic, sizeof(model_file_magic)) != 0) {
+            throw std::runtime_error("Not a model file.");
+        }
+        offset_ = sizeof(model_file_magic);
+        std::uint32_t format_version = read_raw<std::uint32_t>();
+        std::uint32_t stored_type = read_raw<std::uint32_t>();
+        model_version_ = read_raw<std::uint32_t>();
+        std::uint32_t byte_order = read_raw<std::uint32_t>();
+        if (byte_order != model_byte_order_mark) {
+            throw std::runtime_error("Model file has an unexpected byte order.");
+        }
+        if (format_version != model_format_version) {
+            throw std::runtime_error("Unsupported model file format version.");
+        }
+        if (stored_type != static_cast<std::uint32_t>(type)) {
+            throw std::runtime_error("Model file holds a different estimator type.");
+        }
+        if (model_version_ == 0 || model_version_ > max_model_version) {
+            throw std::runtime_error("Unsupported model version.");
+        }
+    }
+
+    std::uint32_t model_version() const { return model_version_; }
+
+    /**
+     * @brief Reads an integer field and checks that it fits in T.
+     */
+    template <typename T = std::int64_t>
+    T read_int() {
+        std::int64_t value = read_raw<std::int64_t>();
+        if (value < static_cast<std::int64_t>(std::numeric_limits<T>::min()) ||
+            (value > 0 && static_cast<std::uint64_t>(value) > static_cast<std::uint64_t>(std::numeric_limits<T>::max()))) {
+            throw std::runtime_error("Model file field is out of range.");
+        }
+        return static_cast<T>(value);
+    }
+
+    double read_double() { return read_raw<double>(); }
+
+    /**
+     * @brief Reads the field written by BinaryWriter::write_scalar_type() and checks it against T.
+     * @param since_version First model version that has the field; older files hold doubles.
+     * @throw std::runtime_error If the model was saved with a different scalar type.
+     */
+    template <typename T>
+    void read_scalar_type(std::uint32_t since_version) {
+        std::size_t size = model_version_ >= since_version ? read_int<std::size_t>() : sizeof(double);
+        if (size != sizeof(T)) {
+            throw std::runtime_error("Model file was saved with a different scalar type.");
+        }
+    }
+
+    /**
+     * @brief Returns a view of an array field without copying it.
+     */
+    template <typename T>
+    std::span<const T> read_array() {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 8, "Array elements must be plain data.");
+        std::uint64_t count = read_raw<std::uint64_t>();
+        if (count > (bytes_.size() - offset_) / sizeof(T)) {
+            throw std::runtime_error("Model file is truncated.");
+        }
+        const std::byte* data = bytes_.data() + offset_;
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0) {
+            throw std::runtime_error("Model file data is misaligned.");
+        }
+        std::size_t size = static_cast<std::size_t>(count) * sizeof(T);
+        offset_ = std::min(bytes_.size(), offset_ + size + (8 - size % 8) % 8);
+        return std::span<const T>(reinterpret_cast<const T*>(data), static_cast<std::size_t>(count));
+    }
+
+    std::string read_string() {
+        std::span<const char> chars = read_array<char>();
+        return std::string(chars.begin(), chars.end());
+    }
+
+    /**
+     * @brief Returns a row-major view of a matrix field without copying it.
+     * @tparam T The element type the matrix was written with.
+     */
+    template <typename T = double>
+    BasicMatrixView<T> read_matrix() {
+        std::size_t rows = read_int<std::size_t>();
+        std::size_t cols = read_int<std::size_t>();
+        std::span<const T> values = read_array<T>();
+        if ((cols != 0 && rows > values.size() / cols) || rows * cols != values.size()) {
+            throw std::runtime_error("Model file holds a matrix of inconsistent shape.");
+        }
+        return BasicMatrixView<T>(values.data(), rows, cols);
+    }
+
+private:
+    template <typename T>
+    T read_raw() {
+        if (bytes_.size() - offset_ < sizeof(T)) {
+            throw std::runtime_error("Model file is truncated.");
+        }
+        T value;
+        std::memcpy(&value, bytes_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    std::span<const std::byte> bytes_;
+    std::size_t offset_ = 0;
+    std::uint32_t model_version_ = 0;
+};
+
+/**
+ * @brief One decision tree node as stored in a model file (16 bytes).
+ *
+ * Nodes are stored in breadth-first order, as held by ml::tree::FlatTree. An internal node tests
+ * x[feature] <= value and its children are at left and left + 1; a leaf has feature == -1 and its
+ * prediction in value.
+ */
+struct TreeNodeRecord {
+    std::int32_t feature;
+    std::uint32_t left;
+    double value;
+};
+
+static_assert(sizeof(TreeNodeRecord) == 16, "TreeNodeRecord must match the file layout.");
+
+} // namespace ml
+
+#endif // ML_SERIALIZATION_HPP
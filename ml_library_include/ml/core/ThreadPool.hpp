@@ -0,0 +1,287 @@
+#ifndef ML_THREAD_POOL_HPP
+#define ML_THREAD_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * @file ThreadPool.hpp
+ * @brief Work-stealing thread pool shared by all estimators.
+ */
+
+namespace ml {
+
+/**
+ * @class ThreadPool
+ * @brief Fixed-size pool of workers, each with its own task deque.
+ *
+ * Workers run their own tasks newest-first and steal the oldest tasks of other workers when
+ * idle. Threads that wait for a TaskGroup run pending tasks instead of blocking, so parallel
+ * loops may be nested inside pool tasks without deadlocking.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the worker threads.
+     * @param num_threads Number of workers. Zero selects std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool(std::size_t num_threads = 0) {
+        if (num_threads == 0) {
+            num_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i = 0; i < num_threads; ++i) {
+            queues_.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (std::size_t i = 0; i < num_threads; ++i) {
+            threads_.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    /**
+     * @brief Finishes all queued tasks and joins the workers.
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Returns the number of worker threads.
+     */
+    std::size_t size() const { return threads_.size(); }
+
+    /**
+     * @brief Queues a task. Tasks pushed from a worker go to that worker's own deque.
+     */
+    void push(std::function<void()> task) {
+        const Identity& self = current();
+        std::size_t index = self.pool == this
+                                ? self.index
+                                : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+            queues_[index]->tasks.push_back(std::move(task));
+        }
+        queued_.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+        }
+        wake_.notify_one();
+    }
+
+    /**
+     * @brief Runs one queued task on the calling thread, if any is available.
+     * @return True if a task was run.
+     */
+    bool try_run_one() {
+        const Identity& self = current();
+        std::size_t home = self.pool == this ? self.index : next_queue_.load(std::memory_order_relaxed) % queues_.size();
+        std::function<void()> task;
+        if (!pop_task(home, task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    struct Identity {
+        const ThreadPool* pool = nullptr;
+        std::size_t index = 0;
+    };
+
+    static Identity& current() {
+        thread_local Identity identity;
+        return identity;
+    }
+
+    bool pop_task(std::size_t home, std::function<void()>& task) {
+        // Own work first, newest task (best cache locality)
+        {
+            std::lock_guard<std::mutex> lock(queues_[home]->mutex);
+            if (!queues_[home]->tasks.empty()) {
+                task = std::move(queues_[home]->tasks.back());
+                queues_[home]->tasks.pop_back();
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        // Otherwise steal the oldest task of another worker
+        for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+            WorkerQueue& victim = *queues_[(home + offset) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(std::size_t index) {
+        current() = Identity{this, index};
+        while (true) {
+            std::function<void()> task;
+            if (pop_task(index, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_acquire) > 0; });
+            if (stop_ && queued_.load(std::memory_order_acquire) <= 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<std::ptrdiff_t> queued_{0};
+    std::atomic<std::size_t> next_queue_{0};
+    bool stop_ = false;
+};
+
+/**
+ * @class TaskGroup
+ * @brief Fork-join scope: tasks run on a pool and wait() returns once all of them finished.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+
+    /**
+     * @brief Waits for outstanding tasks; exceptions not collected by wait() are dropped.
+     */
+    ~TaskGroup() {
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Schedules a task on the pool.
+     */
+    template <typename F>
+    void run(F&& f) {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        pool_.push([this, task = std::forward<F>(f)]() mutable {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+
+    /**
+     * @brief Runs queued tasks until every task of this group has finished.
+     * @throw Rethrows the first exception thrown by a task of this group.
+     */
+    void wait() {
+        while (pending_.load(std::memory_order_acquire) > 0) {
+            if (!pool_.try_run_one()) {
+                std::this_thread::yield();
+            }
+        }
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            std::swap(error, error_);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    ThreadPool& pool_;
+    std::atomic<std::size_t> pending_{0};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+/**
+ * @brief Calls body(block_begin, block_end) over disjoint blocks covering [begin, end).
+ *
+ * Runs serially on the calling thread when pool is null.
+ * @param pool The pool to run on, or nullptr.
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param body Callable taking (std::size_t block_begin, std::size_t block_end).
+ * @param min_block Smallest number of indices per block.
+ */
+template <typename F>
+void parallel_for_blocks(ThreadPool* pool, std::size_t begin, std::size_t end, F&& body, std::size_t min_block = 1) {
+    if (begin >= end) {
+        return;
+    }
+    std::size_t n = end - begin;
+    min_block = std::max<std::size_t>(1, min_block);
+    if (pool == nullptr || pool->size() <= 1 || n <= min_block) {
+        body(begin, end);
+        return;
+    }
+    // A few blocks per worker so that stealing can even out uneven blocks
+    std::size_t num_blocks = std::min((n + min_block - 1) / min_block, pool->size() * 4);
+    std::size_t block = (n + num_blocks - 1) / num_blocks;
+
+    TaskGroup group(*pool);
+    for (std::size_t b = begin + block; b < end; b += block) {
+        std::size_t e = std::min(end, b + block);
+        group.run([&body, b, e] { body(b, e); });
+    }
+    // The calling thread takes the first block itself
+    body(begin, std::min(end, begin + block));
+    group.wait();
+}
+
+/**
+ * @brief Calls body(i) for every i in [begin, end), serially when pool is null.
+ */
+template <typename F>
+void parallel_for(ThreadPool* pool, std::size_t begin, std::size_t end, F&& body, std::size_t min_block = 1) {
+    parallel_for_blocks(pool, begin, end, [&body](std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+            body(i);
+        }
+    }, min_block);
+}
+
+} // namespace ml
+
+#endif // ML_THREAD_POOL_HPP
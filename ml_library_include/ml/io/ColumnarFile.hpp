@@ -0,0 +1,245 @@
+#ifndef ML_COLUMNAR_FILE_HPP
+#define ML_COLUMNAR_FILE_HPP
+
+#include <vector>
+#include <string>
+#include <span>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include "../core/Matrix.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+
+/**
+ * @file ColumnarFile.hpp
+ * @brief Simple column-major binary dataset format, read in place from a memory-mapped file.
+ *
+ * Layout of a columnar file (little-endian):
+ *   - a 32-byte header: magic "CPPMLCOL", format version and byte-order mark (uint32), then the
+ *     row and column counts (uint64);
+ *   - the columns one after another, each rows IEEE doubles.
+ *
+ * The data starts 8-byte aligned, so the whole file can be used as a column-major MatrixView
+ * without copying, and row batches only touch the pages they need.
+ */
+
+namespace ml {
+namespace io {
+
+inline constexpr char columnar_file_magic[8] = {'C', 'P', 'P', 'M', 'L', 'C', 'O', 'L'};
+inline constexpr std::uint32_t columnar_format_version = 1;
+inline constexpr std::size_t columnar_header_bytes = 32;
+
+/**
+ * @brief Writes a matrix as a columnar file.
+ * @param path Destination file.
+ * @param X The data to write, in any layout.
+ * @throw std::runtime_error If the file cannot be written or the host is not little-endian.
+ */
+inline void write_columnar(const std::string& path, const MatrixView& X) {
+    if constexpr (std::endian::native != std::endian::little) {
+        throw std::runtime_error("Columnar files require a little-endian host.");
+    }
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    std::uint32_t header_words[2] = {columnar_format_version, model_byte_order_mark};
+    std::uint64_t shape[2] = {X.rows(), X.cols()};
+    out.write(columnar_file_magic, sizeof(columnar_file_magic));
+    out.write(reinterpret_cast<const char*>(header_words), sizeof(header_words));
+    out.write(reinterpret_cast<const char*>(shape), sizeof(shape));
+
+    std::vector<double> column;
+    for (std::size_t j = 0; j < X.cols() && X.rows() > 0; ++j) {
+        const double* values = X.data() + j * X.col_stride();
+        if (X.row_stride() != 1 && X.rows() > 1) {
+            column.resize(X.rows());
+            for (std::size_t i = 0; i < X.rows(); ++i) {
+                column[i] = X(i, j);
+            }
+            values = column.data();
+        }
+        out.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(X.rows() * sizeof(double)));
+    }
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+/**
+ * @class ColumnarFile
+ * @brief A memory-mapped columnar file.
+ *
+ * Copies of a ColumnarFile share the mapping, which stays valid as long as any copy or any
+ * view obtained from it is in use.
+ */
+class ColumnarFile {
+public:
+    /**
+     * @brief Maps a columnar file and validates its header.
+     * @param path The file to open.
+     * @throw std::runtime_error If the file cannot be mapped or is not a valid columnar file.
+     */
+    static ColumnarFile open(const std::string& path) {
+        if constexpr (std::endian::native != std::endian::little) {
+            throw std::runtime_error("Columnar files require a little-endian host.");
+        }
+        ColumnarFile result;
+        result.file_ = MappedFile::open(path);
+        std::span<const std::byte> bytes = result.file_->bytes();
+        if (bytes.size() < columnar_header_bytes ||
+            std::memcmp(bytes.data(), columnar_file_magic, sizeof(columnar_file_magic)) != 0) {
+            throw std::runtime_error(path + " is not a columnar file.");
+        }
+        std::uint32_t header_words[2];
+        std::uint64_t shape[2];
+        std::memcpy(header_words, bytes.data() + 8, sizeof(header_words));
+        std::memcpy(shape, bytes.data() + 16, sizeof(shape));
+        if (header_words[0] != columnar_format_version || header_words[1] != model_byte_order_mark) {
+            throw std::runtime_error(path + " has an unsupported columnar format version or byte order.");
+        }
+        std::size_t available = (bytes.size() - columnar_header_bytes) / sizeof(double);
+        if ((shape[1] != 0 && shape[0] > available / shape[1]) || shape[0] * shape[1] > available) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+        result.rows_ = static_cast<std::size_t>(shape[0]);
+        result.cols_ = static_cast<std::size_t>(shape[1]);
+        result.data_ = reinterpret_cast<const double*>(bytes.data() + columnar_header_bytes);
+        return result;
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+
+    /**
+     * @brief Returns a column-major view of the whole file without copying it.
+     */
+    MatrixView view() const { return MatrixView(data_, rows_, cols_, Layout::ColMajor); }
+
+    /**
+     * @brief Returns the values of column j without copying them.
+     */
+    std::span<const double> column(std::size_t j) const {
+        return std::span<const double>(data_ + j * rows_, rows_);
+    }
+
+    /**
+     * @brief Copies rows [begin, begin + count) into a row-major matrix.
+     * @param begin First row.
+     * @param count Number of rows; clamped to the end of the file.
+     * @param out Receives the rows; its storage is reused.
+     * @param pool Pool used to transpose blocks of rows in parallel, or nullptr.
+     */
+    void read_rows(std::size_t begin, std::size_t count, Matrix& out, ThreadPool* pool = nullptr) const {
+        begin = std::min(begin, rows_);
+        count = std::min(count, rows_ - begin);
+        if (out.layout() != Layout::RowMajor) {
+            out = Matrix();
+        }
+        out.assign(count, cols_);
+        parallel_for_blocks(pool, 0, count, [&](std::size_t block_begin, std::size_t block_end) {
+            // Tiles keep the written rows in cache while every column is read sequentially
+            constexpr std::size_t tile = 256;
+            for (std::size_t t = block_begin; t < block_end; t += tile) {
+                std::size_t t_end = std::min(block_end, t + tile);
+                for (std::size_t j = 0; j < cols_; ++j) {
+                    const double* column_values = data_ + j * rows_ + begin;
+                    for (std::size_t i = t; i < t_end; ++i) {
+                        out.row(i)[j] = column_values[i];
+                    }
+                }
+            }
+        }, 1024);
+    }
+
+    /**
+     * @brief Copies the whole file into a row-major matrix.
+     */
+    Matrix to_matrix(ThreadPool* pool = nullptr) const {
+        Matrix result;
+        read_rows(0, rows_, result, pool);
+        return result;
+    }
+
+private:
+    ColumnarFile() = default;
+
+    std::shared_ptr<const MappedFile> file_;
+    const double* data_ = nullptr;
+    std::size_t rows_ = 0;
+    std::size_t cols_ = 0;
+};
+
+/**
+ * @brief Reads a whole columnar file into a row-major matrix.
+ * @param path The file to read.
+ * @param pool Pool used to transpose in parallel, or nullptr.
+ * @throw std::runtime_error If the file is not a valid columnar file.
+ */
+inline Matrix read_columnar(const std::string& path, ThreadPool* pool = nullptr) {
+    return ColumnarFile::open(path).to_matrix(pool);
+}
+
+/**
+ * @class ColumnarBatchReader
+ * @brief Reads a columnar file as a sequence of row-major batches, for data larger than memory.
+ */
+class ColumnarBatchReader {
+public:
+    /**
+     * @brief Maps the file.
+     * @param path The file to read.
+     * @param batch_rows Maximum number of rows per batch.
+     * @param pool Pool used to transpose each batch in parallel, or nullptr.
+     * @throw std::invalid_argument If batch_rows is zero.
+     * @throw std::runtime_error If the file is not a valid columnar file.
+     */
+    ColumnarBatchReader(const std::string& path, std::size_t batch_rows, ThreadPool* pool = nullptr)
+        : file_(ColumnarFile::open(path)), batch_rows_(batch_rows), pool_(pool) {
+        if (batch_rows_ == 0) {
+            throw std::invalid_argument("batch_rows must be greater than zero.");
+        }
+    }
+
+    /**
+     * @brief Copies the next batch of rows.
+     * @param batch Receives up to batch_rows rows in row-major order; its storage is reused.
+     * @return False once the file is exhausted.
+     */
+    bool next(Matrix& batch) {
+        if (rows_read_ >= file_.rows()) {
+            return false;
+        }
+        file_.read_rows(rows_read_, batch_rows_, batch, pool_);
+        rows_read_ += batch.rows();
+        return true;
+    }
+
+    const ColumnarFile& file() const { return file_; }
+
+    /**
+     * @brief Number of rows returned so far.
+     */
+    std::size_t rows_read() const { return rows_read_; }
+
+private:
+    ColumnarFile file_;
+    std::size_t batch_rows_;
+    ThreadPool* pool_;
+    std::size_t rows_read_ = 0;
+};
+
+} // namespace io
+} // namespace ml
+
+#endif // ML_COLUMNAR_FILE_HPP
@@ -0,0 +1,423 @@
+#ifndef ML_CSV_HPP
+#define ML_CSV_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <charconv>
+#include <system_error>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+
+#include "../core/Matrix.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+
+/**
+ * @file Csv.hpp
+ * @brief Chunked, multi-threaded parsing of numeric CSV files into contiguous matrices.
+ *
+ * The text is split into chunks at line boundaries. A first parallel pass counts the rows of
+ * every chunk, which fixes where each chunk's rows go, and a second pass parses every chunk
+ * straight into its rows of a single row-major Matrix. Fields are parsed in place with
+ * std::from_chars; no per-field strings are created.
+ *
+ * Only numeric fields are supported. Surrounding whitespace and double quotes are ignored, and
+ * empty fields become CsvOptions::missing_value. Blank lines are skipped.
+ */
+
+namespace ml {
+namespace io {
+
+/**
+ * @brief Options shared by the CSV readers.
+ */
+struct CsvOptions {
+    char delimiter = ',';                                          ///< Field separator
+    bool has_header = false;                                       ///< Whether the first line holds column names
+    double missing_value = std::numeric_limits<double>::quiet_NaN(); ///< Value stored for empty fields
+    std::size_t chunk_bytes = std::size_t(1) << 20;                ///< Approximate bytes of text per parse task
+    ThreadPool* pool = nullptr;                                    ///< Pool that parses chunks in parallel, or nullptr
+};
+
+namespace detail {
+
+inline bool is_csv_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void trim(const char*& begin, const char*& end) {
+    while (begin < end && is_csv_space(*begin)) {
+        ++begin;
+    }
+    while (end > begin && is_csv_space(end[-1])) {
+        --end;
+    }
+}
+
+inline bool is_blank(const char* begin, const char* end) {
+    trim(begin, end);
+    return begin == end;
+}
+
+/**
+ * @brief Calls f(line_begin, line_end) for every non-blank line of [begin, end).
+ */
+template <typename F>
+void for_each_line(const char* begin, const char* end, F&& f) {
+    while (begin < end) {
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+        const char* line_end = newline != nullptr ? newline : end;
+        if (!is_blank(begin, line_end)) {
+            f(begin, line_end);
+        }
+        begin = newline != nullptr ? newline + 1 : end;
+    }
+}
+
+inline std::size_t count_fields(const char* begin, const char* end, char delimiter) {
+    return 1 + static_cast<std::size_t>(std::count(begin, end, delimiter));
+}
+
+/**
+ * @brief Parses a whole field as a double.
+ * @return False if the field is not a number.
+ */
+inline bool parse_double(const char* begin, const char* end, double& value) {
+    if (begin < end && *begin == '+') {
+        ++begin;
+    }
+#if defined(__cpp_lib_to_chars)
+    auto [stop, error] = std::from_chars(begin, end, value);
+    return error == std::errc() && stop == end;
+#else
+    // Standard libraries without floating-point from_chars: strtod needs a terminated copy
+    char buffer[64];
+    std::size_t length = static_cast<std::size_t>(end - begin);
+    if (length == 0 || length >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char* stop = nullptr;
+    value = std::strtod(buffer, &stop);
+    return stop == buffer + length;
+#endif
+}
+
+inline double parse_field(const char* begin, const char* end, const CsvOptions& options,
+                          std::size_t row, std::size_t col) {
+    trim(begin, end);
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        ++begin;
+        --end;
+        trim(begin, end);
+    }
+    if (begin == end) {
+        return options.missing_value;
+    }
+    double value = 0.0;
+    if (!parse_double(begin, end, value)) {
+        throw std::runtime_error("Cannot parse CSV field '" + std::string(begin, end) + "' in data row " +
+                                 std::to_string(row + 1) + ", column " + std::to_string(col + 1) + ".");
+    }
+    return value;
+}
+
+/**
+ * @brief Parses the non-blank lines of [begin, end) into consecutive rows starting at out.
+ * @param first_row Index of the first row in the whole file, used in error messages.
+ */
+inline void parse_rows(const char* begin, const char* end, std::size_t cols, double* out,
+                       std::size_t first_row, const CsvOptions& options) {
+    std::size_t row = first_row;
+    for_each_line(begin, end, [&](const char* field, const char* line_end) {
+        for (std::size_t c = 0; c < cols; ++c) {
+            const char* separator = static_cast<const char*>(
+                std::memchr(field, options.delimiter, static_cast<std::size_t>(line_end - field)));
+            bool last = c + 1 == cols;
+            if ((separator == nullptr) != last) {
+                throw std::runtime_error("CSV data row " + std::to_string(row + 1) + " does not have " +
+                                         std::to_string(cols) + " fields.");
+            }
+            const char* field_end = last ? line_end : separator;
+            *out++ = parse_field(field, field_end, options, row, c);
+            field = field_end + 1;
+        }
+        ++row;
+    });
+}
+
+/**
+ * @brief Line-aligned chunks of a text buffer and the index of the first row of each.
+ */
+struct ChunkPlan {
+    std::vector<std::pair<const char*, const char*>> chunks;
+    std::vector<std::size_t> row_offsets; ///< One entry per chunk plus the total row count
+    std::size_t cols = 0;                 ///< Field count of the first non-blank line
+
+    std::size_t rows() const { return row_offsets.back(); }
+};
+
+inline ChunkPlan plan_chunks(const char* begin, const char* end, const CsvOptions& options) {
+    ChunkPlan plan;
+    std::size_t chunk_bytes = std::max<std::size_t>(options.chunk_bytes, 1);
+    const char* position = begin;
+    while (position < end) {
+        const char* stop = end;
+        if (static_cast<std::size_t>(end - position) > chunk_bytes) {
+            const char* target = position + chunk_bytes;
+            const char* newline = static_cast<const char*>(std::memchr(target, '\n', static_cast<std::size_t>(end - target)));
+            stop = newline != nullptr ? newline + 1 : end;
+        }
+        plan.chunks.emplace_back(position, stop);
+        position = stop;
+    }
+
+    plan.row_offsets.assign(plan.chunks.size() + 1, 0);
+    parallel_for(options.pool, 0, plan.chunks.size(), [&](std::size_t i) {
+        std::size_t rows = 0;
+        for_each_line(plan.chunks[i].first, plan.chunks[i].second, [&rows](const char*, const char*) { ++rows; });
+        plan.row_offsets[i + 1] = rows;
+    });
+    std::partial_sum(plan.row_offsets.begin(), plan.row_offsets.end(), plan.row_offsets.begin());
+
+    for (const auto& chunk : plan.chunks) {
+        bool found = false;
+        for_each_line(chunk.first, chunk.second, [&](const char* line_begin, const char* line_end) {
+            if (!found) {
+                plan.cols = count_fields(line_begin, line_end, options.delimiter);
+                found = true;
+            }
+        });
+        if (found) {
+            break;
+        }
+    }
+    return plan;
+}
+
+/**
+ * @brief Parses every chunk of a plan in parallel into a row-major buffer of plan.rows() x cols.
+ */
+inline void parse_chunks(const ChunkPlan& plan, std::size_t cols, double* out, std::size_t first_row,
+                         const CsvOptions& options) {
+    parallel_for(options.pool, 0, plan.chunks.size(), [&](std::size_t i) {
+        parse_rows(plan.chunks[i].first, plan.chunks[i].second, cols, out + plan.row_offsets[i] * cols,
+                   first_row + plan.row_offsets[i], options);
+    });
+}
+
+/**
+ * @brief Splits a header line into trimmed column names.
+ */
+inline std::vector<std::string> split_header(const char* begin, const char* end, char delimiter) {
+    std::vector<std::string> names;
+    while (true) {
+        const char* separator = static_cast<const char*>(std::memchr(begin, delimiter, static_cast<std::size_t>(end - begin)));
+        const char* name_end = separator != nullptr ? separator : end;
+        const char* name_begin = begin;
+        trim(name_begin, name_end);
+        if (name_end - name_begin >= 2 && *name_begin == '"' && name_end[-1] == '"') {
+            ++name_begin;
+            --name_end;
+        }
+        names.emplace_back(name_begin, name_end);
+        if (separator == nullptr) {
+            return names;
+        }
+        begin = separator + 1;
+    }
+}
+
+/**
+ * @brief Returns the end of the header line of [begin, end) and stores its column names.
+ */
+inline const char* skip_header(const char* begin, const char* end, char delimiter, std::vector<std::string>* names) {
+    if (begin == end) {
+        return end;
+    }
+    const char* newline = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+    const char* line_end = newline != nullptr ? newline : end;
+    if (names != nullptr) {
+        *names = split_header(begin, line_end, delimiter);
+    }
+    return newline != nullptr ? newline + 1 : end;
+}
+
+} // namespace detail
+
+/**
+ * @brief Parses CSV text held in memory into a row-major matrix.
+ * @param text The CSV text.
+ * @param options Delimiter, header and threading options.
+ * @param header Receives the column names if options.has_header is set; may be null.
+ * @return A rows x columns matrix; empty if the text has no data rows.
+ * @throw std::runtime_error If a field is not numeric or a row has the wrong number of fields.
+ */
+inline Matrix parse_csv(std::string_view text, const CsvOptions& options = CsvOptions(),
+                        std::vector<std::string>* header = nullptr) {
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+    if (options.has_header) {
+        begin = detail::skip_header(begin, end, options.delimiter, header);
+    }
+    detail::ChunkPlan plan = detail::plan_chunks(begin, end, options);
+    if (plan.rows() == 0) {
+        return Matrix();
+    }
+    Matrix result(plan.rows(), plan.cols);
+    detail::parse_chunks(plan, plan.cols, result.data(), 0, options);
+    return result;
+}
+
+/**
+ * @brief Reads a whole CSV file into a row-major matrix.
+ *
+ * The file is memory-mapped where the platform allows it and parsed in chunks on
+ * options.pool.
+ * @param path The file to read.
+ * @param options Delimiter, header and threading options.
+ * @param header Receives the column names if options.has_header is set; may be null.
+ * @return A rows x columns matrix; empty if the file has no data rows.
+ * @throw std::runtime_error If the file cannot be read or holds malformed rows.
+ */
+inline Matrix read_csv(const std::string& path, const CsvOptions& options = CsvOptions(),
+                       std::vector<std::string>* header = nullptr) {
+    auto file = MappedFile::open(path);
+    std::span<const std::byte> bytes = file->bytes();
+    return parse_csv(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()), options, header);
+}
+
+/**
+ * @class CsvBatchReader
+ * @brief Reads a CSV file as a sequence of fixed-size row batches, for data larger than memory.
+ *
+ * Only the current batch and one read buffer are held in memory. Each batch is parsed in
+ * parallel on options.pool like read_csv().
+ *
+ * @code
+ * ml::io::CsvBatchReader reader("data.csv", 100000);
+ * ml::Matrix batch;
+ * while (reader.next(batch)) {
+ *     // use batch
+ * }
+ * @endcode
+ */
+class CsvBatchReader {
+public:
+    /**
+     * @brief Opens the file and reads its header line, if any.
+     * @param path The file to read.
+     * @param batch_rows Maximum number of rows per batch.
+     * @param options Delimiter, header and threading options.
+     * @throw std::invalid_argument If batch_rows is zero.
+     * @throw std::runtime_error If the file cannot be opened.
+     */
+    CsvBatchReader(const std::string& path, std::size_t batch_rows, CsvOptions options = CsvOptions())
+        : in_(path, std::ios::binary), options_(options), batch_rows_(batch_rows) {
+        if (batch_rows_ == 0) {
+            throw std::invalid_argument("batch_rows must be greater than zero.");
+        }
+        if (!in_) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        if (options_.has_header) {
+            std::string line;
+            std::getline(in_, line);
+            header_ = detail::split_header(line.data(), line.data() + line.size(), options_.delimiter);
+        }
+    }
+
+    /**
+     * @brief Parses the next batch of rows.
+     * @param batch Receives up to batch_rows rows in row-major order; its storage is reused.
+     * @return False once the file is exhausted.
+     * @throw std::runtime_error If the batch holds malformed rows.
+     */
+    bool next(Matrix& batch) {
+        std::size_t rows = 0;
+        std::size_t consumed = 0;
+        while (rows < batch_rows_) {
+            const char* data = buffer_.data();
+            const void* newline = std::memchr(data + consumed, '\n', buffer_.size() - consumed);
+            if (newline == nullptr) {
+                if (read_more()) {
+                    continue;
+                }
+                // The last line of the file need not end with a newline
+                if (!detail::is_blank(data + consumed, data + buffer_.size())) {
+                    ++rows;
+                }
+                consumed = buffer_.size();
+                break;
+            }
+            const char* line_end = static_cast<const char*>(newline);
+            if (!detail::is_blank(data + consumed, line_end)) {
+                ++rows;
+            }
+            consumed = static_cast<std::size_t>(line_end - data) + 1;
+        }
+        if (rows == 0) {
+            buffer_.clear();
+            return false;
+        }
+
+        const char* begin = buffer_.data();
+        detail::ChunkPlan plan = detail::plan_chunks(begin, begin + consumed, options_);
+        if (cols_ == 0) {
+            cols_ = plan.cols;
+        }
+        if (batch.layout() != Layout::RowMajor) {
+            batch = Matrix();
+        }
+        batch.assign(rows, cols_);
+        detail::parse_chunks(plan, cols_, batch.data(), rows_read_, options_);
+        buffer_.erase(0, consumed);
+        rows_read_ += rows;
+        return true;
+    }
+
+    /**
+     * @brief Column names read from the header line; empty without options.has_header.
+     */
+    const std::vector<std::string>& header() const { return header_; }
+
+    /**
+     * @brief Number of rows returned so far.
+     */
+    std::size_t rows_read() const { return rows_read_; }
+
+private:
+    bool read_more() {
+        if (!in_) {
+            return false;
+        }
+        std::size_t block = std::max<std::size_t>(options_.chunk_bytes, 1 << 16);
+        std::size_t old_size = buffer_.size();
+        buffer_.resize(old_size + block);
+        in_.read(&buffer_[old_size], static_cast<std::streamsize>(block));
+        buffer_.resize(old_size + static_cast<std::size_t>(in_.gcount()));
+        return buffer_.size() > old_size;
+    }
+
+    std::ifstream in_;
+    CsvOptions options_;
+    std::size_t batch_rows_;
+    std::size_t cols_ = 0;
+    std::size_t rows_read_ = 0;
+    std::string buffer_;
+    std::vector<std::string> header_;
+};
+
+} // namespace io
+} // namespace ml
+
+#endif // ML_CSV_HPP
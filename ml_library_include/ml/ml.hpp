@@ -2,10 +2,21 @@
 #ifndef ML_H
 #define ML_H
 
+#include "./core/Matrix.hpp"
+#include "./core/DataHolder.hpp"
+#include "./core/ThreadPool.hpp"
+#include "./core/Scratch.hpp"
+#include "./core/Profiling.hpp"
+#include "./core/Kernels.hpp"
+#include "./core/Serialization.hpp"
+#include "./io/Csv.hpp"
+#include "./io/ColumnarFile.hpp"
 #include "./tree/DecisionTreeClassifier.hpp"
 #include "./tree/DecisionTreeRegressor.hpp"
 #include "./tree/RandomForestClassifier.hpp"
 #include "./tree/RandomForestRegressor.hpp"
+#include "./tree/GradientBoostingClassifier.hpp"
+#include "./tree/GradientBoostingRegressor.hpp"
 #include "./regression/PolynomialRegression.hpp"
 #include "./regression/MultiLinearRegression.hpp"
 #include "./neural_network/ANN.hpp"
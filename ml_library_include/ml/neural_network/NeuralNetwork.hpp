@@ -6,6 +6,13 @@
 #include <cstdlib>
 #include <cassert>
 #include <iostream>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <span>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/Serialization.hpp"
 
 /**
  * @file NeuralNetwork.hpp
@@ -13,126 +20,151 @@
  */
 
 /**
- * @class Connection
+ * @class BasicConnection
  * @brief Represents a connection between neurons with a weight and a change in weight.
+ * @tparam T Scalar type of the weights, double or float.
  */
-struct Connection {
-    double weight;       ///< The weight of the connection.
-    double deltaWeight;  ///< The change in weight (for momentum).
+template <typename T>
+struct BasicConnection {
+    T weight;       ///< The weight of the connection.
+    T deltaWeight;  ///< The change in weight (for momentum).
 };
 
 /**
- * @class Neuron
+ * @brief Connection with a double-precision weight.
+ */
+using Connection = BasicConnection<double>;
+
+template <typename T>
+class BasicNeuralNetwork;
+
+/**
+ * @class BasicNeuron
  * @brief Represents a single neuron in the neural network.
+ * @tparam T Scalar type of the weights and outputs, double or float.
  */
-class Neuron {
+template <typename T>
+class BasicNeuron {
 public:
     /**
      * @brief Constructs a Neuron.
      * @param numOutputs The number of outputs from this neuron.
      * @param index The index of this neuron in its layer.
      */
-    Neuron(unsigned numOutputs, unsigned index);
+    BasicNeuron(unsigned numOutputs, unsigned index);
 
     /**
      * @brief Sets the output value of the neuron.
      * @param val The value to set.
      */
-    void setOutputVal(double val);
+    void setOutputVal(T val);
 
     /**
      * @brief Gets the output value of the neuron.
      * @return The output value.
      */
-    double getOutputVal() const;
+    T getOutputVal() const;
 
     /**
      * @brief Feeds forward the input values to the next layer.
      * @param prevLayer The previous layer of neurons.
      */
-    void feedForward(const std::vector<Neuron>& prevLayer);
+    void feedForward(const std::vector<BasicNeuron<T>>& prevLayer);
 
     /**
      * @brief Calculates the output gradients for the output layer.
      * @param targetVal The target value.
      */
-    void calcOutputGradients(double targetVal);
+    void calcOutputGradients(T targetVal);
 
     /**
      * @brief Calculates the hidden gradients for hidden layers.
      * @param nextLayer The next layer of neurons.
      */
-    void calcHiddenGradients(const std::vector<Neuron>& nextLayer);
+    void calcHiddenGradients(const std::vector<BasicNeuron<T>>& nextLayer);
 
     /**
      * @brief Updates the input weights for the neuron.
      * @param prevLayer The previous layer of neurons.
      */
-    void updateInputWeights(std::vector<Neuron>& prevLayer);
+    void updateInputWeights(std::vector<BasicNeuron<T>>& prevLayer);
 
 private:
     /**
      * @brief A small random weight generator.
      * @return A random weight.
      */
-    static double randomWeight();
+    static T randomWeight();
 
     /**
      * @brief Activation function for the neuron.
      * @param x The input value.
      * @return The activated value.
      */
-    static double activationFunction(double x);
+    static T activationFunction(T x);
 
     /**
      * @brief Derivative of the activation function.
      * @param x The input value.
      * @return The derivative value.
      */
-    static double activationFunctionDerivative(double x);
+    static T activationFunctionDerivative(T x);
 
     /**
      * @brief Sums the contributions of the errors at the nodes we feed.
      * @param nextLayer The next layer of neurons.
      * @return The sum of the contributions.
      */
-    double sumDOW(const std::vector<Neuron>& nextLayer) const;
+    T sumDOW(const std::vector<BasicNeuron<T>>& nextLayer) const;
+
+    T m_outputVal;                                    ///< The output value of the neuron.
+    std::vector<BasicConnection<T>> m_outputWeights;  ///< The weights of the connections to the next layer.
+    unsigned m_myIndex;                               ///< The index of this neuron in its layer.
+    T m_gradient;                                     ///< The gradient calculated during backpropagation.
 
-    double m_outputVal;                       ///< The output value of the neuron.
-    std::vector<Connection> m_outputWeights;  ///< The weights of the connections to the next layer.
-    unsigned m_myIndex;                       ///< The index of this neuron in its layer.
-    double m_gradient;                        ///< The gradient calculated during backpropagation.
+    friend class BasicNeuralNetwork<T>; ///< Reads and restores the connection weights in save() and load().
 
     // Hyperparameters
     static double eta;    ///< Overall net learning rate [0.0..1.0].
     static double alpha;  ///< Momentum multiplier of last deltaWeight [0.0..1.0].
 };
 
+/**
+ * @brief Neuron with double-precision weights.
+ */
+using Neuron = BasicNeuron<double>;
+
 // Initialize static members
-double Neuron::eta = 0.15;   // Learning rate
-double Neuron::alpha = 0.5;  // Momentum
+template <typename T>
+double BasicNeuron<T>::eta = 0.15;   // Learning rate
+template <typename T>
+double BasicNeuron<T>::alpha = 0.5;  // Momentum
 
-Neuron::Neuron(unsigned numOutputs, unsigned index)
+template <typename T>
+BasicNeuron<T>::BasicNeuron(unsigned numOutputs, unsigned index)
     : m_myIndex(index)
 {
     for (unsigned c = 0; c < numOutputs; ++c) {
-        Connection conn;
+        BasicConnection<T> conn;
         conn.weight = randomWeight();
         conn.deltaWeight = 0.0;
         m_outputWeights.push_back(conn);
     }
 }
 
-void Neuron::setOutputVal(double val) {
+template <typename T>
+void BasicNeuron<T>::setOutputVal(T val) {
     m_outputVal = val;
 }
 
-double Neuron::getOutputVal() const {
+template <typename T>
+T BasicNeuron<T>::getOutputVal() const {
     return m_outputVal;
 }
 
-void Neuron::feedForward(const std::vector<Neuron>& prevLayer) {
-    double sum = 0.0;
+template <typename T>
+void BasicNeuron<T>::feedForward(const std::vector<BasicNeuron<T>>& prevLayer) {
+    T sum = 0.0;
 
     // Sum the previous layer's outputs (which are our inputs)
     // Include the bias node from the previous layer.
@@ -140,26 +172,29 @@ void Neuron::feedForward(const std::vector<Neuron>& prevLayer) {
         sum += prevLayer[n].getOutputVal() * prevLayer[n].m_outputWeights[m_myIndex].weight;
     }
 
-    m_outputVal = Neuron::activationFunction(sum);
+    m_outputVal = activationFunction(sum);
 }
 
-void Neuron::calcOutputGradients(double targetVal) {
-    double delta = targetVal - m_outputVal;
-    m_gradient = delta * Neuron::activationFunctionDerivative(m_outputVal);
+template <typename T>
+void BasicNeuron<T>::calcOutputGradients(T targetVal) {
+    T delta = targetVal - m_outputVal;
+    m_gradient = delta * activationFunctionDerivative(m_outputVal);
 }
 
-void Neuron::calcHiddenGradients(const std::vector<Neuron>& nextLayer) {
-    double dow = sumDOW(nextLayer);
-    m_gradient = dow * Neuron::activationFunctionDerivative(m_outputVal);
+template <typename T>
+void BasicNeuron<T>::calcHiddenGradients(const std::vector<BasicNeuron<T>>& nextLayer) {
+    T dow = sumDOW(nextLayer);
+    m_gradient = dow * activationFunctionDerivative(m_outputVal);
 }
 
-void Neuron::updateInputWeights(std::vector<Neuron>& prevLayer) {
+template <typename T>
+void BasicNeuron<T>::updateInputWeights(std::vector<BasicNeuron<T>>& prevLayer) {
     // Update the weights in the previous layer
     for (size_t n = 0; n < prevLayer.size(); ++n) {
-        Neuron& neuron = prevLayer[n];
-        double oldDeltaWeight = neuron.m_outputWeights[m_myIndex].deltaWeight;
+        BasicNeuron<T>& neuron = prevLayer[n];
+        T oldDeltaWeight = neuron.m_outputWeights[m_myIndex].deltaWeight;
 
-        double newDeltaWeight =
+        T newDeltaWeight =
             // Individual input, magnified by the gradient and train rate:
             eta * neuron.getOutputVal() * m_gradient
             // Also add momentum = a fraction of the previous delta weight
@@ -170,22 +205,26 @@ void Neuron::updateInputWeights(std::vector<Neuron>& prevLayer) {
     }
 }
 
-double Neuron::randomWeight() {
-    return rand() / double(RAND_MAX);
+template <typename T>
+T BasicNeuron<T>::randomWeight() {
+    return static_cast<T>(rand() / double(RAND_MAX));
 }
 
-double Neuron::activationFunction(double x) {
+template <typename T>
+T BasicNeuron<T>::activationFunction(T x) {
     // Hyperbolic tangent activation function
-    return tanh(x);
+    return std::tanh(x);
 }
 
-double Neuron::activationFunctionDerivative(double x) {
+template <typename T>
+T BasicNeuron<T>::activationFunctionDerivative(T x) {
     // Derivative of tanh activation function
     return 1.0 - x * x;
 }
 
-double Neuron::sumDOW(const std::vector<Neuron>& nextLayer) const {
-    double sum = 0.0;
+template <typename T>
+T BasicNeuron<T>::sumDOW(const std::vector<BasicNeuron<T>>& nextLayer) const {
+    T sum = 0.0;
 
     // Sum our contributions of the errors at the nodes we feed
     for (size_t n = 0; n < nextLayer.size() - 1; ++n) {
@@ -196,34 +235,46 @@ double Neuron::sumDOW(const std::vector<Neuron>& nextLayer) const {
 }
 
 /**
- * @class NeuralNetwork
+ * @class BasicNeuralNetwork
  * @brief Represents the neural network consisting of layers of neurons.
+ * @tparam T Scalar type of the weights, inputs and outputs, double or float.
  */
-class NeuralNetwork {
+template <typename T>
+class BasicNeuralNetwork {
 public:
     /**
      * @brief Constructs a NeuralNetwork with the given topology.
      * @param topology A vector representing the number of neurons in each layer.
      */
-    NeuralNetwork(const std::vector<unsigned>& topology);
+    BasicNeuralNetwork(const std::vector<unsigned>& topology);
 
     /**
      * @brief Feeds the input values forward through the network.
      * @param inputVals The input values.
      */
-    void feedForward(const std::vector<double>& inputVals);
+    void feedForward(const std::vector<T>& inputVals);
 
     /**
      * @brief Performs backpropagation to adjust weights.
      * @param targetVals The target output values.
      */
-    void backProp(const std::vector<double>& targetVals);
+    void backProp(const std::vector<T>& targetVals);
 
     /**
      * @brief Gets the results from the output layer.
      * @param resultVals The vector to store output values.
      */
-    void getResults(std::vector<double>& resultVals) const;
+    void getResults(std::vector<T>& resultVals) const;
+
+    /**
+     * @brief Feeds a batch of inputs forward and writes the outputs into a caller-provided buffer.
+     *
+     * Runs without allocating; the neuron outputs are left at those of the last row.
+     * @param inputs One row of input values per sample, in any layout.
+     * @param outputs Receives the output values row by row (inputs.rows() x number of outputs).
+     * @throw std::invalid_argument If the sizes do not match the topology.
+     */
+    void predictInto(const ml::BasicMatrixView<T>& inputs, std::span<T> outputs);
 
     /**
      * @brief Gets the recent average error of the network.
@@ -231,25 +282,52 @@ public:
      */
     double getRecentAverageError() const;
 
+    /**
+     * @brief Saves the topology and connection weights to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a network written by save(), replacing the current topology and weights.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a NeuralNetwork.
+     */
+    void load(const std::string& path);
+
 private:
-    std::vector<std::vector<Neuron>> m_layers; ///< Layers of the network: m_layers[layerNum][neuronNum]
-    double m_error;                            ///< The current error of the network.
-    double m_recentAverageError;               ///< The recent average error.
+    /**
+     * @brief Feeds one sample forward through the network.
+     * @param inputVals One value per input neuron.
+     */
+    void feedForwardRow(const T* inputVals);
+
+    std::vector<std::vector<BasicNeuron<T>>> m_layers; ///< Layers of the network: m_layers[layerNum][neuronNum]
+    double m_error;                                    ///< The current error of the network.
+    double m_recentAverageError;                       ///< The recent average error.
     static double m_recentAverageSmoothingFactor; ///< Smoothing factor for the average error.
 };
 
+/**
+ * @brief Neural network with double-precision weights.
+ */
+using NeuralNetwork = BasicNeuralNetwork<double>;
+
 // Initialize static members
-double NeuralNetwork::m_recentAverageSmoothingFactor = 100.0;
+template <typename T>
+double BasicNeuralNetwork<T>::m_recentAverageSmoothingFactor = 100.0;
 
-NeuralNetwork::NeuralNetwork(const std::vector<unsigned>& topology) {
+template <typename T>
+BasicNeuralNetwork<T>::BasicNeuralNetwork(const std::vector<unsigned>& topology) {
     size_t numLayers = topology.size();
     for (size_t layerNum = 0; layerNum < numLayers; ++layerNum) {
-        m_layers.push_back(std::vector<Neuron>());
+        m_layers.push_back(std::vector<BasicNeuron<T>>());
         unsigned numOutputs = (layerNum == topology.size() - 1) ? 0 : topology[layerNum + 1];
 
         // Add neurons to the layer, including a bias neuron
         for (unsigned neuronNum = 0; neuronNum <= topology[layerNum]; ++neuronNum) {
-            m_layers.back().push_back(Neuron(numOutputs, neuronNum));
+            m_layers.back().push_back(BasicNeuron<T>(numOutputs, neuronNum));
             // std::cout << "Created a Neuron!" << std::endl;
         }
 
@@ -258,30 +336,54 @@ NeuralNetwork::NeuralNetwork(const std::vector<unsigned>& topology) {
     }
 }
 
-void NeuralNetwork::feedForward(const std::vector<double>& inputVals) {
+template <typename T>
+void BasicNeuralNetwork<T>::feedForward(const std::vector<T>& inputVals) {
     assert(inputVals.size() == m_layers[0].size() - 1);
+    feedForwardRow(inputVals.data());
+}
+
+template <typename T>
+void BasicNeuralNetwork<T>::predictInto(const ml::BasicMatrixView<T>& inputs, std::span<T> outputs) {
+    size_t numInputs = m_layers[0].size() - 1;
+    size_t numOutputs = m_layers.back().size() - 1;
+    if (inputs.cols() != numInputs) {
+        throw std::invalid_argument("The number of input values must match the input layer.");
+    }
+    ml::check_output_size(inputs.rows() * numOutputs, outputs.size());
+    std::span<T> rowBuffer = ml::scratch<T, 1>(numInputs);
+    const std::vector<BasicNeuron<T>>& outputLayer = m_layers.back();
+    for (size_t i = 0; i < inputs.rows(); ++i) {
+        feedForwardRow(ml::contiguous_row(inputs, i, rowBuffer));
+        for (size_t n = 0; n < numOutputs; ++n) {
+            outputs[i * numOutputs + n] = outputLayer[n].getOutputVal();
+        }
+    }
+}
 
+template <typename T>
+void BasicNeuralNetwork<T>::feedForwardRow(const T* inputVals) {
     // Assign the input values to the input neurons
-    for (size_t i = 0; i < inputVals.size(); ++i) {
+    for (size_t i = 0; i < m_layers[0].size() - 1; ++i) {
         m_layers[0][i].setOutputVal(inputVals[i]);
     }
 
     // Forward propagation
     for (size_t layerNum = 1; layerNum < m_layers.size(); ++layerNum) {
-        std::vector<Neuron>& prevLayer = m_layers[layerNum - 1];
+        std::vector<BasicNeuron<T>>& prevLayer = m_layers[layerNum - 1];
         for (size_t n = 0; n < m_layers[layerNum].size() - 1; ++n) {
             m_layers[layerNum][n].feedForward(prevLayer);
         }
     }
 }
 
-void NeuralNetwork::backProp(const std::vector<double>& targetVals) {
+template <typename T>
+void BasicNeuralNetwork<T>::backProp(const std::vector<T>& targetVals) {
     // Calculate overall net error (RMS of output neuron errors)
-    std::vector<Neuron>& outputLayer = m_layers.back();
+    std::vector<BasicNeuron<T>>& outputLayer = m_layers.back();
     m_error = 0.0;
 
     for (size_t n = 0; n < outputLayer.size() - 1; ++n) {
-        double delta = targetVals[n] - outputLayer[n].getOutputVal();
+        T delta = targetVals[n] - outputLayer[n].getOutputVal();
         m_error += delta * delta;
     }
     m_error /= outputLayer.size() - 1; // Get average squared error
@@ -299,8 +401,8 @@ void NeuralNetwork::backProp(const std::vector<double>& targetVals) {
 
     // Calculate gradients on hidden layers
     for (size_t layerNum = m_layers.size() - 2; layerNum > 0; --layerNum) {
-        std::vector<Neuron>& hiddenLayer = m_layers[layerNum];
-        std::vector<Neuron>& nextLayer = m_layers[layerNum + 1];
+        std::vector<BasicNeuron<T>>& hiddenLayer = m_layers[layerNum];
+        std::vector<BasicNeuron<T>>& nextLayer = m_layers[layerNum + 1];
 
         for (size_t n = 0; n < hiddenLayer.size(); ++n) {
             hiddenLayer[n].calcHiddenGradients(nextLayer);
@@ -309,8 +411,8 @@ void NeuralNetwork::backProp(const std::vector<double>& targetVals) {
 
     // Update connection weights for all layers (from output to first hidden layer)
     for (size_t layerNum = m_layers.size() - 1; layerNum > 0; --layerNum) {
-        std::vector<Neuron>& layer = m_layers[layerNum];
-        std::vector<Neuron>& prevLayer = m_layers[layerNum - 1];
+        std::vector<BasicNeuron<T>>& layer = m_layers[layerNum];
+        std::vector<BasicNeuron<T>>& prevLayer = m_layers[layerNum - 1];
 
         for (size_t n = 0; n < layer.size() - 1; ++n) {
             layer[n].updateInputWeights(prevLayer);
@@ -318,16 +420,61 @@ void NeuralNetwork::backProp(const std::vector<double>& targetVals) {
     }
 }
 
-void NeuralNetwork::getResults(std::vector<double>& resultVals) const {
+template <typename T>
+void BasicNeuralNetwork<T>::getResults(std::vector<T>& resultVals) const {
     resultVals.clear();
-    const std::vector<Neuron>& outputLayer = m_layers.back();
+    const std::vector<BasicNeuron<T>>& outputLayer = m_layers.back();
     for (size_t n = 0; n < outputLayer.size() - 1; ++n) {
         resultVals.push_back(outputLayer[n].getOutputVal());
     }
 }
 
-double NeuralNetwork::getRecentAverageError() const {
+template <typename T>
+double BasicNeuralNetwork<T>::getRecentAverageError() const {
     return m_recentAverageError;
 }
 
+template <typename T>
+void BasicNeuralNetwork<T>::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::NeuralNetwork, 2);
+    writer.write_scalar_type<T>();
+    std::vector<uint32_t> topology;
+    for (const auto& layer : m_layers) {
+        topology.push_back(static_cast<uint32_t>(layer.size() - 1));
+    }
+    writer.write_array(topology);
+    writer.write_double(m_recentAverageError);
+    for (const auto& layer : m_layers) {
+        for (const BasicNeuron<T>& neuron : layer) {
+            writer.write_array(neuron.m_outputWeights);
+        }
+    }
+    writer.finish();
+}
+
+template <typename T>
+void BasicNeuralNetwork<T>::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::NeuralNetwork, 2);
+    reader.read_scalar_type<T>(2);
+    std::span<const uint32_t> stored_topology = reader.read_array<uint32_t>();
+    if (stored_topology.empty()) {
+        throw std::runtime_error("Model file holds an empty network.");
+    }
+    BasicNeuralNetwork loaded(std::vector<unsigned>(stored_topology.begin(), stored_topology.end()));
+    loaded.m_error = 0.0;
+    loaded.m_recentAverageError = reader.read_double();
+    for (auto& layer : loaded.m_layers) {
+        for (BasicNeuron<T>& neuron : layer) {
+            std::span<const BasicConnection<T>> weights = reader.read_array<BasicConnection<T>>();
+            if (weights.size() != neuron.m_outputWeights.size()) {
+                throw std::runtime_error("Model file holds weights that do not match the topology.");
+            }
+            neuron.m_outputWeights.assign(weights.begin(), weights.end());
+        }
+    }
+    *this = std::move(loaded);
+}
+
 #endif // NEURAL_NETWORK_HPP
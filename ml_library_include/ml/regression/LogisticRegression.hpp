@@ -6,6 +6,13 @@
 #include <stdexcept>
 #include <numeric>
 #include <algorithm>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file LogisticRegression.hpp
@@ -39,7 +46,6 @@ public:
             throw std::invalid_argument("The number of feature vectors must match the number of labels.");
         }
 
-        size_t numSamples = features.size();
         size_t numFeatures = features[0].size();
 
         // Validate that all feature vectors have the same size
@@ -49,6 +55,30 @@ public:
             }
         }
 
+        train(ml::Matrix(features), labels);
+    }
+
+    /**
+     * @brief Train the model using features and labels.
+     * @param features Input feature matrix (one row per sample).
+     * @param labels Binary labels (0 or 1).
+     */
+    void train(const ml::MatrixView& features, const std::vector<int>& labels) {
+        if (features.empty() || labels.empty()) {
+            throw std::invalid_argument("Features and labels must not be empty.");
+        }
+        if (features.rows() != labels.size()) {
+            throw std::invalid_argument("The number of feature vectors must match the number of labels.");
+        }
+
+        ml::Matrix packed;
+        ml::MatrixView X = ml::as_row_major(features, packed);
+        size_t numSamples = X.rows();
+        size_t numFeatures = X.cols();
+        if (!weights_.empty() && weights_.size() != X.cols()) {
+            throw std::invalid_argument("Feature vector size does not match the number of weights.");
+        }
+
         // Initialize weights if they haven't been initialized yet
         if (weights_.empty()) {
             weights_ = std::vector<double>(numFeatures, 0.0);
@@ -62,11 +92,12 @@ public:
             double biasGradient = 0.0;
 
             for (size_t i = 0; i < numSamples; ++i) {
-                double prediction = predictProbability(features[i]);
+                const double* x = X.row(i);
+                double prediction = sigmoid(linearPredictor(x));
                 double error = prediction - labels[i];
 
                 for (size_t j = 0; j < numFeatures; ++j) {
-                    gradients[j] += error * features[i][j];
+                    gradients[j] += error * x[j];
                 }
 
                 if (useBias_) {
@@ -94,6 +125,33 @@ public:
         return predictProbability(features) >= 0.5 ? 1 : 0;
     }
 
+    /**
+     * @brief Predicts the class labels for a batch of inputs.
+     * @param features Input feature matrix (one row per sample).
+     * @return Predicted class labels (0 or 1).
+     */
+    std::vector<int> predict(const ml::MatrixView& features) const {
+        std::vector<int> predictions(features.rows());
+        predictInto(features, predictions);
+        return predictions;
+    }
+
+    /**
+     * @brief Predicts the class labels for a batch of inputs into a caller-provided buffer without allocating.
+     * @param features Input feature matrix (one row per sample), in any layout.
+     * @param predictions Receives one class label (0 or 1) per row of features.
+     */
+    void predictInto(const ml::MatrixView& features, std::span<int> predictions) const {
+        if (features.cols() != weights_.size()) {
+            throw std::invalid_argument("Feature vector size does not match the number of weights.");
+        }
+        ml::check_output_size(features.rows(), predictions.size());
+        std::span<double> rowBuffer = ml::scratch<double, 1>(features.cols());
+        for (size_t i = 0; i < features.rows(); ++i) {
+            predictions[i] = sigmoid(linearPredictor(ml::contiguous_row(features, i, rowBuffer))) >= 0.5 ? 1 : 0;
+        }
+    }
+
     /**
      * @brief Predicts the probability of class 1 for a given input.
      * @param features Input feature vector.
@@ -104,11 +162,43 @@ public:
             throw std::invalid_argument("Feature vector size does not match the number of weights.");
         }
 
-        double z = std::inner_product(features.begin(), features.end(), weights_.begin(), 0.0);
-        if (useBias_) {
-            z += bias_;
-        }
-        return sigmoid(z);
+        return sigmoid(linearPredictor(features.data()));
+    }
+
+    /**
+     * @brief Saves the trained model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        ml::BinaryWriter writer(file, ml::ModelType::LogisticRegression, 1);
+        writer.write_double(learningRate_);
+        writer.write_int(iterations_);
+        writer.write_int(useBias_ ? 1 : 0);
+        writer.write_double(bias_);
+        writer.write_array(weights_);
+        writer.finish();
+    }
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a LogisticRegression.
+     */
+    void load(const std::string& path) {
+        auto file = ml::MappedFile::open(path);
+        ml::BinaryReader reader(file->bytes(), ml::ModelType::LogisticRegression, 1);
+        double learningRate = reader.read_double();
+        int iterations = reader.read_int<int>();
+        bool useBias = reader.read_int() != 0;
+        double bias = reader.read_double();
+        std::span<const double> weights = reader.read_array<double>();
+        learningRate_ = learningRate;
+        iterations_ = iterations;
+        useBias_ = useBias;
+        bias_ = bias;
+        weights_.assign(weights.begin(), weights.end());
     }
 
 private:
@@ -118,6 +208,19 @@ private:
     double bias_ = 0.0;                 ///< Bias term
     bool useBias_;                      ///< Whether to use a bias term
 
+    /**
+     * @brief Computes the linear combination of a sample and the weights, plus bias.
+     * @param x Pointer to numFeatures contiguous feature values.
+     * @return The value of w.x + b.
+     */
+    double linearPredictor(const double* x) const {
+        double z = ml::kernels::dot(weights_.data(), x, weights_.size());
+        if (useBias_) {
+            z += bias_;
+        }
+        return z;
+    }
+
     /**
      * @brief Sigmoid activation function (numerically stable version).
      * @param z Linear combination of inputs and weights.
@@ -5,6 +5,13 @@
 #include <stdexcept>
 #include <numeric>
 #include <cmath>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file MultiLinearRegression.hpp
@@ -40,7 +47,6 @@ public:
             throw std::invalid_argument("Features and target data sizes do not match.");
         }
 
-        size_t numSamples = features.size();
         size_t numFeatures = features[0].size();
 
         // Validate that all feature vectors have the same size
@@ -50,14 +56,32 @@ public:
             }
         }
 
+        train(ml::Matrix(features), target);
+    }
+
+    /**
+     * @brief Trains the Multilinear Regression model on the provided data.
+     *
+     * @param features A dense matrix with one row of features per data point.
+     * @param target A vector containing the target values corresponding to each data point.
+     * @throw std::invalid_argument If the number of features does not match the target size.
+     */
+    void train(const ml::MatrixView& features, const std::vector<double>& target) {
+        if (features.empty() || features.rows() != target.size()) {
+            throw std::invalid_argument("Features and target data sizes do not match.");
+        }
+
+        ml::Matrix packed;
+        ml::MatrixView X = ml::as_row_major(features, packed);
+
         // Initialize weights and bias if they haven't been initialized yet
         if (weights_.empty()) {
-            weights_.resize(numFeatures, 0.0);
+            weights_.resize(X.cols(), 0.0);
             bias_ = 0.0;
         }
 
         for (int iter = 0; iter < iterations_; ++iter) {
-            gradientDescentStep(features, target);
+            gradientDescentStep(X, target);
         }
     }
 
@@ -71,9 +95,36 @@ public:
         if (features.size() != weights_.size()) {
             throw std::invalid_argument("Feature vector size does not match the number of weights.");
         }
-        double result = std::inner_product(weights_.begin(), weights_.end(), features.begin(), 0.0);
-        result += bias_;
-        return result;
+        return predictRow(features.data());
+    }
+
+    /**
+     * @brief Predicts the outputs for a batch of data points.
+     *
+     * @param features A dense matrix with one row of features per data point.
+     * @return The predicted values.
+     */
+    std::vector<double> predict(const ml::MatrixView& features) const {
+        std::vector<double> predictions(features.rows());
+        predictInto(features, predictions);
+        return predictions;
+    }
+
+    /**
+     * @brief Predicts the outputs for a batch of data points into a caller-provided buffer without allocating.
+     *
+     * @param features A dense matrix with one row of features per data point, in any layout.
+     * @param predictions Receives one predicted value per row of features.
+     */
+    void predictInto(const ml::MatrixView& features, std::span<double> predictions) const {
+        if (features.cols() != weights_.size()) {
+            throw std::invalid_argument("Feature vector size does not match the number of weights.");
+        }
+        ml::check_output_size(features.rows(), predictions.size());
+        std::span<double> rowBuffer = ml::scratch<double, 1>(features.cols());
+        for (size_t i = 0; i < features.rows(); ++i) {
+            predictions[i] = predictRow(ml::contiguous_row(features, i, rowBuffer));
+        }
     }
 
     /**
@@ -94,6 +145,44 @@ public:
         return bias_;
     }
 
+    /**
+     * @brief Saves the trained model to a binary model file.
+     *
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        ml::BinaryWriter writer(file, ml::ModelType::MultilinearRegression, 1);
+        writer.write_double(learningRate_);
+        writer.write_int(iterations_);
+        writer.write_double(lambda_);
+        writer.write_double(bias_);
+        writer.write_array(weights_);
+        writer.finish();
+    }
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a MultilinearRegression.
+     */
+    void load(const std::string& path) {
+        auto file = ml::MappedFile::open(path);
+        ml::BinaryReader reader(file->bytes(), ml::ModelType::MultilinearRegression, 1);
+        double learningRate = reader.read_double();
+        int iterations = reader.read_int<int>();
+        double lambda = reader.read_double();
+        double bias = reader.read_double();
+        std::span<const double> weights = reader.read_array<double>();
+        learningRate_ = learningRate;
+        iterations_ = iterations;
+        lambda_ = lambda;
+        bias_ = bias;
+        weights_.assign(weights.begin(), weights.end());
+    }
+
 private:
     double learningRate_;            ///< The learning rate for gradient descent.
     int iterations_;                 ///< The number of iterations for training.
@@ -101,25 +190,38 @@ private:
     std::vector<double> weights_;    ///< The weights for the model.
     double bias_ = 0.0;              ///< Bias term.
 
+    /**
+     * @brief Predicts the output for one data point stored contiguously.
+     *
+     * @param x Pointer to the feature values of the data point.
+     * @return The predicted value.
+     */
+    double predictRow(const double* x) const {
+        double result = ml::kernels::dot(weights_.data(), x, weights_.size());
+        result += bias_;
+        return result;
+    }
+
     /**
      * @brief Performs a single iteration of gradient descent to update the model weights.
      *
-     * @param features A vector of vectors containing the feature data.
+     * @param features A row-major matrix containing the feature data.
      * @param target A vector containing the target values.
      */
-    void gradientDescentStep(const std::vector<std::vector<double>>& features, const std::vector<double>& target) {
-        size_t numSamples = features.size();
+    void gradientDescentStep(const ml::MatrixView& features, const std::vector<double>& target) {
+        size_t numSamples = features.rows();
         size_t numFeatures = weights_.size();
 
         std::vector<double> gradients(numFeatures, 0.0);
         double biasGradient = 0.0;
 
         for (size_t i = 0; i < numSamples; ++i) {
-            double prediction = predict(features[i]);
+            const double* x = features.row(i);
+            double prediction = predictRow(x);
             double error = prediction - target[i];
 
             for (size_t j = 0; j < numFeatures; ++j) {
-                gradients[j] += (error * features[i][j]) + (lambda_ * weights_[j]);
+                gradients[j] += (error * x[j]) + (lambda_ * weights_[j]);
             }
 
             biasGradient += error;
@@ -6,6 +6,11 @@
 #include <stdexcept>
 #include <algorithm>
 #include <numeric>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Scratch.hpp"
+#include "../core/Serialization.hpp"
 
 /**
  * @file PolynomialRegression.hpp
@@ -65,6 +70,18 @@ public:
         return result;
     }
 
+    /**
+     * @brief Predicts the outputs for a batch of input values into a caller-provided buffer.
+     * @param x Input features.
+     * @param predictions Receives one predicted value per input.
+     */
+    void predictInto(std::span<const double> x, std::span<double> predictions) const {
+        ml::check_output_size(x.size(), predictions.size());
+        for (size_t i = 0; i < x.size(); ++i) {
+            predictions[i] = predict(x[i]);
+        }
+    }
+
     /**
      * @brief Get the coefficients of the fitted polynomial.
      * @return Vector of coefficients.
@@ -73,6 +90,39 @@ public:
         return coefficients_;
     }
 
+    /**
+     * @brief Saves the trained model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        ml::BinaryWriter writer(file, ml::ModelType::PolynomialRegression, 1);
+        writer.write_int(degree_);
+        writer.write_double(lambda_);
+        writer.write_array(coefficients_);
+        writer.finish();
+    }
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a PolynomialRegression.
+     */
+    void load(const std::string& path) {
+        auto file = ml::MappedFile::open(path);
+        ml::BinaryReader reader(file->bytes(), ml::ModelType::PolynomialRegression, 1);
+        int degree = reader.read_int<int>();
+        double lambda = reader.read_double();
+        std::span<const double> coefficients = reader.read_array<double>();
+        if (degree < 0 || (!coefficients.empty() && coefficients.size() != static_cast<size_t>(degree) + 1)) {
+            throw std::runtime_error("Model file holds inconsistent polynomial coefficients.");
+        }
+        degree_ = degree;
+        lambda_ = lambda;
+        coefficients_.assign(coefficients.begin(), coefficients.end());
+    }
+
 private:
     int degree_;                      ///< Degree of the polynomial
     double lambda_;                   ///< Regularization parameter
@@ -9,6 +9,17 @@
 #include <numeric>
 #include <random>
 #include <cassert>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <memory>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/DataHolder.hpp"
+#include "../core/Profiling.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Kernels.hpp"
 
 /**
  * @file SupportVectorRegression.hpp
@@ -16,10 +27,12 @@
  */
 
 /**
- * @class SupportVectorRegression
+ * @class BasicSupportVectorRegression
  * @brief Support Vector Regression using the ε-insensitive loss function.
+ * @tparam T Scalar type of the samples, targets and support vectors, double or float; the solver works in double.
  */
-class SupportVectorRegression {
+template <typename T>
+class BasicSupportVectorRegression {
 public:
     /**
      * @brief Kernel function types.
@@ -39,27 +52,76 @@ public:
      * @param gamma Gamma parameter for RBF kernel.
      * @param coef0 Independent term in polynomial kernel.
      */
-    SupportVectorRegression(double C = 1.0, double epsilon = 0.1, KernelType kernel_type = KernelType::RBF,
-                            int degree = 3, double gamma = 1.0, double coef0 = 0.0);
+    BasicSupportVectorRegression(double C = 1.0, double epsilon = 0.1, KernelType kernel_type = KernelType::RBF,
+                                 int degree = 3, double gamma = 1.0, double coef0 = 0.0);
 
     /**
      * @brief Destructor for SupportVectorRegression.
      */
-    ~SupportVectorRegression();
+    ~BasicSupportVectorRegression();
 
     /**
      * @brief Fits the SVR model to the training data.
      * @param X A vector of feature vectors (training data).
      * @param y A vector of target values (training labels).
      */
-    void fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y);
+    void fit(const std::vector<std::vector<T>>& X, const std::vector<T>& y);
+
+    /**
+     * @brief Fits the SVR model to the training data.
+     * @param X A dense matrix of training samples (one row per sample).
+     * @param y A vector of target values (training labels).
+     */
+    void fit(const ml::BasicMatrixView<T>& X, const std::vector<T>& y);
+
+    /**
+     * @brief Fits the SVR model by referencing the caller's training data without copying it.
+     *
+     * X and y must stay alive and unchanged until fit_view() returns; the support vectors are
+     * copied out of X at the end of fitting.
+     * @param X A dense matrix of training samples (one row per sample).
+     * @param y The target values (training labels).
+     */
+    void fit_view(const ml::BasicMatrixView<T>& X, std::span<const T> y);
 
     /**
      * @brief Predicts target values for the given input data.
      * @param X A vector of feature vectors (test data).
      * @return A vector of predicted target values.
      */
-    std::vector<double> predict(const std::vector<std::vector<double>>& X) const;
+    std::vector<T> predict(const std::vector<std::vector<T>>& X) const;
+
+    /**
+     * @brief Predicts target values for the given input data.
+     * @param X A dense matrix of test samples (one row per sample).
+     * @return A vector of predicted target values.
+     */
+    std::vector<T> predict(const ml::BasicMatrixView<T>& X) const;
+
+    /**
+     * @brief Predicts target values into a caller-provided buffer without allocating.
+     * @param X A dense matrix of test samples (one row per sample), in any layout.
+     * @param predictions Receives one target value per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows().
+     */
+    void predict_into(const ml::BasicMatrixView<T>& X, std::span<T> predictions) const;
+
+    /**
+     * @brief Saves the fitted model (kernel parameters, support vectors and their dual
+     * coefficients) to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the support vectors are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a SupportVectorRegression.
+     */
+    void load(const std::string& path);
 
 private:
     double C; ///< Regularization parameter.
@@ -69,30 +131,51 @@ private:
     double gamma; ///< Gamma parameter for RBF kernel.
     double coef0; ///< Independent term in polynomial kernel.
 
-    std::vector<std::vector<double>> X_train; ///< Training data features.
-    std::vector<double> y_train;              ///< Training data target values.
+    ml::BasicMatrixHolder<T> X_train;                 ///< Training data features, one sample per row.
+    ml::ArrayHolder<T> y_train;          ///< Training data target values.
     std::vector<double> alpha;                ///< Lagrange multipliers for positive errors.
     std::vector<double> alpha_star;           ///< Lagrange multipliers for negative errors.
     double b;                                 ///< Bias term.
 
-    std::function<double(const std::vector<double>&, const std::vector<double>&)> kernel; ///< Kernel function.
+    ml::BasicMatrixHolder<T> support_vectors;         ///< Training samples with a non-zero dual coefficient, one per row.
+    ml::ArrayHolder<T> dual_coef;        ///< alpha - alpha_star of each support vector.
+    std::shared_ptr<const ml::MappedFile> model_file; ///< Mapped model file that the support vectors borrow from after load().
+
+    std::function<double(const T*, const T*, size_t)> kernel; ///< Kernel function.
 
     /**
      * @brief Initializes the kernel function based on the kernel type.
      */
     void initialize_kernel();
 
+    /**
+     * @brief Resets the multipliers and runs SMO on the stored training data.
+     */
+    void fit_training_data();
+
     /**
      * @brief Solves the dual optimization problem using SMO.
      */
     void solve();
 
     /**
-     * @brief Computes the output for a single sample.
+     * @brief Copies the support vectors out of the training data and releases the training state.
+     */
+    void extract_support_vectors();
+
+    /**
+     * @brief Computes the output of the fitted model for a single sample.
      * @param x The feature vector of the sample.
      * @return The predicted target value.
      */
-    double predict_sample(const std::vector<double>& x) const;
+    T predict_sample(const T* x) const;
+
+    /**
+     * @brief Computes the output for a training sample from the current multipliers (used by SMO).
+     * @param x The feature vector of the sample.
+     * @return The current model output.
+     */
+    double training_output(const T* x) const;
 
     /**
      * @brief Computes the kernel value between two samples.
@@ -100,7 +183,7 @@ private:
      * @param x2 The second feature vector.
      * @return The kernel value.
      */
-    double compute_kernel(const std::vector<double>& x1, const std::vector<double>& x2) const;
+    double compute_kernel(const T* x1, const T* x2) const;
 
     /**
      * @brief Random number generator.
@@ -131,88 +214,186 @@ private:
     size_t select_second_index(size_t i);
 };
 
-SupportVectorRegression::SupportVectorRegression(double C, double epsilon, KernelType kernel_type,
-                                                 int degree, double gamma, double coef0)
+/**
+ * @brief Support Vector Regression on double-precision samples.
+ */
+using SupportVectorRegression = BasicSupportVectorRegression<double>;
+
+template <typename T>
+BasicSupportVectorRegression<T>::BasicSupportVectorRegression(double C, double epsilon, KernelType kernel_type,
+                                                                int degree, double gamma, double coef0)
     : C(C), epsilon(epsilon), kernel_type(kernel_type), degree(degree), gamma(gamma), coef0(coef0), b(0.0) {
     initialize_kernel();
     rng.seed(std::random_device{}());
 }
 
-SupportVectorRegression::~SupportVectorRegression() {}
+template <typename T>
+BasicSupportVectorRegression<T>::~BasicSupportVectorRegression() {}
 
-void SupportVectorRegression::initialize_kernel() {
+template <typename T>
+void BasicSupportVectorRegression<T>::initialize_kernel() {
     if (kernel_type == KernelType::LINEAR) {
-        kernel = [](const std::vector<double>& x1, const std::vector<double>& x2) {
-            return std::inner_product(x1.begin(), x1.end(), x2.begin(), 0.0);
+        kernel = [](const T* x1, const T* x2, size_t n) {
+            return static_cast<double>(ml::kernels::dot(x1, x2, n));
         };
     } else if (kernel_type == KernelType::POLYNOMIAL) {
-        kernel = [this](const std::vector<double>& x1, const std::vector<double>& x2) {
-            return std::pow(gamma * std::inner_product(x1.begin(), x1.end(), x2.begin(), 0.0) + coef0, degree);
+        kernel = [this](const T* x1, const T* x2, size_t n) {
+            return std::pow(gamma * ml::kernels::dot(x1, x2, n) + coef0, degree);
         };
     } else if (kernel_type == KernelType::RBF) {
-        kernel = [this](const std::vector<double>& x1, const std::vector<double>& x2) {
-            double sum = 0.0;
-            for (size_t i = 0; i < x1.size(); ++i) {
-                double diff = x1[i] - x2[i];
-                sum += diff * diff;
-            }
-            return std::exp(-gamma * sum);
+        kernel = [this](const T* x1, const T* x2, size_t n) {
+            return std::exp(-gamma * ml::kernels::squared_l2(x1, x2, n));
         };
     }
 }
 
-void SupportVectorRegression::fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y) {
-    X_train = X;
-    y_train = y;
-    size_t n_samples = X_train.size();
+template <typename T>
+void BasicSupportVectorRegression<T>::fit(const std::vector<std::vector<T>>& X, const std::vector<T>& y) {
+    if (X.size() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    X_train.own(ml::BasicMatrix<T>(X));
+    y_train.own(y);
+    fit_training_data();
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::fit(const ml::BasicMatrixView<T>& X, const std::vector<T>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    X_train.own(ml::BasicMatrix<T>(X));
+    y_train.own(y);
+    fit_training_data();
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::fit_view(const ml::BasicMatrixView<T>& X, std::span<const T> y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    X_train.borrow(X);
+    y_train.borrow(y);
+    fit_training_data();
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::fit_training_data() {
+    size_t n_samples = X_train.rows();
 
-    alpha.resize(n_samples, 0.0);
-    alpha_star.resize(n_samples, 0.0);
+    alpha.assign(n_samples, 0.0);
+    alpha_star.assign(n_samples, 0.0);
+    b = 0.0;
 
     initialize_errors();
 
     solve();
+
+    extract_support_vectors();
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::extract_support_vectors() {
+    size_t n_features = X_train.cols();
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < X_train.rows(); ++i) {
+        if (std::abs(alpha[i] - alpha_star[i]) > 1e-8) {
+            indices.push_back(i);
+        }
+    }
+
+    ml::BasicMatrix<T> vectors(indices.size(), n_features);
+    std::vector<T> coefficients(indices.size());
+    for (size_t s = 0; s < indices.size(); ++s) {
+        const T* x = X_train.row(indices[s]);
+        std::copy(x, x + n_features, vectors.row(s));
+        coefficients[s] = alpha[indices[s]] - alpha_star[indices[s]];
+    }
+    support_vectors.own(std::move(vectors));
+    dual_coef.own(std::move(coefficients));
+    model_file.reset();
+
+    // Only the support vectors are needed for prediction
+    X_train.own(ml::BasicMatrix<T>());
+    y_train.own({});
+    alpha.clear();
+    alpha_star.clear();
+    errors.clear();
 }
 
-std::vector<double> SupportVectorRegression::predict(const std::vector<std::vector<double>>& X) const {
-    std::vector<double> predictions;
+template <typename T>
+std::vector<T> BasicSupportVectorRegression<T>::predict(const std::vector<std::vector<T>>& X) const {
+    std::vector<T> predictions;
     predictions.reserve(X.size());
     for (const auto& x : X) {
-        predictions.push_back(predict_sample(x));
+        predictions.push_back(predict_sample(x.data()));
     }
     return predictions;
 }
 
-void SupportVectorRegression::initialize_errors() {
-    size_t n_samples = X_train.size();
+template <typename T>
+std::vector<T> BasicSupportVectorRegression<T>::predict(const ml::BasicMatrixView<T>& X) const {
+    std::vector<T> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::predict_into(const ml::BasicMatrixView<T>& X, std::span<T> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    std::span<T> row_buffer = ml::scratch<T, 1>(X.cols());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        predictions[i] = predict_sample(ml::contiguous_row(X, i, row_buffer));
+    }
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::initialize_errors() {
+    size_t n_samples = X_train.rows();
     errors.resize(n_samples);
     for (size_t i = 0; i < n_samples; ++i) {
-        errors[i] = predict_sample(X_train[i]) - y_train[i];
+        errors[i] = training_output(X_train.row(i)) - y_train[i];
     }
 }
 
-double SupportVectorRegression::predict_sample(const std::vector<double>& x) const {
+template <typename T>
+T BasicSupportVectorRegression<T>::predict_sample(const T* x) const {
+    ml::BasicMatrixView<T> vectors = support_vectors.view();
+    std::span<const T> coefficients = dual_coef.span();
     double result = b;
-    size_t n_samples = X_train.size();
+    for (size_t s = 0; s < vectors.rows(); ++s) {
+        result += coefficients[s] * kernel(vectors.row(s), x, vectors.cols());
+    }
+    return static_cast<T>(result);
+}
+
+template <typename T>
+double BasicSupportVectorRegression<T>::training_output(const T* x) const {
+    double result = b;
+    size_t n_samples = X_train.rows();
     for (size_t i = 0; i < n_samples; ++i) {
         double coeff = alpha[i] - alpha_star[i];
         if (std::abs(coeff) > 1e-8) {
-            result += coeff * compute_kernel(X_train[i], x);
+            result += coeff * compute_kernel(X_train.row(i), x);
         }
     }
     return result;
 }
 
-double SupportVectorRegression::compute_kernel(const std::vector<double>& x1, const std::vector<double>& x2) const {
-    return kernel(x1, x2);
+template <typename T>
+double BasicSupportVectorRegression<T>::compute_kernel(const T* x1, const T* x2) const {
+    ML_PROFILE_COUNT("SupportVectorRegression::kernel_evaluations", 1);
+    return kernel(x1, x2, X_train.cols());
 }
 
-void SupportVectorRegression::update_error(size_t i) {
-    errors[i] = predict_sample(X_train[i]) - y_train[i];
+template <typename T>
+void BasicSupportVectorRegression<T>::update_error(size_t i) {
+    errors[i] = training_output(X_train.row(i)) - y_train[i];
 }
 
-size_t SupportVectorRegression::select_second_index(size_t i) {
-    size_t n_samples = X_train.size();
+template <typename T>
+size_t BasicSupportVectorRegression<T>::select_second_index(size_t i) {
+    size_t n_samples = X_train.rows();
     std::uniform_int_distribution<size_t> dist(0, n_samples - 1);
     size_t j = dist(rng);
     while (j == i) {
@@ -221,8 +402,10 @@ size_t SupportVectorRegression::select_second_index(size_t i) {
     return j;
 }
 
-void SupportVectorRegression::solve() {
-    size_t n_samples = X_train.size();
+template <typename T>
+void BasicSupportVectorRegression<T>::solve() {
+    ML_PROFILE_SCOPE("SupportVectorRegression::solve");
+    size_t n_samples = X_train.rows();
     size_t max_passes = 5;
     size_t passes = 0;
     double tol = 1e-3;
@@ -243,9 +426,9 @@ void SupportVectorRegression::solve() {
                 double E_j = errors[j];
 
                 // Compute eta
-                double K_ii = compute_kernel(X_train[i], X_train[i]);
-                double K_jj = compute_kernel(X_train[j], X_train[j]);
-                double K_ij = compute_kernel(X_train[i], X_train[j]);
+                double K_ii = compute_kernel(X_train.row(i), X_train.row(i));
+                double K_jj = compute_kernel(X_train.row(j), X_train.row(j));
+                double K_ij = compute_kernel(X_train.row(i), X_train.row(j));
                 double eta = K_ii + K_jj - 2 * K_ij;
 
                 if (eta <= 0) {
@@ -296,4 +479,54 @@ void SupportVectorRegression::solve() {
     }
 }
 
+template <typename T>
+void BasicSupportVectorRegression<T>::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::SupportVectorRegression, 2);
+    writer.write_scalar_type<T>();
+    writer.write_double(C);
+    writer.write_double(epsilon);
+    writer.write_int(static_cast<int64_t>(kernel_type));
+    writer.write_int(degree);
+    writer.write_double(gamma);
+    writer.write_double(coef0);
+    writer.write_double(b);
+    writer.write_matrix(support_vectors.view());
+    writer.write_array(dual_coef.span());
+    writer.finish();
+}
+
+template <typename T>
+void BasicSupportVectorRegression<T>::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::SupportVectorRegression, 2);
+    reader.read_scalar_type<T>(2);
+    double new_C = reader.read_double();
+    double new_epsilon = reader.read_double();
+    int new_kernel_type = reader.read_int<int>();
+    int new_degree = reader.read_int<int>();
+    double new_gamma = reader.read_double();
+    double new_coef0 = reader.read_double();
+    double new_b = reader.read_double();
+    ml::BasicMatrixView<T> vectors = reader.read_matrix<T>();
+    std::span<const T> coefficients = reader.read_array<T>();
+    if (new_kernel_type < static_cast<int>(KernelType::LINEAR) || new_kernel_type > static_cast<int>(KernelType::RBF)) {
+        throw std::runtime_error("Model file holds an unknown kernel type.");
+    }
+    if (vectors.rows() != coefficients.size()) {
+        throw std::runtime_error("Model file holds mismatched support vectors and coefficients.");
+    }
+    C = new_C;
+    epsilon = new_epsilon;
+    kernel_type = static_cast<KernelType>(new_kernel_type);
+    degree = new_degree;
+    gamma = new_gamma;
+    coef0 = new_coef0;
+    b = new_b;
+    initialize_kernel();
+    support_vectors.borrow(vectors);
+    dual_coef.borrow(coefficients);
+    model_file = std::move(file);
+}
+
 #endif // SUPPORT_VECTOR_REGRESSION_HPP
@@ -0,0 +1,245 @@
+#ifndef ML_TREE_CODE_GENERATOR_HPP
+#define ML_TREE_CODE_GENERATOR_HPP
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "FlatTree.hpp"
+
+/**
+ * @file CodeGenerator.hpp
+ * @brief Turns trained trees into C++ source that predicts without the library.
+ */
+
+namespace ml {
+namespace tree {
+
+/**
+ * @brief Shape of the code that write_cpp_model() emits for each tree.
+ */
+enum class CodeStyle {
+    /**
+     * Nested if/else with the thresholds as immediates. The compiler sees the whole tree, so
+     * each test is a compare and a branch with no node loads; best for shallow trees.
+     */
+    Branches,
+    /**
+     * A constexpr array of nodes per tree, walked by one shared loop like FlatTree::predict().
+     * Compiles quickly and stays compact however deep or numerous the trees are.
+     */
+    Tables
+};
+
+namespace detail {
+
+/**
+ * @brief Spells a double as a literal that reads back as exactly the same value.
+ * @throw std::invalid_argument If value is NaN.
+ */
+inline std::string double_literal(double value) {
+    if (std::isnan(value)) {
+        throw std::invalid_argument("Cannot generate code for a tree holding NaN.");
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? "HUGE_VAL" : "-HUGE_VAL";
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    std::string literal(buffer, result.ptr);
+    if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+    }
+    return literal;
+}
+
+inline bool is_identifier(const std::string& name) {
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+}
+
+/**
+ * @brief What a leaf returns: its value, or for classifiers the position of its label in classes.
+ */
+inline std::string leaf_literal(double value, std::span<const int> classes) {
+    if (classes.empty()) {
+        return double_literal(value);
+    }
+    auto it = std::lower_bound(classes.begin(), classes.end(), static_cast<int>(value));
+    if (it == classes.end() || *it != static_cast<int>(value)) {
+        throw std::invalid_argument("A leaf holds a label that is not among the classes.");
+    }
+    return std::to_string(it - classes.begin());
+}
+
+inline void write_branches(std::ostream& out, std::span<const TreeNodeRecord> nodes, std::uint32_t node,
+                           std::span<const int> classes, int indent) {
+    std::string pad(static_cast<std::size_t>(indent) * 4, ' ');
+    const TreeNodeRecord& record = nodes[node];
+    if (record.feature < 0) {
+        out << pad << "return " << leaf_literal(record.value, classes) << ";\n";
+        return;
+    }
+    // NaN fails the test and goes right, as in FlatTree::predict()
+    out << pad << "if (x[" << record.feature << "] <= " << double_literal(record.value) << ") {\n";
+    write_branches(out, nodes, record.left, classes, indent + 1);
+    out << pad << "} else {\n";
+    write_branches(out, nodes, record.left + 1, classes, indent + 1);
+    out << pad << "}\n";
+}
+
+} // namespace detail
+
+/**
+ * @brief Writes a standalone C++ header that predicts exactly like the given trees.
+ *
+ * The header needs nothing but the standard library. Everything goes in namespace name:
+ * one function tree_<i>(const double* x) per tree and a predict(const double* x) that combines
+ * them like the estimator does, where x points to the features of one sample. For regression,
+ * predict() returns the mean of the tree values, summed in tree order so the result is bitwise
+ * equal to the interpreted prediction. For classification, each tree returns the position of
+ * its label in classes and predict() returns the label with the most votes, the smallest one on
+ * ties. A test on a NaN feature fails and goes right, as in FlatTree.
+ *
+ * @param out Receives the header.
+ * @param name Namespace of the generated code; also names the include guard.
+ * @param trees The trees, none of them empty.
+ * @param classes For classifiers, every label the leaves hold, in increasing order; empty for regression.
+ * @param style Whether trees become nested branches or constexpr node tables.
+ * @throw std::invalid_argument If name is not an identifier, there are no trees, a tree is empty,
+ *        a leaf label is missing from classes, or a node holds NaN.
+ */
+inline void write_cpp_model(std::ostream& out, const std::string& name, std::span<const FlatTree* const> trees,
+                            std::span<const int> classes, CodeStyle style) {
+    if (!detail::is_identifier(name)) {
+        throw std::invalid_argument("Generated code needs a C++ identifier as its name, not '" + name + "'.");
+    }
+    if (trees.empty() || std::any_of(trees.begin(), trees.end(), [](const FlatTree* tree) { return tree->empty(); })) {
+        throw std::invalid_argument("Cannot generate code for a model that is not fitted.");
+    }
+    bool classifier = !classes.empty();
+    const char* leaf_type = classifier ? "int" : "double";
+    std::string guard = "ML_GENERATED_" + name + "_HPP";
+    std::transform(guard.begin(), guard.end(), guard.begin(), [](unsigned char c) { return std::toupper(c); });
+
+    out << "// Generated by ml::tree::write_cpp_model(); do not edit.\n"
+        << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+        << "#include <cmath>\n#include <cstddef>\n\n"
+        << "namespace " << name << " {\n\n"
+        << "inline constexpr std::size_t n_trees = " << trees.size() << ";\n\n";
+
+    if (style == CodeStyle::Tables) {
+        out << "struct Node {\n"
+            << "    int feature;     // -1 for leaves\n"
+            << "    unsigned left;   // The right child follows the left one\n"
+            << "    double value;    // Threshold, or leaf " << (classifier ? "class position" : "value") << "\n"
+            << "};\n\n";
+        for (std::size_t t = 0; t < trees.size(); ++t) {
+            out << "inline constexpr Node tree_" << t << "_nodes[] = {\n";
+            for (const TreeNodeRecord& record : trees[t]->nodes()) {
+                std::string value = record.feature < 0 ? detail::leaf_literal(record.value, classes)
+                                                       : detail::double_literal(record.value);
+                out << "    {" << record.feature << ", " << record.left << "u, " << value << "},\n";
+            }
+            out << "};\n\n";
+        }
+        out << "inline " << leaf_type << " walk(const Node* nodes, const double* x) {\n"
+            << "    unsigned i = 0;\n"
+            << "    while (nodes[i].feature >= 0) {\n"
+            << "        i = nodes[i].left + static_cast<unsigned>(!(x[nodes[i].feature] <= nodes[i].value));\n"
+            << "    }\n"
+            << "    return static_cast<" << leaf_type << ">(nodes[i].value);\n"
+            << "}\n\n";
+        for (std::size_t t = 0; t < trees.size(); ++t) {
+            out << "inline " << leaf_type << " tree_" << t << "(const double* x) { return walk(tree_" << t
+                << "_nodes, x); }\n";
+        }
+        out << "\n";
+    } else {
+        for (std::size_t t = 0; t < trees.size(); ++t) {
+            out << "inline " << leaf_type << " tree_" << t << "(const double* x) {\n";
+            detail::write_branches(out, trees[t]->nodes(), 0, classes, 1);
+            out << "}\n\n";
+        }
+    }
+
+    if (classifier) {
+        out << "inline constexpr int classes[] = {";
+        for (std::size_t c = 0; c < classes.size(); ++c) {
+            out << (c == 0 ? "" : ", ") << classes[c];
+        }
+        out << "};\n\n"
+            << "inline int predict(const double* x) {\n"
+            << "    unsigned votes[" << classes.size() << "] = {};\n";
+        for (std::size_t t = 0; t < trees.size(); ++t) {
+            out << "    ++votes[tree_" << t << "(x)];\n";
+        }
+        out << "    std::size_t best = 0;\n"
+            << "    for (std::size_t c = 1; c < " << classes.size() << "; ++c) {\n"
+            << "        best = votes[c] > votes[best] ? c : best;\n"
+            << "    }\n"
+            << "    return classes[best];\n"
+            << "}\n\n";
+    } else {
+        out << "inline double predict(const double* x) {\n"
+            << "    double sum = 0.0;\n";
+        for (std::size_t t = 0; t < trees.size(); ++t) {
+            out << "    sum += tree_" << t << "(x);\n";
+        }
+        out << "    return sum / " << trees.size() << ".0;\n"
+            << "}\n\n";
+    }
+    out << "} // namespace " << name << "\n\n#endif // " << guard << "\n";
+}
+
+/**
+ * @brief Writes the header of write_cpp_model() to a file.
+ * @param path Destination file.
+ * @throw std::runtime_error If the file cannot be written.
+ */
+inline void write_cpp_model(const std::string& path, const std::string& name, std::span<const FlatTree* const> trees,
+                            std::span<const int> classes, CodeStyle style) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    write_cpp_model(file, name, trees, classes, style);
+    file.flush();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+/**
+ * @brief The distinct labels held by the leaves of classification trees, in increasing order.
+ */
+inline std::vector<int> leaf_labels(std::span<const FlatTree* const> trees) {
+    std::vector<int> labels;
+    for (const FlatTree* tree : trees) {
+        for (const TreeNodeRecord& record : tree->nodes()) {
+            if (record.feature < 0) {
+                labels.push_back(static_cast<int>(record.value));
+            }
+        }
+    }
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    return labels;
+}
+
+} // namespace tree
+} // namespace ml
+
+#endif // ML_TREE_CODE_GENERATOR_HPP
@@ -5,8 +5,19 @@
 #include <algorithm>
 #include <numeric>
 #include <limits>
-#include <map>
 #include <cmath>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/Profiling.hpp"
+#include "../core/ThreadPool.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+#include "CodeGenerator.hpp"
 
 /**
  * @file DecisionTreeClassifier.hpp
@@ -31,6 +42,47 @@ public:
      */
     ~DecisionTreeClassifier();
 
+    /**
+     * @brief Sets the pool used to grow the tree in parallel.
+     *
+     * Large nodes search their features in parallel and smaller subtrees are grown as separate
+     * tasks; the tree is the same as on one thread.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Switches training to histograms of quantized features.
+     *
+     * Each feature is quantized once into at most max_bins bins and splits are chosen from per-bin
+     * sums, which scales to far larger datasets than the exact search at the cost of only
+     * considering thresholds between bins.
+     * @param max_bins Bins per feature, between 2 and 256, or 0 for exact training (the default).
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    void set_max_bins(int max_bins);
+
+    /**
+     * @brief Grows the tree best-first up to a number of leaves.
+     *
+     * The leaf whose split decreases the impurity most is split next, so the size of the tree, and
+     * the cost of predicting with it, is bounded directly. max_depth still applies.
+     * @param max_leaf_nodes At least 2, or -1 to grow depth-first (the default).
+     * @throw std::invalid_argument If max_leaf_nodes is out of range.
+     */
+    void set_max_leaf_nodes(int max_leaf_nodes);
+
+    /**
+     * @brief Only makes the splits that decrease the impurity enough.
+     *
+     * As in scikit-learn, the decrease of a split is N_t / N * (G - N_l / N_t * G_l - N_r / N_t * G_r),
+     * where N is the number of training samples, N_t, N_l and N_r those of the node and its
+     * children, and G, G_l and G_r their Gini impurities.
+     * @param min_impurity_decrease The smallest decrease, 0 by default.
+     * @throw std::invalid_argument If min_impurity_decrease is negative.
+     */
+    void set_min_impurity_decrease(double min_impurity_decrease);
+
     /**
      * @brief Fits the model to the training data.
      * @param X A vector of feature vectors.
@@ -38,6 +90,13 @@ public:
      */
     void fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y);
 
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of target class labels.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<int>& y);
+
     /**
      * @brief Predicts class labels for given input data.
      * @param X A vector of feature vectors.
@@ -45,181 +104,410 @@ public:
      */
     std::vector<int> predict(const std::vector<std::vector<double>>& X) const;
 
-private:
-    struct Node {
-        bool is_leaf;
-        int value; // Class label for leaf nodes
-        int feature_index;
-        double threshold;
-        Node* left;
-        Node* right;
-
-        Node() : is_leaf(false), value(0), feature_index(-1), threshold(0.0), left(nullptr), right(nullptr) {}
-    };
+    /**
+     * @brief Predicts class labels for given input data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of predicted class labels.
+     */
+    std::vector<int> predict(const ml::MatrixView& X) const;
+
+    /**
+     * @brief Predicts class labels into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param predictions Receives one label per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows() or X has a different number of features than the training samples.
+     */
+    void predict_into(const ml::MatrixView& X, std::span<int> predictions) const;
+
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the tree nodes are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a DecisionTreeClassifier.
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief Writes a standalone C++ header that predicts like this model, for inference without the library.
+     *
+     * The header defines `int predict(const double* x)` returning the predicted label
+     * in namespace name, where x points to the features of one sample; see ml::tree::write_cpp_model().
+     * @param path Destination file.
+     * @param name Namespace of the generated code.
+     * @param style Nested branches, or constexpr node tables for large models.
+     * @throw std::invalid_argument If the model is not fitted or name is not an identifier.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void export_cpp(const std::string& path, const std::string& name,
+                    ml::tree::CodeStyle style = ml::tree::CodeStyle::Branches) const;
 
-    Node* root;
+private:
+    ml::tree::FlatTree tree;  // Leaves hold class labels
     int max_depth;
     int min_samples_split;
+    int max_bins = 0;
+    int max_leaf_nodes = -1;
+    double min_impurity_decrease = 0.0;
+    ml::ThreadPool* thread_pool = nullptr;
+    size_t n_features = 0;  // Of the training samples
+    double n_samples = 0.0;  // Of the current fit, to weight the impurity decreases
+
+    /**
+     * @brief Best split of a node found by find_best_split().
+     */
+    struct Split {
+        int feature_index = -1;  ///< -1 if no split separates the samples.
+        double threshold = 0.0;
+        double gain = 0.0;  ///< Decrease of the impurity summed over the samples of the node.
+    };
+
+    /**
+     * @brief A node that may still be split by build_best_first().
+     */
+    struct Candidate {
+        double gain;
+        size_t node;
+        std::span<size_t> indices;
+        int depth;
+        Split split;
+    };
+
+    /**
+     * @brief Grows the subtree for the samples in indices into nodes[node].
+     * @param y Class of every sample as an index into classes.
+     * @param classes The distinct labels, in increasing order.
+     * @param indices The rows of the node; partitioned in place between the children.
+     * @param nodes The tree so far; the children of a split are appended as a pair.
+     */
+    void build_tree(const ml::MatrixView& X, const std::vector<int>& y, const std::vector<int>& classes,
+                    std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth);
+
+    /**
+     * @brief Grows the tree into nodes, always splitting the leaf with the largest impurity decrease next.
+     */
+    void build_best_first(const ml::MatrixView& X, const std::vector<int>& y, const std::vector<int>& classes,
+                          std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes);
+
+    /**
+     * @brief Makes nodes[node] a leaf of the majority class and finds the split that should replace it.
+     * @return The split, with feature_index -1 if the node stays a leaf.
+     */
+    Split evaluate_node(const ml::MatrixView& X, const std::vector<int>& y, const std::vector<int>& classes,
+                        std::span<const size_t> indices, std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) const;
+
+    /**
+     * @brief Finds the split with the lowest weighted Gini impurity.
+     *
+     * Each feature is sorted once and its thresholds are swept in order while the per-class counts
+     * of both sides are updated incrementally, so a node costs O(d n log n) and copies no rows.
+     * @param counts Number of samples of each class among indices.
+     */
+    Split find_best_split(const ml::MatrixView& X, const std::vector<int>& y, std::span<const size_t> indices,
+                          const std::vector<size_t>& counts) const;
+
+    /**
+     * @brief Counts the samples of each class among indices.
+     */
+    std::vector<size_t> class_counts(const std::vector<int>& y, size_t n_classes, std::span<const size_t> indices) const;
+
+    /**
+     * @brief Index of the most frequent class; ties go to the smallest label.
+     */
+    int majority_class(const std::vector<size_t>& counts) const;
 
-    Node* build_tree(const std::vector<std::vector<double>>& X, const std::vector<int>& y, int depth);
-    double calculate_gini(const std::vector<int>& y) const;
-    void split_dataset(const std::vector<std::vector<double>>& X, const std::vector<int>& y, int feature_index, double threshold,
-                       std::vector<std::vector<double>>& X_left, std::vector<int>& y_left,
-                       std::vector<std::vector<double>>& X_right, std::vector<int>& y_right) const;
-    int predict_sample(const std::vector<double>& x, Node* node) const;
-    void delete_tree(Node* node);
 };
 
 DecisionTreeClassifier::DecisionTreeClassifier(int max_depth, int min_samples_split)
-    : root(nullptr), max_depth(max_depth), min_samples_split(min_samples_split) {}
+    : max_depth(max_depth), min_samples_split(min_samples_split) {}
+
+DecisionTreeClassifier::~DecisionTreeClassifier() = default;
+
+void DecisionTreeClassifier::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
 
-DecisionTreeClassifier::~DecisionTreeClassifier() {
-    delete_tree(root);
+void DecisionTreeClassifier::set_max_bins(int max_bins) {
+    if (max_bins != 0 && (max_bins < 2 || max_bins > 256)) {
+        throw std::invalid_argument("max_bins must be 0 or between 2 and 256.");
+    }
+    this->max_bins = max_bins;
+}
+
+void DecisionTreeClassifier::set_max_leaf_nodes(int max_leaf_nodes) {
+    if (max_leaf_nodes != -1 && max_leaf_nodes < 2) {
+        throw std::invalid_argument("max_leaf_nodes must be -1 or at least 2.");
+    }
+    this->max_leaf_nodes = max_leaf_nodes;
+}
+
+void DecisionTreeClassifier::set_min_impurity_decrease(double min_impurity_decrease) {
+    if (!(min_impurity_decrease >= 0.0)) {
+        throw std::invalid_argument("min_impurity_decrease must be non-negative.");
+    }
+    this->min_impurity_decrease = min_impurity_decrease;
 }
 
 void DecisionTreeClassifier::fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y) {
-    root = build_tree(X, y, 0);
+    fit(ml::Matrix(X), y);
+}
+
+void DecisionTreeClassifier::fit(const ml::MatrixView& X, const std::vector<int>& y) {
+    ML_PROFILE_SCOPE("DecisionTreeClassifier::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
+    }
+    if (y.empty()) {
+        throw std::invalid_argument("Cannot fit a tree to an empty dataset.");
+    }
+    n_features = X.cols();
+    // Map the labels to dense class indices so that counting needs no lookups
+    std::vector<int> classes(y.begin(), y.end());
+    std::sort(classes.begin(), classes.end());
+    classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+    std::vector<int> y_index(y.size());
+    for (size_t i = 0; i < y.size(); ++i) {
+        y_index[i] = static_cast<int>(std::lower_bound(classes.begin(), classes.end(), y[i]) - classes.begin());
+    }
+    std::vector<size_t> indices(X.rows());
+    std::iota(indices.begin(), indices.end(), 0);
+    if (max_bins > 0) {
+        ml::tree::BinnedMatrix binned(X, max_bins, thread_pool);
+        ml::tree::HistogramTreeBuilder builder(binned, {.classes = y_index, .labels = classes},
+                                               {.max_depth = max_depth, .min_samples_split = min_samples_split,
+                                                .max_leaf_nodes = max_leaf_nodes, .min_impurity_decrease = min_impurity_decrease},
+                                               nullptr, thread_pool);
+        tree = ml::tree::FlatTree(builder.build(indices));
+        return;
+    }
+    n_samples = static_cast<double>(X.rows());
+    std::vector<ml::TreeNodeRecord> nodes(1);
+    if (max_leaf_nodes > 0) {
+        build_best_first(X, y_index, classes, indices, nodes);
+    } else {
+        build_tree(X, y_index, classes, indices, nodes, 0, 0);
+    }
+    tree = ml::tree::FlatTree(nodes);
 }
 
 std::vector<int> DecisionTreeClassifier::predict(const std::vector<std::vector<double>>& X) const {
     std::vector<int> predictions;
+    predictions.reserve(X.size());
     for (const auto& x : X) {
-        predictions.push_back(predict_sample(x, root));
+        ml::check_feature_count(n_features, x.size());
+        predictions.push_back(static_cast<int>(tree.predict(ml::MatrixView(x.data(), 1, x.size()), 0)));
     }
     return predictions;
 }
 
-DecisionTreeClassifier::Node* DecisionTreeClassifier::build_tree(const std::vector<std::vector<double>>& X, const std::vector<int>& y, int depth) {
-    Node* node = new Node();
+std::vector<int> DecisionTreeClassifier::predict(const ml::MatrixView& X) const {
+    std::vector<int> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
 
-    // Check stopping criteria
-    if (depth >= max_depth || y.size() < static_cast<size_t>(min_samples_split) || calculate_gini(y) == 0.0) {
-        node->is_leaf = true;
-        // Majority class label
-        std::map<int, int> class_counts;
-        for (int label : y) {
-            class_counts[label]++;
+void DecisionTreeClassifier::predict_into(const ml::MatrixView& X, std::span<int> predictions) const {
+    ML_PROFILE_SCOPE("DecisionTreeClassifier::predict");
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::check_feature_count(n_features, X.cols());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        predictions[i] = static_cast<int>(tree.predict(X, i));
+    }
+}
+
+void DecisionTreeClassifier::build_tree(const ml::MatrixView& X, const std::vector<int>& y, const std::vector<int>& classes,
+                                        std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes, size_t node,
+                                        int depth) {
+    Split best = evaluate_node(X, y, classes, indices, nodes, node, depth);
+    if (best.feature_index == -1) {
+        return;
+    }
+
+    // Recursively build the left and right subtrees on the two halves of the partitioned rows
+    std::array<std::span<size_t>, 2> child_rows = ml::tree::split_node(X, indices, best.feature_index, best.threshold, nodes, node);
+    size_t left = nodes[node].left;
+    if (thread_pool == nullptr || indices.size() < ml::tree::parallel_node_rows) {
+        build_tree(X, y, classes, child_rows[0], nodes, left, depth + 1);
+        build_tree(X, y, classes, child_rows[1], nodes, left + 1, depth + 1);
+        return;
+    }
+
+    // A child below the parallel cutoff is grown as a task into its own array and attached afterwards
+    std::vector<ml::TreeNodeRecord> subtrees[2];
+    ml::TaskGroup group(*thread_pool);
+    for (size_t side = 0; side < 2; ++side) {
+        if (child_rows[side].size() < ml::tree::parallel_node_rows) {
+            group.run([&, side] {
+                subtrees[side].resize(1);
+                build_tree(X, y, classes, child_rows[side], subtrees[side], 0, depth + 1);
+            });
+        }
+    }
+    for (size_t side = 0; side < 2; ++side) {
+        if (child_rows[side].size() >= ml::tree::parallel_node_rows) {
+            build_tree(X, y, classes, child_rows[side], nodes, left + side, depth + 1);
         }
-        node->value = std::max_element(class_counts.begin(), class_counts.end(),
-                                       [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-                                           return a.second < b.second;
-                                       })->first;
-        return node;
-    }
-
-    double best_gini = std::numeric_limits<double>::max();
-    int best_feature_index = -1;
-    double best_threshold = 0.0;
-    std::vector<std::vector<double>> best_X_left, best_X_right;
-    std::vector<int> best_y_left, best_y_right;
-
-    int num_features = X[0].size();
-    for (int feature_index = 0; feature_index < num_features; ++feature_index) {
-        // Get all possible thresholds
-        std::vector<double> feature_values;
-        for (const auto& x : X) {
-            feature_values.push_back(x[feature_index]);
+    }
+    group.wait();
+    for (size_t side = 0; side < 2; ++side) {
+        if (!subtrees[side].empty()) {
+            ml::tree::append_subtree(nodes, left + side, subtrees[side]);
         }
-        std::sort(feature_values.begin(), feature_values.end());
-        std::vector<double> thresholds;
-        for (size_t i = 1; i < feature_values.size(); ++i) {
-            thresholds.push_back((feature_values[i - 1] + feature_values[i]) / 2.0);
+    }
+}
+
+void DecisionTreeClassifier::build_best_first(const ml::MatrixView& X, const std::vector<int>& y, const std::vector<int>& classes,
+                                              std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes) {
+    Split root = evaluate_node(X, y, classes, indices, nodes, 0, 0);
+    if (root.feature_index == -1) {
+        return;
+    }
+    ml::tree::grow_best_first(Candidate{root.gain, 0, indices, 0, root}, max_leaf_nodes, [&](Candidate& leaf, auto& push) {
+        std::array<std::span<size_t>, 2> child_rows =
+            ml::tree::split_node(X, leaf.indices, leaf.split.feature_index, leaf.split.threshold, nodes, leaf.node);
+        for (size_t side = 0; side < 2; ++side) {
+            size_t child = nodes[leaf.node].left + side;
+            Split best = evaluate_node(X, y, classes, child_rows[side], nodes, child, leaf.depth + 1);
+            if (best.feature_index != -1) {
+                push(Candidate{best.gain, child, child_rows[side], leaf.depth + 1, best});
+            }
         }
+    });
+}
 
-        // Evaluate each threshold
-        for (double threshold : thresholds) {
-            std::vector<std::vector<double>> X_left, X_right;
-            std::vector<int> y_left, y_right;
-            split_dataset(X, y, feature_index, threshold, X_left, y_left, X_right, y_right);
+DecisionTreeClassifier::Split DecisionTreeClassifier::evaluate_node(const ml::MatrixView& X, const std::vector<int>& y,
+                                                                    const std::vector<int>& classes, std::span<const size_t> indices,
+                                                                    std::vector<ml::TreeNodeRecord>& nodes, size_t node,
+                                                                    int depth) const {
+    std::vector<size_t> counts = class_counts(y, classes.size(), indices);
+    int majority = majority_class(counts);
+    nodes[node] = ml::TreeNodeRecord{-1, 0, static_cast<double>(classes[majority])};
 
-            if (y_left.empty() || y_right.empty())
-                continue;
+    // Check stopping criteria; a pure node has all of its samples in the majority class
+    if (depth >= max_depth || indices.size() < static_cast<size_t>(min_samples_split) || counts[majority] == indices.size()) {
+        return {};
+    }
 
-            double gini_left = calculate_gini(y_left);
-            double gini_right = calculate_gini(y_right);
-            double gini = (gini_left * y_left.size() + gini_right * y_right.size()) / y.size();
-
-            if (gini < best_gini) {
-                best_gini = gini;
-                best_feature_index = feature_index;
-                best_threshold = threshold;
-                best_X_left = X_left;
-                best_X_right = X_right;
-                best_y_left = y_left;
-                best_y_right = y_right;
-            }
-        }
+    ML_PROFILE_SCOPE("DecisionTreeClassifier::build_tree");
+    Split best = find_best_split(X, y, indices, counts);
+    if (best.feature_index != -1 && best.gain < min_impurity_decrease * n_samples) {
+        return {};
+    }
+    return best;
+}
+
+DecisionTreeClassifier::Split DecisionTreeClassifier::find_best_split(const ml::MatrixView& X, const std::vector<int>& y,
+                                                                      std::span<const size_t> indices,
+                                                                      const std::vector<size_t>& counts) const {
+    size_t n = indices.size();
+    size_t n_classes = counts.size();
+    // n times the weighted Gini impurity of a split is n - sum_left / n_left - sum_right / n_right, where sum_side
+    // is the sum of the squared class counts of that side, so the best split maximises the subtracted score
+    double total_squares = 0.0;
+    for (size_t count : counts) {
+        total_squares += static_cast<double>(count) * count;
     }
+    // Large nodes search their features in parallel; each feature reports its best threshold
+    std::vector<std::pair<double, double>> feature_best(X.cols());
+    ml::ThreadPool* pool = n >= ml::tree::parallel_node_rows ? thread_pool : nullptr;
+    ml::parallel_for(pool, 0, X.cols(), [&](size_t feature_index) {
+        std::span<std::pair<double, int>> sorted = ml::scratch<std::pair<double, int>>(n);
+        for (size_t i = 0; i < n; ++i) {
+            sorted[i] = {X(indices[i], feature_index), y[indices[i]]};
+        }
+        std::sort(sorted.begin(), sorted.end());
+        ML_PROFILE_COUNT("DecisionTreeClassifier::split_evaluations", n - 1);
+
+        // Move the samples from the right side to the left one at a time, in increasing feature value
+        std::vector<size_t> left_counts(n_classes, 0);
+        double left_squares = 0.0;
+        double right_squares = total_squares;
+        double best_score = -1.0;
+        double best_threshold = 0.0;
+        for (size_t i = 1; i < n; ++i) {
+            size_t c = static_cast<size_t>(sorted[i - 1].second);
+            double left_count = static_cast<double>(left_counts[c]);
+            double right_count = static_cast<double>(counts[c] - left_counts[c]);
+            left_squares += 2.0 * left_count + 1.0;
+            right_squares -= 2.0 * right_count - 1.0;
+            ++left_counts[c];
 
-    // If no split improves the Gini impurity, make this a leaf node
-    if (best_feature_index == -1) {
-        node->is_leaf = true;
-        // Majority class label
-        std::map<int, int> class_counts;
-        for (int label : y) {
-            class_counts[label]++;
+            // Only thresholds between distinct values separate the samples
+            if (sorted[i - 1].first == sorted[i].first) {
+                continue;
+            }
+            double score = left_squares / i + right_squares / (n - i);
+            if (score > best_score) {
+                best_score = score;
+                best_threshold = (sorted[i - 1].first + sorted[i].first) / 2.0;
+            }
         }
-        node->value = std::max_element(class_counts.begin(), class_counts.end(),
-                                       [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-                                           return a.second < b.second;
-                                       })->first;
-        return node;
-    }
-
-    // Recursively build the left and right subtrees
-    node->feature_index = best_feature_index;
-    node->threshold = best_threshold;
-    node->left = build_tree(best_X_left, best_y_left, depth + 1);
-    node->right = build_tree(best_X_right, best_y_right, depth + 1);
-    return node;
-}
-
-double DecisionTreeClassifier::calculate_gini(const std::vector<int>& y) const {
-    std::map<int, int> class_counts;
-    for (int label : y) {
-        class_counts[label]++;
-    }
-    double impurity = 1.0;
-    size_t total = y.size();
-    for (const auto& class_count : class_counts) {
-        double prob = static_cast<double>(class_count.second) / total;
-        impurity -= prob * prob;
-    }
-    return impurity;
-}
-
-void DecisionTreeClassifier::split_dataset(const std::vector<std::vector<double>>& X, const std::vector<int>& y,
-                                           int feature_index, double threshold,
-                                           std::vector<std::vector<double>>& X_left, std::vector<int>& y_left,
-                                           std::vector<std::vector<double>>& X_right, std::vector<int>& y_right) const {
-    for (size_t i = 0; i < X.size(); ++i) {
-        if (X[i][feature_index] <= threshold) {
-            X_left.push_back(X[i]);
-            y_left.push_back(y[i]);
-        } else {
-            X_right.push_back(X[i]);
-            y_right.push_back(y[i]);
+        feature_best[feature_index] = {best_score, best_threshold};
+    });
+
+    // Ties go to the lowest feature, as in a serial scan
+    Split best;
+    double best_score = -1.0;
+    for (size_t feature_index = 0; feature_index < X.cols(); ++feature_index) {
+        if (feature_best[feature_index].first > best_score) {
+            best_score = feature_best[feature_index].first;
+            best.feature_index = static_cast<int>(feature_index);
+            best.threshold = feature_best[feature_index].second;
         }
     }
+    best.gain = best_score - total_squares / n;
+    return best;
 }
 
-int DecisionTreeClassifier::predict_sample(const std::vector<double>& x, Node* node) const {
-    if (node->is_leaf) {
-        return node->value;
-    }
-    if (x[node->feature_index] <= node->threshold) {
-        return predict_sample(x, node->left);
-    } else {
-        return predict_sample(x, node->right);
+std::vector<size_t> DecisionTreeClassifier::class_counts(const std::vector<int>& y, size_t n_classes,
+                                                         std::span<const size_t> indices) const {
+    std::vector<size_t> counts(n_classes, 0);
+    for (size_t idx : indices) {
+        ++counts[y[idx]];
     }
+    return counts;
 }
 
-void DecisionTreeClassifier::delete_tree(Node* node) {
-    if (node != nullptr) {
-        delete_tree(node->left);
-        delete_tree(node->right);
-        delete node;
-    }
+int DecisionTreeClassifier::majority_class(const std::vector<size_t>& counts) const {
+    return static_cast<int>(std::max_element(counts.begin(), counts.end()) - counts.begin());
+}
+
+void DecisionTreeClassifier::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::DecisionTreeClassifier, 2);
+    writer.write_int(max_depth);
+    writer.write_int(min_samples_split);
+    writer.write_int(static_cast<int64_t>(n_features));
+    writer.write_array(tree.nodes());
+    writer.finish();
+}
+
+void DecisionTreeClassifier::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::DecisionTreeClassifier, 2);
+    int new_max_depth = reader.read_int<int>();
+    int new_min_samples_split = reader.read_int<int>();
+    // Version 1 files do not record the feature count; take the width the tree reads
+    bool has_n_features = reader.model_version() >= 2;
+    size_t new_n_features = has_n_features ? reader.read_int<size_t>() : 0;
+    ml::tree::FlatTree new_tree = ml::tree::FlatTree::borrow(reader.read_array<ml::TreeNodeRecord>(), file);
+    new_n_features = ml::tree::check_tree_features(new_tree, new_n_features, has_n_features);
+    tree = std::move(new_tree);
+    n_features = new_n_features;
+    max_depth = new_max_depth;
+    min_samples_split = new_min_samples_split;
+}
+
+void DecisionTreeClassifier::export_cpp(const std::string& path, const std::string& name, ml::tree::CodeStyle style) const {
+    const ml::tree::FlatTree* trees[] = {&tree};
+    ml::tree::write_cpp_model(path, name, trees, ml::tree::leaf_labels(trees), style);
 }
 
 #endif // DECISION_TREE_CLASSIFIER_HPP
@@ -5,6 +5,17 @@
 #include <algorithm>
 #include <numeric>
 #include <limits>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/ThreadPool.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+#include "CodeGenerator.hpp"
 
 /**
  * @file DecisionTreeRegressor.hpp
@@ -29,6 +40,47 @@ public:
      */
     ~DecisionTreeRegressor();
 
+    /**
+     * @brief Sets the pool used to grow the tree in parallel.
+     *
+     * Large nodes search their features in parallel and smaller subtrees are grown as separate
+     * tasks; the tree is the same as on one thread.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Switches training to histograms of quantized features.
+     *
+     * Each feature is quantized once into at most max_bins bins and splits are chosen from per-bin
+     * sums, which scales to far larger datasets than the exact search at the cost of only
+     * considering thresholds between bins.
+     * @param max_bins Bins per feature, between 2 and 256, or 0 for exact training (the default).
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    void set_max_bins(int max_bins);
+
+    /**
+     * @brief Grows the tree best-first up to a number of leaves.
+     *
+     * The leaf whose split decreases the squared error most is split next, so the size of the tree,
+     * and the cost of predicting with it, is bounded directly. max_depth still applies.
+     * @param max_leaf_nodes At least 2, or -1 to grow depth-first (the default).
+     * @throw std::invalid_argument If max_leaf_nodes is out of range.
+     */
+    void set_max_leaf_nodes(int max_leaf_nodes);
+
+    /**
+     * @brief Only makes the splits that decrease the impurity enough.
+     *
+     * As in scikit-learn, the decrease of a split is N_t / N * (E - N_l / N_t * E_l - N_r / N_t * E_r),
+     * where N is the number of training samples, N_t, N_l and N_r those of the node and its
+     * children, and E, E_l and E_r their mean squared errors.
+     * @param min_impurity_decrease The smallest decrease, 0 by default.
+     * @throw std::invalid_argument If min_impurity_decrease is negative.
+     */
+    void set_min_impurity_decrease(double min_impurity_decrease);
+
     /**
      * @brief Fits the model to the training data.
      * @param X A vector of feature vectors.
@@ -36,6 +88,13 @@ public:
      */
     void fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y);
 
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of target values.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<double>& y);
+
     /**
      * @brief Predicts target values for given input data.
      * @param X A vector of feature vectors.
@@ -43,160 +102,339 @@ public:
      */
     std::vector<double> predict(const std::vector<std::vector<double>>& X) const;
 
-private:
-    struct Node {
-        bool is_leaf;
-        double value;
-        int feature_index;
-        double threshold;
-        Node* left;
-        Node* right;
-
-        Node() : is_leaf(false), value(0.0), feature_index(-1), threshold(0.0), left(nullptr), right(nullptr) {}
-    };
+    /**
+     * @brief Predicts target values for given input data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of predicted target values.
+     */
+    std::vector<double> predict(const ml::MatrixView& X) const;
+
+    /**
+     * @brief Predicts target values into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param predictions Receives one target value per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows() or X has a different number of features than the training samples.
+     */
+    void predict_into(const ml::MatrixView& X, std::span<double> predictions) const;
 
-    Node* root;
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the tree nodes are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a DecisionTreeRegressor.
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief Writes a standalone C++ header that predicts like this model, for inference without the library.
+     *
+     * The header defines `double predict(const double* x)` returning the predicted value
+     * in namespace name, where x points to the features of one sample; see ml::tree::write_cpp_model().
+     * @param path Destination file.
+     * @param name Namespace of the generated code.
+     * @param style Nested branches, or constexpr node tables for large models.
+     * @throw std::invalid_argument If the model is not fitted or name is not an identifier.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void export_cpp(const std::string& path, const std::string& name,
+                    ml::tree::CodeStyle style = ml::tree::CodeStyle::Branches) const;
+
+private:
+    ml::tree::FlatTree tree;
     int max_depth;
     int min_samples_split;
+    int max_bins = 0;
+    int max_leaf_nodes = -1;
+    double min_impurity_decrease = 0.0;
+    ml::ThreadPool* thread_pool = nullptr;
+    size_t n_features = 0;  // Of the training samples
+    double n_samples = 0.0;  // Of the current fit, to weight the impurity decreases
+
+    /**
+     * @brief Best split of a node found by find_best_split().
+     */
+    struct Split {
+        int feature_index = -1;  ///< -1 if no split separates the samples.
+        double threshold = 0.0;
+        double gain = 0.0;  ///< Decrease of the squared error summed over the samples of the node.
+    };
+
+    /**
+     * @brief A node that may still be split by build_best_first().
+     */
+    struct Candidate {
+        double gain;
+        size_t node;
+        std::span<size_t> indices;
+        int depth;
+        Split split;
+    };
+
+    /**
+     * @brief Grows the subtree for the samples in indices into nodes[node].
+     * @param indices The rows of the node; partitioned in place between the children.
+     * @param nodes The tree so far; the children of a split are appended as a pair.
+     */
+    void build_tree(const ml::MatrixView& X, const std::vector<double>& y, std::span<size_t> indices,
+                    std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth);
+
+    /**
+     * @brief Grows the tree into nodes, always splitting the leaf with the largest impurity decrease next.
+     */
+    void build_best_first(const ml::MatrixView& X, const std::vector<double>& y, std::span<size_t> indices,
+                          std::vector<ml::TreeNodeRecord>& nodes);
+
+    /**
+     * @brief Makes nodes[node] a leaf holding the mean target and finds the split that should replace it.
+     * @return The split, with feature_index -1 if the node stays a leaf.
+     */
+    Split evaluate_node(const ml::MatrixView& X, const std::vector<double>& y, std::span<const size_t> indices,
+                        std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) const;
 
-    Node* build_tree(const std::vector<std::vector<double>>& X, const std::vector<double>& y, int depth);
-    double calculate_mse(const std::vector<double>& y) const;
-    void split_dataset(const std::vector<std::vector<double>>& X, const std::vector<double>& y, int feature_index, double threshold,
-                       std::vector<std::vector<double>>& X_left, std::vector<double>& y_left,
-                       std::vector<std::vector<double>>& X_right, std::vector<double>& y_right) const;
-    double predict_sample(const std::vector<double>& x, Node* node) const;
-    void delete_tree(Node* node);
+    /**
+     * @brief Finds the split with the lowest summed squared error.
+     *
+     * Each feature is sorted once and its thresholds are swept in order with running target sums,
+     * so a node costs O(d n log n) and copies no rows.
+     */
+    Split find_best_split(const ml::MatrixView& X, const std::vector<double>& y, std::span<const size_t> indices) const;
+    double calculate_mean(const std::vector<double>& y, std::span<const size_t> indices) const;
 };
 
 DecisionTreeRegressor::DecisionTreeRegressor(int max_depth, int min_samples_split)
-    : root(nullptr), max_depth(max_depth), min_samples_split(min_samples_split) {}
+    : max_depth(max_depth), min_samples_split(min_samples_split) {}
+
+DecisionTreeRegressor::~DecisionTreeRegressor() = default;
+
+void DecisionTreeRegressor::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+void DecisionTreeRegressor::set_max_bins(int max_bins) {
+    if (max_bins != 0 && (max_bins < 2 || max_bins > 256)) {
+        throw std::invalid_argument("max_bins must be 0 or between 2 and 256.");
+    }
+    this->max_bins = max_bins;
+}
+
+void DecisionTreeRegressor::set_max_leaf_nodes(int max_leaf_nodes) {
+    if (max_leaf_nodes != -1 && max_leaf_nodes < 2) {
+        throw std::invalid_argument("max_leaf_nodes must be -1 or at least 2.");
+    }
+    this->max_leaf_nodes = max_leaf_nodes;
+}
 
-DecisionTreeRegressor::~DecisionTreeRegressor() {
-    delete_tree(root);
+void DecisionTreeRegressor::set_min_impurity_decrease(double min_impurity_decrease) {
+    if (!(min_impurity_decrease >= 0.0)) {
+        throw std::invalid_argument("min_impurity_decrease must be non-negative.");
+    }
+    this->min_impurity_decrease = min_impurity_decrease;
 }
 
 void DecisionTreeRegressor::fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y) {
-    root = build_tree(X, y, 0);
+    fit(ml::Matrix(X), y);
+}
+
+void DecisionTreeRegressor::fit(const ml::MatrixView& X, const std::vector<double>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    n_features = X.cols();
+    std::vector<size_t> indices(X.rows());
+    std::iota(indices.begin(), indices.end(), 0);
+    if (max_bins > 0) {
+        ml::tree::BinnedMatrix binned(X, max_bins, thread_pool);
+        ml::tree::HistogramTreeBuilder builder(binned, {.values = y},
+                                               {.max_depth = max_depth, .min_samples_split = min_samples_split,
+                                                .max_leaf_nodes = max_leaf_nodes, .min_impurity_decrease = min_impurity_decrease},
+                                               nullptr, thread_pool);
+        tree = ml::tree::FlatTree(builder.build(indices));
+        return;
+    }
+    n_samples = static_cast<double>(X.rows());
+    std::vector<ml::TreeNodeRecord> nodes(1);
+    if (max_leaf_nodes > 0) {
+        build_best_first(X, y, indices, nodes);
+    } else {
+        build_tree(X, y, indices, nodes, 0, 0);
+    }
+    tree = ml::tree::FlatTree(nodes);
 }
 
 std::vector<double> DecisionTreeRegressor::predict(const std::vector<std::vector<double>>& X) const {
     std::vector<double> predictions;
+    predictions.reserve(X.size());
     for (const auto& x : X) {
-        predictions.push_back(predict_sample(x, root));
+        ml::check_feature_count(n_features, x.size());
+        predictions.push_back(tree.predict(ml::MatrixView(x.data(), 1, x.size()), 0));
     }
     return predictions;
 }
 
-DecisionTreeRegressor::Node* DecisionTreeRegressor::build_tree(const std::vector<std::vector<double>>& X, const std::vector<double>& y, int depth) {
-    Node* node = new Node();
+std::vector<double> DecisionTreeRegressor::predict(const ml::MatrixView& X) const {
+    std::vector<double> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
 
-    // Check stopping criteria
-    if (depth >= max_depth || y.size() < min_samples_split) {
-        node->is_leaf = true;
-        node->value = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
-        return node;
-    }
-
-    double best_mse = std::numeric_limits<double>::max();
-    int best_feature_index = -1;
-    double best_threshold = 0.0;
-    std::vector<std::vector<double>> best_X_left, best_X_right;
-    std::vector<double> best_y_left, best_y_right;
-
-    int num_features = X[0].size();
-    for (int feature_index = 0; feature_index < num_features; ++feature_index) {
-        // Get all possible thresholds
-        std::vector<double> feature_values;
-        for (const auto& x : X) {
-            feature_values.push_back(x[feature_index]);
+void DecisionTreeRegressor::predict_into(const ml::MatrixView& X, std::span<double> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::check_feature_count(n_features, X.cols());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        predictions[i] = tree.predict(X, i);
+    }
+}
+
+void DecisionTreeRegressor::build_tree(const ml::MatrixView& X, const std::vector<double>& y, std::span<size_t> indices,
+                                       std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) {
+    Split best = evaluate_node(X, y, indices, nodes, node, depth);
+    if (best.feature_index == -1) {
+        return;
+    }
+
+    // Recursively build the left and right subtrees on the two halves of the partitioned rows
+    std::array<std::span<size_t>, 2> child_rows = ml::tree::split_node(X, indices, best.feature_index, best.threshold, nodes, node);
+    size_t left = nodes[node].left;
+    if (thread_pool == nullptr || indices.size() < ml::tree::parallel_node_rows) {
+        build_tree(X, y, child_rows[0], nodes, left, depth + 1);
+        build_tree(X, y, child_rows[1], nodes, left + 1, depth + 1);
+        return;
+    }
+
+    // A child below the parallel cutoff is grown as a task into its own array and attached afterwards
+    std::vector<ml::TreeNodeRecord> subtrees[2];
+    ml::TaskGroup group(*thread_pool);
+    for (size_t side = 0; side < 2; ++side) {
+        if (child_rows[side].size() < ml::tree::parallel_node_rows) {
+            group.run([&, side] {
+                subtrees[side].resize(1);
+                build_tree(X, y, child_rows[side], subtrees[side], 0, depth + 1);
+            });
         }
-        std::sort(feature_values.begin(), feature_values.end());
-        std::vector<double> thresholds;
-        for (size_t i = 1; i < feature_values.size(); ++i) {
-            thresholds.push_back((feature_values[i - 1] + feature_values[i]) / 2.0);
+    }
+    for (size_t side = 0; side < 2; ++side) {
+        if (child_rows[side].size() >= ml::tree::parallel_node_rows) {
+            build_tree(X, y, child_rows[side], nodes, left + side, depth + 1);
         }
-
-        // Evaluate each threshold
-        for (double threshold : thresholds) {
-            std::vector<std::vector<double>> X_left, X_right;
-            std::vector<double> y_left, y_right;
-            split_dataset(X, y, feature_index, threshold, X_left, y_left, X_right, y_right);
-
-            if (y_left.empty() || y_right.empty())
-                continue;
-
-            double mse_left = calculate_mse(y_left);
-            double mse_right = calculate_mse(y_right);
-            double mse = (mse_left * y_left.size() + mse_right * y_right.size()) / y.size();
-
-            if (mse < best_mse) {
-                best_mse = mse;
-                best_feature_index = feature_index;
-                best_threshold = threshold;
-                best_X_left = X_left;
-                best_X_right = X_right;
-                best_y_left = y_left;
-                best_y_right = y_right;
-            }
+    }
+    group.wait();
+    for (size_t side = 0; side < 2; ++side) {
+        if (!subtrees[side].empty()) {
+            ml::tree::append_subtree(nodes, left + side, subtrees[side]);
         }
     }
+}
 
-    // If no split improves the mse, make this a leaf node
-    if (best_feature_index == -1) {
-        node->is_leaf = true;
-        node->value = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
-        return node;
+void DecisionTreeRegressor::build_best_first(const ml::MatrixView& X, const std::vector<double>& y, std::span<size_t> indices,
+                                             std::vector<ml::TreeNodeRecord>& nodes) {
+    Split root = evaluate_node(X, y, indices, nodes, 0, 0);
+    if (root.feature_index == -1) {
+        return;
     }
-
-    // Recursively build the left and right subtrees
-    node->feature_index = best_feature_index;
-    node->threshold = best_threshold;
-    node->left = build_tree(best_X_left, best_y_left, depth + 1);
-    node->right = build_tree(best_X_right, best_y_right, depth + 1);
-    return node;
+    ml::tree::grow_best_first(Candidate{root.gain, 0, indices, 0, root}, max_leaf_nodes, [&](Candidate& leaf, auto& push) {
+        std::array<std::span<size_t>, 2> child_rows =
+            ml::tree::split_node(X, leaf.indices, leaf.split.feature_index, leaf.split.threshold, nodes, leaf.node);
+        for (size_t side = 0; side < 2; ++side) {
+            size_t child = nodes[leaf.node].left + side;
+            Split best = evaluate_node(X, y, child_rows[side], nodes, child, leaf.depth + 1);
+            if (best.feature_index != -1) {
+                push(Candidate{best.gain, child, child_rows[side], leaf.depth + 1, best});
+            }
+        }
+    });
 }
 
-double DecisionTreeRegressor::calculate_mse(const std::vector<double>& y) const {
-    double mean = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
-    double mse = 0.0;
-    for (double val : y) {
-        mse += (val - mean) * (val - mean);
+DecisionTreeRegressor::Split DecisionTreeRegressor::evaluate_node(const ml::MatrixView& X, const std::vector<double>& y,
+                                                                  std::span<const size_t> indices,
+                                                                  std::vector<ml::TreeNodeRecord>& nodes, size_t node,
+                                                                  int depth) const {
+    nodes[node] = ml::TreeNodeRecord{-1, 0, calculate_mean(y, indices)};
+
+    // Check stopping criteria
+    if (depth >= max_depth || indices.size() < static_cast<size_t>(min_samples_split)) {
+        return {};
+    }
+
+    Split best = find_best_split(X, y, indices);
+    if (best.feature_index != -1 && best.gain < min_impurity_decrease * n_samples) {
+        return {};
     }
-    return mse / y.size();
+    return best;
 }
 
-void DecisionTreeRegressor::split_dataset(const std::vector<std::vector<double>>& X, const std::vector<double>& y,
-                                          int feature_index, double threshold,
-                                          std::vector<std::vector<double>>& X_left, std::vector<double>& y_left,
-                                          std::vector<std::vector<double>>& X_right, std::vector<double>& y_right) const {
-    for (size_t i = 0; i < X.size(); ++i) {
-        if (X[i][feature_index] <= threshold) {
-            X_left.push_back(X[i]);
-            y_left.push_back(y[i]);
-        } else {
-            X_right.push_back(X[i]);
-            y_right.push_back(y[i]);
+DecisionTreeRegressor::Split DecisionTreeRegressor::find_best_split(const ml::MatrixView& X, const std::vector<double>& y,
+                                                                    std::span<const size_t> indices) const {
+    // Large nodes search their features in parallel; each feature reports its best threshold
+    std::vector<std::pair<double, double>> feature_best(X.cols());
+    ml::ThreadPool* pool = indices.size() >= ml::tree::parallel_node_rows ? thread_pool : nullptr;
+    ml::parallel_for(pool, 0, X.cols(), [&](size_t feature_index) {
+        std::span<std::pair<double, size_t>> sorted = ml::scratch<std::pair<double, size_t>>(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            sorted[i] = {X(indices[i], feature_index), indices[i]};
+        }
+        std::sort(sorted.begin(), sorted.end());
+        feature_best[feature_index] = ml::tree::best_variance_split(sorted, y, {});
+    });
+
+    // Ties go to the lowest feature, as in a serial scan
+    Split best;
+    double best_score = -1.0;
+    for (size_t feature_index = 0; feature_index < X.cols(); ++feature_index) {
+        if (feature_best[feature_index].first > best_score) {
+            best_score = feature_best[feature_index].first;
+            best.feature_index = static_cast<int>(feature_index);
+            best.threshold = feature_best[feature_index].second;
+            best.gain = best_score;
         }
     }
+    return best;
 }
 
-double DecisionTreeRegressor::predict_sample(const std::vector<double>& x, Node* node) const {
-    if (node->is_leaf) {
-        return node->value;
-    }
-    if (x[node->feature_index] <= node->threshold) {
-        return predict_sample(x, node->left);
-    } else {
-        return predict_sample(x, node->right);
+double DecisionTreeRegressor::calculate_mean(const std::vector<double>& y, std::span<const size_t> indices) const {
+    double sum = 0.0;
+    for (size_t idx : indices) {
+        sum += y[idx];
     }
+    return sum / indices.size();
 }
 
-void DecisionTreeRegressor::delete_tree(Node* node) {
-    if (node != nullptr) {
-        delete_tree(node->left);
-        delete_tree(node->right);
-        delete node;
-    }
+void DecisionTreeRegressor::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::DecisionTreeRegressor, 2);
+    writer.write_int(max_depth);
+    writer.write_int(min_samples_split);
+    writer.write_int(static_cast<int64_t>(n_features));
+    writer.write_array(tree.nodes());
+    writer.finish();
+}
+
+void DecisionTreeRegressor::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::DecisionTreeRegressor, 2);
+    int new_max_depth = reader.read_int<int>();
+    int new_min_samples_split = reader.read_int<int>();
+    // Version 1 files do not record the feature count; take the width the tree reads
+    bool has_n_features = reader.model_version() >= 2;
+    size_t new_n_features = has_n_features ? reader.read_int<size_t>() : 0;
+    ml::tree::FlatTree new_tree = ml::tree::FlatTree::borrow(reader.read_array<ml::TreeNodeRecord>(), file);
+    new_n_features = ml::tree::check_tree_features(new_tree, new_n_features, has_n_features);
+    tree = std::move(new_tree);
+    n_features = new_n_features;
+    max_depth = new_max_depth;
+    min_samples_split = new_min_samples_split;
+}
+
+void DecisionTreeRegressor::export_cpp(const std::string& path, const std::string& name, ml::tree::CodeStyle style) const {
+    const ml::tree::FlatTree* trees[] = {&tree};
+    ml::tree::write_cpp_model(path, name, trees, {}, style);
 }
 
 #endif // DECISION_TREE_REGRESSOR_HPP
@@ -0,0 +1,219 @@
+#ifndef ML_FLAT_TREE_HPP
+#define ML_FLAT_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <vector>
+#include <stdexcept>
+#include "../core/Matrix.hpp"
+#include "../core/DataHolder.hpp"
+#include "../core/Serialization.hpp"
+
+/**
+ * @file FlatTree.hpp
+ * @brief Contiguous storage and non-recursive traversal of trained decision trees.
+ */
+
+namespace ml {
+namespace tree {
+
+/**
+ * @brief A trained decision tree stored as one array of 16-byte nodes.
+ *
+ * Nodes are in breadth-first order, the same layout as in model files, so the top levels that
+ * every prediction visits share a few cache lines and the two children of a node are adjacent.
+ * Prediction walks the array in a loop and picks the right child by adding the outcome of the
+ * test to the index of the left one, so there is no recursion and no pointer to chase.
+ *
+ * predict_block() routes a block of rows through the tree together, one level at a time and
+ * without branches, so the independent node loads of the rows overlap instead of each row
+ * stalling on its own path and mispredicting every data-dependent turn.
+ *
+ * Trees built by fit own their nodes; trees read from a model file borrow them from the mapping,
+ * which they keep alive, so loading neither copies nor allocates node storage.
+ */
+class FlatTree {
+public:
+    /** @brief The largest number of rows predict_block() takes at once. */
+    static constexpr std::size_t block_rows = 64;
+
+    FlatTree() = default;
+
+    /**
+     * @brief Lays out a tree whose nodes are given in any order where children follow their parent.
+     * @param records Nodes as built by a tree builder; the first one is the root.
+     * @throw std::runtime_error If the records do not describe a valid tree.
+     */
+    explicit FlatTree(std::span<const TreeNodeRecord> records) {
+        // Children always follow their parent, which rules out cycles
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const TreeNodeRecord& record = records[i];
+            if (record.feature < -1 ||
+                (record.feature >= 0 && (record.left <= i || record.left + std::size_t(1) >= records.size()))) {
+                throw std::runtime_error("Model file holds an invalid tree.");
+            }
+            required_features_ = std::max(required_features_, static_cast<std::size_t>(record.feature + 1));
+        }
+        if (records.empty()) {
+            return;
+        }
+
+        // Renumber breadth-first; a node reached twice would make the tree larger than its records
+        std::vector<TreeNodeRecord> nodes;
+        nodes.reserve(records.size());
+        std::vector<std::uint32_t> order{0};
+        std::vector<int> depths{0};
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            const TreeNodeRecord& record = records[order[i]];
+            if (record.feature < 0) {
+                nodes.push_back(TreeNodeRecord{-1, 0, record.value});
+                depth_ = std::max(depth_, depths[i]);
+                continue;
+            }
+            if (order.size() + 2 > records.size()) {
+                throw std::runtime_error("Model file holds an invalid tree.");
+            }
+            nodes.push_back(TreeNodeRecord{record.feature, static_cast<std::uint32_t>(order.size()), record.value});
+            order.push_back(record.left);
+            order.push_back(record.left + 1);
+            depths.push_back(depths[i] + 1);
+            depths.push_back(depths[i] + 1);
+        }
+        nodes_.own(std::move(nodes));
+    }
+
+    /**
+     * @brief Uses nodes that are already in breadth-first order, such as the array of a mapped model file, in place.
+     * @param nodes Nodes as written by save(); they are validated but not copied.
+     * @param file The mapping that holds nodes, kept alive for as long as the tree is.
+     * @throw std::runtime_error If the nodes are not a tree in breadth-first order.
+     */
+    static FlatTree borrow(std::span<const TreeNodeRecord> nodes, std::shared_ptr<const MappedFile> file) {
+        FlatTree tree;
+        // In breadth-first order the k-th split has its children at 2k + 1 and 2k + 2, and a level
+        // ends where the children of the previous level end
+        std::size_t splits = 0;
+        std::size_t level_end = 1;
+        std::size_t next_level_end = 1;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            const TreeNodeRecord& node = nodes[i];
+            if (node.feature < -1 || (node.feature >= 0 && node.left != 2 * splits + 1)) {
+                throw std::runtime_error("Model file holds an invalid tree.");
+            }
+            if (node.feature >= 0) {
+                tree.required_features_ = std::max(tree.required_features_, static_cast<std::size_t>(node.feature) + 1);
+                ++splits;
+                next_level_end = 2 * splits + 1;
+            }
+            if (i + 1 == level_end && next_level_end > level_end) {
+                ++tree.depth_;
+                level_end = next_level_end;
+            }
+        }
+        if (!nodes.empty() && nodes.size() != 2 * splits + 1) {
+            throw std::runtime_error("Model file holds an invalid tree.");
+        }
+        tree.nodes_.borrow(nodes);
+        tree.file_ = std::move(file);
+        return tree;
+    }
+
+    bool empty() const { return nodes_.size() == 0; }
+
+    /** @brief Number of splits on the longest path from the root to a leaf. */
+    int depth() const { return depth_; }
+
+    /** @brief Features a sample needs for the tree to read: one more than the largest feature it tests. */
+    std::size_t required_features() const { return required_features_; }
+
+    /** @brief The nodes in breadth-first order, as written to model files. */
+    std::span<const TreeNodeRecord> nodes() const { return nodes_.span(); }
+
+    /**
+     * @brief Value of the leaf that a row falls into.
+     * @param X Samples, in any layout.
+     * @param row The row of X to route through the tree.
+     */
+    double predict(const MatrixView& X, std::size_t row) const {
+        const TreeNodeRecord* nodes = nodes_.span().data();
+        std::uint32_t i = 0;
+        while (nodes[i].feature >= 0) {
+            i = nodes[i].left + static_cast<std::uint32_t>(!(X(row, nodes[i].feature) <= nodes[i].value));
+        }
+        return nodes[i].value;
+    }
+
+    /**
+     * @brief Routes a block of consecutive rows through the tree.
+     *
+     * Every row takes exactly depth() steps; a row that has reached a leaf stays there, which is a
+     * conditional move rather than a branch.
+     * @param X Samples, in any layout.
+     * @param first_row The first row of the block.
+     * @param n_rows Rows in the block, at most block_rows.
+     * @param visit Called as visit(i, value) with the leaf value of row first_row + i, in order of i.
+     */
+    template <typename Visit>
+    void predict_block(const MatrixView& X, std::size_t first_row, std::size_t n_rows, Visit&& visit) const {
+        route_block(X, n_rows, [first_row](std::size_t i) { return first_row + i; }, visit);
+    }
+
+    /**
+     * @brief Routes a block of rows, given by index, through the tree like predict_block().
+     * @param rows The rows of X in the block, at most block_rows of them.
+     * @param visit Called as visit(i, value) with the leaf value of row rows[i], in order of i.
+     */
+    template <typename Visit>
+    void predict_rows(const MatrixView& X, std::span<const std::size_t> rows, Visit&& visit) const {
+        route_block(X, rows.size(), [rows](std::size_t i) { return rows[i]; }, visit);
+    }
+
+private:
+    template <typename RowOf, typename Visit>
+    void route_block(const MatrixView& X, std::size_t n_rows, RowOf row_of, Visit& visit) const {
+        const TreeNodeRecord* nodes = nodes_.span().data();
+        std::uint32_t position[block_rows] = {};
+        for (int level = 0; level < depth_; ++level) {
+            for (std::size_t i = 0; i < n_rows; ++i) {
+                const TreeNodeRecord& node = nodes[position[i]];
+                // Leaves read feature 0 and discard the result
+                double x = X(row_of(i), static_cast<std::size_t>(std::max(node.feature, 0)));
+                std::uint32_t next = node.left + static_cast<std::uint32_t>(!(x <= node.value));
+                position[i] = node.feature >= 0 ? next : position[i];
+            }
+        }
+        for (std::size_t i = 0; i < n_rows; ++i) {
+            visit(i, nodes[position[i]].value);
+        }
+    }
+
+    ArrayHolder<TreeNodeRecord> nodes_;
+    std::shared_ptr<const MappedFile> file_;  // Mapping that borrowed nodes live in
+    int depth_ = 0;
+    std::size_t required_features_ = 0;
+};
+
+/**
+ * @brief Checks a tree read from a model file against the feature count saved with the model.
+ * @param n_features The saved count, or for files that predate it the count found so far.
+ * @param saved Whether n_features was read from the file.
+ * @return The count to check samples against: the saved one, or else the narrowest width the trees can read.
+ * @throw std::runtime_error If the tree tests a feature beyond the saved count.
+ */
+inline std::size_t check_tree_features(const FlatTree& tree, std::size_t n_features, bool saved) {
+    if (!saved) {
+        return std::max(n_features, tree.required_features());
+    }
+    if (tree.required_features() > n_features) {
+        throw std::runtime_error("Model file holds a tree that tests a feature beyond the model's feature count.");
+    }
+    return n_features;
+}
+
+} // namespace tree
+} // namespace ml
+
+#endif // ML_FLAT_TREE_HPP
@@ -0,0 +1,385 @@
+#ifndef ML_GRADIENT_BOOSTING_HPP
+#define ML_GRADIENT_BOOSTING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <limits>
+#include <array>
+#include <span>
+#include <vector>
+#include <stdexcept>
+#include "../core/Matrix.hpp"
+#include "../core/ThreadPool.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+
+/**
+ * @file GradientBoosting.hpp
+ * @brief The boosting loop and losses shared by the gradient boosted tree estimators.
+ */
+
+namespace ml {
+namespace tree {
+
+/**
+ * @brief Settings of fit_boosted_trees().
+ */
+struct BoostingOptions {
+    int n_estimators = 100;      ///< Boosting rounds; each round grows one tree per output of the loss.
+    double learning_rate = 0.1;  ///< Shrinkage applied to the leaves of every tree.
+    double subsample = 1.0;      ///< Fraction of the training rows, drawn without replacement, that each round fits.
+    int max_bins = 256;          ///< Bins per feature of the quantized training matrix.
+    int n_iter_no_change = -1;   ///< Stop once the validation loss has not improved for this many rounds; -1 never stops.
+    BinnedTreeOptions tree;      ///< Shape of every tree; max_features samples the columns at each node.
+};
+
+/**
+ * @brief A fitted boosted ensemble: the score of output k is baseline[k] plus its trees.
+ */
+struct BoostedTrees {
+    std::vector<double> baseline;         ///< Initial score of each output.
+    std::vector<FlatTree> trees;          ///< One tree per output and round, round after round, already shrunk.
+    std::vector<double> validation_loss;  ///< Mean validation loss after each round grown; empty without validation rows.
+};
+
+/**
+ * @brief Squared error, (y - f)^2 / 2, for regression. Its residual is y - f and leaves hold the mean residual.
+ */
+struct SquaredErrorLoss {
+    static constexpr bool newton_leaves = false;
+
+    std::size_t outputs() const { return 1; }
+    double leaf_scale() const { return 1.0; }
+
+    void baseline(std::span<const double> y, std::span<double> scores) const {
+        scores[0] = y.empty() ? 0.0 : std::accumulate(y.begin(), y.end(), 0.0) / y.size();
+    }
+
+    void residuals(double y, const double* score, double* residual, std::size_t) const {
+        residual[0] = y - score[0];
+    }
+
+    double hessian(double) const { return 1.0; }
+
+    /** @brief Loss of one row as reported for validation: the squared error, so the mean is the MSE. */
+    double loss(double y, const double* score) const {
+        return (y - score[0]) * (y - score[0]);
+    }
+};
+
+/**
+ * @brief Binomial deviance for two classes, with y the index 0 or 1 of the class and f its log-odds.
+ */
+struct LogisticLoss {
+    static constexpr bool newton_leaves = true;
+
+    std::size_t outputs() const { return 1; }
+    double leaf_scale() const { return 1.0; }
+
+    void baseline(std::span<const double> y, std::span<double> scores) const {
+        double positive = std::accumulate(y.begin(), y.end(), 0.0);
+        double p = std::clamp(positive / std::max<std::size_t>(y.size(), 1), 1e-15, 1.0 - 1e-15);
+        scores[0] = std::log(p / (1.0 - p));
+    }
+
+    void residuals(double y, const double* score, double* residual, std::size_t) const {
+        residual[0] = y - 1.0 / (1.0 + std::exp(-score[0]));
+    }
+
+    // With y in {0, 1}, |y - p| (1 - |y - p|) = p (1 - p)
+    double hessian(double residual) const {
+        return std::abs(residual) * (1.0 - std::abs(residual));
+    }
+
+    /** @brief Log-loss of one row. */
+    double loss(double y, const double* score) const {
+        double f = score[0];
+        return std::max(f, 0.0) + std::log1p(std::exp(-std::abs(f))) - y * f;
+    }
+};
+
+/**
+ * @brief Multinomial deviance, with one score per class and y the index of the class.
+ *
+ * Leaves take Friedman's step (K - 1) / K * sum(r) / sum(|r| (1 - |r|)) for K classes.
+ */
+struct SoftmaxLoss {
+    static constexpr bool newton_leaves = true;
+
+    std::size_t classes;
+
+    std::size_t outputs() const { return classes; }
+    double leaf_scale() const { return (classes - 1.0) / classes; }
+
+    // Log of the class priors; classes absent from y get a tiny prior instead of minus infinity
+    void baseline(std::span<const double> y, std::span<double> scores) const {
+        std::vector<double> counts(classes, 0.0);
+        for (double label : y) {
+            counts[static_cast<std::size_t>(label)] += 1.0;
+        }
+        for (std::size_t k = 0; k < classes; ++k) {
+            scores[k] = std::log(std::max(counts[k], 1e-3) / std::max<std::size_t>(y.size(), 1));
+        }
+    }
+
+    void residuals(double y, const double* score, double* residual, std::size_t stride) const {
+        double top = *std::max_element(score, score + classes);
+        double total = 0.0;
+        for (std::size_t k = 0; k < classes; ++k) {
+            total += std::exp(score[k] - top);
+        }
+        for (std::size_t k = 0; k < classes; ++k) {
+            residual[k * stride] = (static_cast<std::size_t>(y) == k ? 1.0 : 0.0) - std::exp(score[k] - top) / total;
+        }
+    }
+
+    double hessian(double residual) const {
+        return std::abs(residual) * (1.0 - std::abs(residual));
+    }
+
+    /** @brief Cross-entropy of one row. */
+    double loss(double y, const double* score) const {
+        double top = *std::max_element(score, score + classes);
+        double total = 0.0;
+        for (std::size_t k = 0; k < classes; ++k) {
+            total += std::exp(score[k] - top);
+        }
+        return top + std::log(total) - score[static_cast<std::size_t>(y)];
+    }
+};
+
+/**
+ * @brief Adds the values of boosted trees to the scores of a block of consecutive rows.
+ * @param trees Whole rounds of trees, outputs trees per round.
+ * @param n_rows Rows in the block, at most FlatTree::block_rows.
+ * @param scores Row-major, outputs scores per row of the block.
+ */
+inline void add_block_scores(std::span<const FlatTree> trees, std::size_t outputs, const MatrixView& X, std::size_t first_row,
+                             std::size_t n_rows, double* scores) {
+    // One tree after another so the rows share each tree's nodes
+    for (std::size_t t = 0; t < trees.size(); ++t) {
+        std::size_t k = t % outputs;
+        trees[t].predict_block(X, first_row, n_rows, [&](std::size_t i, double value) {
+            scores[i * outputs + k] += value;
+        });
+    }
+}
+
+/**
+ * @brief Adds the values of boosted trees to the scores of every row of X.
+ * @param scores Row-major, outputs scores per row of X.
+ * @param pool Pool to score blocks of rows in parallel, or nullptr to run on the calling thread.
+ */
+inline void add_tree_scores(std::span<const FlatTree> trees, std::size_t outputs, const MatrixView& X,
+                            std::span<double> scores, ThreadPool* pool) {
+    constexpr std::size_t block = FlatTree::block_rows;
+    parallel_for(pool, 0, (X.rows() + block - 1) / block, [&](std::size_t b) {
+        std::size_t first = b * block;
+        add_block_scores(trees, outputs, X, first, std::min(block, X.rows() - first), scores.data() + first * outputs);
+    });
+}
+
+/**
+ * @brief Adds the values of boosted trees to the scores of some rows of X, given by index.
+ * @param rows The rows of X to score.
+ * @param scores Row-major, outputs scores per entry of rows.
+ * @param pool Pool to score blocks of rows in parallel, or nullptr to run on the calling thread.
+ */
+inline void add_row_scores(std::span<const FlatTree> trees, std::size_t outputs, const MatrixView& X,
+                           std::span<const std::size_t> rows, std::span<double> scores, ThreadPool* pool) {
+    constexpr std::size_t block = FlatTree::block_rows;
+    parallel_for(pool, 0, (rows.size() + block - 1) / block, [&](std::size_t b) {
+        std::size_t first = b * block;
+        std::span<const std::size_t> block_rows = rows.subspan(first, std::min(block, rows.size() - first));
+        double* block_scores = scores.data() + first * outputs;
+        for (std::size_t t = 0; t < trees.size(); ++t) {
+            std::size_t k = t % outputs;
+            trees[t].predict_rows(X, block_rows, [&](std::size_t i, double value) {
+                block_scores[i * outputs + k] += value;
+            });
+        }
+    });
+}
+
+/**
+ * @brief Replaces every leaf of a tree by its Newton step, scale * sum(residual) / sum(hessian) over its rows.
+ * @param records A tree as returned by HistogramTreeBuilder::build().
+ * @param rows The row of X behind every training position.
+ * @param positions The training positions the tree was grown on.
+ * @param residuals Residual of every training position.
+ */
+template <typename Hessian>
+void set_newton_leaves(std::vector<TreeNodeRecord>& records, const MatrixView& X, std::span<const std::size_t> rows,
+                       std::span<const std::size_t> positions, std::span<const double> residuals, double scale,
+                       Hessian&& hessian) {
+    std::vector<double> sums(records.size(), 0.0), hessians(records.size(), 0.0);
+    for (std::size_t position : positions) {
+        std::size_t row = rows[position];
+        std::uint32_t i = 0;
+        while (records[i].feature >= 0) {
+            i = records[i].left + static_cast<std::uint32_t>(!(X(row, records[i].feature) <= records[i].value));
+        }
+        sums[i] += residuals[position];
+        hessians[i] += hessian(residuals[position]);
+    }
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        if (records[i].feature < 0) {
+            records[i].value = std::abs(hessians[i]) < 1e-150 ? 0.0 : scale * sums[i] / hessians[i];
+        }
+    }
+}
+
+/**
+ * @brief Splits rows 0..n-1 at random into training rows and a validation fraction, both in increasing order.
+ * @throw std::invalid_argument If either part would be empty.
+ */
+inline std::array<std::vector<std::size_t>, 2> holdout_split(std::size_t n, double validation_fraction, std::mt19937& engine) {
+    std::size_t n_valid = static_cast<std::size_t>(std::ceil(validation_fraction * n));
+    if (n_valid == 0 || n_valid >= n) {
+        throw std::invalid_argument("Too few samples to hold out a validation set.");
+    }
+    std::vector<std::size_t> rows(n);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::shuffle(rows.begin(), rows.end(), engine);
+    std::array<std::vector<std::size_t>, 2> parts{std::vector<std::size_t>(rows.begin() + n_valid, rows.end()),
+                                                  std::vector<std::size_t>(rows.begin(), rows.begin() + n_valid)};
+    std::sort(parts[0].begin(), parts[0].end());
+    std::sort(parts[1].begin(), parts[1].end());
+    return parts;
+}
+
+/**
+ * @brief Fits gradient boosted trees that minimize a loss.
+ *
+ * Every round takes the negative gradient of the loss at the current scores and fits one
+ * histogram tree per output to it, on a fresh subsample of the rows. With Loss::newton_leaves
+ * each leaf then takes a Newton step over its rows (Friedman's TreeBoost); otherwise it keeps the
+ * mean residual the tree was grown with. Leaves are shrunk by the learning rate.
+ *
+ * The training and validation rows are read from X and X_valid in place, by index, so a
+ * hold-out split of one matrix needs no copy of either part. The features are quantized once for all rounds. With a pool, the trees of a round grow in
+ * parallel, each splitting its large nodes on the pool too, and the gradients and scores are
+ * updated over blocks of rows. All random draws are made on the calling thread, so a seeded fit
+ * gives the same trees whatever the pool.
+ *
+ * Loss provides outputs(), baseline(y, scores), residuals(y, score, residual, stride) writing the
+ * residual of output k to residual[k * stride], hessian(residual), leaf_scale() and loss(y, score),
+ * where score points to the outputs() scores of a row.
+ *
+ * @param y Target of every row of X; the class index for classification losses.
+ * @param rows The rows of X to fit on.
+ * @param X_valid Samples scored after every round for validation_loss and early stopping; may be X itself.
+ * @param y_valid Target of every row of X_valid.
+ * @param valid_rows The rows of X_valid to score; may be empty.
+ * @param engine Draws the row subsamples and the seeds of the trees.
+ * @param pool Pool to work on, or nullptr to run on the calling thread.
+ */
+template <typename Loss>
+BoostedTrees fit_boosted_trees(const Loss& loss, const BoostingOptions& options, const MatrixView& X, std::span<const double> y,
+                               std::span<const std::size_t> rows, const MatrixView& X_valid, std::span<const double> y_valid,
+                               std::span<const std::size_t> valid_rows, std::mt19937& engine, ThreadPool* pool) {
+    // Everything below is indexed by position in rows and valid_rows
+    std::size_t n = rows.size();
+    std::size_t n_valid = valid_rows.size();
+    std::vector<double> targets(n), valid_targets(n_valid);
+    std::transform(rows.begin(), rows.end(), targets.begin(), [&](std::size_t row) { return y[row]; });
+    std::transform(valid_rows.begin(), valid_rows.end(), valid_targets.begin(), [&](std::size_t row) { return y_valid[row]; });
+    std::size_t outputs = loss.outputs();
+    BoostedTrees model;
+    model.baseline.assign(outputs, 0.0);
+    loss.baseline(targets, model.baseline);
+
+    std::vector<double> scores(n * outputs), valid_scores(n_valid * outputs);
+    for (std::size_t i = 0; i < scores.size(); ++i) {
+        scores[i] = model.baseline[i % outputs];
+    }
+    for (std::size_t i = 0; i < valid_scores.size(); ++i) {
+        valid_scores[i] = model.baseline[i % outputs];
+    }
+
+    BinnedMatrix binned(X, rows, options.max_bins, pool);
+    std::vector<double> residuals(outputs * n);  // One contiguous column per output
+    std::vector<std::size_t> permutation(n);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::size_t n_sampled = std::clamp<std::size_t>(static_cast<std::size_t>(std::llround(options.subsample * n)), 1, n);
+    double best_loss = std::numeric_limits<double>::infinity();
+    std::size_t best_rounds = 0;
+
+    for (int round = 0; round < options.n_estimators; ++round) {
+        parallel_for(pool, 0, n, [&](std::size_t i) {
+            loss.residuals(targets[i], scores.data() + i * outputs, residuals.data() + i, n);
+        }, 4096);
+
+        // Draw the rows of the round and the seeds of its trees on this thread
+        std::vector<std::size_t> sample;
+        if (n_sampled < n) {
+            for (std::size_t i = 0; i < n_sampled; ++i) {
+                std::uniform_int_distribution<std::size_t> pick(i, n - 1);
+                std::swap(permutation[i], permutation[pick(engine)]);
+            }
+            sample.assign(permutation.begin(), permutation.begin() + n_sampled);
+            std::sort(sample.begin(), sample.end());
+        } else {
+            sample = permutation;
+        }
+        std::vector<std::mt19937::result_type> seeds(outputs);
+        for (auto& seed : seeds) {
+            seed = engine();
+        }
+
+        std::size_t first_tree = model.trees.size();
+        model.trees.resize(first_tree + outputs);
+        parallel_for(pool, 0, outputs, [&](std::size_t k) {
+            std::span<const double> residual(residuals.data() + k * n, n);
+            std::vector<std::size_t> indices = sample;
+            std::mt19937 tree_engine(seeds[k]);
+            HistogramTreeBuilder builder(binned, {.values = residual}, options.tree, &tree_engine, pool);
+            std::vector<TreeNodeRecord> records = builder.build(indices);
+            if constexpr (Loss::newton_leaves) {
+                set_newton_leaves(records, X, rows, sample, residual, options.learning_rate * loss.leaf_scale(),
+                                  [&](double r) { return loss.hessian(r); });
+            } else {
+                for (TreeNodeRecord& record : records) {
+                    if (record.feature < 0) {
+                        record.value *= options.learning_rate;
+                    }
+                }
+            }
+            model.trees[first_tree + k] = FlatTree(records);
+        });
+
+        std::span<const FlatTree> round_trees = std::span<const FlatTree>(model.trees).subspan(first_tree);
+        add_row_scores(round_trees, outputs, X, rows, scores, pool);
+        if (n_valid == 0) {
+            continue;
+        }
+        add_row_scores(round_trees, outputs, X_valid, valid_rows, valid_scores, pool);
+        double total = 0.0;
+        for (std::size_t i = 0; i < n_valid; ++i) {
+            total += loss.loss(valid_targets[i], valid_scores.data() + i * outputs);
+        }
+        double mean = total / n_valid;
+        model.validation_loss.push_back(mean);
+        if (mean < best_loss) {
+            best_loss = mean;
+            best_rounds = static_cast<std::size_t>(round) + 1;
+        } else if (options.n_iter_no_change > 0 &&
+                   static_cast<std::size_t>(round) + 1 - best_rounds >= static_cast<std::size_t>(options.n_iter_no_change)) {
+            break;
+        }
+    }
+    // Early stopping keeps the rounds up to the best validation loss
+    if (options.n_iter_no_change > 0 && !model.validation_loss.empty()) {
+        model.trees.resize(best_rounds * outputs);
+    }
+    return model;
+}
+
+} // namespace tree
+} // namespace ml
+
+#endif // ML_GRADIENT_BOOSTING_HPP
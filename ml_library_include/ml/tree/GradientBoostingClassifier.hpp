@@ -0,0 +1,487 @@
+#ifndef GRADIENT_BOOSTING_CLASSIFIER_HPP
+#define GRADIENT_BOOSTING_CLASSIFIER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+#include "GradientBoosting.hpp"
+
+/**
+ * @file GradientBoostingClassifier.hpp
+ * @brief Gradient boosted classification trees trained on feature histograms.
+ */
+
+/**
+ * @class GradientBoostingClassifier
+ * @brief Fits shallow regression trees to the gradient of the log-loss, one round after another.
+ *
+ * Two classes share one log-odds score (logistic loss); more classes get one score and one tree per
+ * round each (softmax loss), and the trees of a round grow in parallel on the thread pool. Leaves
+ * take a Newton step over their rows, shrunk by the learning rate. Trees are grown from histograms
+ * of the features quantized once per fit, optionally on a random fraction of the rows, and a
+ * validation set can stop the training once its log-loss no longer improves.
+ */
+class GradientBoostingClassifier {
+public:
+    /**
+     * @brief Constructs a GradientBoostingClassifier.
+     * @param n_estimators The number of boosting rounds.
+     * @param learning_rate Shrinkage applied to every tree, in (0, 1].
+     * @param max_depth The maximum depth of each tree.
+     * @param min_samples_split The minimum number of samples required to split an internal node.
+     * @param max_features Features drawn at random for every split, or -1 to consider all of them (the default).
+     * @param random_state Seed for the row and feature sampling and the validation hold-out; 0 seeds from std::random_device.
+     *        With a nonzero seed, every fit() grows the same trees whatever the thread pool.
+     * @throw std::invalid_argument If n_estimators or learning_rate is out of range.
+     */
+    GradientBoostingClassifier(int n_estimators = 100, double learning_rate = 0.1, int max_depth = 3, int min_samples_split = 2,
+                               int max_features = -1, unsigned int random_state = 0);
+
+    /**
+     * @brief Sets the pool used to build trees and to predict samples in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Sets the number of bins each feature is quantized into.
+     * @param max_bins Between 2 and 256 (the default).
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    void set_max_bins(int max_bins);
+
+    /**
+     * @brief Fits every round on a random fraction of the training rows, drawn without replacement.
+     * @param fraction In (0, 1]; 1 (the default) uses every row.
+     * @throw std::invalid_argument If fraction is out of range.
+     */
+    void set_subsample(double fraction);
+
+    /**
+     * @brief Grows every tree best-first up to a number of leaves instead of depth-first.
+     * @param max_leaf_nodes At least 2, or -1 to grow depth-first (the default). max_depth still applies.
+     * @throw std::invalid_argument If max_leaf_nodes is out of range.
+     */
+    void set_max_leaf_nodes(int max_leaf_nodes);
+
+    /**
+     * @brief Stops training once the validation log-loss has not improved for a number of rounds.
+     *
+     * fit(X, y) then holds out a random validation_fraction of the rows; fit(X, y, X_valid, y_valid)
+     * uses the given set instead. The model keeps the rounds up to the lowest validation log-loss.
+     * @param n_iter_no_change Rounds without improvement before stopping, or -1 to disable (the default).
+     * @param validation_fraction Fraction of the rows held out by fit(X, y), in (0, 1).
+     * @throw std::invalid_argument If an argument is out of range.
+     */
+    void set_early_stopping(int n_iter_no_change, double validation_fraction = 0.1);
+
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A vector of feature vectors.
+     * @param y A vector of class labels.
+     */
+    void fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y);
+
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of class labels, with at least two distinct labels.
+     * @throw std::invalid_argument If the sizes differ, y holds a single label, or early stopping is on and
+     *        every held-out row has a label found nowhere else, so no validation rows remain.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<int>& y);
+
+    /**
+     * @brief Fits the model to the training data, scoring a validation set after every round.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of class labels, with at least two distinct labels.
+     * @param X_valid Validation samples, used for validation_loss() and early stopping.
+     * @param y_valid Class labels of the validation samples, all of them present in y.
+     * @throw std::invalid_argument If the sizes differ, y holds a single label or y_valid a label missing from y.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<int>& y, const ml::MatrixView& X_valid, const std::vector<int>& y_valid);
+
+    /**
+     * @brief Validation log-loss after each round of the last fit(); empty without a validation set.
+     */
+    const std::vector<double>& validation_loss() const;
+
+    /**
+     * @brief Number of rounds in the model, fewer than n_estimators if training stopped early.
+     */
+    size_t n_rounds() const;
+
+    /**
+     * @brief Predicts class labels for given input data.
+     * @param X A vector of feature vectors.
+     * @return A vector of predicted class labels.
+     */
+    std::vector<int> predict(const std::vector<std::vector<double>>& X) const;
+
+    /**
+     * @brief Predicts class labels for given input data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of predicted class labels.
+     */
+    std::vector<int> predict(const ml::MatrixView& X) const;
+
+    /**
+     * @brief Predicts class labels into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param predictions Receives one label per row of X; ties go to the smallest label.
+     * @throw std::invalid_argument If predictions.size() != X.rows() or X has a different number of features than the training samples.
+     */
+    void predict_into(const ml::MatrixView& X, std::span<int> predictions) const;
+
+    /**
+     * @brief Predicts the probability of every class.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return One row per sample and one column per class, in increasing order of the labels.
+     * @throw std::invalid_argument If X has a different number of features than the training samples.
+     */
+    ml::Matrix predict_proba(const ml::MatrixView& X) const;
+
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the tree nodes are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a GradientBoostingClassifier.
+     */
+    void load(const std::string& path);
+
+private:
+    int n_estimators;
+    double learning_rate;
+    int max_depth;
+    int min_samples_split;
+    int max_features;
+    unsigned int random_state;
+    std::mt19937 random_engine;  // Re-seeded from random_state by every fit()
+
+    ml::ThreadPool* thread_pool = nullptr;
+    int max_bins = 256;
+    double subsample = 1.0;
+    int max_leaf_nodes = -1;
+    int n_iter_no_change = -1;
+    double validation_fraction = 0.1;
+
+    std::vector<int> labels;         // The distinct labels, in increasing order
+    std::vector<double> baseline;    // One score for two classes, else one per class
+    std::vector<ml::tree::FlatTree> trees;  // baseline.size() trees per round; leaves already shrunk
+    size_t n_features = 0;  // Of the training samples
+    std::vector<double> validation_losses;
+
+    /**
+     * @brief Maps labels to their index in labels, as the doubles fit_boosted_trees() takes.
+     * @throw std::invalid_argument If a label is not in labels.
+     */
+    std::vector<double> class_indices(const std::vector<int>& y) const;
+
+    /**
+     * @brief Raw scores of a block of at most FlatTree::block_rows rows, baseline.size() per row.
+     */
+    void block_scores(const ml::MatrixView& X, size_t first, size_t n_rows, double* scores) const;
+
+    /**
+     * @brief Fits the given rows of X, scoring the given rows of X_valid after every round.
+     * @throw std::invalid_argument If the rows hold a single label or y_valid a label missing from them.
+     */
+    void fit_rows(const ml::MatrixView& X, const std::vector<int>& y, std::span<const size_t> rows,
+                  const ml::MatrixView& X_valid, const std::vector<int>& y_valid, std::span<const size_t> valid_rows);
+};
+
+GradientBoostingClassifier::GradientBoostingClassifier(int n_estimators, double learning_rate, int max_depth,
+                                                       int min_samples_split, int max_features, unsigned int random_state)
+    : n_estimators(n_estimators), learning_rate(learning_rate), max_depth(max_depth), min_samples_split(min_samples_split),
+      max_features(max_features), random_state(random_state) {
+    if (n_estimators < 1) {
+        throw std::invalid_argument("n_estimators must be at least 1.");
+    }
+    if (!(learning_rate > 0.0 && learning_rate <= 1.0)) {
+        throw std::invalid_argument("learning_rate must be in (0, 1].");
+    }
+}
+
+void GradientBoostingClassifier::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+void GradientBoostingClassifier::set_max_bins(int max_bins) {
+    if (max_bins < 2 || max_bins > 256) {
+        throw std::invalid_argument("max_bins must be between 2 and 256.");
+    }
+    this->max_bins = max_bins;
+}
+
+void GradientBoostingClassifier::set_subsample(double fraction) {
+    if (!(fraction > 0.0 && fraction <= 1.0)) {
+        throw std::invalid_argument("subsample must be in (0, 1].");
+    }
+    subsample = fraction;
+}
+
+void GradientBoostingClassifier::set_max_leaf_nodes(int max_leaf_nodes) {
+    if (max_leaf_nodes != -1 && max_leaf_nodes < 2) {
+        throw std::invalid_argument("max_leaf_nodes must be -1 or at least 2.");
+    }
+    this->max_leaf_nodes = max_leaf_nodes;
+}
+
+void GradientBoostingClassifier::set_early_stopping(int n_iter_no_change, double validation_fraction) {
+    if (n_iter_no_change != -1 && n_iter_no_change < 1) {
+        throw std::invalid_argument("n_iter_no_change must be -1 or at least 1.");
+    }
+    if (!(validation_fraction > 0.0 && validation_fraction < 1.0)) {
+        throw std::invalid_argument("validation_fraction must be in (0, 1).");
+    }
+    this->n_iter_no_change = n_iter_no_change;
+    this->validation_fraction = validation_fraction;
+}
+
+void GradientBoostingClassifier::fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y) {
+    fit(ml::Matrix(X), y);
+}
+
+void GradientBoostingClassifier::fit(const ml::MatrixView& X, const std::vector<int>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
+    }
+    if (n_iter_no_change == -1) {
+        fit(X, y, ml::MatrixView(), {});
+        return;
+    }
+    // Start over from the seed so that fitting twice gives the same model
+    random_engine.seed(random_state != 0 ? random_state : std::random_device()());
+    auto [train, valid] = ml::tree::holdout_split(X.rows(), validation_fraction, random_engine);
+    // A rare label drawn only into the validation rows goes back to the training rows; early
+    // stopping cannot work if that empties the validation set
+    std::vector<int> known;
+    for (size_t row : train) {
+        known.push_back(y[row]);
+    }
+    std::sort(known.begin(), known.end());
+    std::erase_if(valid, [&](size_t row) {
+        if (std::binary_search(known.begin(), known.end(), y[row])) {
+            return false;
+        }
+        train.push_back(row);
+        return true;
+    });
+    if (valid.empty()) {
+        throw std::invalid_argument("Every held-out label is too rare to validate on; pass a validation set to fit().");
+    }
+    std::sort(train.begin(), train.end());
+    fit_rows(X, y, train, X, y, valid);
+}
+
+void GradientBoostingClassifier::fit(const ml::MatrixView& X, const std::vector<int>& y, const ml::MatrixView& X_valid,
+                                     const std::vector<int>& y_valid) {
+    if (X.rows() != y.size() || X_valid.rows() != y_valid.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
+    }
+    if (X_valid.rows() > 0 && X_valid.cols() != X.cols()) {
+        throw std::invalid_argument("Validation samples must have as many features as the training samples.");
+    }
+    std::vector<size_t> rows(X.rows()), valid_rows(X_valid.rows());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::iota(valid_rows.begin(), valid_rows.end(), 0);
+    random_engine.seed(random_state != 0 ? random_state : std::random_device()());
+    fit_rows(X, y, rows, X_valid, y_valid, valid_rows);
+}
+
+void GradientBoostingClassifier::fit_rows(const ml::MatrixView& X, const std::vector<int>& y, std::span<const size_t> rows,
+                                          const ml::MatrixView& X_valid, const std::vector<int>& y_valid,
+                                          std::span<const size_t> valid_rows) {
+    n_features = X.cols();
+    std::vector<int> new_labels(rows.size());
+    std::transform(rows.begin(), rows.end(), new_labels.begin(), [&](size_t row) { return y[row]; });
+    std::sort(new_labels.begin(), new_labels.end());
+    new_labels.erase(std::unique(new_labels.begin(), new_labels.end()), new_labels.end());
+    if (new_labels.size() < 2) {
+        throw std::invalid_argument("GradientBoostingClassifier needs at least two classes.");
+    }
+    labels = std::move(new_labels);
+    std::vector<double> y_index = class_indices(y);
+    std::vector<double> y_valid_index = class_indices(y_valid);
+
+    ml::tree::BoostingOptions options{.n_estimators = n_estimators, .learning_rate = learning_rate, .subsample = subsample,
+                                      .max_bins = max_bins, .n_iter_no_change = n_iter_no_change,
+                                      .tree = {.max_depth = max_depth, .min_samples_split = min_samples_split,
+                                               .max_features = max_features, .max_leaf_nodes = max_leaf_nodes}};
+    ml::tree::BoostedTrees model =
+        labels.size() == 2
+            ? ml::tree::fit_boosted_trees(ml::tree::LogisticLoss{}, options, X, y_index, rows, X_valid, y_valid_index,
+                                          valid_rows, random_engine, thread_pool)
+            : ml::tree::fit_boosted_trees(ml::tree::SoftmaxLoss{labels.size()}, options, X, y_index, rows, X_valid,
+                                          y_valid_index, valid_rows, random_engine, thread_pool);
+    baseline = std::move(model.baseline);
+    trees = std::move(model.trees);
+    validation_losses = std::move(model.validation_loss);
+}
+
+const std::vector<double>& GradientBoostingClassifier::validation_loss() const {
+    return validation_losses;
+}
+
+size_t GradientBoostingClassifier::n_rounds() const {
+    return baseline.empty() ? 0 : trees.size() / baseline.size();
+}
+
+std::vector<int> GradientBoostingClassifier::predict(const std::vector<std::vector<double>>& X) const {
+    return predict(ml::Matrix(X).view());
+}
+
+std::vector<int> GradientBoostingClassifier::predict(const ml::MatrixView& X) const {
+    std::vector<int> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+void GradientBoostingClassifier::predict_into(const ml::MatrixView& X, std::span<int> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    if (labels.empty()) {
+        std::fill(predictions.begin(), predictions.end(), 0);
+        return;
+    }
+    ml::check_feature_count(n_features, X.cols());
+    constexpr size_t block = ml::tree::FlatTree::block_rows;
+    size_t outputs = baseline.size();
+    ml::parallel_for(thread_pool, 0, (X.rows() + block - 1) / block, [&](size_t b) {
+        size_t first = b * block;
+        size_t n_rows = std::min(block, X.rows() - first);
+        std::span<double> scores = ml::scratch<double>(n_rows * outputs);
+        block_scores(X, first, n_rows, scores.data());
+        for (size_t i = 0; i < n_rows; ++i) {
+            const double* row = scores.data() + i * outputs;
+            size_t best = outputs == 1 ? (row[0] > 0.0 ? 1 : 0) : std::max_element(row, row + outputs) - row;
+            predictions[first + i] = labels[best];
+        }
+    });
+}
+
+ml::Matrix GradientBoostingClassifier::predict_proba(const ml::MatrixView& X) const {
+    ml::check_feature_count(n_features, X.cols());
+    ml::Matrix probabilities(X.rows(), labels.size());
+    constexpr size_t block = ml::tree::FlatTree::block_rows;
+    size_t outputs = baseline.size();
+    ml::parallel_for(thread_pool, 0, (X.rows() + block - 1) / block, [&](size_t b) {
+        size_t first = b * block;
+        size_t n_rows = std::min(block, X.rows() - first);
+        std::span<double> scores = ml::scratch<double>(n_rows * outputs);
+        block_scores(X, first, n_rows, scores.data());
+        for (size_t i = 0; i < n_rows; ++i) {
+            const double* row = scores.data() + i * outputs;
+            if (outputs == 1) {
+                double p = 1.0 / (1.0 + std::exp(-row[0]));
+                probabilities(first + i, 0) = 1.0 - p;
+                probabilities(first + i, 1) = p;
+                continue;
+            }
+            double top = *std::max_element(row, row + outputs);
+            double total = 0.0;
+            for (size_t k = 0; k < outputs; ++k) {
+                total += std::exp(row[k] - top);
+            }
+            for (size_t k = 0; k < outputs; ++k) {
+                probabilities(first + i, k) = std::exp(row[k] - top) / total;
+            }
+        }
+    });
+    return probabilities;
+}
+
+std::vector<double> GradientBoostingClassifier::class_indices(const std::vector<int>& y) const {
+    std::vector<double> indices(y.size());
+    for (size_t i = 0; i < y.size(); ++i) {
+        auto it = std::lower_bound(labels.begin(), labels.end(), y[i]);
+        if (it == labels.end() || *it != y[i]) {
+            throw std::invalid_argument("Validation labels must appear in the training labels.");
+        }
+        indices[i] = static_cast<double>(it - labels.begin());
+    }
+    return indices;
+}
+
+void GradientBoostingClassifier::block_scores(const ml::MatrixView& X, size_t first, size_t n_rows, double* scores) const {
+    size_t outputs = baseline.size();
+    for (size_t i = 0; i < n_rows; ++i) {
+        std::copy(baseline.begin(), baseline.end(), scores + i * outputs);
+    }
+    ml::tree::add_block_scores(trees, outputs, X, first, n_rows, scores);
+}
+
+void GradientBoostingClassifier::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::GradientBoostingClassifier, 2);
+    writer.write_int(n_estimators);
+    writer.write_double(learning_rate);
+    writer.write_int(max_depth);
+    writer.write_int(min_samples_split);
+    writer.write_int(max_features);
+    writer.write_int(static_cast<int64_t>(n_features));
+    writer.write_array(labels);
+    writer.write_array(baseline);
+    writer.write_int(static_cast<int64_t>(trees.size()));
+    for (const ml::tree::FlatTree& tree : trees) {
+        writer.write_array(tree.nodes());
+    }
+    writer.finish();
+}
+
+void GradientBoostingClassifier::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::GradientBoostingClassifier, 2);
+    int new_n_estimators = reader.read_int<int>();
+    double new_learning_rate = reader.read_double();
+    int new_max_depth = reader.read_int<int>();
+    int new_min_samples_split = reader.read_int<int>();
+    int new_max_features = reader.read_int<int>();
+    // Version 1 files do not record the feature count; take the widest one the trees read
+    bool has_n_features = reader.model_version() >= 2;
+    size_t new_n_features = has_n_features ? reader.read_int<size_t>() : 0;
+    std::span<const int> new_labels = reader.read_array<int>();
+    std::span<const double> new_baseline = reader.read_array<double>();
+    size_t n_trees = reader.read_int<size_t>();
+    size_t outputs = new_labels.size() == 2 ? 1 : new_labels.size();
+    // fit() needs two classes, and prediction indexes labels by the best of the outputs
+    if (new_labels.size() < 2 || new_baseline.size() != outputs || n_trees % outputs != 0) {
+        throw std::runtime_error("Model file holds an invalid GradientBoostingClassifier.");
+    }
+    std::vector<ml::tree::FlatTree> new_trees;
+    for (size_t i = 0; i < n_trees; ++i) {
+        new_trees.push_back(ml::tree::FlatTree::borrow(reader.read_array<ml::TreeNodeRecord>(), file));
+        new_n_features = ml::tree::check_tree_features(new_trees.back(), new_n_features, has_n_features);
+    }
+    n_estimators = new_n_estimators;
+    learning_rate = new_learning_rate;
+    max_depth = new_max_depth;
+    min_samples_split = new_min_samples_split;
+    max_features = new_max_features;
+    labels.assign(new_labels.begin(), new_labels.end());
+    baseline.assign(new_baseline.begin(), new_baseline.end());
+    trees = std::move(new_trees);
+    n_features = new_n_features;
+    validation_losses.clear();
+}
+
+#endif // GRADIENT_BOOSTING_CLASSIFIER_HPP
@@ -0,0 +1,361 @@
+#ifndef GRADIENT_BOOSTING_REGRESSOR_HPP
+#define GRADIENT_BOOSTING_REGRESSOR_HPP
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <fstream>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+#include "GradientBoosting.hpp"
+
+/**
+ * @file GradientBoostingRegressor.hpp
+ * @brief Gradient boosted regression trees trained on feature histograms.
+ */
+
+/**
+ * @class GradientBoostingRegressor
+ * @brief Fits a sum of shallow regression trees, each one to the residuals of the trees before it.
+ *
+ * Minimizes the squared error. Every tree is grown from histograms of the features quantized once
+ * per fit, on a random fraction of the rows if set_subsample() is used, and its leaves are shrunk
+ * by the learning rate. A validation set, given to fit() or held out by set_early_stopping(),
+ * is scored after every round and can stop the training once it no longer improves.
+ */
+class GradientBoostingRegressor {
+public:
+    /**
+     * @brief Constructs a GradientBoostingRegressor.
+     * @param n_estimators The number of boosting rounds, one tree each.
+     * @param learning_rate Shrinkage applied to every tree, in (0, 1].
+     * @param max_depth The maximum depth of each tree.
+     * @param min_samples_split The minimum number of samples required to split an internal node.
+     * @param max_features Features drawn at random for every split, or -1 to consider all of them (the default).
+     * @param random_state Seed for the row and feature sampling and the validation hold-out; 0 seeds from std::random_device.
+     *        With a nonzero seed, every fit() grows the same trees whatever the thread pool.
+     * @throw std::invalid_argument If n_estimators or learning_rate is out of range.
+     */
+    GradientBoostingRegressor(int n_estimators = 100, double learning_rate = 0.1, int max_depth = 3, int min_samples_split = 2,
+                              int max_features = -1, unsigned int random_state = 0);
+
+    /**
+     * @brief Sets the pool used to build trees and to predict samples in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Sets the number of bins each feature is quantized into.
+     * @param max_bins Between 2 and 256 (the default).
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    void set_max_bins(int max_bins);
+
+    /**
+     * @brief Fits every tree on a random fraction of the training rows, drawn without replacement.
+     *
+     * Besides regularizing the ensemble, this cuts the cost of every round proportionally.
+     * @param fraction In (0, 1]; 1 (the default) uses every row.
+     * @throw std::invalid_argument If fraction is out of range.
+     */
+    void set_subsample(double fraction);
+
+    /**
+     * @brief Grows every tree best-first up to a number of leaves instead of depth-first.
+     * @param max_leaf_nodes At least 2, or -1 to grow depth-first (the default). max_depth still applies.
+     * @throw std::invalid_argument If max_leaf_nodes is out of range.
+     */
+    void set_max_leaf_nodes(int max_leaf_nodes);
+
+    /**
+     * @brief Stops training once the validation error has not improved for a number of rounds.
+     *
+     * fit(X, y) then holds out a random validation_fraction of the rows; fit(X, y, X_valid, y_valid)
+     * uses the given set instead. The model keeps the rounds up to the lowest validation error.
+     * @param n_iter_no_change Rounds without improvement before stopping, or -1 to disable (the default).
+     * @param validation_fraction Fraction of the rows held out by fit(X, y), in (0, 1).
+     * @throw std::invalid_argument If an argument is out of range.
+     */
+    void set_early_stopping(int n_iter_no_change, double validation_fraction = 0.1);
+
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A vector of feature vectors.
+     * @param y A vector of target values.
+     */
+    void fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y);
+
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of target values.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<double>& y);
+
+    /**
+     * @brief Fits the model to the training data, scoring a validation set after every round.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of target values.
+     * @param X_valid Validation samples, used for validation_loss() and early stopping.
+     * @param y_valid Target values of the validation samples.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<double>& y, const ml::MatrixView& X_valid,
+             const std::vector<double>& y_valid);
+
+    /**
+     * @brief Validation mean squared error after each round of the last fit(); empty without a validation set.
+     */
+    const std::vector<double>& validation_loss() const;
+
+    /**
+     * @brief Number of rounds in the model, fewer than n_estimators if training stopped early.
+     */
+    size_t n_rounds() const;
+
+    /**
+     * @brief Predicts target values for given input data.
+     * @param X A vector of feature vectors.
+     * @return A vector of predicted target values.
+     */
+    std::vector<double> predict(const std::vector<std::vector<double>>& X) const;
+
+    /**
+     * @brief Predicts target values for given input data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of predicted target values.
+     */
+    std::vector<double> predict(const ml::MatrixView& X) const;
+
+    /**
+     * @brief Predicts target values into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param predictions Receives one target value per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows() or X has a different number of features than the training samples.
+     */
+    void predict_into(const ml::MatrixView& X, std::span<double> predictions) const;
+
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the tree nodes are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a GradientBoostingRegressor.
+     */
+    void load(const std::string& path);
+
+private:
+    int n_estimators;
+    double learning_rate;
+    int max_depth;
+    int min_samples_split;
+    int max_features;
+    unsigned int random_state;
+    std::mt19937 random_engine;  // Re-seeded from random_state by every fit()
+
+    ml::ThreadPool* thread_pool = nullptr;
+    int max_bins = 256;
+    double subsample = 1.0;
+    int max_leaf_nodes = -1;
+    int n_iter_no_change = -1;
+    double validation_fraction = 0.1;
+
+    double baseline = 0.0;
+    std::vector<ml::tree::FlatTree> trees;  // Leaves already multiplied by the learning rate
+    size_t n_features = 0;  // Of the training samples
+    std::vector<double> validation_losses;
+
+    /**
+     * @brief Fits the given rows of X, scoring the given rows of X_valid after every round.
+     */
+    void fit_rows(const ml::MatrixView& X, const std::vector<double>& y, std::span<const size_t> rows,
+                  const ml::MatrixView& X_valid, const std::vector<double>& y_valid, std::span<const size_t> valid_rows);
+};
+
+GradientBoostingRegressor::GradientBoostingRegressor(int n_estimators, double learning_rate, int max_depth,
+                                                     int min_samples_split, int max_features, unsigned int random_state)
+    : n_estimators(n_estimators), learning_rate(learning_rate), max_depth(max_depth), min_samples_split(min_samples_split),
+      max_features(max_features), random_state(random_state) {
+    if (n_estimators < 1) {
+        throw std::invalid_argument("n_estimators must be at least 1.");
+    }
+    if (!(learning_rate > 0.0 && learning_rate <= 1.0)) {
+        throw std::invalid_argument("learning_rate must be in (0, 1].");
+    }
+}
+
+void GradientBoostingRegressor::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+void GradientBoostingRegressor::set_max_bins(int max_bins) {
+    if (max_bins < 2 || max_bins > 256) {
+        throw std::invalid_argument("max_bins must be between 2 and 256.");
+    }
+    this->max_bins = max_bins;
+}
+
+void GradientBoostingRegressor::set_subsample(double fraction) {
+    if (!(fraction > 0.0 && fraction <= 1.0)) {
+        throw std::invalid_argument("subsample must be in (0, 1].");
+    }
+    subsample = fraction;
+}
+
+void GradientBoostingRegressor::set_max_leaf_nodes(int max_leaf_nodes) {
+    if (max_leaf_nodes != -1 && max_leaf_nodes < 2) {
+        throw std::invalid_argument("max_leaf_nodes must be -1 or at least 2.");
+    }
+    this->max_leaf_nodes = max_leaf_nodes;
+}
+
+void GradientBoostingRegressor::set_early_stopping(int n_iter_no_change, double validation_fraction) {
+    if (n_iter_no_change != -1 && n_iter_no_change < 1) {
+        throw std::invalid_argument("n_iter_no_change must be -1 or at least 1.");
+    }
+    if (!(validation_fraction > 0.0 && validation_fraction < 1.0)) {
+        throw std::invalid_argument("validation_fraction must be in (0, 1).");
+    }
+    this->n_iter_no_change = n_iter_no_change;
+    this->validation_fraction = validation_fraction;
+}
+
+void GradientBoostingRegressor::fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y) {
+    fit(ml::Matrix(X), y);
+}
+
+void GradientBoostingRegressor::fit(const ml::MatrixView& X, const std::vector<double>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    if (n_iter_no_change == -1) {
+        fit(X, y, ml::MatrixView(), {});
+        return;
+    }
+    // Start over from the seed so that fitting twice gives the same model
+    random_engine.seed(random_state != 0 ? random_state : std::random_device()());
+    auto [train, valid] = ml::tree::holdout_split(X.rows(), validation_fraction, random_engine);
+    fit_rows(X, y, train, X, y, valid);
+}
+
+void GradientBoostingRegressor::fit(const ml::MatrixView& X, const std::vector<double>& y, const ml::MatrixView& X_valid,
+                                    const std::vector<double>& y_valid) {
+    if (X.rows() != y.size() || X_valid.rows() != y_valid.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    if (X.rows() == 0) {
+        throw std::invalid_argument("Cannot fit on an empty dataset.");
+    }
+    if (X_valid.rows() > 0 && X_valid.cols() != X.cols()) {
+        throw std::invalid_argument("Validation samples must have as many features as the training samples.");
+    }
+    std::vector<size_t> rows(X.rows()), valid_rows(X_valid.rows());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::iota(valid_rows.begin(), valid_rows.end(), 0);
+    random_engine.seed(random_state != 0 ? random_state : std::random_device()());
+    fit_rows(X, y, rows, X_valid, y_valid, valid_rows);
+}
+
+void GradientBoostingRegressor::fit_rows(const ml::MatrixView& X, const std::vector<double>& y, std::span<const size_t> rows,
+                                         const ml::MatrixView& X_valid, const std::vector<double>& y_valid,
+                                         std::span<const size_t> valid_rows) {
+    n_features = X.cols();
+    ml::tree::BoostingOptions options{.n_estimators = n_estimators, .learning_rate = learning_rate, .subsample = subsample,
+                                      .max_bins = max_bins, .n_iter_no_change = n_iter_no_change,
+                                      .tree = {.max_depth = max_depth, .min_samples_split = min_samples_split,
+                                               .max_features = max_features, .max_leaf_nodes = max_leaf_nodes}};
+    ml::tree::BoostedTrees model = ml::tree::fit_boosted_trees(ml::tree::SquaredErrorLoss{}, options, X, y, rows, X_valid,
+                                                               y_valid, valid_rows, random_engine, thread_pool);
+    baseline = model.baseline[0];
+    trees = std::move(model.trees);
+    validation_losses = std::move(model.validation_loss);
+}
+
+const std::vector<double>& GradientBoostingRegressor::validation_loss() const {
+    return validation_losses;
+}
+
+size_t GradientBoostingRegressor::n_rounds() const {
+    return trees.size();
+}
+
+std::vector<double> GradientBoostingRegressor::predict(const std::vector<std::vector<double>>& X) const {
+    return predict(ml::Matrix(X).view());
+}
+
+std::vector<double> GradientBoostingRegressor::predict(const ml::MatrixView& X) const {
+    std::vector<double> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+void GradientBoostingRegressor::predict_into(const ml::MatrixView& X, std::span<double> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::check_feature_count(n_features, X.cols());
+    std::fill(predictions.begin(), predictions.end(), baseline);
+    ml::tree::add_tree_scores(trees, 1, X, predictions, thread_pool);
+}
+
+void GradientBoostingRegressor::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::GradientBoostingRegressor, 2);
+    writer.write_int(n_estimators);
+    writer.write_double(learning_rate);
+    writer.write_int(max_depth);
+    writer.write_int(min_samples_split);
+    writer.write_int(max_features);
+    writer.write_int(static_cast<int64_t>(n_features));
+    writer.write_double(baseline);
+    writer.write_int(static_cast<int64_t>(trees.size()));
+    for (const ml::tree::FlatTree& tree : trees) {
+        writer.write_array(tree.nodes());
+    }
+    writer.finish();
+}
+
+void GradientBoostingRegressor::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::GradientBoostingRegressor, 2);
+    int new_n_estimators = reader.read_int<int>();
+    double new_learning_rate = reader.read_double();
+    int new_max_depth = reader.read_int<int>();
+    int new_min_samples_split = reader.read_int<int>();
+    int new_max_features = reader.read_int<int>();
+    // Version 1 files do not record the feature count; take the widest one the trees read
+    bool has_n_features = reader.model_version() >= 2;
+    size_t new_n_features = has_n_features ? reader.read_int<size_t>() : 0;
+    double new_baseline = reader.read_double();
+    size_t n_trees = reader.read_int<size_t>();
+    std::vector<ml::tree::FlatTree> new_trees;
+    for (size_t i = 0; i < n_trees; ++i) {
+        new_trees.push_back(ml::tree::FlatTree::borrow(reader.read_array<ml::TreeNodeRecord>(), file));
+        new_n_features = ml::tree::check_tree_features(new_trees.back(), new_n_features, has_n_features);
+    }
+    n_estimators = new_n_estimators;
+    learning_rate = new_learning_rate;
+    max_depth = new_max_depth;
+    min_samples_split = new_min_samples_split;
+    max_features = new_max_features;
+    baseline = new_baseline;
+    trees = std::move(new_trees);
+    n_features = new_n_features;
+    validation_losses.clear();
+}
+
+#endif // GRADIENT_BOOSTING_REGRESSOR_HPP
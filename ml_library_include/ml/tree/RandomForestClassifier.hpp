@@ -5,10 +5,23 @@
 #include <algorithm>
 #include <numeric>
 #include <limits>
-#include <unordered_map>
 #include <cmath>
 #include <random>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <array>
+#include <optional>
+#include <fstream>
+#include <functional>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+#include "CodeGenerator.hpp"
 
 /**
  * @file RandomForestClassifier.hpp
@@ -27,14 +40,90 @@ public:
      * @param max_depth The maximum depth of the tree.
      * @param min_samples_split The minimum number of samples required to split an internal node.
      * @param max_features The number of features to consider when looking for the best split. Defaults to sqrt(num_features).
+     * @param random_state Seed for the bootstrap samples and feature draws; 0 seeds from std::random_device.
+     *        With a nonzero seed, every fit() grows the same trees whatever the thread pool.
      */
-    RandomForestClassifier(int n_estimators = 10, int max_depth = 5, int min_samples_split = 2, int max_features = -1);
+    RandomForestClassifier(int n_estimators = 10, int max_depth = 5, int min_samples_split = 2, int max_features = -1,
+                           unsigned int random_state = 0);
 
     /**
      * @brief Destructor for RandomForestClassifier.
      */
     ~RandomForestClassifier() = default;
 
+    /**
+     * @brief Sets the pool used to build trees and to predict samples in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Switches training to histograms of quantized features.
+     *
+     * Each feature is quantized once into at most max_bins bins and splits are chosen from per-bin
+     * sums, which scales to far larger datasets than the exact search at the cost of only
+     * considering thresholds between bins.
+     * @param max_bins Bins per feature, between 2 and 256, or 0 for exact training (the default).
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    void set_max_bins(int max_bins);
+
+    /**
+     * @brief Switches the forest to extremely randomized trees.
+     *
+     * Each node then tries a single threshold per candidate feature, drawn uniformly between the
+     * feature's extremes in the node (or between its occupied bins with histogram training), instead
+     * of every midpoint. Nodes need no sorting and cost O(n * max_features); the extra randomness
+     * usually costs little accuracy on noisy data.
+     * @param enabled Whether to draw random thresholds.
+     */
+    void set_extra_trees(bool enabled);
+
+    /**
+     * @brief Grows every tree best-first up to a number of leaves.
+     *
+     * The leaf whose split decreases the impurity most is split next, so the size of each tree, and
+     * the cost of predicting with the forest, is bounded directly. max_depth still applies.
+     * @param max_leaf_nodes At least 2, or -1 to grow depth-first (the default).
+     * @throw std::invalid_argument If max_leaf_nodes is out of range.
+     */
+    void set_max_leaf_nodes(int max_leaf_nodes);
+
+    /**
+     * @brief Only makes the splits that decrease the Gini impurity enough.
+     *
+     * As in scikit-learn, the decrease of a split is N_t / N * (G - N_l / N_t * G_l - N_r / N_t * G_r),
+     * with the sample counts N of the tree's bootstrap sample, the node and its children.
+     * @param min_impurity_decrease The smallest decrease, 0 by default.
+     * @throw std::invalid_argument If min_impurity_decrease is negative.
+     */
+    void set_min_impurity_decrease(double min_impurity_decrease);
+
+    /**
+     * @brief Makes fit() score every training row with the trees that did not draw it.
+     *
+     * Trees are then grown in waves of one per pool thread and added to the out-of-bag estimate in
+     * tree order, so the monitor sees the same scores whatever the thread pool.
+     * @param enabled Whether to compute the out-of-bag predictions and accuracy.
+     * @param monitor Called after each tree with the number of trees so far and the out-of-bag
+     *        accuracy of those trees; returning false stops fit() and keeps only those trees. May be empty.
+     */
+    void set_oob_score(bool enabled, std::function<bool(size_t n_trees, double accuracy)> monitor = nullptr);
+
+    /**
+     * @brief Out-of-bag accuracy of the last fit(), over the rows left out by at least one tree.
+     * @return NaN if out-of-bag scoring was not enabled or no row was ever left out.
+     */
+    double oob_accuracy() const;
+
+    /**
+     * @brief Out-of-bag prediction of every training row of the last fit().
+     *
+     * Each row gets the majority vote of the trees that did not draw it, ties going to the smallest
+     * label; a row that every tree drew gets the smallest label and is left out of oob_accuracy().
+     */
+    const std::vector<int>& oob_predictions() const;
+
     /**
      * @brief Fits the model to the training data.
      * @param X A vector of feature vectors.
@@ -42,6 +131,13 @@ public:
      */
     void fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y);
 
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of target class labels.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<int>& y);
+
     /**
      * @brief Predicts class labels for given input data.
      * @param X A vector of feature vectors.
@@ -49,37 +145,141 @@ public:
      */
     std::vector<int> predict(const std::vector<std::vector<double>>& X) const;
 
-private:
-    struct Node {
-        bool is_leaf;
-        int value; // Class label for leaf nodes
-        int feature_index;
-        double threshold;
-        std::unique_ptr<Node> left;
-        std::unique_ptr<Node> right;
-
-        Node() : is_leaf(false), value(0), feature_index(-1), threshold(0.0) {}
-    };
+    /**
+     * @brief Predicts class labels for given input data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of predicted class labels.
+     */
+    std::vector<int> predict(const ml::MatrixView& X) const;
 
+    /**
+     * @brief Predicts class labels into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param predictions Receives one label per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows() or X has a different number of features than the training samples.
+     */
+    void predict_into(const ml::MatrixView& X, std::span<int> predictions) const;
+
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the tree nodes are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a RandomForestClassifier.
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief Writes a standalone C++ header that predicts like this model, for inference without the library.
+     *
+     * The header defines `int predict(const double* x)` returning the majority label
+     * in namespace name, where x points to the features of one sample; see ml::tree::write_cpp_model().
+     * @param path Destination file.
+     * @param name Namespace of the generated code.
+     * @param style Nested branches, or constexpr node tables for large models.
+     * @throw std::invalid_argument If the model is not fitted or name is not an identifier.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void export_cpp(const std::string& path, const std::string& name,
+                    ml::tree::CodeStyle style = ml::tree::CodeStyle::Branches) const;
+
+private:
     struct DecisionTree {
-        std::unique_ptr<Node> root;
+        ml::tree::FlatTree flat_tree;
         int max_depth;
         int min_samples_split;
         int max_features;
         std::mt19937 random_engine;
+        bool random_splits;  // One random threshold per feature and node, as in extremely randomized trees
+        int max_leaf_nodes;
+        double min_impurity_decrease;
+        double n_samples = 0.0;  // Bootstrap weight of the current fit, to weight the impurity decreases
 
-        DecisionTree(int max_depth, int min_samples_split, int max_features, std::mt19937::result_type seed);
+        DecisionTree(int max_depth, int min_samples_split, int max_features, std::mt19937::result_type seed,
+                     bool random_splits = false, int max_leaf_nodes = -1, double min_impurity_decrease = 0.0);
         ~DecisionTree() = default;
-        void fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y);
-        int predict_sample(const std::vector<double>& x) const;
+        /**
+         * @brief Grows the tree on a bootstrap sample.
+         * @param y Class of every row as an index into classes.
+         * @param classes The distinct labels, in increasing order.
+         * @param weights How many times each row of X was drawn.
+         * @param indices The rows drawn at least once; partitioned in place while the tree is grown.
+         */
+        void fit(const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes, std::span<const uint32_t> weights,
+                 std::span<size_t> indices);
+
+        /**
+         * @brief Grows the tree from the histograms of a quantized feature matrix.
+         * @param y The targets, weighted by the bootstrap multiplicities.
+         * @param indices The rows drawn at least once; partitioned in place while the tree is grown.
+         */
+        void fit(const ml::tree::BinnedMatrix& X, const ml::tree::BinnedTargets& y, std::span<size_t> indices);
+        int predict_sample(const ml::MatrixView& X, size_t row) const;
 
     private:
-        std::unique_ptr<Node> build_tree(const std::vector<std::vector<double>>& X, const std::vector<int>& y, int depth);
-        double calculate_gini(const std::vector<int>& y) const;
-        void split_dataset(const std::vector<std::vector<double>>& X, const std::vector<int>& y, int feature_index, double threshold,
-                           std::vector<std::vector<double>>& X_left, std::vector<int>& y_left,
-                           std::vector<std::vector<double>>& X_right, std::vector<int>& y_right) const;
-        int majority_class(const std::vector<int>& y) const;
+        /**
+         * @brief Best split of a node found by find_best_split().
+         */
+        struct Split {
+            int feature_index = -1;  ///< -1 if no split separates the samples.
+            double threshold = 0.0;
+            double gain = 0.0;  ///< Decrease of the impurity summed over the weight of the node.
+        };
+
+        /**
+         * @brief A node that may still be split by build_best_first().
+         */
+        struct Candidate {
+            double gain;
+            size_t node;
+            std::span<size_t> indices;
+            int depth;
+            Split split;
+        };
+
+        /**
+         * @brief Grows the subtree for the samples in indices into nodes[node].
+         * @param nodes The tree so far; the children of a split are appended as a pair.
+         */
+        void build_tree(const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes, std::span<const uint32_t> weights,
+                        std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth);
+
+        /**
+         * @brief Grows the tree into nodes, always splitting the leaf with the largest impurity decrease next.
+         */
+        void build_best_first(const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes,
+                              std::span<const uint32_t> weights, std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes);
+
+        /**
+         * @brief Makes nodes[node] a leaf of the majority class and finds the split that should replace it.
+         * @return The split, with feature_index -1 if the node stays a leaf.
+         */
+        Split evaluate_node(const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes,
+                            std::span<const uint32_t> weights, std::span<const size_t> indices,
+                            std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth);
+
+        /**
+         * @brief Finds the split with the lowest weighted Gini impurity over max_features random features.
+         *
+         * Each feature is sorted once and swept in order while the weighted class counts of both sides
+         * are updated in flat arrays; with random_splits a single drawn threshold is counted instead.
+         * @param counts Weighted number of samples of each class among indices.
+         */
+        Split find_best_split(const ml::MatrixView& X, std::span<const int> y, std::span<const uint32_t> weights,
+                              std::span<const size_t> indices, const std::vector<double>& counts);
+
+        /**
+         * @brief Weighted number of samples of each class among indices.
+         */
+        std::vector<double> class_counts(std::span<const int> y, size_t n_classes, std::span<const uint32_t> weights,
+                                         std::span<const size_t> indices) const;
     };
 
     int n_estimators;
@@ -87,102 +287,394 @@ private:
     int min_samples_split;
     int max_features;
     std::vector<std::unique_ptr<DecisionTree>> trees;
-    std::mt19937 random_engine;
+    size_t n_features = 0;  // Of the training samples
+    unsigned int random_state;
+    std::mt19937 random_engine;  // Re-seeded from random_state by every fit()
+
+    ml::ThreadPool* thread_pool = nullptr;
+    int max_bins = 0;
+    bool extra_trees = false;
+    int max_leaf_nodes = -1;
+    double min_impurity_decrease = 0.0;
+    bool oob_enabled = false;
+    std::function<bool(size_t, double)> oob_monitor;
+    std::vector<int> oob_prediction;
+    double oob_score = std::numeric_limits<double>::quiet_NaN();
+
+    std::vector<int> classes;  // Labels found in the leaves, in increasing order
 
-    void bootstrap_sample(const std::vector<std::vector<double>>& X, const std::vector<int>& y,
-                          std::vector<std::vector<double>>& X_sample, std::vector<int>& y_sample);
+    /**
+     * @brief Draws a bootstrap sample as per-row multiplicities over the shared training matrix.
+     * @param weights Receives how many times each row was drawn.
+     * @return The rows drawn at least once, in increasing order.
+     */
+    static std::vector<size_t> bootstrap_sample(size_t n_samples, std::mt19937& engine, std::vector<uint32_t>& weights);
+
+    /**
+     * @brief Collects the labels that the trees can predict into classes.
+     */
+    void collect_classes();
+    int predict_sample(const ml::MatrixView& X, size_t row) const;
 };
 
-RandomForestClassifier::RandomForestClassifier(int n_estimators, int max_depth, int min_samples_split, int max_features)
-    : n_estimators(n_estimators), max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features) {
-    std::random_device rd;
-    random_engine.seed(rd());
+RandomForestClassifier::RandomForestClassifier(int n_estimators, int max_depth, int min_samples_split, int max_features,
+                                               unsigned int random_state)
+    : n_estimators(n_estimators), max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features),
+      random_state(random_state) {
+}
+
+void RandomForestClassifier::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+void RandomForestClassifier::set_max_bins(int max_bins) {
+    if (max_bins != 0 && (max_bins < 2 || max_bins > 256)) {
+        throw std::invalid_argument("max_bins must be 0 or between 2 and 256.");
+    }
+    this->max_bins = max_bins;
+}
+
+void RandomForestClassifier::set_extra_trees(bool enabled) {
+    extra_trees = enabled;
+}
+
+void RandomForestClassifier::set_max_leaf_nodes(int max_leaf_nodes) {
+    if (max_leaf_nodes != -1 && max_leaf_nodes < 2) {
+        throw std::invalid_argument("max_leaf_nodes must be -1 or at least 2.");
+    }
+    this->max_leaf_nodes = max_leaf_nodes;
+}
+
+void RandomForestClassifier::set_min_impurity_decrease(double min_impurity_decrease) {
+    if (!(min_impurity_decrease >= 0.0)) {
+        throw std::invalid_argument("min_impurity_decrease must be non-negative.");
+    }
+    this->min_impurity_decrease = min_impurity_decrease;
+}
+
+void RandomForestClassifier::set_oob_score(bool enabled, std::function<bool(size_t, double)> monitor) {
+    oob_enabled = enabled;
+    oob_monitor = std::move(monitor);
+}
+
+double RandomForestClassifier::oob_accuracy() const {
+    return oob_score;
+}
+
+const std::vector<int>& RandomForestClassifier::oob_predictions() const {
+    return oob_prediction;
 }
 
 void RandomForestClassifier::fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y) {
+    fit(ml::Matrix(X), y);
+}
+
+void RandomForestClassifier::fit(const ml::MatrixView& X, const std::vector<int>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of labels.");
+    }
+    n_features = X.cols();
+
     // Set max_features if not set
     int actual_max_features = max_features;
     if (actual_max_features == -1) {
-        actual_max_features = static_cast<int>(std::sqrt(X[0].size()));
+        actual_max_features = static_cast<int>(std::sqrt(X.cols()));
     }
 
-    for (int i = 0; i < n_estimators; ++i) {
-        std::vector<std::vector<double>> X_sample;
-        std::vector<int> y_sample;
-        bootstrap_sample(X, y, X_sample, y_sample);
+    // Start over from the seed so that fitting twice gives the same model
+    random_engine.seed(random_state != 0 ? random_state : std::random_device()());
+
+    // Draw one seed per tree up front so the result does not depend on scheduling
+    std::vector<std::mt19937::result_type> seeds(n_estimators);
+    for (auto& seed : seeds) {
+        seed = random_engine();
+    }
 
-        auto tree = std::make_unique<DecisionTree>(max_depth, min_samples_split, actual_max_features, random_engine());
-        tree->fit(X_sample, y_sample);
-        trees.push_back(std::move(tree));
+    // The trees and out-of-bag voting count the classes in flat arrays indexed by dense class indices
+    size_t n = X.rows();
+    std::vector<int> labels, y_index;
+    {
+        labels.assign(y.begin(), y.end());
+        std::sort(labels.begin(), labels.end());
+        labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+        y_index.resize(y.size());
+        for (size_t i = 0; i < y.size(); ++i) {
+            y_index[i] = static_cast<int>(std::lower_bound(labels.begin(), labels.end(), y[i]) - labels.begin());
+        }
+    }
+    // Histogram training quantizes the features once for all trees
+    std::optional<ml::tree::BinnedMatrix> binned;
+    if (max_bins > 0) {
+        binned.emplace(X, max_bins, thread_pool);
+    }
+
+    // Each out-of-bag row keeps the votes of the trees that left it out and its current majority class,
+    // so adding a tree only revisits the rows that tree left out
+    size_t n_classes = labels.size();
+    std::vector<uint32_t> oob_votes(oob_enabled ? n * n_classes : 0, 0);
+    std::vector<int> oob_class(oob_enabled ? n : 0, -1);
+    std::vector<std::vector<std::pair<size_t, int>>> tree_oob(seeds.size());
+    size_t correct = 0;
+    size_t covered = 0;
+    oob_prediction.clear();
+    oob_score = std::numeric_limits<double>::quiet_NaN();
+
+    trees.clear();
+    trees.resize(seeds.size());
+    size_t n_trees = seeds.size();
+    size_t wave = !oob_enabled ? n_trees : thread_pool ? thread_pool->size() : 1;
+    wave = std::max<size_t>(wave, 1);
+    size_t built = 0;
+    bool stopped = false;
+    for (size_t begin = 0; begin < n_trees && !stopped; begin += wave) {
+        ml::parallel_for(thread_pool, begin, std::min(begin + wave, n_trees), [&](size_t i) {
+            std::mt19937 engine(seeds[i]);
+            std::vector<uint32_t> weights;
+            std::vector<size_t> indices = bootstrap_sample(n, engine, weights);
+
+            auto tree = std::make_unique<DecisionTree>(max_depth, min_samples_split, actual_max_features, engine(), extra_trees,
+                                                       max_leaf_nodes, min_impurity_decrease);
+            if (binned) {
+                tree->fit(*binned, {.classes = y_index, .labels = labels, .weights = weights}, indices);
+            } else {
+                tree->fit(X, y_index, labels, weights, indices);
+            }
+            if (oob_enabled) {
+                for (size_t row = 0; row < n; ++row) {
+                    if (weights[row] == 0) {
+                        int label = tree->predict_sample(X, row);
+                        tree_oob[i].emplace_back(row, std::lower_bound(labels.begin(), labels.end(), label) - labels.begin());
+                    }
+                }
+            }
+            trees[i] = std::move(tree);
+        });
+
+        // Fold the wave into the estimate in tree order
+        for (size_t i = begin; i < std::min(begin + wave, n_trees) && !stopped; ++i) {
+            built = i + 1;
+            if (!oob_enabled) {
+                continue;
+            }
+            for (auto [row, c] : tree_oob[i]) {
+                std::span<uint32_t> votes(oob_votes.data() + row * n_classes, n_classes);
+                ++votes[c];
+                int previous = oob_class[row];
+                if (previous < 0) {
+                    ++covered;
+                }
+                // Ties go to the smallest label
+                int current = static_cast<int>(std::max_element(votes.begin(), votes.end()) - votes.begin());
+                oob_class[row] = current;
+                correct += (current == y_index[row]);
+                correct -= (previous == y_index[row]);
+            }
+            tree_oob[i] = {};
+            double accuracy = covered > 0 ? static_cast<double>(correct) / covered : std::numeric_limits<double>::quiet_NaN();
+            if (oob_monitor && !oob_monitor(built, accuracy)) {
+                stopped = true;
+            }
+        }
+    }
+    trees.resize(built);
+    collect_classes();
+
+    if (oob_enabled) {
+        oob_prediction.resize(n);
+        for (size_t row = 0; row < n; ++row) {
+            oob_prediction[row] = labels.empty() ? 0 : labels[std::max(oob_class[row], 0)];
+        }
+        if (covered > 0) {
+            oob_score = static_cast<double>(correct) / covered;
+        }
     }
 }
 
 std::vector<int> RandomForestClassifier::predict(const std::vector<std::vector<double>>& X) const {
+    for (const auto& x : X) {
+        ml::check_feature_count(n_features, x.size());
+    }
     std::vector<int> predictions(X.size());
-    for (size_t i = 0; i < X.size(); ++i) {
-        std::unordered_map<int, int> votes;
+    ml::parallel_for(thread_pool, 0, X.size(), [&](size_t i) {
+        predictions[i] = predict_sample(ml::MatrixView(X[i].data(), 1, X[i].size()), 0);
+    });
+    return predictions;
+}
+
+std::vector<int> RandomForestClassifier::predict(const ml::MatrixView& X) const {
+    std::vector<int> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+void RandomForestClassifier::predict_into(const ml::MatrixView& X, std::span<int> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::check_feature_count(n_features, X.cols());
+    // Score a block of rows with one tree after another so the rows share each tree's nodes
+    constexpr size_t block = ml::tree::FlatTree::block_rows;
+    size_t n_classes = classes.size();
+    ml::parallel_for(thread_pool, 0, (X.rows() + block - 1) / block, [&](size_t b) {
+        size_t first = b * block;
+        size_t n_rows = std::min(block, X.rows() - first);
+        std::span<uint32_t> votes = ml::scratch<uint32_t>(n_rows * n_classes);
+        std::fill(votes.begin(), votes.end(), 0);
         for (const auto& tree : trees) {
-            int vote = tree->predict_sample(X[i]);
-            votes[vote]++;
+            tree->flat_tree.predict_block(X, first, n_rows, [&](size_t i, double label) {
+                size_t c = std::lower_bound(classes.begin(), classes.end(), static_cast<int>(label)) - classes.begin();
+                ++votes[i * n_classes + c];
+            });
         }
-        // Majority vote
-        predictions[i] = std::max_element(votes.begin(), votes.end(),
-                                          [](const auto& a, const auto& b) {
-                                              return a.second < b.second;
-                                          })->first;
+        // Majority vote; ties go to the smallest label
+        for (size_t i = 0; i < n_rows; ++i) {
+            std::span<uint32_t> row = votes.subspan(i * n_classes, n_classes);
+            predictions[first + i] = classes.empty() ? 0 : classes[std::max_element(row.begin(), row.end()) - row.begin()];
+        }
+    });
+}
+
+int RandomForestClassifier::predict_sample(const ml::MatrixView& X, size_t row) const {
+    // Count the votes per class index; ties go to the smallest label
+    std::span<uint32_t> votes = ml::scratch<uint32_t>(classes.size());
+    std::fill(votes.begin(), votes.end(), 0);
+    for (const auto& tree : trees) {
+        int label = tree->predict_sample(X, row);
+        ++votes[std::lower_bound(classes.begin(), classes.end(), label) - classes.begin()];
     }
-    return predictions;
+    return classes.empty() ? 0 : classes[std::max_element(votes.begin(), votes.end()) - votes.begin()];
 }
 
-void RandomForestClassifier::bootstrap_sample(const std::vector<std::vector<double>>& X, const std::vector<int>& y,
-                                              std::vector<std::vector<double>>& X_sample, std::vector<int>& y_sample) {
-    size_t n_samples = X.size();
+void RandomForestClassifier::collect_classes() {
+    classes.clear();
+    for (const auto& tree : trees) {
+        for (const ml::TreeNodeRecord& node : tree->flat_tree.nodes()) {
+            if (node.feature < 0) {
+                classes.push_back(static_cast<int>(node.value));
+            }
+        }
+    }
+    std::sort(classes.begin(), classes.end());
+    classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+}
+
+std::vector<size_t> RandomForestClassifier::bootstrap_sample(size_t n_samples, std::mt19937& engine,
+                                                         std::vector<uint32_t>& weights) {
     std::uniform_int_distribution<size_t> dist(0, n_samples - 1);
 
+    // Count the draws per row instead of listing or copying every drawn row
+    weights.assign(n_samples, 0);
     for (size_t i = 0; i < n_samples; ++i) {
-        size_t index = dist(random_engine);
-        X_sample.push_back(X[index]);
-        y_sample.push_back(y[index]);
+        ++weights[dist(engine)];
     }
+    std::vector<size_t> indices;
+    indices.reserve(n_samples);
+    for (size_t row = 0; row < n_samples; ++row) {
+        if (weights[row] > 0) {
+            indices.push_back(row);
+        }
+    }
+    return indices;
 }
 
-RandomForestClassifier::DecisionTree::DecisionTree(int max_depth, int min_samples_split, int max_features, std::mt19937::result_type seed)
-    : root(nullptr), max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features), random_engine(seed) {}
+RandomForestClassifier::DecisionTree::DecisionTree(int max_depth, int min_samples_split, int max_features, std::mt19937::result_type seed,
+                                                   bool random_splits, int max_leaf_nodes, double min_impurity_decrease)
+    : max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features), random_engine(seed),
+      random_splits(random_splits), max_leaf_nodes(max_leaf_nodes), min_impurity_decrease(min_impurity_decrease) {}
+
+void RandomForestClassifier::DecisionTree::fit(const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes,
+                                               std::span<const uint32_t> weights, std::span<size_t> indices) {
+    n_samples = ml::tree::total_weight(weights, indices);
+    std::vector<ml::TreeNodeRecord> records(1);
+    if (max_leaf_nodes > 0) {
+        build_best_first(X, y, classes, weights, indices, records);
+    } else {
+        build_tree(X, y, classes, weights, indices, records, 0, 0);
+    }
+    flat_tree = ml::tree::FlatTree(records);
+}
 
-void RandomForestClassifier::DecisionTree::fit(const std::vector<std::vector<double>>& X, const std::vector<int>& y) {
-    root = build_tree(X, y, 0);
+void RandomForestClassifier::DecisionTree::fit(const ml::tree::BinnedMatrix& X, const ml::tree::BinnedTargets& y,
+                                  std::span<size_t> indices) {
+    ml::tree::HistogramTreeBuilder builder(X, y,
+                                           {max_depth, min_samples_split, max_features, random_splits, max_leaf_nodes,
+                                            min_impurity_decrease},
+                                           &random_engine);
+    flat_tree = ml::tree::FlatTree(builder.build(indices));
 }
 
-int RandomForestClassifier::DecisionTree::predict_sample(const std::vector<double>& x) const {
-    const Node* node = root.get();
-    while (!node->is_leaf) {
-        if (x[node->feature_index] <= node->threshold) {
-            node = node->left.get();
-        } else {
-            node = node->right.get();
-        }
+int RandomForestClassifier::DecisionTree::predict_sample(const ml::MatrixView& X, size_t row) const {
+    return static_cast<int>(flat_tree.predict(X, row));
+}
+
+void RandomForestClassifier::DecisionTree::build_tree(const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes,
+                                                      std::span<const uint32_t> weights, std::span<size_t> indices,
+                                                      std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) {
+    Split best = evaluate_node(X, y, classes, weights, indices, nodes, node, depth);
+    if (best.feature_index == -1) {
+        return;
+    }
+
+    // Recursively build the left and right subtrees on the two halves of the partitioned rows
+    std::array<std::span<size_t>, 2> child_rows = ml::tree::split_node(X, indices, best.feature_index, best.threshold, nodes, node);
+    size_t left = nodes[node].left;
+    build_tree(X, y, classes, weights, child_rows[0], nodes, left, depth + 1);
+    build_tree(X, y, classes, weights, child_rows[1], nodes, left + 1, depth + 1);
+}
+
+void RandomForestClassifier::DecisionTree::build_best_first(const ml::MatrixView& X, std::span<const int> y,
+                                                            std::span<const int> classes, std::span<const uint32_t> weights,
+                                                            std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes) {
+    Split root = evaluate_node(X, y, classes, weights, indices, nodes, 0, 0);
+    if (root.feature_index == -1) {
+        return;
     }
-    return node->value;
+    ml::tree::grow_best_first(Candidate{root.gain, 0, indices, 0, root}, max_leaf_nodes, [&](Candidate& leaf, auto& push) {
+        std::array<std::span<size_t>, 2> child_rows =
+            ml::tree::split_node(X, leaf.indices, leaf.split.feature_index, leaf.split.threshold, nodes, leaf.node);
+        for (size_t side = 0; side < 2; ++side) {
+            size_t child = nodes[leaf.node].left + side;
+            Split best = evaluate_node(X, y, classes, weights, child_rows[side], nodes, child, leaf.depth + 1);
+            if (best.feature_index != -1) {
+                push(Candidate{best.gain, child, child_rows[side], leaf.depth + 1, best});
+            }
+        }
+    });
 }
 
-std::unique_ptr<RandomForestClassifier::Node> RandomForestClassifier::DecisionTree::build_tree(
-    const std::vector<std::vector<double>>& X, const std::vector<int>& y, int depth) {
-    auto node = std::make_unique<Node>();
+RandomForestClassifier::DecisionTree::Split RandomForestClassifier::DecisionTree::evaluate_node(
+    const ml::MatrixView& X, std::span<const int> y, std::span<const int> classes, std::span<const uint32_t> weights,
+    std::span<const size_t> indices, std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) {
+    std::vector<double> counts = class_counts(y, classes.size(), weights, indices);
+    double node_weight = std::accumulate(counts.begin(), counts.end(), 0.0);
+    // Ties go to the smallest label
+    size_t majority = std::max_element(counts.begin(), counts.end()) - counts.begin();
+    nodes[node] = ml::TreeNodeRecord{-1, 0, static_cast<double>(classes[majority])};
+
+    // Check stopping criteria; a pure node has all of its samples in the majority class
+    if (depth >= max_depth || node_weight < min_samples_split || counts[majority] == node_weight) {
+        return {};
+    }
 
-    // Check stopping criteria
-    if (depth >= max_depth || y.size() < static_cast<size_t>(min_samples_split) || calculate_gini(y) == 0.0) {
-        node->is_leaf = true;
-        node->value = majority_class(y);
-        return node;
+    Split best = find_best_split(X, y, weights, indices, counts);
+    if (best.feature_index != -1 && best.gain < min_impurity_decrease * n_samples) {
+        return {};
     }
+    return best;
+}
 
-    double best_gini = std::numeric_limits<double>::max();
-    int best_feature_index = -1;
-    double best_threshold = 0.0;
-    std::vector<std::vector<double>> best_X_left, best_X_right;
-    std::vector<int> best_y_left, best_y_right;
+RandomForestClassifier::DecisionTree::Split RandomForestClassifier::DecisionTree::find_best_split(
+    const ml::MatrixView& X, std::span<const int> y, std::span<const uint32_t> weights, std::span<const size_t> indices,
+    const std::vector<double>& counts) {
+    size_t n = indices.size();
+    size_t n_classes = counts.size();
+    double node_weight = std::accumulate(counts.begin(), counts.end(), 0.0);
+    // W times the weighted Gini impurity of a split is W - squares_left / W_left - squares_right / W_right, where
+    // squares_side is the sum of the squared class weights of that side, so the best split maximises the subtracted score
+    double total_squares = 0.0;
+    for (double count : counts) {
+        total_squares += count * count;
+    }
 
-    int num_features = X[0].size();
+    int num_features = static_cast<int>(X.cols());
     std::vector<int> features_indices(num_features);
     std::iota(features_indices.begin(), features_indices.end(), 0);
 
@@ -192,102 +684,138 @@ std::unique_ptr<RandomForestClassifier::Node> RandomForestClassifier::DecisionTr
         features_indices.resize(max_features);
     }
 
+    Split best;
+    double best_score = -1.0;
+    std::vector<double> left_counts(n_classes);
     for (int feature_index : features_indices) {
-        // Get all possible thresholds
-        std::vector<double> feature_values;
-        feature_values.reserve(X.size());
-        for (const auto& x : X) {
-            feature_values.push_back(x[feature_index]);
+        std::fill(left_counts.begin(), left_counts.end(), 0.0);
+        if (random_splits) {
+            // Extremely randomized trees try one threshold drawn uniformly between the extremes of the node
+            double low = std::numeric_limits<double>::infinity();
+            double high = -low;
+            for (size_t idx : indices) {
+                low = std::min(low, X(idx, feature_index));
+                high = std::max(high, X(idx, feature_index));
+            }
+            if (!(low < high)) continue;
+            double threshold = std::uniform_real_distribution<double>(low, high)(random_engine);
+            for (size_t idx : indices) {
+                if (X(idx, feature_index) <= threshold) {
+                    left_counts[y[idx]] += weights[idx];
+                }
+            }
+            double left_weight = 0.0, left_squares = 0.0, right_squares = 0.0;
+            for (size_t c = 0; c < n_classes; ++c) {
+                double right_count = counts[c] - left_counts[c];
+                left_weight += left_counts[c];
+                left_squares += left_counts[c] * left_counts[c];
+                right_squares += right_count * right_count;
+            }
+            if (left_weight == 0.0 || left_weight == node_weight) continue;
+            double score = left_squares / left_weight + right_squares / (node_weight - left_weight);
+            if (score > best_score) {
+                best_score = score;
+                best.feature_index = feature_index;
+                best.threshold = threshold;
+            }
+            continue;
         }
-        std::sort(feature_values.begin(), feature_values.end());
-        feature_values.erase(std::unique(feature_values.begin(), feature_values.end()), feature_values.end());
-
-        if (feature_values.size() <= 1) continue;
 
-        std::vector<double> thresholds;
-        thresholds.reserve(feature_values.size() - 1);
-        for (size_t i = 1; i < feature_values.size(); ++i) {
-            thresholds.push_back((feature_values[i - 1] + feature_values[i]) / 2.0);
+        std::span<std::pair<double, size_t>> sorted = ml::scratch<std::pair<double, size_t>>(n);
+        for (size_t i = 0; i < n; ++i) {
+            sorted[i] = {X(indices[i], feature_index), indices[i]};
         }
-
-        // Evaluate each threshold
-        for (double threshold : thresholds) {
-            std::vector<std::vector<double>> X_left, X_right;
-            std::vector<int> y_left, y_right;
-            split_dataset(X, y, feature_index, threshold, X_left, y_left, X_right, y_right);
-
-            if (y_left.empty() || y_right.empty())
+        std::sort(sorted.begin(), sorted.end());
+
+        // Move the samples from the right side to the left one at a time, in increasing feature value
+        double left_weight = 0.0;
+        double left_squares = 0.0;
+        double right_squares = total_squares;
+        for (size_t i = 1; i < n; ++i) {
+            size_t row = sorted[i - 1].second;
+            size_t c = static_cast<size_t>(y[row]);
+            double w = weights[row];
+            left_squares += w * (2.0 * left_counts[c] + w);
+            right_squares -= w * (2.0 * (counts[c] - left_counts[c]) - w);
+            left_counts[c] += w;
+            left_weight += w;
+
+            // Only thresholds between distinct values separate the samples
+            if (sorted[i - 1].first == sorted[i].first) {
                 continue;
-
-            double gini_left = calculate_gini(y_left);
-            double gini_right = calculate_gini(y_right);
-            double gini = (gini_left * y_left.size() + gini_right * y_right.size()) / y.size();
-
-            if (gini < best_gini) {
-                best_gini = gini;
-                best_feature_index = feature_index;
-                best_threshold = threshold;
-                best_X_left = std::move(X_left);
-                best_X_right = std::move(X_right);
-                best_y_left = std::move(y_left);
-                best_y_right = std::move(y_right);
+            }
+            double score = left_squares / left_weight + right_squares / (node_weight - left_weight);
+            if (score > best_score) {
+                best_score = score;
+                best.feature_index = feature_index;
+                best.threshold = (sorted[i - 1].first + sorted[i].first) / 2.0;
             }
         }
     }
+    best.gain = best_score - total_squares / node_weight;
+    return best;
+}
 
-    // If no split improves the Gini impurity, make this a leaf node
-    if (best_feature_index == -1) {
-        node->is_leaf = true;
-        node->value = majority_class(y);
-        return node;
+std::vector<double> RandomForestClassifier::DecisionTree::class_counts(std::span<const int> y, size_t n_classes,
+                                                                       std::span<const uint32_t> weights,
+                                                                       std::span<const size_t> indices) const {
+    std::vector<double> counts(n_classes, 0.0);
+    for (size_t idx : indices) {
+        counts[y[idx]] += weights[idx];
     }
-
-    // Recursively build the left and right subtrees
-    node->feature_index = best_feature_index;
-    node->threshold = best_threshold;
-    node->left = build_tree(best_X_left, best_y_left, depth + 1);
-    node->right = build_tree(best_X_right, best_y_right, depth + 1);
-    return node;
+    return counts;
 }
 
-double RandomForestClassifier::DecisionTree::calculate_gini(const std::vector<int>& y) const {
-    std::unordered_map<int, int> class_counts;
-    for (int label : y) {
-        class_counts[label]++;
+void RandomForestClassifier::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::RandomForestClassifier, 2);
+    writer.write_int(n_estimators);
+    writer.write_int(max_depth);
+    writer.write_int(min_samples_split);
+    writer.write_int(max_features);
+    writer.write_int(static_cast<int64_t>(n_features));
+    writer.write_int(static_cast<int64_t>(trees.size()));
+    for (const auto& tree : trees) {
+        writer.write_array(tree->flat_tree.nodes());
     }
-    double impurity = 1.0;
-    size_t total = y.size();
-    for (const auto& [label, count] : class_counts) {
-        double prob = static_cast<double>(count) / total;
-        impurity -= prob * prob;
-    }
-    return impurity;
+    writer.finish();
 }
 
-int RandomForestClassifier::DecisionTree::majority_class(const std::vector<int>& y) const {
-    std::unordered_map<int, int> class_counts;
-    for (int label : y) {
-        class_counts[label]++;
+void RandomForestClassifier::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::RandomForestClassifier, 2);
+    int new_n_estimators = reader.read_int<int>();
+    int new_max_depth = reader.read_int<int>();
+    int new_min_samples_split = reader.read_int<int>();
+    int new_max_features = reader.read_int<int>();
+    // Version 1 files do not record the feature count; take the widest one the trees read
+    bool has_n_features = reader.model_version() >= 2;
+    size_t new_n_features = has_n_features ? reader.read_int<size_t>() : 0;
+    size_t n_trees = reader.read_int<size_t>();
+    std::vector<std::unique_ptr<DecisionTree>> new_trees;
+    for (size_t i = 0; i < n_trees; ++i) {
+        auto tree = std::make_unique<DecisionTree>(new_max_depth, new_min_samples_split, new_max_features, 0);
+        tree->flat_tree = ml::tree::FlatTree::borrow(reader.read_array<ml::TreeNodeRecord>(), file);
+        new_n_features = ml::tree::check_tree_features(tree->flat_tree, new_n_features, has_n_features);
+        new_trees.push_back(std::move(tree));
     }
-    return std::max_element(class_counts.begin(), class_counts.end(),
-                            [](const auto& a, const auto& b) {
-                                return a.second < b.second;
-                            })->first;
+    n_estimators = new_n_estimators;
+    max_depth = new_max_depth;
+    min_samples_split = new_min_samples_split;
+    max_features = new_max_features;
+    trees = std::move(new_trees);
+    n_features = new_n_features;
+    collect_classes();
+    oob_prediction.clear();
+    oob_score = std::numeric_limits<double>::quiet_NaN();
 }
 
-void RandomForestClassifier::DecisionTree::split_dataset(const std::vector<std::vector<double>>& X, const std::vector<int>& y,
-                                                         int feature_index, double threshold,
-                                                         std::vector<std::vector<double>>& X_left, std::vector<int>& y_left,
-                                                         std::vector<std::vector<double>>& X_right, std::vector<int>& y_right) const {
-    for (size_t i = 0; i < X.size(); ++i) {
-        if (X[i][feature_index] <= threshold) {
-            X_left.push_back(X[i]);
-            y_left.push_back(y[i]);
-        } else {
-            X_right.push_back(X[i]);
-            y_right.push_back(y[i]);
-        }
+void RandomForestClassifier::export_cpp(const std::string& path, const std::string& name, ml::tree::CodeStyle style) const {
+    std::vector<const ml::tree::FlatTree*> flat_trees;
+    for (const auto& tree : trees) {
+        flat_trees.push_back(&tree->flat_tree);
     }
+    ml::tree::write_cpp_model(path, name, flat_trees, classes, style);
 }
 
 #endif // RANDOM_FOREST_CLASSIFIER_HPP
@@ -8,6 +8,20 @@
 #include <cmath>
 #include <random>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <span>
+#include <array>
+#include <optional>
+#include <fstream>
+#include <functional>
+#include "../core/Matrix.hpp"
+#include "../core/Scratch.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/Serialization.hpp"
+#include "TreeBuilder.hpp"
+#include "FlatTree.hpp"
+#include "CodeGenerator.hpp"
 
 /**
  * @file RandomForestRegressor.hpp
@@ -26,14 +40,89 @@ public:
      * @param max_depth The maximum depth of the tree.
      * @param min_samples_split The minimum number of samples required to split an internal node.
      * @param max_features The number of features to consider when looking for the best split. Defaults to sqrt(num_features).
+     * @param random_state Seed for the bootstrap samples and feature draws; 0 seeds from std::random_device.
+     *        With a nonzero seed, every fit() grows the same trees whatever the thread pool.
      */
-    RandomForestRegressor(int n_estimators = 10, int max_depth = 5, int min_samples_split = 2, int max_features = -1);
+    RandomForestRegressor(int n_estimators = 10, int max_depth = 5, int min_samples_split = 2, int max_features = -1,
+                           unsigned int random_state = 0);
 
     /**
      * @brief Destructor for RandomForestRegressor.
      */
     ~RandomForestRegressor() = default;
 
+    /**
+     * @brief Sets the pool used to build trees and to predict samples in parallel.
+     * @param pool The pool to use, or nullptr to run on the calling thread. Must outlive its use.
+     */
+    void set_thread_pool(ml::ThreadPool* pool);
+
+    /**
+     * @brief Switches training to histograms of quantized features.
+     *
+     * Each feature is quantized once into at most max_bins bins and splits are chosen from per-bin
+     * sums, which scales to far larger datasets than the exact search at the cost of only
+     * considering thresholds between bins.
+     * @param max_bins Bins per feature, between 2 and 256, or 0 for exact training (the default).
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    void set_max_bins(int max_bins);
+
+    /**
+     * @brief Switches the forest to extremely randomized trees.
+     *
+     * Each node then tries a single threshold per candidate feature, drawn uniformly between the
+     * feature's extremes in the node (or between its occupied bins with histogram training), instead
+     * of every midpoint. Nodes need no sorting and cost O(n * max_features); the extra randomness
+     * usually costs little accuracy on noisy data.
+     * @param enabled Whether to draw random thresholds.
+     */
+    void set_extra_trees(bool enabled);
+
+    /**
+     * @brief Grows every tree best-first up to a number of leaves.
+     *
+     * The leaf whose split decreases the squared error most is split next, so the size of each tree,
+     * and the cost of predicting with the forest, is bounded directly. max_depth still applies.
+     * @param max_leaf_nodes At least 2, or -1 to grow depth-first (the default).
+     * @throw std::invalid_argument If max_leaf_nodes is out of range.
+     */
+    void set_max_leaf_nodes(int max_leaf_nodes);
+
+    /**
+     * @brief Only makes the splits that decrease the mean squared error enough.
+     *
+     * As in scikit-learn, the decrease of a split is N_t / N * (E - N_l / N_t * E_l - N_r / N_t * E_r),
+     * with the sample counts N of the tree's bootstrap sample, the node and its children.
+     * @param min_impurity_decrease The smallest decrease, 0 by default.
+     * @throw std::invalid_argument If min_impurity_decrease is negative.
+     */
+    void set_min_impurity_decrease(double min_impurity_decrease);
+
+    /**
+     * @brief Makes fit() score every training row with the trees that did not draw it.
+     *
+     * Trees are then grown in waves of one per pool thread and added to the out-of-bag estimate in
+     * tree order, so the monitor sees the same scores whatever the thread pool.
+     * @param enabled Whether to compute the out-of-bag predictions and MSE.
+     * @param monitor Called after each tree with the number of trees so far and the out-of-bag MSE
+     *        of those trees; returning false stops fit() and keeps only those trees. May be empty.
+     */
+    void set_oob_score(bool enabled, std::function<bool(size_t n_trees, double mse)> monitor = nullptr);
+
+    /**
+     * @brief Out-of-bag mean squared error of the last fit(), over the rows left out by at least one tree.
+     * @return NaN if out-of-bag scoring was not enabled or no row was ever left out.
+     */
+    double oob_mse() const;
+
+    /**
+     * @brief Out-of-bag prediction of every training row of the last fit().
+     *
+     * Each row is the mean of the trees that did not draw it, or NaN if every tree drew it.
+     */
+    const std::vector<double>& oob_predictions() const;
+
     /**
      * @brief Fits the model to the training data.
      * @param X A vector of feature vectors.
@@ -41,6 +130,13 @@ public:
      */
     void fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y);
 
+    /**
+     * @brief Fits the model to the training data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @param y A vector of target values.
+     */
+    void fit(const ml::MatrixView& X, const std::vector<double>& y);
+
     /**
      * @brief Predicts target values for given input data.
      * @param X A vector of feature vectors.
@@ -48,37 +144,131 @@ public:
      */
     std::vector<double> predict(const std::vector<std::vector<double>>& X) const;
 
-private:
-    struct Node {
-        bool is_leaf;
-        double value;
-        int feature_index;
-        double threshold;
-        std::unique_ptr<Node> left;
-        std::unique_ptr<Node> right;
-
-        Node()
-            : is_leaf(false), value(0.0), feature_index(-1), threshold(0.0), left(nullptr), right(nullptr) {}
-    };
+    /**
+     * @brief Predicts target values for given input data.
+     * @param X A dense matrix of samples (one row per sample).
+     * @return A vector of predicted target values.
+     */
+    std::vector<double> predict(const ml::MatrixView& X) const;
 
+    /**
+     * @brief Predicts target values into a caller-provided buffer without allocating.
+     * @param X A dense matrix of samples (one row per sample), in any layout.
+     * @param predictions Receives one target value per row of X.
+     * @throw std::invalid_argument If predictions.size() != X.rows() or X has a different number of features than the training samples.
+     */
+    void predict_into(const ml::MatrixView& X, std::span<double> predictions) const;
+
+    /**
+     * @brief Saves the fitted model to a binary model file.
+     * @param path Destination file.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Loads a model written by save(), replacing the current one.
+     *
+     * The file is memory-mapped and the tree nodes are used in place, without copying.
+     * @param path Source file.
+     * @throw std::runtime_error If the file cannot be read or does not hold a RandomForestRegressor.
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief Writes a standalone C++ header that predicts like this model, for inference without the library.
+     *
+     * The header defines `double predict(const double* x)` returning the mean of the trees
+     * in namespace name, where x points to the features of one sample; see ml::tree::write_cpp_model().
+     * @param path Destination file.
+     * @param name Namespace of the generated code.
+     * @param style Nested branches, or constexpr node tables for large models.
+     * @throw std::invalid_argument If the model is not fitted or name is not an identifier.
+     * @throw std::runtime_error If the file cannot be written.
+     */
+    void export_cpp(const std::string& path, const std::string& name,
+                    ml::tree::CodeStyle style = ml::tree::CodeStyle::Branches) const;
+
+private:
     struct DecisionTree {
-        std::unique_ptr<Node> root;
+        ml::tree::FlatTree flat_tree;
         int max_depth;
         int min_samples_split;
         int max_features;
         std::mt19937 random_engine;
+        bool random_splits;  // One random threshold per feature and node, as in extremely randomized trees
+        int max_leaf_nodes;
+        double min_impurity_decrease;
+        double n_samples = 0.0;  // Bootstrap weight of the current fit, to weight the impurity decreases
 
-        DecisionTree(int max_depth, int min_samples_split, int max_features);
+        DecisionTree(int max_depth, int min_samples_split, int max_features, std::mt19937::result_type seed,
+                     bool random_splits = false, int max_leaf_nodes = -1, double min_impurity_decrease = 0.0);
         ~DecisionTree() = default;
-        void fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y);
-        double predict_sample(const std::vector<double>& x) const;
+        /**
+         * @brief Grows the tree on a bootstrap sample.
+         * @param weights How many times each row of X was drawn.
+         * @param indices The rows drawn at least once; partitioned in place while the tree is grown.
+         */
+        void fit(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights, std::span<size_t> indices);
+
+        /**
+         * @brief Grows the tree from the histograms of a quantized feature matrix.
+         * @param y The targets, weighted by the bootstrap multiplicities.
+         * @param indices The rows drawn at least once; partitioned in place while the tree is grown.
+         */
+        void fit(const ml::tree::BinnedMatrix& X, const ml::tree::BinnedTargets& y, std::span<size_t> indices);
+        double predict_sample(const ml::MatrixView& X, size_t row) const;
 
     private:
-        std::unique_ptr<Node> build_tree(const std::vector<std::vector<double>>& X, const std::vector<double>& y, int depth);
-        double calculate_mse(const std::vector<double>& y) const;
-        void split_dataset(const std::vector<std::vector<double>>& X, const std::vector<double>& y, int feature_index, double threshold,
-                           std::vector<std::vector<double>>& X_left, std::vector<double>& y_left,
-                           std::vector<std::vector<double>>& X_right, std::vector<double>& y_right) const;
+        /**
+         * @brief Best split of a node found by find_best_split().
+         */
+        struct Split {
+            int feature_index = -1;  ///< -1 if no split separates the samples.
+            double threshold = 0.0;
+            double gain = 0.0;  ///< Decrease of the squared error summed over the weight of the node.
+        };
+
+        /**
+         * @brief A node that may still be split by build_best_first().
+         */
+        struct Candidate {
+            double gain;
+            size_t node;
+            std::span<size_t> indices;
+            int depth;
+            Split split;
+        };
+
+        /**
+         * @brief Grows the subtree for the samples in indices into nodes[node].
+         * @param nodes The tree so far; the children of a split are appended as a pair.
+         */
+        void build_tree(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights, std::span<size_t> indices,
+                        std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth);
+
+        /**
+         * @brief Grows the tree into nodes, always splitting the leaf with the largest impurity decrease next.
+         */
+        void build_best_first(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights,
+                              std::span<size_t> indices, std::vector<ml::TreeNodeRecord>& nodes);
+
+        /**
+         * @brief Makes nodes[node] a leaf holding the mean target and finds the split that should replace it.
+         * @return The split, with feature_index -1 if the node stays a leaf.
+         */
+        Split evaluate_node(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights,
+                            std::span<const size_t> indices, std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth);
+
+        /**
+         * @brief Finds the split with the lowest weighted squared error over max_features random features.
+         *
+         * Each feature is sorted once and swept with running target sums; with random_splits a single
+         * drawn threshold is scored instead.
+         */
+        Split find_best_split(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights,
+                              std::span<const size_t> indices);
+        double calculate_mean(const std::vector<double>& y, std::span<const uint32_t> weights, std::span<const size_t> indices) const;
     };
 
     int n_estimators;
@@ -86,101 +276,337 @@ private:
     int min_samples_split;
     int max_features;
     std::vector<std::unique_ptr<DecisionTree>> trees;
-    std::mt19937 random_engine;
+    size_t n_features = 0;  // Of the training samples
+    unsigned int random_state;
+    std::mt19937 random_engine;  // Re-seeded from random_state by every fit()
+
+    ml::ThreadPool* thread_pool = nullptr;
+    int max_bins = 0;
+    bool extra_trees = false;
+    int max_leaf_nodes = -1;
+    double min_impurity_decrease = 0.0;
+    bool oob_enabled = false;
+    std::function<bool(size_t, double)> oob_monitor;
+    std::vector<double> oob_prediction;
+    double oob_error = std::numeric_limits<double>::quiet_NaN();
 
-    void bootstrap_sample(const std::vector<std::vector<double>>& X, const std::vector<double>& y,
-                          std::vector<std::vector<double>>& X_sample, std::vector<double>& y_sample);
+    /**
+     * @brief Draws a bootstrap sample as per-row multiplicities over the shared training matrix.
+     * @param weights Receives how many times each row was drawn.
+     * @return The rows drawn at least once, in increasing order.
+     */
+    static std::vector<size_t> bootstrap_sample(size_t n_samples, std::mt19937& engine, std::vector<uint32_t>& weights);
 };
 
-RandomForestRegressor::RandomForestRegressor(int n_estimators, int max_depth, int min_samples_split, int max_features)
-    : n_estimators(n_estimators), max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features) {
-    std::random_device rd;
-    random_engine.seed(rd());
+RandomForestRegressor::RandomForestRegressor(int n_estimators, int max_depth, int min_samples_split, int max_features,
+                                               unsigned int random_state)
+    : n_estimators(n_estimators), max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features),
+      random_state(random_state) {
+}
+
+void RandomForestRegressor::set_thread_pool(ml::ThreadPool* pool) {
+    thread_pool = pool;
+}
+
+void RandomForestRegressor::set_max_bins(int max_bins) {
+    if (max_bins != 0 && (max_bins < 2 || max_bins > 256)) {
+        throw std::invalid_argument("max_bins must be 0 or between 2 and 256.");
+    }
+    this->max_bins = max_bins;
+}
+
+void RandomForestRegressor::set_extra_trees(bool enabled) {
+    extra_trees = enabled;
+}
+
+void RandomForestRegressor::set_max_leaf_nodes(int max_leaf_nodes) {
+    if (max_leaf_nodes != -1 && max_leaf_nodes < 2) {
+        throw std::invalid_argument("max_leaf_nodes must be -1 or at least 2.");
+    }
+    this->max_leaf_nodes = max_leaf_nodes;
+}
+
+void RandomForestRegressor::set_min_impurity_decrease(double min_impurity_decrease) {
+    if (!(min_impurity_decrease >= 0.0)) {
+        throw std::invalid_argument("min_impurity_decrease must be non-negative.");
+    }
+    this->min_impurity_decrease = min_impurity_decrease;
+}
+
+void RandomForestRegressor::set_oob_score(bool enabled, std::function<bool(size_t, double)> monitor) {
+    oob_enabled = enabled;
+    oob_monitor = std::move(monitor);
+}
+
+double RandomForestRegressor::oob_mse() const {
+    return oob_error;
+}
+
+const std::vector<double>& RandomForestRegressor::oob_predictions() const {
+    return oob_prediction;
 }
 
 void RandomForestRegressor::fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y) {
+    fit(ml::Matrix(X), y);
+}
+
+void RandomForestRegressor::fit(const ml::MatrixView& X, const std::vector<double>& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("The number of samples must match the number of target values.");
+    }
+    n_features = X.cols();
+
     // Set max_features if not set
     int actual_max_features = max_features;
     if (actual_max_features == -1) {
-        actual_max_features = static_cast<int>(std::sqrt(X[0].size()));
+        actual_max_features = static_cast<int>(std::sqrt(X.cols()));
+    }
+
+    // Start over from the seed so that fitting twice gives the same model
+    random_engine.seed(random_state != 0 ? random_state : std::random_device()());
+
+    // Draw one seed per tree up front so the result does not depend on scheduling
+    std::vector<std::mt19937::result_type> seeds(n_estimators);
+    for (auto& seed : seeds) {
+        seed = random_engine();
+    }
+
+    // Histogram training quantizes the features once for all trees
+    std::optional<ml::tree::BinnedMatrix> binned;
+    if (max_bins > 0) {
+        binned.emplace(X, max_bins, thread_pool);
     }
 
-    for (int i = 0; i < n_estimators; ++i) {
-        std::vector<std::vector<double>> X_sample;
-        std::vector<double> y_sample;
-        bootstrap_sample(X, y, X_sample, y_sample);
+    // Each out-of-bag row keeps the sum and count of the predictions of the trees that left it out; the
+    // squared error of its mean is swapped in and out of the running total as trees are added
+    size_t n = X.rows();
+    std::vector<double> oob_sum(oob_enabled ? n : 0, 0.0);
+    std::vector<uint32_t> oob_count(oob_enabled ? n : 0, 0);
+    std::vector<std::vector<std::pair<size_t, double>>> tree_oob(seeds.size());
+    double squared_error = 0.0;
+    size_t covered = 0;
+    oob_prediction.clear();
+    oob_error = std::numeric_limits<double>::quiet_NaN();
+
+    trees.clear();
+    trees.resize(seeds.size());
+    size_t n_trees = seeds.size();
+    size_t wave = !oob_enabled ? n_trees : thread_pool ? thread_pool->size() : 1;
+    wave = std::max<size_t>(wave, 1);
+    size_t built = 0;
+    bool stopped = false;
+    for (size_t begin = 0; begin < n_trees && !stopped; begin += wave) {
+        ml::parallel_for(thread_pool, begin, std::min(begin + wave, n_trees), [&](size_t i) {
+            std::mt19937 engine(seeds[i]);
+            std::vector<uint32_t> weights;
+            std::vector<size_t> indices = bootstrap_sample(n, engine, weights);
+
+            auto tree = std::make_unique<DecisionTree>(max_depth, min_samples_split, actual_max_features, engine(), extra_trees,
+                                                       max_leaf_nodes, min_impurity_decrease);
+            if (binned) {
+                tree->fit(*binned, {.values = y, .weights = weights}, indices);
+            } else {
+                tree->fit(X, y, weights, indices);
+            }
+            if (oob_enabled) {
+                for (size_t row = 0; row < n; ++row) {
+                    if (weights[row] == 0) {
+                        tree_oob[i].emplace_back(row, tree->flat_tree.predict(X, row));
+                    }
+                }
+            }
+            trees[i] = std::move(tree);
+        });
 
-        auto tree = std::make_unique<DecisionTree>(max_depth, min_samples_split, actual_max_features);
-        tree->fit(X_sample, y_sample);
-        trees.push_back(std::move(tree));
+        // Fold the wave into the estimate in tree order
+        for (size_t i = begin; i < std::min(begin + wave, n_trees) && !stopped; ++i) {
+            built = i + 1;
+            if (!oob_enabled) {
+                continue;
+            }
+            for (auto [row, value] : tree_oob[i]) {
+                if (oob_count[row] > 0) {
+                    double error = oob_sum[row] / oob_count[row] - y[row];
+                    squared_error -= error * error;
+                } else {
+                    ++covered;
+                }
+                oob_sum[row] += value;
+                ++oob_count[row];
+                double error = oob_sum[row] / oob_count[row] - y[row];
+                squared_error += error * error;
+            }
+            tree_oob[i] = {};
+            double mse = covered > 0 ? std::max(squared_error, 0.0) / covered : std::numeric_limits<double>::quiet_NaN();
+            if (oob_monitor && !oob_monitor(built, mse)) {
+                stopped = true;
+            }
+        }
+    }
+    trees.resize(built);
+
+    if (oob_enabled) {
+        // Recompute the final error exactly rather than keeping the running total's rounding
+        oob_prediction.assign(n, std::numeric_limits<double>::quiet_NaN());
+        squared_error = 0.0;
+        for (size_t row = 0; row < n; ++row) {
+            if (oob_count[row] > 0) {
+                oob_prediction[row] = oob_sum[row] / oob_count[row];
+                squared_error += (oob_prediction[row] - y[row]) * (oob_prediction[row] - y[row]);
+            }
+        }
+        if (covered > 0) {
+            oob_error = squared_error / covered;
+        }
     }
 }
 
 std::vector<double> RandomForestRegressor::predict(const std::vector<std::vector<double>>& X) const {
+    for (const auto& x : X) {
+        ml::check_feature_count(n_features, x.size());
+    }
     std::vector<double> predictions(X.size(), 0.0);
-    for (const auto& tree : trees) {
-        for (size_t i = 0; i < X.size(); ++i) {
-            predictions[i] += tree->predict_sample(X[i]);
+    ml::parallel_for(thread_pool, 0, X.size(), [&](size_t i) {
+        ml::MatrixView x(X[i].data(), 1, X[i].size());
+        for (const auto& tree : trees) {
+            predictions[i] += tree->predict_sample(x, 0);
         }
-    }
-    for (auto& pred : predictions) {
-        pred /= n_estimators;
-    }
+        predictions[i] /= trees.size();
+    });
     return predictions;
 }
 
-void RandomForestRegressor::bootstrap_sample(const std::vector<std::vector<double>>& X, const std::vector<double>& y,
-                                             std::vector<std::vector<double>>& X_sample, std::vector<double>& y_sample) {
-    size_t n_samples = X.size();
+std::vector<double> RandomForestRegressor::predict(const ml::MatrixView& X) const {
+    std::vector<double> predictions(X.rows());
+    predict_into(X, predictions);
+    return predictions;
+}
+
+void RandomForestRegressor::predict_into(const ml::MatrixView& X, std::span<double> predictions) const {
+    ml::check_output_size(X.rows(), predictions.size());
+    ml::check_feature_count(n_features, X.cols());
+    // Score a block of rows with one tree after another so the rows share each tree's nodes
+    constexpr size_t block = ml::tree::FlatTree::block_rows;
+    ml::parallel_for(thread_pool, 0, (X.rows() + block - 1) / block, [&](size_t b) {
+        size_t first = b * block;
+        std::span<double> sums = predictions.subspan(first, std::min(block, X.rows() - first));
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for (const auto& tree : trees) {
+            tree->flat_tree.predict_block(X, first, sums.size(), [&](size_t i, double value) {
+                sums[i] += value;
+            });
+        }
+        for (double& sum : sums) {
+            sum /= trees.size();
+        }
+    });
+}
+
+std::vector<size_t> RandomForestRegressor::bootstrap_sample(size_t n_samples, std::mt19937& engine,
+                                                        std::vector<uint32_t>& weights) {
     std::uniform_int_distribution<size_t> dist(0, n_samples - 1);
 
+    // Count the draws per row instead of listing or copying every drawn row
+    weights.assign(n_samples, 0);
     for (size_t i = 0; i < n_samples; ++i) {
-        size_t index = dist(random_engine);
-        X_sample.push_back(X[index]);
-        y_sample.push_back(y[index]);
+        ++weights[dist(engine)];
+    }
+    std::vector<size_t> indices;
+    indices.reserve(n_samples);
+    for (size_t row = 0; row < n_samples; ++row) {
+        if (weights[row] > 0) {
+            indices.push_back(row);
+        }
     }
+    return indices;
 }
 
-RandomForestRegressor::DecisionTree::DecisionTree(int max_depth, int min_samples_split, int max_features)
-    : root(nullptr), max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features) {
-    std::random_device rd;
-    random_engine.seed(rd());
+RandomForestRegressor::DecisionTree::DecisionTree(int max_depth, int min_samples_split, int max_features, std::mt19937::result_type seed,
+                                                  bool random_splits, int max_leaf_nodes, double min_impurity_decrease)
+    : max_depth(max_depth), min_samples_split(min_samples_split), max_features(max_features), random_engine(seed),
+      random_splits(random_splits), max_leaf_nodes(max_leaf_nodes), min_impurity_decrease(min_impurity_decrease) {}
+
+void RandomForestRegressor::DecisionTree::fit(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights,
+                                              std::span<size_t> indices) {
+    n_samples = ml::tree::total_weight(weights, indices);
+    std::vector<ml::TreeNodeRecord> records(1);
+    if (max_leaf_nodes > 0) {
+        build_best_first(X, y, weights, indices, records);
+    } else {
+        build_tree(X, y, weights, indices, records, 0, 0);
+    }
+    flat_tree = ml::tree::FlatTree(records);
 }
 
-void RandomForestRegressor::DecisionTree::fit(const std::vector<std::vector<double>>& X, const std::vector<double>& y) {
-    root = build_tree(X, y, 0);
+void RandomForestRegressor::DecisionTree::fit(const ml::tree::BinnedMatrix& X, const ml::tree::BinnedTargets& y,
+                                  std::span<size_t> indices) {
+    ml::tree::HistogramTreeBuilder builder(X, y,
+                                           {max_depth, min_samples_split, max_features, random_splits, max_leaf_nodes,
+                                            min_impurity_decrease},
+                                           &random_engine);
+    flat_tree = ml::tree::FlatTree(builder.build(indices));
 }
 
-double RandomForestRegressor::DecisionTree::predict_sample(const std::vector<double>& x) const {
-    const Node* node = root.get();
-    while (!node->is_leaf) {
-        if (x[node->feature_index] <= node->threshold) {
-            node = node->left.get();
-        } else {
-            node = node->right.get();
-        }
+double RandomForestRegressor::DecisionTree::predict_sample(const ml::MatrixView& X, size_t row) const {
+    return flat_tree.predict(X, row);
+}
+
+void RandomForestRegressor::DecisionTree::build_tree(const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights,
+                                                     std::span<size_t> indices,
+                                                     std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) {
+    Split best = evaluate_node(X, y, weights, indices, nodes, node, depth);
+    if (best.feature_index == -1) {
+        return;
     }
-    return node->value;
+
+    // Recursively build the left and right subtrees on the two halves of the partitioned rows
+    std::array<std::span<size_t>, 2> child_rows = ml::tree::split_node(X, indices, best.feature_index, best.threshold, nodes, node);
+    size_t left = nodes[node].left;
+    build_tree(X, y, weights, child_rows[0], nodes, left, depth + 1);
+    build_tree(X, y, weights, child_rows[1], nodes, left + 1, depth + 1);
 }
 
-std::unique_ptr<RandomForestRegressor::Node> RandomForestRegressor::DecisionTree::build_tree(
-    const std::vector<std::vector<double>>& X, const std::vector<double>& y, int depth) {
-    auto node = std::make_unique<Node>();
+void RandomForestRegressor::DecisionTree::build_best_first(const ml::MatrixView& X, const std::vector<double>& y,
+                                                           std::span<const uint32_t> weights, std::span<size_t> indices,
+                                                           std::vector<ml::TreeNodeRecord>& nodes) {
+    Split root = evaluate_node(X, y, weights, indices, nodes, 0, 0);
+    if (root.feature_index == -1) {
+        return;
+    }
+    ml::tree::grow_best_first(Candidate{root.gain, 0, indices, 0, root}, max_leaf_nodes, [&](Candidate& leaf, auto& push) {
+        std::array<std::span<size_t>, 2> child_rows =
+            ml::tree::split_node(X, leaf.indices, leaf.split.feature_index, leaf.split.threshold, nodes, leaf.node);
+        for (size_t side = 0; side < 2; ++side) {
+            size_t child = nodes[leaf.node].left + side;
+            Split best = evaluate_node(X, y, weights, child_rows[side], nodes, child, leaf.depth + 1);
+            if (best.feature_index != -1) {
+                push(Candidate{best.gain, child, child_rows[side], leaf.depth + 1, best});
+            }
+        }
+    });
+}
+
+RandomForestRegressor::DecisionTree::Split RandomForestRegressor::DecisionTree::evaluate_node(
+    const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights, std::span<const size_t> indices,
+    std::vector<ml::TreeNodeRecord>& nodes, size_t node, int depth) {
+    nodes[node] = ml::TreeNodeRecord{-1, 0, calculate_mean(y, weights, indices)};
 
     // Check stopping criteria
-    if (depth >= max_depth || y.size() < static_cast<size_t>(min_samples_split)) {
-        node->is_leaf = true;
-        node->value = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
-        return node;
+    if (depth >= max_depth || ml::tree::total_weight(weights, indices) < min_samples_split) {
+        return {};
     }
 
-    double best_mse = std::numeric_limits<double>::max();
-    int best_feature_index = -1;
-    double best_threshold = 0.0;
-    std::vector<std::vector<double>> best_X_left, best_X_right;
-    std::vector<double> best_y_left, best_y_right;
+    Split best = find_best_split(X, y, weights, indices);
+    if (best.feature_index != -1 && best.gain < min_impurity_decrease * n_samples) {
+        return {};
+    }
+    return best;
+}
 
-    int num_features = X[0].size();
+RandomForestRegressor::DecisionTree::Split RandomForestRegressor::DecisionTree::find_best_split(
+    const ml::MatrixView& X, const std::vector<double>& y, std::span<const uint32_t> weights, std::span<const size_t> indices) {
+    size_t n = indices.size();
+    int num_features = static_cast<int>(X.cols());
     std::vector<int> features_indices(num_features);
     std::iota(features_indices.begin(), features_indices.end(), 0);
 
@@ -190,84 +616,118 @@ std::unique_ptr<RandomForestRegressor::Node> RandomForestRegressor::DecisionTree
         features_indices.resize(max_features);
     }
 
-    for (int feature_index : features_indices) {
-        // Get all possible thresholds
-        std::vector<double> feature_values;
-        feature_values.reserve(X.size());
-        for (const auto& x : X) {
-            feature_values.push_back(x[feature_index]);
+    // Random thresholds are scored like ml::tree::best_variance_split, on the targets centred on the node mean
+    double node_weight = ml::tree::total_weight(weights, indices);
+    double mean = random_splits ? calculate_mean(y, weights, indices) : 0.0;
+    double centred_sum = 0.0;
+    if (random_splits) {
+        for (size_t idx : indices) {
+            centred_sum += weights[idx] * (y[idx] - mean);
         }
-        std::sort(feature_values.begin(), feature_values.end());
-        feature_values.erase(std::unique(feature_values.begin(), feature_values.end()), feature_values.end());
+    }
 
-        std::vector<double> thresholds;
-        thresholds.reserve(feature_values.size() - 1);
-        for (size_t i = 1; i < feature_values.size(); ++i) {
-            thresholds.push_back((feature_values[i - 1] + feature_values[i]) / 2.0);
+    Split best;
+    double best_score = -1.0;
+    for (int feature_index : features_indices) {
+        std::pair<double, double> split;
+        if (random_splits) {
+            // Extremely randomized trees try one threshold drawn uniformly between the extremes of the node
+            double low = std::numeric_limits<double>::infinity();
+            double high = -low;
+            for (size_t idx : indices) {
+                low = std::min(low, X(idx, feature_index));
+                high = std::max(high, X(idx, feature_index));
+            }
+            if (!(low < high)) continue;
+            double threshold = std::uniform_real_distribution<double>(low, high)(random_engine);
+            double left_weight = 0.0;
+            double left_sum = 0.0;
+            for (size_t idx : indices) {
+                if (X(idx, feature_index) <= threshold) {
+                    left_weight += weights[idx];
+                    left_sum += weights[idx] * (y[idx] - mean);
+                }
+            }
+            if (left_weight == 0.0 || left_weight == node_weight) continue;
+            double right_sum = centred_sum - left_sum;
+            split = {left_sum * left_sum / left_weight + right_sum * right_sum / (node_weight - left_weight), threshold};
+        } else {
+            std::span<std::pair<double, size_t>> sorted = ml::scratch<std::pair<double, size_t>>(n);
+            for (size_t i = 0; i < n; ++i) {
+                sorted[i] = {X(indices[i], feature_index), indices[i]};
+            }
+            std::sort(sorted.begin(), sorted.end());
+            split = ml::tree::best_variance_split(sorted, y, weights);
         }
 
-        // Evaluate each threshold
-        for (double threshold : thresholds) {
-            std::vector<std::vector<double>> X_left, X_right;
-            std::vector<double> y_left, y_right;
-            split_dataset(X, y, feature_index, threshold, X_left, y_left, X_right, y_right);
-
-            if (y_left.empty() || y_right.empty())
-                continue;
-
-            double mse_left = calculate_mse(y_left);
-            double mse_right = calculate_mse(y_right);
-            double mse = (mse_left * y_left.size() + mse_right * y_right.size()) / y.size();
-
-            if (mse < best_mse) {
-                best_mse = mse;
-                best_feature_index = feature_index;
-                best_threshold = threshold;
-                best_X_left = std::move(X_left);
-                best_X_right = std::move(X_right);
-                best_y_left = std::move(y_left);
-                best_y_right = std::move(y_right);
-            }
+        if (split.first > best_score) {
+            best_score = split.first;
+            best.feature_index = feature_index;
+            best.threshold = split.second;
+            best.gain = split.first;
         }
     }
+    return best;
+}
 
-    // If no split improves the mse, make this a leaf node
-    if (best_feature_index == -1) {
-        node->is_leaf = true;
-        node->value = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
-        return node;
+double RandomForestRegressor::DecisionTree::calculate_mean(const std::vector<double>& y, std::span<const uint32_t> weights,
+                                                           std::span<const size_t> indices) const {
+    double sum = 0.0;
+    for (size_t idx : indices) {
+        sum += weights[idx] * y[idx];
     }
+    return sum / ml::tree::total_weight(weights, indices);
+}
 
-    // Recursively build the left and right subtrees
-    node->feature_index = best_feature_index;
-    node->threshold = best_threshold;
-    node->left = build_tree(best_X_left, best_y_left, depth + 1);
-    node->right = build_tree(best_X_right, best_y_right, depth + 1);
-    return node;
+void RandomForestRegressor::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    ml::BinaryWriter writer(file, ml::ModelType::RandomForestRegressor, 2);
+    writer.write_int(n_estimators);
+    writer.write_int(max_depth);
+    writer.write_int(min_samples_split);
+    writer.write_int(max_features);
+    writer.write_int(static_cast<int64_t>(n_features));
+    writer.write_int(static_cast<int64_t>(trees.size()));
+    for (const auto& tree : trees) {
+        writer.write_array(tree->flat_tree.nodes());
+    }
+    writer.finish();
 }
 
-double RandomForestRegressor::DecisionTree::calculate_mse(const std::vector<double>& y) const {
-    double mean = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
-    double mse = std::transform_reduce(y.begin(), y.end(), 0.0, std::plus<>(), [mean](double val) {
-        double diff = val - mean;
-        return diff * diff;
-    });
-    return mse / y.size();
+void RandomForestRegressor::load(const std::string& path) {
+    auto file = ml::MappedFile::open(path);
+    ml::BinaryReader reader(file->bytes(), ml::ModelType::RandomForestRegressor, 2);
+    int new_n_estimators = reader.read_int<int>();
+    int new_max_depth = reader.read_int<int>();
+    int new_min_samples_split = reader.read_int<int>();
+    int new_max_features = reader.read_int<int>();
+    // Version 1 files do not record the feature count; take the widest one the trees read
+    bool has_n_features = reader.model_version() >= 2;
+    size_t new_n_features = has_n_features ? reader.read_int<size_t>() : 0;
+    size_t n_trees = reader.read_int<size_t>();
+    std::vector<std::unique_ptr<DecisionTree>> new_trees;
+    for (size_t i = 0; i < n_trees; ++i) {
+        auto tree = std::make_unique<DecisionTree>(new_max_depth, new_min_samples_split, new_max_features, 0);
+        tree->flat_tree = ml::tree::FlatTree::borrow(reader.read_array<ml::TreeNodeRecord>(), file);
+        new_n_features = ml::tree::check_tree_features(tree->flat_tree, new_n_features, has_n_features);
+        new_trees.push_back(std::move(tree));
+    }
+    n_estimators = new_n_estimators;
+    max_depth = new_max_depth;
+    min_samples_split = new_min_samples_split;
+    max_features = new_max_features;
+    trees = std::move(new_trees);
+    n_features = new_n_features;
+    oob_prediction.clear();
+    oob_error = std::numeric_limits<double>::quiet_NaN();
 }
 
-void RandomForestRegressor::DecisionTree::split_dataset(const std::vector<std::vector<double>>& X, const std::vector<double>& y,
-                                                        int feature_index, double threshold,
-                                                        std::vector<std::vector<double>>& X_left, std::vector<double>& y_left,
-                                                        std::vector<std::vector<double>>& X_right, std::vector<double>& y_right) const {
-    for (size_t i = 0; i < X.size(); ++i) {
-        if (X[i][feature_index] <= threshold) {
-            X_left.push_back(X[i]);
-            y_left.push_back(y[i]);
-        } else {
-            X_right.push_back(X[i]);
-            y_right.push_back(y[i]);
-        }
+void RandomForestRegressor::export_cpp(const std::string& path, const std::string& name, ml::tree::CodeStyle style) const {
+    std::vector<const ml::tree::FlatTree*> flat_trees;
+    for (const auto& tree : trees) {
+        flat_trees.push_back(&tree->flat_tree);
     }
+    ml::tree::write_cpp_model(path, name, flat_trees, {}, style);
 }
 
 #endif // RANDOM_FOREST_REGRESSOR_HPP
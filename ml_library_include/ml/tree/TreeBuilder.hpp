@@ -0,0 +1,620 @@
+#ifndef ML_TREE_BUILDER_HPP
+#define ML_TREE_BUILDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include "../core/Matrix.hpp"
+#include "../core/Serialization.hpp"
+#include "../core/ThreadPool.hpp"
+
+/**
+ * @file TreeBuilder.hpp
+ * @brief Building blocks shared by the decision tree and random forest builders.
+ *
+ * The builders never copy rows. Each one keeps a single array of row indices into the training
+ * matrix and partitions it in place as it grows the tree, like quicksort, so every node owns a
+ * contiguous range of that array and training needs O(n) memory beyond the data.
+ *
+ * Histogram training quantizes every feature once into at most 256 bins (BinnedMatrix) and
+ * picks each split from per-bin sums instead of sorted values (HistogramTreeBuilder), which
+ * makes split search O(n + bins) per feature and stores the features in one byte each.
+ */
+
+namespace ml {
+namespace tree {
+
+/**
+ * @brief Node size from which a builder with a thread pool searches the features of a node in parallel.
+ *
+ * Below it the per-feature work is too small to share, so each child that falls under it is grown
+ * as a single task instead, next to its larger siblings.
+ */
+inline constexpr std::size_t parallel_node_rows = 8192;
+
+/**
+ * @brief Attaches a subtree that was grown into its own array.
+ * @param nodes The tree; nodes[slot] receives the root of the subtree and the rest is appended.
+ * @param slot A leaf of nodes reserved for the subtree.
+ * @param subtree Nodes with the root first and children after their parent.
+ */
+inline void append_subtree(std::vector<TreeNodeRecord>& nodes, std::size_t slot, const std::vector<TreeNodeRecord>& subtree) {
+    // Node k > 0 of the subtree lands at base + k
+    std::size_t base = nodes.size() - 1;
+    nodes.resize(base + subtree.size());
+    for (std::size_t k = 0; k < subtree.size(); ++k) {
+        TreeNodeRecord record = subtree[k];
+        if (record.feature >= 0) {
+            record.left += static_cast<std::uint32_t>(base);
+        }
+        nodes[k == 0 ? slot : base + k] = record;
+    }
+}
+
+/**
+ * @brief Grows a tree best-first: the leaf whose split decreases the impurity most is split next.
+ *
+ * Leaf is a node that can still be split, with a double member gain that ranks it; ties go to
+ * the leaf found first. expand(leaf, push) makes the split and calls push(child) for each child
+ * that can be split further, so that the leaves that cannot are final as soon as they are found.
+ * @param root The root, if it can be split.
+ * @param max_leaf_nodes Stop once the tree has this many leaves; 0 or less grows until no leaf can be split.
+ */
+template <typename Leaf, typename Expand>
+void grow_best_first(Leaf root, int max_leaf_nodes, Expand expand) {
+    struct Entry {
+        double gain;
+        std::size_t order;
+        Leaf leaf;
+    };
+    auto later = [](const Entry& a, const Entry& b) {
+        return a.gain < b.gain || (a.gain == b.gain && a.order > b.order);
+    };
+    std::vector<Entry> heap;
+    std::size_t order = 0;
+    auto push = [&](Leaf&& leaf) {
+        double gain = leaf.gain;
+        heap.push_back(Entry{gain, order++, std::move(leaf)});
+        std::push_heap(heap.begin(), heap.end(), later);
+    };
+    push(std::move(root));
+    // Every split turns one leaf into two
+    for (int leaves = 1; !heap.empty() && (max_leaf_nodes <= 0 || leaves < max_leaf_nodes); ++leaves) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Leaf leaf = std::move(heap.back().leaf);
+        heap.pop_back();
+        expand(leaf, push);
+    }
+}
+
+/**
+ * @brief Total multiplicity of the rows of a node.
+ * @param weights How many times each row of the training matrix was drawn.
+ * @param indices The rows of the node.
+ */
+inline double total_weight(std::span<const std::uint32_t> weights, std::span<const std::size_t> indices) {
+    double total = 0.0;
+    for (std::size_t row : indices) {
+        total += weights[row];
+    }
+    return total;
+}
+
+/**
+ * @brief Best regression threshold of one feature, from a single sweep over the rows sorted by it.
+ *
+ * A side with weight w, sum of squares q and target sum s around the node mean has squared error
+ * q - s^2 / w. The q of both sides add up to the same total for every threshold, so the best split
+ * maximizes s_left^2 / w_left + s_right^2 / w_right, and that score is its reduction of the squared
+ * error. Centring the targets and summing the left side with Kahan compensation keeps the score
+ * accurate when the targets have a large offset.
+ * @param sorted The (feature value, row) pairs of the node, in increasing value.
+ * @param y Target of every row.
+ * @param weights Multiplicity of every row, or empty to count each row once.
+ * @return The score and threshold of the best split; the score is -1 if no threshold separates the rows.
+ */
+inline std::pair<double, double> best_variance_split(std::span<const std::pair<double, std::size_t>> sorted,
+                                                     std::span<const double> y, std::span<const std::uint32_t> weights) {
+    auto weight = [&](std::size_t row) { return weights.empty() ? 1.0 : static_cast<double>(weights[row]); };
+    double node_weight = 0.0;
+    double node_sum = 0.0;
+    for (const auto& [value, row] : sorted) {
+        node_weight += weight(row);
+        node_sum += weight(row) * y[row];
+    }
+    double mean = node_sum / node_weight;
+    // Zero up to rounding; the right side is what the left one leaves of it
+    double centred_sum = 0.0;
+    for (const auto& [value, row] : sorted) {
+        centred_sum += weight(row) * (y[row] - mean);
+    }
+
+    double best_score = -1.0;
+    double best_threshold = 0.0;
+    double left_weight = 0.0;
+    double left_sum = 0.0;
+    double compensation = 0.0;
+    for (std::size_t i = 1; i < sorted.size(); ++i) {
+        std::size_t row = sorted[i - 1].second;
+        left_weight += weight(row);
+        double term = weight(row) * (y[row] - mean) - compensation;
+        double next = left_sum + term;
+        compensation = (next - left_sum) - term;
+        left_sum = next;
+
+        // Only thresholds between distinct values separate the rows
+        if (sorted[i - 1].first == sorted[i].first) {
+            continue;
+        }
+        double right_sum = centred_sum - left_sum;
+        double score = left_sum * left_sum / left_weight + right_sum * right_sum / (node_weight - left_weight);
+        if (score > best_score) {
+            best_score = score;
+            best_threshold = (sorted[i - 1].first + sorted[i].first) / 2.0;
+        }
+    }
+    return {best_score, best_threshold};
+}
+
+/**
+ * @brief Reorders the rows of a node so that those going left come first.
+ * @param X The training samples.
+ * @param indices The rows of the node; reordered in place.
+ * @param feature_index The feature of the split.
+ * @param threshold Rows with X(row, feature_index) <= threshold go left.
+ * @return The number of rows going left; indices.first(count) and indices.subspan(count) are the children.
+ */
+inline std::size_t partition_rows(const MatrixView& X, std::span<std::size_t> indices, int feature_index, double threshold) {
+    auto middle = std::partition(indices.begin(), indices.end(), [&](std::size_t row) {
+        return X(row, feature_index) <= threshold;
+    });
+    return static_cast<std::size_t>(middle - indices.begin());
+}
+
+/**
+ * @brief Turns nodes[node] into a split and appends its two children, as leaves, next to each other.
+ * @param indices The rows of the node; partitioned in place between the children.
+ * @return The rows of the left and of the right child.
+ */
+inline std::array<std::span<std::size_t>, 2> split_node(const MatrixView& X, std::span<std::size_t> indices, int feature_index,
+                                                        double threshold, std::vector<TreeNodeRecord>& nodes, std::size_t node) {
+    std::size_t n_left = partition_rows(X, indices, feature_index, threshold);
+    std::size_t left = nodes.size();
+    nodes[node] = TreeNodeRecord{feature_index, static_cast<std::uint32_t>(left), threshold};
+    nodes.resize(left + 2, TreeNodeRecord{-1, 0, 0.0});
+    return {indices.first(n_left), indices.subspan(n_left)};
+}
+
+/**
+ * @brief A feature matrix quantized into at most 256 bins per feature.
+ *
+ * Bin b of feature f holds the values in (threshold(f, b - 1), threshold(f, b)], so the split
+ * "bin <= b" sends a training row the same way as the test x[f] <= threshold(f, b) on raw data.
+ * Features with at most max_bins distinct values get one bin per value; others are cut at quantiles.
+ */
+class BinnedMatrix {
+public:
+    /**
+     * @brief Quantizes X.
+     * @param X The training samples, in any layout.
+     * @param max_bins The maximum number of bins per feature, between 2 and 256.
+     * @param pool Pool to quantize the features in parallel, or nullptr to run on the calling thread.
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    BinnedMatrix(const MatrixView& X, int max_bins = 256, ThreadPool* pool = nullptr) : rows_(X.rows()), cols_(X.cols()) {
+        quantize(X, [](std::size_t row) { return row; }, max_bins, pool);
+    }
+
+    /**
+     * @brief Quantizes some rows of X without copying them out first.
+     * @param rows The rows of X to keep; row i of the binned matrix is row rows[i] of X.
+     * @throw std::invalid_argument If max_bins is out of range.
+     */
+    BinnedMatrix(const MatrixView& X, std::span<const std::size_t> rows, int max_bins = 256, ThreadPool* pool = nullptr)
+        : rows_(rows.size()), cols_(X.cols()) {
+        quantize(X, [rows](std::size_t i) { return rows[i]; }, max_bins, pool);
+    }
+
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+
+    /** @brief The bins of one feature, one byte per row. */
+    const std::uint8_t* column(std::size_t col) const { return codes_.data() + col * rows_; }
+
+    /** @brief Number of bins of a feature. */
+    std::size_t bins(std::size_t col) const { return thresholds_[col].size() + 1; }
+
+    /** @brief Position of the first bin of a feature when the bins of all features are laid end to end. */
+    std::size_t bin_offset(std::size_t col) const { return offsets_[col]; }
+
+    /** @brief Total number of bins over all features. */
+    std::size_t total_bins() const { return offsets_[cols_]; }
+
+    /** @brief Raw-value threshold equivalent to splitting a feature after a bin. */
+    double threshold(std::size_t col, std::size_t bin) const { return thresholds_[col][bin]; }
+
+private:
+    template <typename RowOf>
+    void quantize(const MatrixView& X, RowOf row_of, int max_bins, ThreadPool* pool) {
+        if (max_bins < 2 || max_bins > 256) {
+            throw std::invalid_argument("max_bins must be between 2 and 256.");
+        }
+        codes_.resize(rows_ * cols_);
+        thresholds_.resize(cols_);
+        parallel_for(pool, 0, cols_, [&](std::size_t col) {
+            std::vector<double> sorted(rows_);
+            for (std::size_t row = 0; row < rows_; ++row) {
+                sorted[row] = X(row_of(row), col);
+            }
+            std::sort(sorted.begin(), sorted.end());
+            thresholds_[col] = cut_points(sorted, static_cast<std::size_t>(max_bins));
+
+            const std::vector<double>& cuts = thresholds_[col];
+            std::uint8_t* codes = codes_.data() + col * rows_;
+            for (std::size_t row = 0; row < rows_; ++row) {
+                double value = X(row_of(row), col);
+                codes[row] = static_cast<std::uint8_t>(std::lower_bound(cuts.begin(), cuts.end(), value) - cuts.begin());
+            }
+        });
+        offsets_.resize(cols_ + 1, 0);
+        for (std::size_t col = 0; col < cols_; ++col) {
+            offsets_[col + 1] = offsets_[col] + bins(col);
+        }
+    }
+
+    static std::vector<double> cut_points(const std::vector<double>& sorted, std::size_t max_bins) {
+        std::vector<double> cuts;
+        std::size_t distinct = sorted.empty() ? 0 : 1;
+        for (std::size_t i = 1; i < sorted.size(); ++i) {
+            distinct += sorted[i] != sorted[i - 1];
+        }
+        if (distinct <= max_bins) {
+            for (std::size_t i = 1; i < sorted.size(); ++i) {
+                if (sorted[i] != sorted[i - 1]) {
+                    cuts.push_back((sorted[i - 1] + sorted[i]) / 2.0);
+                }
+            }
+            return cuts;
+        }
+        // Cut after the value at every quantile, halfway to the next distinct value
+        for (std::size_t b = 1; b < max_bins; ++b) {
+            double value = sorted[b * sorted.size() / max_bins];
+            auto next = std::upper_bound(sorted.begin(), sorted.end(), value);
+            if (next == sorted.end()) {
+                break;
+            }
+            double cut = (value + *next) / 2.0;
+            if (cuts.empty() || cut > cuts.back()) {
+                cuts.push_back(cut);
+            }
+        }
+        return cuts;
+    }
+
+    std::size_t rows_;
+    std::size_t cols_;
+    std::vector<std::uint8_t> codes_;  // Column-major
+    std::vector<std::vector<double>> thresholds_;
+    std::vector<std::size_t> offsets_;
+};
+
+/**
+ * @brief Reorders the rows of a node of a binned matrix so that those going left come first.
+ * @return The number of rows whose bin of the feature is at most bin.
+ */
+inline std::size_t partition_rows(const BinnedMatrix& X, std::span<std::size_t> indices, int feature_index, std::size_t bin) {
+    const std::uint8_t* codes = X.column(feature_index);
+    auto middle = std::partition(indices.begin(), indices.end(), [&](std::size_t row) {
+        return codes[row] <= bin;
+    });
+    return static_cast<std::size_t>(middle - indices.begin());
+}
+
+/**
+ * @brief The targets a histogram tree is fitted to.
+ *
+ * Regression sets values; classification sets classes and labels instead.
+ */
+struct BinnedTargets {
+    std::span<const double> values = {};  ///< Target value of every row.
+    std::span<const int> classes = {};    ///< Class of every row as an index into labels.
+    std::span<const int> labels = {};     ///< The label of each class.
+    std::span<const std::uint32_t> weights = {};  ///< Multiplicity of every row, e.g. from a bootstrap; empty counts each row once.
+};
+
+/**
+ * @brief Stopping rules and feature sampling of a histogram tree.
+ */
+struct BinnedTreeOptions {
+    int max_depth = 5;
+    int min_samples_split = 2;
+    int max_features = -1;  ///< Features drawn at random for every node; -1 considers them all.
+    bool random_splits = false;  ///< Try one random cut per feature, between its occupied bins, as in extremely randomized trees.
+    int max_leaf_nodes = -1;  ///< Grow best-first up to this many leaves; -1 grows depth-first.
+    double min_impurity_decrease = 0.0;  ///< Smallest impurity decrease of a split, weighted by the node's share of the rows.
+};
+
+/**
+ * @brief Grows a decision tree from the per-bin sums of a BinnedMatrix.
+ *
+ * Every bin of a node histogram holds the (weighted) number of rows followed by either the sum
+ * of their targets (regression) or their count per class (classification). Both split criteria then
+ * reduce to maximizing sum_k s_k^2 / n over the two sides, where s_k are the sums of a side.
+ * Only the smaller child's histogram is built from its rows; the larger child's is the
+ * parent's minus the smaller one, computed in place in the parent's buffer.
+ *
+ * With a thread pool, nodes of at least parallel_node_rows rows fill and search the histograms
+ * of different features in parallel. With options.max_leaf_nodes set the tree grows best-first,
+ * and every leaf waiting to be split keeps its histogram.
+ */
+class HistogramTreeBuilder {
+public:
+    /**
+     * @param engine Draws the features of each node when options.max_features != -1 and the cuts when
+     *        options.random_splits is set; may be null otherwise.
+     * @param pool Pool for the work on large nodes, or nullptr to run on the calling thread.
+     */
+    HistogramTreeBuilder(const BinnedMatrix& X, const BinnedTargets& y, const BinnedTreeOptions& options,
+                         std::mt19937* engine = nullptr, ThreadPool* pool = nullptr)
+        : X_(X), y_(y), options_(options), engine_(engine), pool_(pool),
+          stride_(1 + (y.labels.empty() ? 1 : y.labels.size())), features_(X.cols()) {
+        std::iota(features_.begin(), features_.end(), 0);
+    }
+
+    /**
+     * @brief Grows the tree on the rows in indices, which may repeat.
+     * @param indices The training rows; partitioned in place while the tree is grown.
+     * @return The tree, with the children of a node after it and next to each other.
+     */
+    std::vector<TreeNodeRecord> build(std::span<std::size_t> indices) {
+        records_.clear();
+        records_.push_back(TreeNodeRecord{-1, 0, 0.0});
+        if (indices.empty()) {
+            return std::move(records_);
+        }
+        Leaf root{.indices = indices, .histogram = std::vector<double>(X_.total_bins() * stride_, 0.0)};
+        accumulate(indices, root.histogram);
+        root_weight_ = node_totals(root.histogram)[0];
+        if (!evaluate(root)) {
+            return std::move(records_);
+        }
+        if (options_.max_leaf_nodes > 0) {
+            grow_best_first(std::move(root), options_.max_leaf_nodes, [&](Leaf& leaf, auto& push) {
+                for (Leaf& child : split(leaf)) {
+                    if (evaluate(child)) {
+                        push(std::move(child));
+                    }
+                }
+            });
+        } else {
+            grow(root);
+        }
+        return std::move(records_);
+    }
+
+private:
+    struct Split {
+        int feature_index = -1;
+        std::size_t bin = 0;
+        double score = -1.0;
+    };
+
+    // A node that may still be split, with its rows, its histogram and its best split
+    struct Leaf {
+        double gain = 0.0;
+        std::size_t node = 0;
+        std::span<std::size_t> indices = {};
+        std::vector<double> histogram = {};
+        int depth = 0;
+        Split split = {};
+    };
+
+    ThreadPool* pool_for(std::size_t rows) const {
+        return rows >= parallel_node_rows ? pool_ : nullptr;
+    }
+
+    void accumulate(std::span<const std::size_t> indices, std::vector<double>& histogram) const {
+        parallel_for(pool_for(indices.size()), 0, X_.cols(), [&](std::size_t col) {
+            const std::uint8_t* codes = X_.column(col);
+            double* bins = histogram.data() + X_.bin_offset(col) * stride_;
+            if (y_.labels.empty()) {
+                for (std::size_t row : indices) {
+                    double weight = y_.weights.empty() ? 1.0 : y_.weights[row];
+                    double* bin = bins + codes[row] * stride_;
+                    bin[0] += weight;
+                    bin[1] += weight * y_.values[row];
+                }
+            } else {
+                for (std::size_t row : indices) {
+                    double weight = y_.weights.empty() ? 1.0 : y_.weights[row];
+                    double* bin = bins + codes[row] * stride_;
+                    bin[0] += weight;
+                    bin[1 + y_.classes[row]] += weight;
+                }
+            }
+        });
+    }
+
+    // Sums of the node: the bins of any single feature add up to them
+    std::vector<double> node_totals(const std::vector<double>& histogram) const {
+        std::vector<double> totals(stride_, 0.0);
+        for (std::size_t bin = 0; bin < X_.bins(0); ++bin) {
+            for (std::size_t k = 0; k < stride_; ++k) {
+                totals[k] += histogram[bin * stride_ + k];
+            }
+        }
+        return totals;
+    }
+
+    double leaf_value(const std::vector<double>& totals) const {
+        if (y_.labels.empty()) {
+            return totals[1] / totals[0];
+        }
+        auto majority = std::max_element(totals.begin() + 1, totals.end());
+        return y_.labels[majority - totals.begin() - 1];
+    }
+
+    double side_score(const double* sums) const {
+        double squares = 0.0;
+        for (std::size_t k = 1; k < stride_; ++k) {
+            squares += sums[k] * sums[k];
+        }
+        return squares / sums[0];
+    }
+
+    Split find_best_split(const std::vector<double>& histogram, const std::vector<double>& totals) {
+        std::size_t n_features = features_.size();
+        if (options_.max_features != -1 && engine_ != nullptr) {
+            std::shuffle(features_.begin(), features_.end(), *engine_);
+            n_features = std::min(n_features, static_cast<std::size_t>(options_.max_features));
+        }
+        // Random cuts are drawn up front as fractions of each feature's occupied range, in feature order
+        std::vector<double> draws;
+        if (options_.random_splits) {
+            std::uniform_real_distribution<double> fraction(0.0, 1.0);
+            for (std::size_t f = 0; f < n_features; ++f) {
+                draws.push_back(fraction(*engine_));
+            }
+        }
+        // Each feature reports its best split; ties go to the feature searched first
+        std::vector<std::pair<double, std::size_t>> feature_best(n_features);
+        parallel_for(pool_for(static_cast<std::size_t>(totals[0])), 0, n_features, [&](std::size_t f) {
+            std::size_t col = features_[f];
+            const double* bins = histogram.data() + X_.bin_offset(col) * stride_;
+            std::vector<double> left(stride_, 0.0), right(stride_);
+            double best_score = -1.0;
+            std::size_t best_bin = 0;
+            if (options_.random_splits) {
+                feature_best[f] = random_split(bins, X_.bins(col), totals, draws[f]);
+                return;
+            }
+            // Move one bin at a time from the right side to the left one
+            for (std::size_t bin = 0; bin + 1 < X_.bins(col); ++bin) {
+                for (std::size_t k = 0; k < stride_; ++k) {
+                    left[k] += bins[bin * stride_ + k];
+                    right[k] = totals[k] - left[k];
+                }
+                if (left[0] == 0.0 || bins[bin * stride_] == 0.0) {
+                    continue;
+                }
+                if (right[0] == 0.0) {
+                    break;
+                }
+                double score = side_score(left.data()) + side_score(right.data());
+                if (score > best_score) {
+                    best_score = score;
+                    best_bin = bin;
+                }
+            }
+            feature_best[f] = {best_score, best_bin};
+        });
+
+        Split best;
+        double best_score = -1.0;
+        for (std::size_t f = 0; f < n_features; ++f) {
+            if (feature_best[f].first > best_score) {
+                best_score = feature_best[f].first;
+                best.feature_index = static_cast<int>(features_[f]);
+                best.bin = feature_best[f].second;
+                best.score = best_score;
+            }
+        }
+        return best;
+    }
+
+    // Scores the cut after the bin at the given fraction of the occupied bins; -1 if a single bin is occupied
+    std::pair<double, std::size_t> random_split(const double* bins, std::size_t n_bins, const std::vector<double>& totals,
+                                                double draw) const {
+        std::size_t first = 0;
+        while (first < n_bins && bins[first * stride_] == 0.0) {
+            ++first;
+        }
+        std::size_t last = n_bins;
+        while (last > first + 1 && bins[(last - 1) * stride_] == 0.0) {
+            --last;
+        }
+        if (last <= first + 1) {
+            return {-1.0, 0};
+        }
+        std::size_t cut = first + std::min(static_cast<std::size_t>(draw * (last - 1 - first)), last - 2 - first);
+        std::vector<double> left(stride_, 0.0), right(stride_);
+        for (std::size_t bin = first; bin <= cut; ++bin) {
+            for (std::size_t k = 0; k < stride_; ++k) {
+                left[k] += bins[bin * stride_ + k];
+            }
+        }
+        for (std::size_t k = 0; k < stride_; ++k) {
+            right[k] = totals[k] - left[k];
+        }
+        return {side_score(left.data()) + side_score(right.data()), cut};
+    }
+
+    // Sets the value of the leaf and finds its best split; returns whether that split should be made
+    bool evaluate(Leaf& leaf) {
+        std::vector<double> totals = node_totals(leaf.histogram);
+        records_[leaf.node].value = leaf_value(totals);
+        bool pure = !y_.labels.empty() &&
+                    std::find(totals.begin() + 1, totals.end(), totals[0]) != totals.end();
+        if (leaf.depth >= options_.max_depth || totals[0] < options_.min_samples_split || pure) {
+            return false;
+        }
+        leaf.split = find_best_split(leaf.histogram, totals);
+        if (leaf.split.feature_index == -1) {
+            return false;
+        }
+        // A side scores its weight minus its weight times its impurity, so the impurity decrease is the score gained
+        leaf.gain = (leaf.split.score - side_score(totals.data())) / root_weight_;
+        return options_.min_impurity_decrease <= 0.0 || leaf.gain >= options_.min_impurity_decrease;
+    }
+
+    // Makes the split of the leaf and returns the two children
+    std::array<Leaf, 2> split(Leaf& leaf) {
+        std::size_t n_left = partition_rows(X_, leaf.indices, leaf.split.feature_index, leaf.split.bin);
+        std::uint32_t left = static_cast<std::uint32_t>(records_.size());
+        records_[leaf.node] = TreeNodeRecord{leaf.split.feature_index, left, X_.threshold(leaf.split.feature_index, leaf.split.bin)};
+        records_.push_back(TreeNodeRecord{-1, 0, 0.0});
+        records_.push_back(TreeNodeRecord{-1, 0, 0.0});
+
+        // Scan the rows of the smaller child only and turn the parent's histogram into the larger child's
+        std::array<Leaf, 2> children{Leaf{.node = left, .indices = leaf.indices.first(n_left), .depth = leaf.depth + 1},
+                                     Leaf{.node = left + 1u, .indices = leaf.indices.subspan(n_left), .depth = leaf.depth + 1}};
+        std::size_t smaller = children[0].indices.size() <= children[1].indices.size() ? 0 : 1;
+        children[smaller].histogram.assign(leaf.histogram.size(), 0.0);
+        accumulate(children[smaller].indices, children[smaller].histogram);
+        for (std::size_t i = 0; i < leaf.histogram.size(); ++i) {
+            leaf.histogram[i] -= children[smaller].histogram[i];
+        }
+        children[1 - smaller].histogram = std::move(leaf.histogram);
+        return children;
+    }
+
+    void grow(Leaf& leaf) {
+        for (Leaf& child : split(leaf)) {
+            if (evaluate(child)) {
+                grow(child);
+            }
+        }
+    }
+
+    const BinnedMatrix& X_;
+    BinnedTargets y_;
+    BinnedTreeOptions options_;
+    std::mt19937* engine_;
+    ThreadPool* pool_;
+    std::size_t stride_;
+    std::vector<std::size_t> features_;
+    std::vector<TreeNodeRecord> records_;
+    double root_weight_ = 0.0;
+};
+
+} // namespace tree
+} // namespace ml
+
+#endif // ML_TREE_BUILDER_HPP
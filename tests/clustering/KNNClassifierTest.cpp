@@ -41,6 +41,17 @@ int main() {
         assert(predictions[i] == expected_classes[i] && "KNN prediction does not match expected class.");
     }
 
+    // Fitting on a borrowed buffer must give the same answers without copying it
+    std::vector<double> flat;
+    for (const auto& row : X_train) {
+        flat.insert(flat.end(), row.begin(), row.end());
+    }
+    std::vector<double> flat_test = {1.0, 1.0, 8.0, 9.0, 0.0, 0.0};
+    KNNClassifier knn_view(3);
+    knn_view.fit_view(ml::MatrixView(std::span<const double>(flat), X_train.size(), 2), y_train);
+    std::vector<int> view_predictions = knn_view.predict(ml::MatrixView(std::span<const double>(flat_test), 3, 2));
+    assert(view_predictions == predictions && "Borrowed-data predictions differ from owned-data predictions.");
+
     // Inform user of successful test
     std::cout << "KNN Classifier Basic Test passed." << std::endl;
 
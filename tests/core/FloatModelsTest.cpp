@@ -0,0 +1,141 @@
+#include "../../ml_library_include/ml/clustering/KMeans.hpp"
+#include "../../ml_library_include/ml/clustering/KNNClassifier.hpp"
+#include "../../ml_library_include/ml/clustering/KNNRegressor.hpp"
+#include "../../ml_library_include/ml/regression/SupportVectorRegression.hpp"
+#include "../../ml_library_include/ml/neural_network/NeuralNetwork.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cmath>
+#include <stdexcept>
+#include <cassert>
+
+template <typename F>
+bool throws_runtime_error(F&& body) {
+    try {
+        body();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    const std::string path = "float_models_test_model.bin";
+
+    // Three well separated blobs
+    ml::Matrix X(60, 2);
+    std::vector<int> labels(X.rows());
+    std::vector<double> targets(X.rows());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        double offset = (i % 3) * 4.0;
+        X(i, 0) = offset + (i % 7) * 0.1;
+        X(i, 1) = offset - (i % 5) * 0.1;
+        labels[i] = static_cast<int>(i % 3);
+        targets[i] = offset + (i % 7) * 0.05;
+    }
+    ml::BasicMatrix<float> X_float(X.view(), ml::Layout::RowMajor);
+    std::vector<float> targets_float(targets.begin(), targets.end());
+
+    {
+        BasicKNNClassifier<float> model(5);
+        model.fit(X_float, labels);
+        KNNClassifier reference(5);
+        reference.fit(X, labels);
+        assert(model.predict(X_float) == reference.predict(X));
+
+        model.save(path);
+        BasicKNNClassifier<float> loaded;
+        loaded.load(path);
+        assert(loaded.predict(X_float) == model.predict(X_float));
+        // A model saved with one scalar type cannot be loaded as another
+        KNNClassifier wrong_type;
+        assert(throws_runtime_error([&] { wrong_type.load(path); }));
+        reference.save(path);
+        assert(throws_runtime_error([&] { loaded.load(path); }));
+    }
+    {
+        // Every sample is distinct, so with one neighbor the nearest is the sample itself and ties cannot differ
+        BasicKNNRegressor<float> model(1);
+        model.fit(X_float, targets_float);
+        KNNRegressor reference(1);
+        reference.fit(X, targets);
+        std::vector<float> predictions = model.predict(X_float);
+        std::vector<double> expected = reference.predict(X);
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            assert(std::abs(predictions[i] - expected[i]) < 1e-4);
+        }
+
+        model.save(path);
+        BasicKNNRegressor<float> loaded;
+        loaded.load(path);
+        assert(loaded.predict(X_float) == predictions);
+    }
+    {
+        BasicKMeans<float> model(3, 100, 1e-4, 7);
+        model.fit(X_float);
+        const ml::BasicMatrix<float>& centers = model.get_cluster_centers_matrix();
+        assert(centers.rows() == 3 && centers.cols() == 2);
+        std::vector<int> clusters = model.predict(X_float);
+        for (size_t i = 3; i < clusters.size(); ++i) {
+            assert(clusters[i] == clusters[i % 3]);
+        }
+        assert(clusters[0] != clusters[1] && clusters[1] != clusters[2] && clusters[0] != clusters[2]);
+
+        model.save(path);
+        BasicKMeans<float> loaded;
+        loaded.load(path);
+        assert(loaded.predict(X_float) == clusters);
+        KMeans wrong_type;
+        assert(throws_runtime_error([&] { wrong_type.load(path); }));
+    }
+    {
+        // A small one-dimensional problem keeps SMO well behaved
+        ml::Matrix X_svr(8, 1);
+        std::vector<double> svr_targets(X_svr.rows());
+        for (size_t i = 0; i < X_svr.rows(); ++i) {
+            X_svr(i, 0) = static_cast<double>(i) / X_svr.rows();
+            svr_targets[i] = X_svr(i, 0);
+        }
+        ml::BasicMatrix<float> X_svr_float(X_svr.view(), ml::Layout::RowMajor);
+        BasicSupportVectorRegression<float> model(1.0, 0.1);
+        model.fit(X_svr_float, std::vector<float>(svr_targets.begin(), svr_targets.end()));
+        std::vector<float> predictions = model.predict(X_svr_float);
+        for (float value : predictions) {
+            assert(std::isfinite(value));
+        }
+
+        model.save(path);
+        BasicSupportVectorRegression<float> loaded;
+        loaded.load(path);
+        assert(loaded.predict(X_svr_float) == predictions);
+    }
+    {
+        BasicNeuralNetwork<float> network({2, 4, 1});
+        for (int epoch = 0; epoch < 50; ++epoch) {
+            for (size_t i = 0; i < X_float.rows(); ++i) {
+                network.feedForward({X_float(i, 0) / 10.0f, X_float(i, 1) / 10.0f});
+                network.backProp({targets_float[i] / 10.0f});
+            }
+        }
+        std::vector<float> outputs(X_float.rows());
+        network.predictInto(X_float, outputs);
+        for (float value : outputs) {
+            assert(std::isfinite(value) && std::abs(value) <= 1.0f);
+        }
+
+        network.save(path);
+        BasicNeuralNetwork<float> loaded({1});
+        loaded.load(path);
+        std::vector<float> loaded_outputs(X_float.rows());
+        loaded.predictInto(X_float, loaded_outputs);
+        assert(loaded_outputs == outputs);
+        NeuralNetwork wrong_type({1});
+        assert(throws_runtime_error([&] { wrong_type.load(path); }));
+    }
+
+    std::remove(path.c_str());
+    std::cout << "Float Models Basic Test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "../../ml_library_include/ml/core/Kernels.hpp"
+#include "../../ml_library_include/ml/core/ThreadPool.hpp"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+
+bool close(double a, double b) {
+    return std::abs(a - b) <= 1e-9 * std::max(1.0, std::abs(b));
+}
+
+int main() {
+    std::vector<double> a(70);
+    std::vector<double> b(70);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = std::sin(0.7 * i) * 3.0;
+        b[i] = std::cos(0.3 * i) - 0.5;
+    }
+
+    std::cout << "Detected kernels: " << ml::kernels::isa_name(ml::kernels::detected_isa()) << std::endl;
+    assert(ml::kernels::active_isa() == ml::kernels::detected_isa());
+
+    ml::Matrix Y(37, 23);
+    for (size_t i = 0; i < Y.rows(); ++i) {
+        for (size_t j = 0; j < Y.cols(); ++j) {
+            Y(i, j) = 0.1 * i - 0.05 * j;
+        }
+    }
+    ml::ThreadPool pool(3);
+
+    std::vector<float> a_float(a.begin(), a.end());
+    std::vector<float> b_float(b.begin(), b.end());
+
+    // Every implementation this CPU supports agrees with a plain loop, for every tail length
+    for (ml::kernels::Isa isa : {ml::kernels::Isa::Scalar, ml::kernels::Isa::SSE2,
+                                 ml::kernels::Isa::AVX2, ml::kernels::Isa::AVX512}) {
+        if (isa > ml::kernels::detected_isa()) {
+            continue;
+        }
+        assert(ml::kernels::set_isa(isa) == isa);
+        for (size_t n = 0; n <= a.size(); ++n) {
+            double squared = 0.0, dot = 0.0, l1 = 0.0, aa = 0.0, bb = 0.0;
+            for (size_t i = 0; i < n; ++i) {
+                squared += (a[i] - b[i]) * (a[i] - b[i]);
+                dot += a[i] * b[i];
+                l1 += std::abs(a[i] - b[i]);
+                aa += a[i] * a[i];
+                bb += b[i] * b[i];
+            }
+            assert(close(ml::kernels::squared_l2(a.data(), b.data(), n), squared));
+            assert(close(ml::kernels::l2(a.data(), b.data(), n), std::sqrt(squared)));
+            assert(close(ml::kernels::dot(a.data(), b.data(), n), dot));
+            assert(close(ml::kernels::l1(a.data(), b.data(), n), l1));
+            double cosine = (aa == 0.0 || bb == 0.0) ? 1.0 : 1.0 - dot / std::sqrt(aa * bb);
+            assert(close(ml::kernels::cosine_distance(a.data(), b.data(), n), cosine));
+
+            // Single precision agrees to within float rounding
+            assert(std::abs(ml::kernels::squared_l2(a_float.data(), b_float.data(), n) - squared) <= 1e-4 * std::max(1.0, squared));
+            assert(std::abs(ml::kernels::dot(a_float.data(), b_float.data(), n) - dot) <= 1e-4 * std::max(1.0, std::abs(dot)));
+            assert(std::abs(ml::kernels::l1(a_float.data(), b_float.data(), n) - l1) <= 1e-4 * std::max(1.0, l1));
+            assert(std::abs(ml::kernels::cosine_distance(a_float.data(), b_float.data(), n) - cosine) <= 1e-4);
+        }
+
+        std::vector<double> distances(Y.rows());
+        std::vector<double> products(Y.rows());
+        ml::kernels::squared_l2_one_to_many(a.data(), Y, distances.data());
+        ml::kernels::dot_one_to_many(a.data(), Y, products.data());
+        ml::Matrix pairwise = ml::kernels::squared_l2_many_to_many(Y, Y, &pool);
+        ml::Matrix gram = ml::kernels::dot_many_to_many(Y, ml::Matrix(Y.view(), ml::Layout::ColMajor));
+        ml::BasicMatrix<float> Y_float(Y.view(), ml::Layout::RowMajor);
+        std::vector<float> distances_float(Y.rows());
+        ml::kernels::squared_l2_one_to_many(a_float.data(), Y_float, distances_float.data());
+        ml::BasicMatrix<float> pairwise_float = ml::kernels::squared_l2_many_to_many(Y_float, Y_float);
+        for (size_t r = 0; r < Y.rows(); ++r) {
+            double squared = 0.0, dot = 0.0;
+            for (size_t j = 0; j < Y.cols(); ++j) {
+                squared += (a[j] - Y(r, j)) * (a[j] - Y(r, j));
+                dot += a[j] * Y(r, j);
+            }
+            assert(close(distances[r], squared));
+            assert(close(products[r], dot));
+            assert(pairwise(r, r) == 0.0);
+            assert(close(pairwise(r, 3), ml::kernels::squared_l2(Y.row(r), Y.row(3), Y.cols())));
+            assert(close(gram(5, r), ml::kernels::dot(Y.row(5), Y.row(r), Y.cols())));
+            assert(std::abs(distances_float[r] - squared) <= 1e-4 * std::max(1.0, squared));
+            assert(std::abs(pairwise_float(r, 3) - pairwise(r, 3)) <= 1e-4 * std::max(1.0, pairwise(r, 3)));
+        }
+    }
+
+    // Requests wider than the CPU supports fall back to the detected kernels
+    assert(ml::kernels::set_isa(ml::kernels::Isa::AVX512) == ml::kernels::detected_isa());
+
+    std::cout << "Kernels Basic Test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "../../ml_library_include/ml/core/Matrix.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/clustering/KNNRegressor.hpp"
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <stdexcept>
+#include "../TestUtils.hpp"
+
+int main() {
+    // Packing nested rows produces one contiguous row-major block
+    std::vector<std::vector<double>> rows = {
+        {1.0, 2.0, 3.0},
+        {4.0, 5.0, 6.0}
+    };
+    ml::Matrix m(rows);
+    assert(m.rows() == 2 && m.cols() == 3);
+    assert(m.row(1) == m.data() + 3);
+    assert(m(1, 2) == 6.0);
+    assert(m.to_vectors() == rows);
+
+    // Ragged input is rejected
+    bool threw = false;
+    try {
+        ml::Matrix ragged(std::vector<std::vector<double>>{{1.0, 2.0}, {3.0}});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw && "Ragged rows should be rejected.");
+
+    // A column-major view over the same logical matrix
+    std::vector<double> col_major = {1.0, 4.0, 2.0, 5.0, 3.0, 6.0};
+    ml::MatrixView cv(col_major.data(), 2, 3, ml::Layout::ColMajor);
+    assert(!cv.is_row_contiguous());
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            assert(cv(i, j) == m(i, j));
+        }
+    }
+
+    // Packing a strided view only copies when rows are not contiguous
+    ml::Matrix storage;
+    ml::MatrixView packed = ml::as_row_major(cv, storage);
+    assert(packed.is_row_contiguous() && packed.row(1)[2] == 6.0);
+    assert(ml::as_row_major(m.view(), storage).data() == m.data());
+
+    // Row blocks share storage with the parent
+    ml::MatrixView block = m.view().row_block(1, 1);
+    assert(block.rows() == 1 && block(0, 0) == 4.0);
+
+    // Estimators accept dense matrices and agree with the nested-vector API
+    std::vector<std::vector<double>> X = {
+        {2.771244718, 1.784783929},
+        {1.728571309, 1.169761413},
+        {3.678319846, 2.81281357},
+        {7.497545867, 3.162953546},
+        {9.00220326,  3.339047188},
+        {7.444542326, 0.476683375}
+    };
+    std::vector<int> y = {0, 0, 0, 1, 1, 1};
+    ml::Matrix X_dense(X);
+    ml::Matrix X_col(X_dense.view(), ml::Layout::ColMajor);
+
+    DecisionTreeClassifier tree(5, 2);
+    tree.fit(X_col, y);
+    assert(tree.predict(X_dense) == y);
+    assert(tree.predict(X) == y);
+
+    KNNRegressor knn(1);
+    std::vector<double> targets = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0};
+    knn.fit(X_dense, targets);
+    std::vector<double> predictions = knn.predict(X_col);
+    for (size_t i = 0; i < predictions.size(); ++i) {
+        assert(approxEqual(predictions[i], targets[i], 1e-9));
+    }
+
+    std::cout << "Matrix Basic Test passed." << std::endl;
+    return 0;
+}
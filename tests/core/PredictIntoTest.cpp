@@ -0,0 +1,159 @@
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeRegressor.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+#include "../../ml_library_include/ml/clustering/KMeans.hpp"
+#include "../../ml_library_include/ml/clustering/KNNClassifier.hpp"
+#include "../../ml_library_include/ml/clustering/KNNRegressor.hpp"
+#include "../../ml_library_include/ml/regression/SupportVectorRegression.hpp"
+#include "../../ml_library_include/ml/regression/LogisticRegression.hpp"
+#include "../../ml_library_include/ml/regression/MultiLinearRegression.hpp"
+#include "../../ml_library_include/ml/regression/PolynomialRegression.hpp"
+#include "../../ml_library_include/ml/neural_network/NeuralNetwork.hpp"
+// Count every heap allocation so the tests can check that prediction makes none
+#define BENCH_COUNT_ALLOCATIONS
+#include "../../benchmarks/BenchmarkHarness.hpp"
+#include <iostream>
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+// Warms up per-thread buffers with one call, then returns the allocations made by a second call
+template <typename F>
+std::uint64_t allocations_after_warmup(F&& predict) {
+    predict();
+    std::uint64_t before = bench::allocation_counters().count.load();
+    predict();
+    return bench::allocation_counters().count.load() - before;
+}
+
+int main() {
+    // The counter sees array and over-aligned allocations as well; direct calls cannot be elided
+    std::uint64_t before = bench::allocation_counters().count.load();
+    ::operator delete[](::operator new[](16));
+    ::operator delete(::operator new(64, std::align_val_t{64}), std::align_val_t{64});
+    assert(bench::allocation_counters().count.load() - before == 2);
+
+    ml::Matrix X(60, 3);
+    std::vector<int> labels(X.rows());
+    std::vector<double> targets(X.rows());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        X(i, 0) = static_cast<double>(i % 10);
+        X(i, 1) = static_cast<double>(i % 7) * 0.5;
+        X(i, 2) = static_cast<double>(i) / 60.0;
+        labels[i] = X(i, 0) + X(i, 1) > 6.0 ? 1 : 0;
+        targets[i] = 2.0 * X(i, 0) - X(i, 1) + 0.5;
+    }
+    // Column-major input exercises the row gathering path
+    ml::Matrix X_col(X.view(), ml::Layout::ColMajor);
+    std::vector<int> label_out(X.rows());
+    std::vector<double> value_out(X.rows());
+
+    DecisionTreeClassifier tree_classifier(4);
+    tree_classifier.fit(X, labels);
+    assert(allocations_after_warmup([&] { tree_classifier.predict_into(X, label_out); }) == 0);
+    assert(label_out == tree_classifier.predict(X));
+
+    DecisionTreeRegressor tree_regressor(4);
+    tree_regressor.fit(X, targets);
+    assert(allocations_after_warmup([&] { tree_regressor.predict_into(X_col, value_out); }) == 0);
+    assert(value_out == tree_regressor.predict(X));
+
+    RandomForestClassifier forest_classifier(7, 4);
+    forest_classifier.fit(X, labels);
+    assert(allocations_after_warmup([&] { forest_classifier.predict_into(X, label_out); }) == 0);
+    assert(label_out == forest_classifier.predict(X));
+
+    RandomForestRegressor forest_regressor(7, 4);
+    forest_regressor.fit(X, targets);
+    assert(allocations_after_warmup([&] { forest_regressor.predict_into(X, value_out); }) == 0);
+    assert(value_out == forest_regressor.predict(X));
+
+    // Loaded forests predict from the mapped nodes, with no allocation either
+    const std::string path = "predict_into_test_model.bin";
+    forest_classifier.save(path);
+    RandomForestClassifier loaded_classifier;
+    loaded_classifier.load(path);
+    std::vector<int> loaded_label_out(X.rows());
+    assert(allocations_after_warmup([&] { loaded_classifier.predict_into(X, loaded_label_out); }) == 0);
+    assert(loaded_label_out == label_out);
+    forest_regressor.save(path);
+    RandomForestRegressor loaded_regressor;
+    loaded_regressor.load(path);
+    std::vector<double> loaded_value_out(X.rows());
+    assert(allocations_after_warmup([&] { loaded_regressor.predict_into(X_col, loaded_value_out); }) == 0);
+    assert(loaded_value_out == value_out);
+    std::remove(path.c_str());
+
+    KMeans kmeans(3, 50, 1e-4, 7);
+    kmeans.fit(X);
+    assert(allocations_after_warmup([&] { kmeans.predict_into(X_col, label_out); }) == 0);
+    assert(label_out == kmeans.predict(X));
+
+    KNNClassifier knn_classifier(5);
+    knn_classifier.fit(X, labels);
+    assert(allocations_after_warmup([&] { knn_classifier.predict_into(X_col, label_out); }) == 0);
+    assert(label_out == knn_classifier.predict(X));
+
+    KNNRegressor knn_regressor(5);
+    knn_regressor.fit(X, targets);
+    assert(allocations_after_warmup([&] { knn_regressor.predict_into(X, value_out); }) == 0);
+    assert(value_out == knn_regressor.predict(X));
+
+    // A small one-dimensional problem keeps SMO well behaved
+    SupportVectorRegression svr(1.0, 0.1, SupportVectorRegression::KernelType::RBF);
+    ml::Matrix X_svr(8, 1);
+    std::vector<double> svr_targets(X_svr.rows());
+    for (size_t i = 0; i < X_svr.rows(); ++i) {
+        X_svr(i, 0) = static_cast<double>(i) / X_svr.rows();
+        svr_targets[i] = X_svr(i, 0);
+    }
+    svr.fit(X_svr, svr_targets);
+    std::vector<double> svr_out(X_svr.rows());
+    assert(allocations_after_warmup([&] { svr.predict_into(X_svr, svr_out); }) == 0);
+    assert(svr_out == svr.predict(X_svr));
+
+    LogisticRegression logistic(0.1, 100);
+    logistic.train(X, labels);
+    assert(allocations_after_warmup([&] { logistic.predictInto(X_col, label_out); }) == 0);
+    assert(label_out == logistic.predict(X));
+
+    MultilinearRegression linear(0.01, 100);
+    linear.train(X, targets);
+    assert(allocations_after_warmup([&] { linear.predictInto(X, value_out); }) == 0);
+    assert(value_out == linear.predict(X));
+
+    PolynomialRegression polynomial(2);
+    std::vector<double> inputs(X.rows());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        inputs[i] = X(i, 0);
+    }
+    polynomial.train(inputs, targets);
+    assert(allocations_after_warmup([&] { polynomial.predictInto(inputs, value_out); }) == 0);
+    assert(value_out[3] == polynomial.predict(inputs[3]));
+
+    NeuralNetwork network({3, 4, 2});
+    std::vector<double> outputs(X.rows() * 2);
+    assert(allocations_after_warmup([&] { network.predictInto(X_col, outputs); }) == 0);
+    std::vector<double> results;
+    network.feedForward(std::vector<double>(X.row(5), X.row(5) + X.cols()));
+    network.getResults(results);
+    assert(results[0] == outputs[10] && results[1] == outputs[11]);
+
+    // Buffers of the wrong size are rejected
+    bool threw = false;
+    try {
+        std::vector<int> too_small(X.rows() - 1);
+        forest_classifier.predict_into(X, too_small);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Predict Into Basic Test passed." << std::endl;
+    return 0;
+}
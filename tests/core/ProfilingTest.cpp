@@ -0,0 +1,68 @@
+#include "../../ml_library_include/ml/core/Profiling.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/clustering/KMeans.hpp"
+#include "../../ml_library_include/ml/regression/SupportVectorRegression.hpp"
+#include "../../ml_library_include/ml/association/Apriori.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+
+int main() {
+    ml::profile::reset();
+
+    std::vector<std::vector<double>> X;
+    std::vector<int> labels;
+    std::vector<double> targets;
+    for (int i = 0; i < 40; ++i) {
+        double offset = (i % 2 == 0) ? 0.0 : 5.0;
+        X.push_back({offset + (i % 7) * 0.1, offset + (i % 5) * 0.1});
+        labels.push_back(i % 2);
+        targets.push_back(offset);
+    }
+
+    DecisionTreeClassifier tree(3);
+    tree.fit(X, labels);
+    tree.predict(ml::Matrix(X));
+
+    KMeans kmeans(2, 10, 1e-4, 1);
+    kmeans.fit(X);
+
+    SupportVectorRegression svr;
+    svr.fit(X, targets);
+
+    Apriori apriori(0.3);
+    apriori.run({{1, 2, 3}, {1, 2}, {2, 3}, {1, 2, 3}, {1, 3}});
+
+    // Counters were recorded at each instrumented hot path
+    assert(ml::profile::counter("DecisionTreeClassifier::split_evaluations").value > 0);
+    assert(ml::profile::counter("KMeans::distance_computations").value > 0);
+    assert(ml::profile::counter("KMeans::distance_computations").value % (X.size() * 2) == 0);
+    assert(ml::profile::counter("SupportVectorRegression::kernel_evaluations").value > 0);
+    assert(ml::profile::counter("Apriori::candidates_level_2").value == 3);
+    assert(ml::profile::timer("DecisionTreeClassifier::fit").calls == 1);
+    assert(ml::profile::timer("DecisionTreeClassifier::predict").calls == 1);
+    assert(ml::profile::timer("SupportVectorRegression::solve").calls == 1);
+
+    std::ostringstream report;
+    ml::profile::report(report);
+    assert(report.str().find("KMeans::assign_labels") != std::string::npos);
+    assert(report.str().find("Apriori::candidates") != std::string::npos);
+
+    std::ostringstream trace;
+    ml::profile::write_chrome_trace(trace);
+    assert(trace.str().rfind("{\"traceEvents\":[", 0) == 0);
+    assert(trace.str().find("\"ph\":\"X\"") != std::string::npos);
+    assert(trace.str().find("\"name\":\"Apriori::run\"") != std::string::npos);
+
+    // reset() zeroes everything but keeps the registered names usable
+    ml::profile::reset();
+    assert(ml::profile::counter("KMeans::distance_computations").value == 0);
+    assert(ml::profile::timer("Apriori::run").calls == 0);
+    kmeans.predict(X);
+    assert(ml::profile::counter("KMeans::distance_computations").value == X.size() * 2);
+
+    std::cout << "Profiling Basic Test passed." << std::endl;
+    return 0;
+}
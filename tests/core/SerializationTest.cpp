@@ -0,0 +1,311 @@
+#include "../../ml_library_include/ml/core/Serialization.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeRegressor.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+#include "../../ml_library_include/ml/tree/GradientBoostingClassifier.hpp"
+#include "../../ml_library_include/ml/tree/GradientBoostingRegressor.hpp"
+#include "../../ml_library_include/ml/clustering/KMeans.hpp"
+#include "../../ml_library_include/ml/clustering/KNNClassifier.hpp"
+#include "../../ml_library_include/ml/clustering/KNNRegressor.hpp"
+#include "../../ml_library_include/ml/clustering/HierarchicalClustering.hpp"
+#include "../../ml_library_include/ml/regression/SupportVectorRegression.hpp"
+#include "../../ml_library_include/ml/regression/LogisticRegression.hpp"
+#include "../../ml_library_include/ml/regression/MultiLinearRegression.hpp"
+#include "../../ml_library_include/ml/regression/PolynomialRegression.hpp"
+#include "../../ml_library_include/ml/neural_network/NeuralNetwork.hpp"
+#include "../../ml_library_include/ml/association/Apriori.hpp"
+#include "../../ml_library_include/ml/association/Eclat.hpp"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cmath>
+#include <cassert>
+
+template <typename F>
+bool throws_runtime_error(F&& body) {
+    try {
+        body();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+template <typename F>
+bool throws_invalid_argument(F&& body) {
+    try {
+        body();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    const std::string path = "serialization_test_model.bin";
+
+    std::vector<std::vector<double>> X;
+    std::vector<int> labels;
+    std::vector<double> targets;
+    for (int i = 0; i < 60; ++i) {
+        double offset = (i % 3) * 4.0;
+        X.push_back({offset + (i % 7) * 0.1, offset - (i % 5) * 0.1});
+        labels.push_back(i % 3);
+        targets.push_back(offset + (i % 7) * 0.05);
+    }
+    ml::Matrix X_matrix(X);
+    ml::Matrix narrow(X.size(), 1);  // Fewer features than the models are trained on
+
+    {
+        DecisionTreeClassifier model(4);
+        model.fit(X, labels);
+        model.save(path);
+        DecisionTreeClassifier loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+    }
+    {
+        DecisionTreeRegressor model(4);
+        model.fit(X, targets);
+        model.save(path);
+        DecisionTreeRegressor loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+    }
+    {
+        RandomForestClassifier model(5, 4);
+        model.fit(X, labels);
+        model.save(path);
+        RandomForestClassifier loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+    }
+    {
+        RandomForestRegressor model(5, 4);
+        model.fit(X, targets);
+        model.save(path);
+        RandomForestRegressor loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+    }
+    {
+        GradientBoostingClassifier model(10, 0.3, 3);
+        model.fit(X, labels);
+        model.save(path);
+        GradientBoostingClassifier loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+        ml::Matrix loaded_proba = loaded.predict_proba(X_matrix);
+        ml::Matrix proba = model.predict_proba(X_matrix);
+        for (size_t i = 0; i < proba.rows(); ++i) {
+            for (size_t k = 0; k < proba.cols(); ++k) {
+                assert(loaded_proba(i, k) == proba(i, k));
+            }
+        }
+    }
+    {
+        GradientBoostingRegressor model(10, 0.3, 3);
+        model.fit(X, targets);
+        model.save(path);
+        GradientBoostingRegressor loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+    }
+    {
+        KMeans model(3, 50, 1e-4, 7);
+        model.fit(X);
+        model.save(path);
+        KMeans loaded;
+        loaded.load(path);
+        assert(loaded.predict(X) == model.predict(X));
+        assert(loaded.get_cluster_centers() == model.get_cluster_centers());
+    }
+    {
+        KNNClassifier model(3);
+        model.fit(X, labels);
+        model.save(path);
+        KNNClassifier loaded;
+        loaded.load(path);
+        assert(loaded.predict(X_matrix) == model.predict(X_matrix));
+    }
+    {
+        KNNRegressor model(3);
+        model.fit(X, targets);
+        model.save(path);
+        KNNRegressor loaded;
+        loaded.load(path);
+        assert(loaded.predict(X_matrix) == model.predict(X_matrix));
+    }
+    {
+        HierarchicalClustering model(3);
+        model.fit(X);
+        model.save(path);
+        HierarchicalClustering loaded;
+        loaded.load(path);
+        assert(loaded.predict() == model.predict());
+        assert(loaded.get_cluster_centers() == model.get_cluster_centers());
+    }
+    {
+        std::vector<std::vector<double>> X_scaled = {{0.0}, {0.25}, {0.5}, {0.75}, {1.0}};
+        SupportVectorRegression model(1.0, 0.1, SupportVectorRegression::KernelType::RBF);
+        model.fit(X_scaled, {0.0, 0.25, 0.5, 0.75, 1.0});
+        model.save(path);
+        SupportVectorRegression loaded;
+        loaded.load(path);
+        std::vector<double> predictions = loaded.predict(X_scaled);
+        assert(!std::isnan(predictions[2]));
+        assert(predictions == model.predict(X_scaled));
+    }
+    {
+        std::vector<int> binary_labels;
+        for (int label : labels) {
+            binary_labels.push_back(label == 0 ? 0 : 1);
+        }
+        LogisticRegression model(0.1, 200);
+        model.train(X, binary_labels);
+        model.save(path);
+        LogisticRegression loaded;
+        loaded.load(path);
+        assert(loaded.predictProbability(X[5]) == model.predictProbability(X[5]));
+    }
+    {
+        MultilinearRegression model(0.01, 200);
+        model.train(X, targets);
+        model.save(path);
+        MultilinearRegression loaded;
+        loaded.load(path);
+        assert(loaded.getWeights() == model.getWeights());
+        assert(loaded.predict(X[3]) == model.predict(X[3]));
+    }
+    {
+        PolynomialRegression model(2);
+        model.train({0.0, 1.0, 2.0, 3.0}, {1.0, 2.0, 5.0, 10.0});
+        model.save(path);
+        PolynomialRegression loaded(1);
+        loaded.load(path);
+        assert(loaded.getCoefficients() == model.getCoefficients());
+    }
+    {
+        NeuralNetwork model({2, 3, 1});
+        for (int i = 0; i < 20; ++i) {
+            model.feedForward({1.0, 0.0});
+            model.backProp({1.0});
+        }
+        model.save(path);
+        NeuralNetwork loaded({1, 1});
+        loaded.load(path);
+        std::vector<double> expected;
+        std::vector<double> actual;
+        model.feedForward({0.0, 1.0});
+        model.getResults(expected);
+        loaded.feedForward({0.0, 1.0});
+        loaded.getResults(actual);
+        assert(actual == expected);
+    }
+
+    std::vector<std::vector<int>> transactions = {{1, 2, 3}, {1, 2}, {2, 3}, {1, 2, 3}, {1, 3}};
+    {
+        Apriori model(0.4);
+        model.run(transactions);
+        model.save(path);
+        Apriori loaded(1.0);
+        loaded.load(path);
+        assert(loaded.get_support_counts() == model.get_support_counts());
+    }
+    {
+        Eclat model(0.4);
+        model.run(transactions);
+        model.save(path);
+        Eclat loaded(1.0);
+        loaded.load(path);
+        assert(loaded.get_support_counts() == model.get_support_counts());
+    }
+
+    // Loading a file written by another estimator fails and leaves the target untouched
+    KMeans kmeans(3, 50, 1e-4, 7);
+    kmeans.fit(X);
+    std::vector<int> kmeans_labels = kmeans.predict(X);
+    assert(throws_runtime_error([&] { kmeans.load(path); }));
+    assert(kmeans.predict(X) == kmeans_labels);
+
+    // Truncated files are rejected instead of read past their end
+    DecisionTreeClassifier tree(4);
+    tree.fit(X, labels);
+    tree.save(path);
+    std::string contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    for (size_t length : {size_t(0), size_t(10), size_t(24), contents.size() - 8}) {
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), static_cast<std::streamsize>(length));
+        }
+        DecisionTreeClassifier loaded;
+        assert(throws_runtime_error([&] { loaded.load(path); }));
+    }
+
+    // Gradient boosting files with fewer than two labels are rejected
+    for (std::vector<int> file_labels : {std::vector<int>{}, std::vector<int>{4}}) {
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            ml::BinaryWriter writer(out, ml::ModelType::GradientBoostingClassifier, 1);
+            writer.write_int(10);
+            writer.write_double(0.1);
+            writer.write_int(3);
+            writer.write_int(2);
+            writer.write_int(-1);
+            writer.write_array(file_labels);
+            writer.write_array(std::vector<double>(file_labels.size(), 0.0));
+            writer.write_int(0);
+            writer.finish();
+        }
+        GradientBoostingClassifier loaded;
+        assert(throws_runtime_error([&] { loaded.load(path); }));
+    }
+
+    // Tree files record the feature count and reject trees that test a feature beyond it; version 1
+    // files, which do not record it, take the widest feature their trees test
+    const ml::TreeNodeRecord split_on_second[] = {{1, 1, 100.0}, {-1, 0, 1.0}, {-1, 0, 2.0}};
+    for (uint32_t version : {1u, 2u}) {
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            ml::BinaryWriter writer(out, ml::ModelType::DecisionTreeRegressor, version);
+            writer.write_int(4);
+            writer.write_int(2);
+            if (version >= 2) {
+                writer.write_int(1);
+            }
+            writer.write_array(std::span<const ml::TreeNodeRecord>(split_on_second));
+            writer.finish();
+        }
+        DecisionTreeRegressor loaded;
+        if (version >= 2) {
+            assert(throws_runtime_error([&] { loaded.load(path); }));
+            continue;
+        }
+        loaded.load(path);
+        assert(loaded.predict(X_matrix) == std::vector<double>(X.size(), 1.0));
+        assert(throws_invalid_argument([&] { loaded.predict(narrow); }));
+    }
+
+    // Missing files are reported as errors
+    std::remove(path.c_str());
+    DecisionTreeRegressor missing;
+    assert(throws_runtime_error([&] { missing.load(path); }));
+
+    std::cout << "Serialization Basic Test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "../../ml_library_include/ml/core/ThreadPool.hpp"
+#include "../../ml_library_include/ml/association/Apriori.hpp"
+#include "../../ml_library_include/ml/clustering/KNNClassifier.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <cassert>
+
+int main() {
+    ml::ThreadPool pool(4);
+    assert(pool.size() == 4);
+
+    // Every index is visited exactly once
+    std::vector<int> visits(10000, 0);
+    ml::parallel_for(&pool, 0, visits.size(), [&](size_t i) { visits[i]++; });
+    for (int v : visits) {
+        assert(v == 1 && "parallel_for must visit each index once.");
+    }
+
+    // Nested parallel loops inside pool tasks must not deadlock
+    std::atomic<long> total{0};
+    ml::parallel_for(&pool, 0, 16, [&](size_t) {
+        ml::parallel_for(&pool, 0, 100, [&](size_t j) { total += static_cast<long>(j); });
+    });
+    assert(total == 16 * 4950 && "Nested parallel_for produced a wrong result.");
+
+    // Exceptions thrown by tasks reach the caller
+    bool threw = false;
+    try {
+        ml::parallel_for(&pool, 0, 100, [](size_t i) {
+            if (i == 57) {
+                throw std::runtime_error("task failure");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw && "Task exception was not propagated.");
+
+    // Estimators give the same answers with and without a pool
+    std::vector<std::vector<int>> transactions = {
+        {1, 2, 5}, {2, 4}, {2, 3}, {1, 2, 4}, {1, 3}, {2, 3}, {1, 3}, {1, 2, 3, 5}, {1, 2, 3}
+    };
+    Apriori serial(0.22);
+    auto expected_itemsets = serial.run(transactions);
+    Apriori parallel(0.22);
+    parallel.set_thread_pool(&pool);
+    assert(parallel.run(transactions) == expected_itemsets);
+    assert(parallel.get_support_counts() == serial.get_support_counts());
+
+    std::vector<std::vector<double>> X;
+    std::vector<int> y;
+    for (int i = 0; i < 200; ++i) {
+        double offset = (i % 2 == 0) ? 0.0 : 10.0;
+        X.push_back({offset + (i % 7) * 0.1, offset + (i % 5) * 0.1});
+        y.push_back(i % 2);
+    }
+
+    KNNClassifier knn(3);
+    knn.fit(X, y);
+    std::vector<int> knn_serial = knn.predict(X);
+    knn.set_thread_pool(&pool);
+    assert(knn.predict(X) == knn_serial);
+
+    RandomForestClassifier forest(16, 4, 2);
+    forest.set_thread_pool(&pool);
+    forest.fit(X, y);
+    assert(forest.predict(X) == y);
+
+    std::cout << "ThreadPool Basic Test passed." << std::endl;
+    return 0;
+}
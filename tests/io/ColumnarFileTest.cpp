@@ -0,0 +1,68 @@
+#include "../../ml_library_include/ml/io/ColumnarFile.hpp"
+#include "../../ml_library_include/ml/core/ThreadPool.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdio>
+#include <cassert>
+
+int main() {
+    const std::string path = "columnar_test_data.col";
+
+    ml::Matrix X(2500, 4);
+    for (std::size_t i = 0; i < X.rows(); ++i) {
+        for (std::size_t j = 0; j < X.cols(); ++j) {
+            X(i, j) = static_cast<double>(i) * 10.0 + static_cast<double>(j);
+        }
+    }
+    ml::io::write_columnar(path, X);
+
+    // The file is viewed in place as a column-major matrix
+    ml::io::ColumnarFile file = ml::io::ColumnarFile::open(path);
+    assert(file.rows() == X.rows() && file.cols() == X.cols());
+    assert(file.view()(1234, 3) == X(1234, 3));
+    assert(file.column(2)[7] == X(7, 2));
+
+    ml::ThreadPool pool(4);
+    assert(file.to_matrix(&pool).to_vectors() == X.to_vectors());
+    assert(ml::io::read_columnar(path).to_vectors() == X.to_vectors());
+
+    // Column-major input is written column by column without reordering
+    ml::Matrix X_col(X.view(), ml::Layout::ColMajor);
+    ml::io::write_columnar(path, X_col);
+    assert(ml::io::read_columnar(path, &pool).to_vectors() == X.to_vectors());
+
+    ml::io::ColumnarBatchReader reader(path, 1000, &pool);
+    ml::Matrix batch;
+    std::size_t batches = 0;
+    while (reader.next(batch)) {
+        std::size_t first = reader.rows_read() - batch.rows();
+        assert(batch(0, 1) == X(first, 1));
+        assert(batch(batch.rows() - 1, 3) == X(first + batch.rows() - 1, 3));
+        ++batches;
+    }
+    assert(batches == 3 && reader.rows_read() == X.rows());
+
+    // Truncated files are rejected
+    {
+        std::ofstream truncated(path, std::ios::binary | std::ios::trunc);
+        truncated.write(reinterpret_cast<const char*>(ml::io::columnar_file_magic), 8);
+        std::uint32_t header_words[2] = {ml::io::columnar_format_version, ml::model_byte_order_mark};
+        std::uint64_t shape[2] = {100, 2};
+        truncated.write(reinterpret_cast<const char*>(header_words), sizeof(header_words));
+        truncated.write(reinterpret_cast<const char*>(shape), sizeof(shape));
+    }
+    bool threw = false;
+    try {
+        ml::io::ColumnarFile::open(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    std::remove(path.c_str());
+
+    std::cout << "Columnar File Basic Test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "../../ml_library_include/ml/io/Csv.hpp"
+#include "../../ml_library_include/ml/core/ThreadPool.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdio>
+#include <cmath>
+#include <cassert>
+
+int main() {
+    // Header, quoting, whitespace, CRLF line endings, blank lines and empty fields
+    std::string text = "x, \"y\" ,z\r\n1.5,2,-3e2\r\n\r\n  4 , \"5\" ,\r\n+6,7.25,8";
+    ml::io::CsvOptions options;
+    options.has_header = true;
+    std::vector<std::string> header;
+    ml::Matrix small = ml::io::parse_csv(text, options, &header);
+    assert((header == std::vector<std::string>{"x", "y", "z"}));
+    assert(small.rows() == 3 && small.cols() == 3);
+    assert(small(0, 0) == 1.5 && small(0, 2) == -300.0);
+    assert(small(1, 1) == 5.0 && std::isnan(small(1, 2)));
+    assert(small(2, 0) == 6.0 && small(2, 1) == 7.25 && small(2, 2) == 8.0);
+
+    // Malformed rows are reported instead of silently padded
+    bool threw = false;
+    try {
+        ml::io::parse_csv("1,2\n3\n");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        ml::io::parse_csv("1,2\n3,abc\n");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(ml::io::parse_csv("").empty());
+
+    // Small chunks on a pool give the same matrix as a single serial pass
+    std::ostringstream generated;
+    generated.precision(17);
+    for (int i = 0; i < 1000; ++i) {
+        generated << i << ';' << i * 0.1 << ';' << -i / 3.0 << '\n';
+    }
+    ml::io::CsvOptions serial;
+    serial.delimiter = ';';
+    ml::Matrix expected = ml::io::parse_csv(generated.str(), serial);
+    assert(expected.rows() == 1000 && expected.cols() == 3);
+    assert(expected(999, 0) == 999.0 && expected(10, 1) == 10 * 0.1 && expected(7, 2) == -7 / 3.0);
+
+    ml::ThreadPool pool(4);
+    ml::io::CsvOptions parallel = serial;
+    parallel.chunk_bytes = 128;
+    parallel.pool = &pool;
+    ml::Matrix actual = ml::io::parse_csv(generated.str(), parallel);
+    assert(actual.to_vectors() == expected.to_vectors());
+
+    // Files are read whole or in batches
+    const std::string path = "csv_test_data.csv";
+    {
+        std::ofstream file(path);
+        file << "a;b;c\n" << generated.str();
+    }
+    parallel.has_header = true;
+    assert(ml::io::read_csv(path, parallel).to_vectors() == expected.to_vectors());
+
+    ml::io::CsvBatchReader reader(path, 300, parallel);
+    assert((reader.header() == std::vector<std::string>{"a", "b", "c"}));
+    ml::Matrix batch;
+    std::vector<std::size_t> batch_sizes;
+    while (reader.next(batch)) {
+        for (std::size_t i = 0; i < batch.rows(); ++i) {
+            std::size_t row = reader.rows_read() - batch.rows() + i;
+            for (std::size_t j = 0; j < batch.cols(); ++j) {
+                assert(batch(i, j) == expected(row, j));
+            }
+        }
+        batch_sizes.push_back(batch.rows());
+    }
+    assert((batch_sizes == std::vector<std::size_t>{300, 300, 300, 100}));
+    std::remove(path.c_str());
+
+    std::cout << "CSV Basic Test passed." << std::endl;
+    return 0;
+}
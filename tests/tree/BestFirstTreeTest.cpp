@@ -0,0 +1,146 @@
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeRegressor.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+#include <iostream>
+#include <vector>
+#include <set>
+#include <cmath>
+#include <stdexcept>
+#include <cassert>
+
+// Number of leaves a regression tree reaches on X, assuming they all predict different values
+static size_t distinct(const std::vector<double>& predictions) {
+    return std::set<double>(predictions.begin(), predictions.end()).size();
+}
+
+static double squared_error(const std::vector<double>& predictions, const std::vector<double>& y) {
+    double error = 0.0;
+    for (size_t i = 0; i < y.size(); ++i) {
+        error += (predictions[i] - y[i]) * (predictions[i] - y[i]);
+    }
+    return error / y.size();
+}
+
+int main() {
+    ml::Matrix X(1500, 3);
+    std::vector<double> targets(X.rows());
+    std::vector<int> labels(X.rows());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        X(i, 0) = static_cast<double>((i * 37) % 101);
+        X(i, 1) = std::sin(static_cast<double>(i)) * 10.0;
+        X(i, 2) = static_cast<double>(i % 7);
+        targets[i] = std::sqrt(X(i, 0)) + (X(i, 1) > 3.0 ? 4.0 : 0.0) + 0.1 * X(i, 2);
+        labels[i] = (X(i, 0) > 40 ? 1 : 0) + (X(i, 1) > 3.0 ? 2 : 0);
+    }
+
+    for (int bins : {0, 64}) {
+        // Without a leaf limit, best-first growth makes the same splits as depth-first growth
+        DecisionTreeRegressor depth_first(6, 2);
+        depth_first.set_max_bins(bins);
+        depth_first.fit(X, targets);
+        DecisionTreeRegressor best_first(6, 2);
+        best_first.set_max_bins(bins);
+        best_first.set_max_leaf_nodes(1000);
+        best_first.fit(X, targets);
+        assert(best_first.predict(X) == depth_first.predict(X));
+
+        // The leaf limit bounds the tree, and each extra leaf lowers the training error
+        double previous_error = squared_error(depth_first.predict(X), targets);
+        for (int max_leaf_nodes : {24, 12, 6, 2}) {
+            DecisionTreeRegressor model(6, 2);
+            model.set_max_bins(bins);
+            model.set_max_leaf_nodes(max_leaf_nodes);
+            model.fit(X, targets);
+            std::vector<double> predictions = model.predict(X);
+            assert(distinct(predictions) == static_cast<size_t>(max_leaf_nodes));
+            double error = squared_error(predictions, targets);
+            assert(error >= previous_error);
+            previous_error = error;
+        }
+
+        // A stump is the best single split either way
+        DecisionTreeRegressor stump(1, 2);
+        stump.set_max_bins(bins);
+        stump.fit(X, targets);
+        DecisionTreeRegressor two_leaves(6, 2);
+        two_leaves.set_max_bins(bins);
+        two_leaves.set_max_leaf_nodes(2);
+        two_leaves.fit(X, targets);
+        assert(two_leaves.predict(X) == stump.predict(X));
+
+        // A large minimum decrease keeps the root a leaf, a small one only prunes weak splits
+        DecisionTreeRegressor constant(6, 2);
+        constant.set_max_bins(bins);
+        constant.set_min_impurity_decrease(1e6);
+        constant.fit(X, targets);
+        assert(distinct(constant.predict(X)) == 1);
+        DecisionTreeRegressor pruned(6, 2);
+        pruned.set_max_bins(bins);
+        pruned.set_min_impurity_decrease(0.01);
+        pruned.fit(X, targets);
+        size_t pruned_leaves = distinct(pruned.predict(X));
+        assert(pruned_leaves > 1 && pruned_leaves < distinct(depth_first.predict(X)));
+
+        DecisionTreeClassifier classifier(6, 2);
+        classifier.set_max_bins(bins);
+        classifier.fit(X, labels);
+        DecisionTreeClassifier best_first_classifier(6, 2);
+        best_first_classifier.set_max_bins(bins);
+        best_first_classifier.set_max_leaf_nodes(1000);
+        best_first_classifier.fit(X, labels);
+        assert(best_first_classifier.predict(X) == classifier.predict(X));
+        // Four leaves are about enough for the four classes
+        DecisionTreeClassifier four_leaves(6, 2);
+        four_leaves.set_max_bins(bins);
+        four_leaves.set_max_leaf_nodes(4);
+        four_leaves.fit(X, labels);
+        std::vector<int> predictions = four_leaves.predict(X);
+        size_t correct = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            correct += predictions[i] == labels[i];
+        }
+        assert(correct > X.rows() * 95 / 100);
+    }
+
+    // Forests pass the limits on to their trees
+    for (int bins : {0, 64}) {
+        RandomForestRegressor forest(10, 8, 2, 2, 5);
+        forest.set_max_bins(bins);
+        forest.set_max_leaf_nodes(16);
+        forest.set_min_impurity_decrease(1e-4);
+        forest.fit(X, targets);
+        assert(squared_error(forest.predict(X), targets) < 0.5);
+
+        RandomForestClassifier classifier(10, 8, 2, 2, 5);
+        classifier.set_max_bins(bins);
+        classifier.set_max_leaf_nodes(8);
+        classifier.fit(X, labels);
+        std::vector<int> predictions = classifier.predict(X);
+        size_t correct = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            correct += predictions[i] == labels[i];
+        }
+        assert(correct > X.rows() * 95 / 100);
+    }
+
+    bool threw = false;
+    try {
+        DecisionTreeRegressor model;
+        model.set_max_leaf_nodes(1);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        RandomForestClassifier model;
+        model.set_min_impurity_decrease(-1.0);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Best-First Tree Basic Test passed." << std::endl;
+    return 0;
+}
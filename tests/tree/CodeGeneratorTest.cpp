@@ -0,0 +1,125 @@
+#include "../../ml_library_include/ml/tree/CodeGenerator.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <cstdlib>
+#include <stdexcept>
+#include <cassert>
+
+static bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+template <typename Function>
+static bool throws_invalid_argument(Function function) {
+    try {
+        function();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    // x[1] <= 0.1 ? 2.5 : (x[0] <= 3 ? -1 : 1e300)
+    std::vector<ml::TreeNodeRecord> records = {
+        {1, 1, 0.1}, {-1, 0, 2.5}, {0, 3, 3.0}, {-1, 0, -1.0}, {-1, 0, 1e300}};
+    ml::tree::FlatTree tree(records);
+    const ml::tree::FlatTree* trees[] = {&tree};
+
+    std::ostringstream branches;
+    ml::tree::write_cpp_model(branches, "model", trees, {}, ml::tree::CodeStyle::Branches);
+    std::string code = branches.str();
+    assert(contains(code, "#ifndef ML_GENERATED_MODEL_HPP"));
+    assert(contains(code, "namespace model {"));
+    assert(contains(code, "inline double tree_0(const double* x) {\n"
+                          "    if (x[1] <= 0.1) {\n"
+                          "        return 2.5;\n"
+                          "    } else {\n"
+                          "        if (x[0] <= 3.0) {\n"
+                          "            return -1.0;\n"
+                          "        } else {\n"
+                          "            return 1e+300;\n"));
+    assert(contains(code, "    sum += tree_0(x);\n    return sum / 1.0;\n"));
+
+    // Literals read back as the same doubles
+    for (double value : {0.1, 1.0 / 3.0, -2.2250738585072014e-308, 123456789.125, 5e-324}) {
+        std::string literal = ml::tree::detail::double_literal(value);
+        assert(std::strtod(literal.c_str(), nullptr) == value);
+    }
+
+    // Classifier leaves become positions in the class list
+    std::vector<ml::TreeNodeRecord> label_records = {{0, 1, 0.5}, {-1, 0, 7.0}, {-1, 0, -3.0}};
+    ml::tree::FlatTree classifier_tree(label_records);
+    const ml::tree::FlatTree* classifier_trees[] = {&classifier_tree, &classifier_tree};
+    std::vector<int> labels = ml::tree::leaf_labels(classifier_trees);
+    assert((labels == std::vector<int>{-3, 7}));
+    std::ostringstream tables;
+    ml::tree::write_cpp_model(tables, "votes", classifier_trees, labels, ml::tree::CodeStyle::Tables);
+    code = tables.str();
+    assert(contains(code, "inline constexpr Node tree_1_nodes[] = {\n"
+                          "    {0, 1u, 0.5},\n"
+                          "    {-1, 0u, 1},\n"
+                          "    {-1, 0u, 0},\n"));
+    assert(contains(code, "inline constexpr int classes[] = {-3, 7};"));
+    assert(contains(code, "    ++votes[tree_1(x)];\n"));
+
+    // Bad input
+    std::ostringstream sink;
+    assert(throws_invalid_argument([&] {
+        ml::tree::write_cpp_model(sink, "2fast", trees, {}, ml::tree::CodeStyle::Branches);
+    }));
+    assert(throws_invalid_argument([&] {
+        ml::tree::write_cpp_model(sink, "missing_label", trees, labels, ml::tree::CodeStyle::Branches);
+    }));
+    ml::tree::FlatTree empty;
+    const ml::tree::FlatTree* empty_trees[] = {&empty};
+    assert(throws_invalid_argument([&] {
+        ml::tree::write_cpp_model(sink, "unfitted", empty_trees, {}, ml::tree::CodeStyle::Tables);
+    }));
+
+    // Estimators export a header per fitted model
+    std::vector<std::vector<double>> X;
+    std::vector<double> y;
+    std::vector<int> classes;
+    for (int i = 0; i < 200; ++i) {
+        X.push_back({static_cast<double>(i % 17), static_cast<double>(i % 5)});
+        y.push_back(X.back()[0] * 0.5 + X.back()[1]);
+        classes.push_back(i % 17 > 8 ? 4 : 2);
+    }
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    RandomForestRegressor forest(5, 4, 2, -1, 3);
+    forest.fit(X, y);
+    std::string forest_path = (directory / "ml_codegen_forest.hpp").string();
+    forest.export_cpp(forest_path, "forest", ml::tree::CodeStyle::Tables);
+    std::ifstream forest_file(forest_path);
+    std::string forest_code((std::istreambuf_iterator<char>(forest_file)), std::istreambuf_iterator<char>());
+    assert(contains(forest_code, "inline constexpr std::size_t n_trees = 5;"));
+    assert(contains(forest_code, "return sum / 5.0;"));
+    std::filesystem::remove(forest_path);
+
+    DecisionTreeClassifier classifier(3, 2);
+    assert(throws_invalid_argument([&] { classifier.export_cpp(forest_path, "unfitted"); }));
+    classifier.fit(X, classes);
+    std::string classifier_path = (directory / "ml_codegen_classifier.hpp").string();
+    classifier.export_cpp(classifier_path, "classifier");
+    std::ifstream classifier_file(classifier_path);
+    std::string classifier_code((std::istreambuf_iterator<char>(classifier_file)), std::istreambuf_iterator<char>());
+    assert(contains(classifier_code, "inline constexpr int classes[] = {2, 4};"));
+    std::filesystem::remove(classifier_path);
+
+    bool failed = false;
+    try {
+        classifier.export_cpp((directory / "missing_directory" / "model.hpp").string(), "classifier");
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    assert(failed);
+
+    std::cout << "Code Generator Basic Test passed." << std::endl;
+    return 0;
+}
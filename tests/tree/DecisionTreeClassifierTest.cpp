@@ -33,6 +33,36 @@ int main() {
         assert(predictions[i] == y[i] && "Prediction does not match expected class.");
     }
 
+    // Thousands of rows with sparse, negative labels on axis-aligned regions are learned exactly
+    ml::Matrix X_large(5000, 3);
+    std::vector<int> y_large(X_large.rows());
+    for (size_t i = 0; i < X_large.rows(); ++i) {
+        X_large(i, 0) = static_cast<double>((i * 7919) % 1000) / 100.0;
+        X_large(i, 1) = static_cast<double>((i * 104729) % 997) / 100.0;
+        X_large(i, 2) = static_cast<double>(i % 3);
+        y_large[i] = X_large(i, 0) < 4.0 ? -3 : (X_large(i, 1) < 5.0 ? 7 : 42);
+    }
+    DecisionTreeClassifier large_model(4, 2);
+    large_model.fit(X_large, y_large);
+    assert(large_model.predict(X_large) == y_large);
+
+    // On a thread pool, nodes above the parallel cutoff give the same tree as on one thread
+    ml::Matrix X_noisy(20000, 4);
+    std::vector<int> y_noisy(X_noisy.rows());
+    for (size_t i = 0; i < X_noisy.rows(); ++i) {
+        for (size_t j = 0; j < X_noisy.cols(); ++j) {
+            X_noisy(i, j) = static_cast<double>((i * (7919 + j * 104729)) % 1009);
+        }
+        y_noisy[i] = static_cast<int>((i * 31) % 5);
+    }
+    DecisionTreeClassifier serial_model(8, 2);
+    serial_model.fit(X_noisy, y_noisy);
+    ml::ThreadPool pool(4);
+    DecisionTreeClassifier parallel_model(8, 2);
+    parallel_model.set_thread_pool(&pool);
+    parallel_model.fit(X_noisy, y_noisy);
+    assert(parallel_model.predict(X_noisy) == serial_model.predict(X_noisy));
+
     // Inform user of successful test
     std::cout << "Decision Tree Classification Basic Test passed." << std::endl;
 
@@ -27,6 +27,43 @@ int main() {
         assert(approxEqual(predictions[i], y[i], 0.1) && "Prediction does not match expected value.");
     }
 
+    // On a thread pool, histogram training gives the same tree as on one thread
+    ml::Matrix X_large(20000, 4);
+    std::vector<double> y_large(X_large.rows());
+    for (size_t i = 0; i < X_large.rows(); ++i) {
+        for (size_t j = 0; j < X_large.cols(); ++j) {
+            X_large(i, j) = static_cast<double>((i * (7919 + j * 104729)) % 1009);
+        }
+        y_large[i] = static_cast<double>((i * 31) % 17) + X_large(i, 0) / 100.0;
+    }
+    DecisionTreeRegressor serial_model(8, 2);
+    serial_model.set_max_bins(64);
+    serial_model.fit(X_large, y_large);
+    ml::ThreadPool pool(4);
+    DecisionTreeRegressor parallel_model(8, 2);
+    parallel_model.set_max_bins(64);
+    parallel_model.set_thread_pool(&pool);
+    parallel_model.fit(X_large, y_large);
+    assert(parallel_model.predict(X_large) == serial_model.predict(X_large));
+
+    // Exact splits are found from centred running sums, so a large offset of the targets picks the same splits
+    // (on targets without tied splits, which rounding could otherwise break either way)
+    std::vector<double> y_smooth(X_large.rows()), y_offset(X_large.rows());
+    for (size_t i = 0; i < X_large.rows(); ++i) {
+        y_smooth[i] = std::sqrt(X_large(i, 0)) + std::sqrt(2.0 * X_large(i, 1));
+        y_offset[i] = y_smooth[i] + 1e9;
+    }
+    DecisionTreeRegressor exact_model(8, 2);
+    exact_model.fit(X_large, y_smooth);
+    DecisionTreeRegressor offset_model(8, 2);
+    offset_model.set_thread_pool(&pool);
+    offset_model.fit(X_large, y_offset);
+    std::vector<double> exact_predictions = exact_model.predict(X_large);
+    std::vector<double> offset_predictions = offset_model.predict(X_large);
+    for (size_t i = 0; i < exact_predictions.size(); ++i) {
+        assert(std::fabs(offset_predictions[i] - 1e9 - exact_predictions[i]) < 1e-4);
+    }
+
     // Inform user of successful test
     std::cout << "Decision Tree Regression Basic Test passed." << std::endl;
 
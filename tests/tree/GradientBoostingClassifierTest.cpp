@@ -0,0 +1,148 @@
+#include "../../ml_library_include/ml/tree/GradientBoostingClassifier.hpp"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <cassert>
+
+static double accuracy(const std::vector<int>& predictions, const std::vector<int>& y) {
+    size_t correct = 0;
+    for (size_t i = 0; i < y.size(); ++i) {
+        correct += predictions[i] == y[i];
+    }
+    return static_cast<double>(correct) / y.size();
+}
+
+int main() {
+    // Three classes arranged around a circle, with non-contiguous labels
+    auto make_data = [](size_t n, size_t offset, ml::Matrix& X, std::vector<int>& y) {
+        const int labels[3] = {-4, 2, 9};
+        X = ml::Matrix(n, 3);
+        y.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            size_t k = i + offset;
+            double angle = static_cast<double>((k * 53) % 360) * 3.14159265358979 / 180.0;
+            double radius = 1.0 + static_cast<double>(k % 10) / 10.0;
+            X(i, 0) = radius * std::cos(angle);
+            X(i, 1) = radius * std::sin(angle);
+            X(i, 2) = static_cast<double>(k % 5);
+            y[i] = labels[static_cast<int>(angle / (2.0 * 3.14159265358979 / 3.0)) % 3];
+        }
+    };
+    ml::Matrix X, X_valid;
+    std::vector<int> y, y_valid;
+    make_data(900, 0, X, y);
+    make_data(300, 7000, X_valid, y_valid);
+
+    GradientBoostingClassifier model(60, 0.2, 3, 2, -1, 4);
+    model.fit(X, y);
+    std::vector<int> predictions = model.predict(X_valid);
+    double multiclass_accuracy = accuracy(predictions, y_valid);
+    std::cout << "Three-class accuracy: " << multiclass_accuracy * 100 << "%" << std::endl;
+    assert(multiclass_accuracy >= 0.95);
+    assert(model.n_rounds() == 60);
+
+    // Probabilities sum to one and their largest entry is the predicted class
+    ml::Matrix proba = model.predict_proba(X_valid);
+    const int labels[3] = {-4, 2, 9};
+    for (size_t i = 0; i < proba.rows(); ++i) {
+        double total = proba(i, 0) + proba(i, 1) + proba(i, 2);
+        assert(std::abs(total - 1.0) < 1e-12);
+        size_t best = 0;
+        for (size_t k = 1; k < 3; ++k) {
+            best = proba(i, k) > proba(i, best) ? k : best;
+        }
+        assert(labels[best] == predictions[i]);
+    }
+
+    // Two classes share one log-odds score
+    std::vector<int> binary(y.size()), binary_valid(y_valid.size());
+    for (size_t i = 0; i < y.size(); ++i) {
+        binary[i] = y[i] == 9 ? 1 : 0;
+    }
+    for (size_t i = 0; i < y_valid.size(); ++i) {
+        binary_valid[i] = y_valid[i] == 9 ? 1 : 0;
+    }
+    GradientBoostingClassifier binary_model(60, 0.2, 3, 2, -1, 4);
+    binary_model.fit(X, binary);
+    assert(accuracy(binary_model.predict(X_valid), binary_valid) >= 0.95);
+    ml::Matrix binary_proba = binary_model.predict_proba(X_valid);
+    assert(binary_proba.cols() == 2);
+    for (size_t i = 0; i < binary_proba.rows(); ++i) {
+        assert(std::abs(binary_proba(i, 0) + binary_proba(i, 1) - 1.0) < 1e-12);
+    }
+
+    // A fixed seed grows the same trees on one thread and on a pool, with row and column sampling
+    ml::ThreadPool pool(4);
+    GradientBoostingClassifier serial(30, 0.2, 3, 2, 2, 8);
+    serial.set_subsample(0.6);
+    serial.fit(X, y);
+    GradientBoostingClassifier parallel(30, 0.2, 3, 2, 2, 8);
+    parallel.set_subsample(0.6);
+    parallel.set_thread_pool(&pool);
+    parallel.fit(X, y);
+    assert(parallel.predict(X_valid) == serial.predict(X_valid));
+    ml::Matrix serial_proba = serial.predict_proba(X_valid);
+    ml::Matrix parallel_proba = parallel.predict_proba(X_valid);
+    for (size_t i = 0; i < serial_proba.rows(); ++i) {
+        for (size_t k = 0; k < 3; ++k) {
+            assert(serial_proba(i, k) == parallel_proba(i, k));
+        }
+    }
+
+    // Noisy labels make the validation log-loss turn up, which stops the training
+    std::vector<int> noisy = binary;
+    std::mt19937 engine(1);
+    std::bernoulli_distribution flip(0.2);
+    for (int& label : noisy) {
+        label = flip(engine) ? 1 - label : label;
+    }
+    GradientBoostingClassifier stopped(1000, 0.1, 3, 2, -1, 1);
+    stopped.set_early_stopping(10, 0.25);
+    stopped.fit(X, noisy);
+    const std::vector<double>& losses = stopped.validation_loss();
+    assert(stopped.n_rounds() > 5 && stopped.n_rounds() < 1000);
+    assert(losses.size() == stopped.n_rounds() + 10);
+    std::cout << "Rounds kept with noisy labels: " << stopped.n_rounds() << std::endl;
+    assert(accuracy(stopped.predict(X_valid), binary_valid) >= 0.9);
+    // Fitting again starts over from the seed, including the hold-out split
+    std::vector<double> stopped_losses = losses;
+    stopped.fit(X, noisy);
+    assert(stopped.validation_loss() == stopped_losses);
+
+    bool threw = false;
+    try {
+        GradientBoostingClassifier single;
+        single.fit(X, std::vector<int>(X.rows(), 3));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    threw = false;
+    try {
+        GradientBoostingClassifier unknown_label(5);
+        unknown_label.fit(X, y, X_valid, std::vector<int>(X_valid.rows(), 100));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // With every label unique, the hold-out has no label left to validate on
+    threw = false;
+    try {
+        GradientBoostingClassifier rare_labels(5);
+        rare_labels.set_early_stopping(2, 0.5);
+        std::vector<int> unique_labels(X.rows());
+        std::iota(unique_labels.begin(), unique_labels.end(), 0);
+        rare_labels.fit(X, unique_labels);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Gradient Boosting Classifier Basic Test passed." << std::endl;
+    return 0;
+}
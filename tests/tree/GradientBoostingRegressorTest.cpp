@@ -0,0 +1,121 @@
+#include "../../ml_library_include/ml/tree/GradientBoostingRegressor.hpp"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+static double mean_squared_error(const std::vector<double>& predictions, const std::vector<double>& y) {
+    double error = 0.0;
+    for (size_t i = 0; i < y.size(); ++i) {
+        error += (predictions[i] - y[i]) * (predictions[i] - y[i]);
+    }
+    return error / y.size();
+}
+
+template <typename F>
+static bool throws_invalid_argument(F&& body) {
+    try {
+        body();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    // A smooth non-linear target of two features, with a little deterministic noise
+    auto make_data = [](size_t n, size_t offset, ml::Matrix& X, std::vector<double>& y) {
+        X = ml::Matrix(n, 3);
+        y.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            size_t k = i + offset;
+            X(i, 0) = static_cast<double>((k * 37) % 101) / 10.0;
+            X(i, 1) = std::sin(static_cast<double>(k)) * 3.0;
+            X(i, 2) = static_cast<double>(k % 7);
+            y[i] = std::sin(X(i, 0)) * 2.0 + X(i, 1) * X(i, 1) * 0.5 + 0.05 * std::cos(static_cast<double>(k * 13));
+        }
+    };
+    ml::Matrix X, X_valid;
+    std::vector<double> y, y_valid;
+    make_data(1200, 0, X, y);
+    make_data(400, 5000, X_valid, y_valid);
+
+    double mean = 0.0;
+    for (double value : y_valid) {
+        mean += value / y_valid.size();
+    }
+    std::vector<double> constant(y_valid.size(), mean);
+    double variance = mean_squared_error(constant, y_valid);
+
+    // Boosting fits the target far better than the mean, on unseen rows too
+    GradientBoostingRegressor model(200, 0.1, 3, 2, -1, 11);
+    model.fit(X, y);
+    assert(model.n_rounds() == 200);
+    std::vector<double> predictions = model.predict(X_valid);
+    double error = mean_squared_error(predictions, y_valid);
+    std::cout << "Validation MSE: " << error << " (variance " << variance << ")" << std::endl;
+    assert(error < 0.05 * variance);
+
+    // More rounds keep lowering the training error
+    GradientBoostingRegressor short_model(20, 0.1, 3, 2, -1, 11);
+    short_model.fit(X, y);
+    assert(mean_squared_error(model.predict(X), y) < mean_squared_error(short_model.predict(X), y));
+
+    // Every input form predicts the same
+    std::vector<std::vector<double>> rows;
+    for (size_t i = 0; i < X_valid.rows(); ++i) {
+        rows.emplace_back(X_valid.row(i), X_valid.row(i) + X_valid.cols());
+    }
+    assert(model.predict(rows) == predictions);
+
+    // A fixed seed grows the same trees on one thread and on a pool, with row and column sampling
+    ml::ThreadPool pool(4);
+    GradientBoostingRegressor serial(50, 0.2, 4, 2, 2, 5);
+    serial.set_subsample(0.7);
+    serial.fit(X, y);
+    GradientBoostingRegressor parallel(50, 0.2, 4, 2, 2, 5);
+    parallel.set_subsample(0.7);
+    parallel.set_thread_pool(&pool);
+    parallel.fit(X, y);
+    assert(parallel.predict(X_valid) == serial.predict(X_valid));
+    assert(mean_squared_error(serial.predict(X_valid), y_valid) < 0.1 * variance);
+
+    // Early stopping keeps the rounds up to the best validation error and stops a few rounds later
+    GradientBoostingRegressor stopped(2000, 0.5, 4, 2, -1, 3);
+    stopped.set_early_stopping(5);
+    stopped.fit(X, y, X_valid, y_valid);
+    const std::vector<double>& losses = stopped.validation_loss();
+    assert(stopped.n_rounds() < 2000);
+    assert(losses.size() == stopped.n_rounds() + 5);
+    assert(*std::min_element(losses.begin(), losses.end()) == losses[stopped.n_rounds() - 1]);
+    assert(std::abs(mean_squared_error(stopped.predict(X_valid), y_valid) - losses[stopped.n_rounds() - 1]) < 1e-9);
+
+    // Without a validation set, early stopping holds out part of the training rows
+    GradientBoostingRegressor held_out(2000, 0.5, 4, 2, -1, 3);
+    held_out.set_early_stopping(5, 0.2);
+    held_out.fit(X, y);
+    assert(held_out.n_rounds() < 2000 && !held_out.validation_loss().empty());
+    // Fitting again starts over from the seed, including the hold-out split
+    std::vector<double> held_out_losses = held_out.validation_loss();
+    held_out.fit(X, y);
+    assert(held_out.validation_loss() == held_out_losses);
+    serial.fit(X, y);
+    assert(serial.predict(X_valid) == parallel.predict(X_valid));
+
+    // A validation set without early stopping only records the error
+    GradientBoostingRegressor monitored(30, 0.1, 3, 2, -1, 3);
+    monitored.fit(X, y, X_valid, y_valid);
+    assert(monitored.n_rounds() == 30 && monitored.validation_loss().size() == 30);
+
+    assert(throws_invalid_argument([] { GradientBoostingRegressor(0); }));
+    assert(throws_invalid_argument([] { GradientBoostingRegressor(10, 0.0); }));
+    assert(throws_invalid_argument([&] { model.set_subsample(1.5); }));
+    assert(throws_invalid_argument([&] { model.set_max_bins(1); }));
+    assert(throws_invalid_argument([&] { model.set_early_stopping(0); }));
+    assert(throws_invalid_argument([&] { model.set_early_stopping(5, 1.0); }));
+
+    std::cout << "Gradient Boosting Regressor Basic Test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "../../ml_library_include/ml/tree/DecisionTreeClassifier.hpp"
+#include "../../ml_library_include/ml/tree/DecisionTreeRegressor.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestClassifier.hpp"
+#include "../../ml_library_include/ml/tree/RandomForestRegressor.hpp"
+#include "../../ml_library_include/ml/tree/TreeBuilder.hpp"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <cassert>
+
+int main() {
+    // Feature 0 has 40 distinct values, feature 1 has 2000
+    ml::Matrix X(2000, 2);
+    std::vector<int> labels(X.rows());
+    std::vector<double> targets(X.rows());
+    for (size_t i = 0; i < X.rows(); ++i) {
+        X(i, 0) = static_cast<double>((i * 7) % 40);
+        X(i, 1) = std::sin(static_cast<double>(i)) * 10.0;
+        labels[i] = (X(i, 0) < 15 ? 3 : 9) + (X(i, 1) > 2.0 ? 10 : 0);
+        targets[i] = X(i, 0) * 0.5 + (X(i, 1) > 2.0 ? 5.0 : 0.0);
+    }
+
+    {
+        ml::tree::BinnedMatrix binned(X, 16);
+        assert(binned.rows() == X.rows() && binned.cols() == 2);
+        assert(binned.bins(0) <= 16 && binned.bins(1) <= 16 && binned.bins(1) >= 8);
+        assert(binned.total_bins() == binned.bins(0) + binned.bins(1));
+        // Bins follow the order of the values and agree with the thresholds
+        for (size_t col = 0; col < 2; ++col) {
+            for (size_t i = 0; i < X.rows(); ++i) {
+                size_t bin = binned.column(col)[i];
+                assert(bin == binned.bins(col) - 1 || X(i, col) <= binned.threshold(col, bin));
+                assert(bin == 0 || X(i, col) > binned.threshold(col, bin - 1));
+            }
+        }
+        // Few distinct values get a bin each
+        ml::tree::BinnedMatrix exact(X, 256);
+        assert(exact.bins(0) == 40);
+        bool threw = false;
+        try {
+            ml::tree::BinnedMatrix invalid(X, 257);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    {
+        DecisionTreeClassifier model(6, 2);
+        model.set_max_bins(64);
+        model.fit(X, labels);
+        std::vector<int> predictions = model.predict(X);
+        size_t correct = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            correct += predictions[i] == labels[i];
+        }
+        assert(correct > X.rows() * 95 / 100);
+
+        bool threw = false;
+        try {
+            model.set_max_bins(1);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    {
+        // With one bin per distinct value the histogram tree matches the exact one
+        ml::Matrix X_small(200, 1);
+        std::vector<double> y_small(X_small.rows());
+        for (size_t i = 0; i < X_small.rows(); ++i) {
+            X_small(i, 0) = static_cast<double>(i % 25);
+            y_small[i] = (i % 25) < 10 ? 1.0 : std::sqrt(static_cast<double>(i % 25));
+        }
+        DecisionTreeRegressor exact(4, 2);
+        exact.fit(X_small, y_small);
+        DecisionTreeRegressor histogram(4, 2);
+        histogram.set_max_bins(256);
+        histogram.fit(X_small, y_small);
+        std::vector<double> expected = exact.predict(X_small);
+        std::vector<double> predictions = histogram.predict(X_small);
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            assert(std::abs(predictions[i] - expected[i]) < 1e-9);
+        }
+    }
+    {
+        DecisionTreeRegressor model(8, 2);
+        model.set_max_bins(32);
+        model.fit(X, targets);
+        std::vector<double> predictions = model.predict(X);
+        double mae = 0.0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            mae += std::abs(predictions[i] - targets[i]);
+        }
+        assert(mae / predictions.size() < 0.5);
+    }
+    {
+        RandomForestClassifier model(10, 6, 2, 2);
+        model.set_max_bins(64);
+        model.fit(X, labels);
+        std::vector<int> predictions = model.predict(X);
+        size_t correct = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            correct += predictions[i] == labels[i];
+        }
+        assert(correct > X.rows() * 95 / 100);
+    }
+    {
+        RandomForestRegressor model(10, 8, 2, 2);
+        model.set_max_bins(32);
+        model.fit(X, targets);
+        std::vector<double> predictions = model.predict(X);
+        double mae = 0.0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            mae += std::abs(predictions[i] - targets[i]);
+        }
+        assert(mae / predictions.size() < 0.5);
+    }
+
+    std::cout << "Histogram Tree Basic Test passed." << std::endl;
+    return 0;
+}
@@ -44,6 +44,62 @@ int main() {
     // Assert that accuracy is within acceptable range
     assert(accuracy >= 0.9 && "Accuracy is below acceptable threshold.");
 
+    // Batched prediction over several blocks of rows agrees with scoring one row at a time
+    std::vector<std::vector<double>> X_large;
+    for (int i = 0; i < 150; ++i) {
+        X_large.push_back({1.5 + (i % 17) * 0.55, 0.3 + (i % 11) * 0.3});
+    }
+    std::vector<int> row_predictions = model.predict(X_large);
+    std::vector<int> batch_predictions = model.predict(ml::Matrix(X_large));
+    assert(batch_predictions == row_predictions);
+
+    // A fixed seed grows the same forest on one thread and on a pool
+    RandomForestClassifier serial(25, 5, 2, -1, 42);
+    serial.fit(X, y);
+    ml::ThreadPool pool(4);
+    RandomForestClassifier parallel(25, 5, 2, -1, 42);
+    parallel.set_thread_pool(&pool);
+    parallel.fit(X, y);
+    assert(parallel.predict(X_large) == serial.predict(X_large));
+    // Fitting again starts over from the seed
+    serial.fit(X, y);
+    assert(serial.predict(X_large) == parallel.predict(X_large));
+
+    // Out-of-bag scoring reports the same scores in the same order on one thread and on a pool
+    std::vector<int> y_large;
+    for (const auto& x : X_large) {
+        y_large.push_back(x[0] + x[1] > 6.0 ? 1 : 0);
+    }
+    std::vector<double> serial_scores, parallel_scores;
+    serial.set_oob_score(true, [&](size_t, double accuracy) { serial_scores.push_back(accuracy); return true; });
+    serial.fit(X_large, y_large);
+    parallel.set_oob_score(true, [&](size_t, double accuracy) { parallel_scores.push_back(accuracy); return true; });
+    parallel.fit(X_large, y_large);
+    assert(serial_scores.size() == 25 && serial_scores == parallel_scores);
+    assert(serial.oob_accuracy() == serial_scores.back());
+    assert(serial.oob_accuracy() >= 0.9);
+    assert(serial.oob_predictions().size() == X_large.size());
+    assert(serial.oob_predictions() == parallel.oob_predictions());
+
+    // The monitor can stop the forest early; the trees grown so far are kept
+    RandomForestClassifier stopped(25, 5, 2, -1, 7);
+    stopped.set_thread_pool(&pool);
+    stopped.set_oob_score(true, [](size_t n_trees, double) { return n_trees < 5; });
+    stopped.fit(X_large, y_large);
+    RandomForestClassifier first_five(5, 5, 2, -1, 7);
+    first_five.fit(X_large, y_large);
+    assert(stopped.predict(X_large) == first_five.predict(X_large));
+
+    // Extremely randomized trees, exact and on histograms, still separate the classes
+    for (int bins : {0, 32}) {
+        RandomForestClassifier extra(25, 8, 2, -1, 3);
+        extra.set_extra_trees(true);
+        extra.set_max_bins(bins);
+        extra.set_oob_score(true);
+        extra.fit(X_large, y_large);
+        assert(extra.oob_accuracy() >= 0.85);
+    }
+
     std::cout << "Random Forest Classification Basic Test passed." << std::endl;
     return 0;
 }
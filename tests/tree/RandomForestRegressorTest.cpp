@@ -33,6 +33,74 @@ int main() {
     // Assert that MAE is within tolerance
     assert(mae < 0.5 && "Mean absolute error exceeds tolerance.");
 
+    // Batched prediction over several blocks of rows agrees with scoring one row at a time
+    std::vector<std::vector<double>> X_large;
+    for (int i = 0; i < 150; ++i) {
+        X_large.push_back({4.8 + (i % 17) * 0.09, 2.9 + (i % 7) * 0.1, 1.2 + (i % 13) * 0.35});
+    }
+    std::vector<double> row_predictions = model.predict(X_large);
+    std::vector<double> batch_predictions = model.predict(ml::Matrix(X_large));
+    for (size_t i = 0; i < row_predictions.size(); ++i) {
+        assert(std::fabs(batch_predictions[i] - row_predictions[i]) < 1e-12);
+    }
+
+    // A fixed seed grows the same forest on one thread and on a pool
+    RandomForestRegressor serial(25, 5, 2, -1, 42);
+    serial.fit(X, y);
+    ml::ThreadPool pool(4);
+    RandomForestRegressor parallel(25, 5, 2, -1, 42);
+    parallel.set_thread_pool(&pool);
+    parallel.fit(X, y);
+    assert(parallel.predict(X_large) == serial.predict(X_large));
+    // Fitting again starts over from the seed
+    serial.fit(X, y);
+    assert(serial.predict(X_large) == parallel.predict(X_large));
+
+    // Out-of-bag scoring reports the same scores in the same order on one thread and on a pool
+    std::vector<double> y_large;
+    for (const auto& x : X_large) {
+        y_large.push_back(x[0] + 0.5 * x[2]);
+    }
+    double y_mean = 0.0, y_variance = 0.0;
+    for (double v : y_large) y_mean += v / y_large.size();
+    for (double v : y_large) y_variance += (v - y_mean) * (v - y_mean) / y_large.size();
+    std::vector<double> serial_scores, parallel_scores;
+    serial.set_oob_score(true, [&](size_t, double mse) { serial_scores.push_back(mse); return true; });
+    serial.fit(X_large, y_large);
+    parallel.set_oob_score(true, [&](size_t, double mse) { parallel_scores.push_back(mse); return true; });
+    parallel.fit(X_large, y_large);
+    assert(serial_scores.size() == 25 && parallel_scores.size() == 25);
+    for (size_t i = 0; i < serial_scores.size(); ++i) {
+        assert(std::fabs(serial_scores[i] - parallel_scores[i]) < 1e-9);
+    }
+    assert(std::fabs(serial.oob_mse() - serial_scores.back()) < 1e-9);
+    assert(serial.oob_mse() < 0.25 * y_variance);
+    assert(serial.oob_predictions().size() == X_large.size());
+    assert(serial.oob_predictions() == parallel.oob_predictions());
+
+    // The monitor can stop the forest early; the trees grown so far are kept
+    RandomForestRegressor stopped(25, 5, 2, -1, 7);
+    stopped.set_thread_pool(&pool);
+    stopped.set_oob_score(true, [](size_t n_trees, double) { return n_trees < 5; });
+    stopped.fit(X_large, y_large);
+    RandomForestRegressor first_five(5, 5, 2, -1, 7);
+    first_five.fit(X_large, y_large);
+    std::vector<double> stopped_predictions = stopped.predict(X_large);
+    std::vector<double> first_five_predictions = first_five.predict(X_large);
+    for (size_t i = 0; i < stopped_predictions.size(); ++i) {
+        assert(std::fabs(stopped_predictions[i] - first_five_predictions[i]) < 1e-12);
+    }
+
+    // Extremely randomized trees, exact and on histograms, still fit the targets
+    for (int bins : {0, 32}) {
+        RandomForestRegressor extra(25, 8, 2, -1, 3);
+        extra.set_extra_trees(true);
+        extra.set_max_bins(bins);
+        extra.set_oob_score(true);
+        extra.fit(X_large, y_large);
+        assert(extra.oob_mse() < 0.25 * y_variance);
+    }
+
     std::cout << "Random Forest Regression Basic Test passed." << std::endl;
     return 0;
 }